@@ -33,6 +33,10 @@ struct circ_queue {
 
 	/* head == tail: empty.
 	 * head == tail-1: full.
+	 *
+	 * Each index is only stored by its own side.  Stores are releases
+	 * and loads of the other side's index are acquires, so that element
+	 * contents are visible before the index that hands them over.
 	 */
 
 	/* This is declared as a uint32_t for alignment reasons. */
@@ -85,7 +89,7 @@ void *circ_queue_write_pos(circ_queue_t q, uint16_t *contig,
 		uint16_t *avail) {
 	void *contents = q->contents;
 	uint16_t wr_head = q->write_head;
-	uint16_t rd_tail = q->read_tail;
+	uint16_t rd_tail = __atomic_load_n(&q->read_tail, __ATOMIC_ACQUIRE);
 
 	if (contig) {
 		if (rd_tail <= wr_head) {
@@ -164,7 +168,7 @@ int circ_queue_advance_write_multi(circ_queue_t q, uint16_t amt) {
 	PIOS_Assert((new_write_head > orig_wr_head) || (new_write_head == 0));
 
 	/* the head is not allowed to advance to meet the tail */
-	if (new_write_head == q->read_tail) {
+	if (new_write_head == __atomic_load_n(&q->read_tail, __ATOMIC_ACQUIRE)) {
 		/* This is only sane if they're trying to return one, like
 		 * advance_write does */
 		PIOS_Assert(amt == 1);
@@ -175,7 +179,7 @@ int circ_queue_advance_write_multi(circ_queue_t q, uint16_t amt) {
 		 * advance later. */
 	}
 
-	q->write_head = new_write_head;
+	__atomic_store_n(&q->write_head, new_write_head, __ATOMIC_RELEASE);
 
 	return 0;
 }
@@ -207,7 +211,7 @@ int circ_queue_advance_write(circ_queue_t q) {
  */
 void *circ_queue_read_pos(circ_queue_t q, uint16_t *contig, uint16_t *avail) {
 	uint16_t read_tail = q->read_tail;
-	uint16_t wr_head = q->write_head;
+	uint16_t wr_head = __atomic_load_n(&q->write_head, __ATOMIC_ACQUIRE);
 
 	void *contents = q->contents;
 
@@ -239,12 +243,14 @@ void *circ_queue_read_pos(circ_queue_t q, uint16_t *contig, uint16_t *avail) {
 		return NULL;
 	}
 
-	return contents + q->read_tail * q->elem_size;
+	return contents + read_tail * q->elem_size;
 }
 
 /** Empties all elements from the queue. */
 void circ_queue_clear(circ_queue_t q) {
-	q->read_tail = q->write_head;
+	__atomic_store_n(&q->read_tail,
+			__atomic_load_n(&q->write_head, __ATOMIC_ACQUIRE),
+			__ATOMIC_RELEASE);
 }
 
 /** Releases an element of read data obtained by circ_queue_read_pos.
@@ -263,7 +269,8 @@ void circ_queue_read_completed(circ_queue_t q) {
 	 */
 	PIOS_Assert(read_tail != q->write_head);
 
-	q->read_tail = next_pos(q->num_elem, read_tail);
+	__atomic_store_n(&q->read_tail, next_pos(q->num_elem, read_tail),
+			__ATOMIC_RELEASE);
 }
 
 /** Releases multiple elements of read data obtained by circ_queue_read_pos.
@@ -296,7 +303,7 @@ void circ_queue_read_completed_multi(circ_queue_t q, uint16_t num) {
 
 	PIOS_Assert((read_tail > orig_read_tail) || (read_tail == 0));
 
-	q->read_tail = read_tail;
+	__atomic_store_n(&q->read_tail, read_tail, __ATOMIC_RELEASE);
 }
 
 uint16_t circ_queue_write_data(circ_queue_t q, const void *buf, uint16_t num) {
@@ -37,11 +37,13 @@
 #include "pios_queue.h"
 #include "pios_mutex.h"
 #include "uavobjectmanager.h"
+#include "uavobjectsinit.h"
 #include "misc_math.h"
 #include "timeutils.h"
 #include "uavobjectmanager.h"
 
 #include "pios_streamfs.h"
+#include "pios_crc.h"
 #include <pios_board_info.h>
 
 #include "accels.h"
@@ -57,6 +59,7 @@
 #include "gpssatellites.h"
 #include "gyros.h"
 #include "loggingsettings.h"
+#include "loggingsector.h"
 #include "loggingstats.h"
 #include "magnetometer.h"
 #include "manualcontrolcommand.h"
@@ -81,8 +84,89 @@ const char DIGITS[16] = "0123456789abcdef";
 
 #define LOGGING_PERIOD_MS 100
 
+// Number of sectors that may be in flight during a log download
+#ifndef LOGGING_DOWNLOAD_WINDOW
+#define LOGGING_DOWNLOAD_WINDOW 8
+#endif
+
+#if LOGGING_DOWNLOAD_WINDOW > 32
+#error "LoggingStats.FileSectorResend only covers 32 sectors"
+#endif
+
+/*
+ * Compact log format, written instead of UAVTalk when LoggingSettings.Format
+ * is Compact or CompactDelta.  The usual header (with its own first line) is
+ * followed by one record per logged update:
+ *
+ *   varint key     code << 1, with bit 0 set for a delta payload
+ *   definition     only when the code is 0: varint code being defined (0
+ *                  for a one-off), uint32 object id, varint instance id
+ *                  and varint data length
+ *   varint dt      milliseconds since the previous record
+ *   payload        the object data, or for a delta a varint length followed
+ *                  by (offset, length, bytes) runs to overwrite in the data
+ *                  last logged under the code
+ *
+ * Varints are little-endian base 128.
+ *
+ * The records are grouped into blocks, so that a reader that loses part of
+ * the log (a flash write that failed, say) can pick up again at the next one:
+ *
+ *   sync           LOGGING_COMPACT_SYNC
+ *   uint32 time    milliseconds at the start of the block
+ *   records        the first dt counts from the block time
+ *   varint key 1   end of the block
+ *   uint16 crc     CRC-16-CCITT of the block from the sync through the key
+ *
+ * Blocks stand alone: a code is defined by the first record of its object
+ * instance in each block, and deltas never reach back past the block start.
+ */
+#define LOGGING_COMPACT_SIGNATURE "dRonin compact log:\n"
+
+static const uint8_t LOGGING_COMPACT_SYNC[4] = { 0xd5, 0x1c, 0xb7, 0x3a };
+
+#define LOGGING_COMPACT_END_KEY 1
+
+// A new block, redefining every code, is started this often
+#ifndef LOGGING_COMPACT_BLOCK_MS
+#define LOGGING_COMPACT_BLOCK_MS 1000
+#endif
+
+// Object instances given codes; any more are logged with one-off definitions
+#ifndef LOGGING_COMPACT_CODES
+#define LOGGING_COMPACT_CODES 64
+#endif
+
+#define LOGGING_VARINT_MAX 5
+#define LOGGING_COMPACT_MAX_RECORD (UAVOBJECTS_LARGEST + 5 * LOGGING_VARINT_MAX + 4)
+
+// What the same update costs as a timestamped UAVTalk packet, less the data
+#define LOGGING_UAVTALK_OVERHEAD (8 + 2 + 1)
+
 // Private types
 
+//! An object instance with a code in the compact format
+struct compact_entry {
+	UAVObjHandle obj;
+	uint16_t inst_id;
+	bool defined;   //!< The current file has the definition
+	uint8_t *last;  //!< Data last logged, for deltas (CompactDelta only)
+};
+
+//! Compact format encoder, allocated the first time it is used
+struct compact_state {
+	struct pios_mutex *lock;
+	bool block_open;       //!< The current file has a block started
+	uint32_t block_time;   //!< When the block was started
+	uint16_t block_crc;    //!< CRC of the block so far
+	uint32_t last_time;
+	uint8_t num_entries;
+	struct compact_entry entries[LOGGING_COMPACT_CODES];
+	uint8_t data[UAVOBJECTS_LARGEST];
+	uint8_t runs[UAVOBJECTS_LARGEST];
+	uint8_t record[LOGGING_COMPACT_MAX_RECORD];
+};
+
 // Private variables
 static UAVTalkConnection uavTalkCon;
 static struct pios_thread *loggingTaskHandle;
@@ -100,13 +184,26 @@ static void register_object(UAVObjHandle obj);
 static void register_default_profile();
 static void logAll(UAVObjHandle obj);
 static void logSettings(UAVObjHandle obj);
+static void logObject(UAVObjHandle obj, uint16_t inst_id, bool assign_code);
+static bool compactStartFile();
+static void compactEndFile();
+static void compactLogObject(UAVObjHandle obj, uint16_t inst_id, bool assign_code);
 static void writeHeader();
 static void updateSettings();
+static void updateWriteStats();
+#ifdef PIOS_INCLUDE_LOG_TO_FLASH
+static int32_t download_open(uint16_t file_id, uint8_t request_seq);
+static int32_t download_step(const LoggingStatsData *stats);
+#endif
 
 // Local variables
 static uintptr_t logging_com_id;
 static uint32_t written_bytes;
+static uint32_t dropped_bytes;
+static uint32_t saved_bytes;
 static bool destination_onboard_flash;
+static uint8_t log_format;
+static struct compact_state *compact;
 
 #ifdef PIOS_INCLUDE_LOG_TO_FLASH
 static const struct streamfs_cfg streamfs_settings = {
@@ -114,6 +211,16 @@ static const struct streamfs_cfg streamfs_settings = {
 	.arena_size    = PIOS_LOGFLASH_SECT_SIZE,
 	.write_size    = 0x00000100, /* 256 bytes */
 };
+
+//! Progress of the log file being downloaded
+static struct {
+	uint16_t file_id;
+	uint32_t base;        //!< Oldest sector the GCS has not acknowledged
+	uint32_t next;        //!< Next sector to read from flash
+	uint32_t last;        //!< Final (short) sector, once eof is set
+	uint8_t request_seq;  //!< Last FileRequestSeq acted on
+	bool eof;
+} download;
 #endif
 
 /**
@@ -180,6 +287,23 @@ int32_t LoggingInitialize(void)
 		return -1;
 	}
 
+#ifdef PIOS_INCLUDE_LOG_TO_FLASH
+	if (destination_onboard_flash) {
+		// Each instance holds one sector of the download window
+		if (LoggingSectorInitialize() == -1) {
+			module_enabled = false;
+			return -1;
+		}
+
+		while (LoggingSectorGetNumInstances() < LOGGING_DOWNLOAD_WINDOW) {
+			if (LoggingSectorCreateInstance() == 0) {
+				module_enabled = false;
+				return -1;
+			}
+		}
+	}
+#endif
+
 	// Initialise UAVTalk
 	uavTalkCon = UAVTalkInitialize(&send_data_nonblock);
 	if (uavTalkCon == 0) {
@@ -220,8 +344,6 @@ static void loggingTask(void *parameters)
 #ifdef PIOS_INCLUDE_LOG_TO_FLASH
 	bool write_open = false;
 	bool read_open = false;
-	int32_t read_sector = 0;
-	uint8_t read_data[LOGGINGSTATS_FILESECTOR_NUMELEM];
 #endif
 
 	// Get settings automatically for now on
@@ -234,6 +356,7 @@ static void loggingTask(void *parameters)
 	if (destination_onboard_flash) {
 		loggingData.MinFileId = PIOS_STREAMFS_MinFileId(logging_com_id);
 		loggingData.MaxFileId = PIOS_STREAMFS_MaxFileId(logging_com_id);
+		loggingData.FileSectorWindow = LOGGING_DOWNLOAD_WINDOW;
 	}
 #endif
 
@@ -294,6 +417,15 @@ static void loggingTask(void *parameters)
 		case LOGGINGSTATS_OPERATION_INITIALIZING:
 			// Unregister all objects
 			UAVObjIterate(&unregister_object);
+
+			// The format can't change partway through a file.  Only logs
+			// downloaded from onboard flash get converted back to UAVTalk
+			// by the GCS, so anything else is always written as UAVTalk.
+			log_format = settings.Format;
+			if (!destination_onboard_flash ||
+					(log_format != LOGGINGSETTINGS_FORMAT_UAVTALK && !compactStartFile())) {
+				log_format = LOGGINGSETTINGS_FORMAT_UAVTALK;
+			}
 #ifdef PIOS_INCLUDE_LOG_TO_FLASH
 			if (destination_onboard_flash){
 				// Close the file if it is open for reading
@@ -343,7 +475,7 @@ static void loggingTask(void *parameters)
 			}
 
 			// Empty the queue
-			LoggingStatsBytesLoggedSet(&written_bytes);
+			updateWriteStats();
 			loggingData.Operation = LOGGINGSTATS_OPERATION_LOGGING;
 			LoggingStatsSet(&loggingData);
 			break;
@@ -352,7 +484,7 @@ static void loggingTask(void *parameters)
 				// Sleep between updating stats.
 				PIOS_Thread_Sleep_Until(&now, LOGGING_PERIOD_MS);
 
-				LoggingStatsBytesLoggedSet(&written_bytes);
+				updateWriteStats();
 
 				now = PIOS_Thread_Systime();
 			}
@@ -360,47 +492,37 @@ static void loggingTask(void *parameters)
 		case LOGGINGSTATS_OPERATION_DOWNLOAD:
 #ifdef PIOS_INCLUDE_LOG_TO_FLASH
 			if (destination_onboard_flash) {
+				if (read_open && (loggingData.FileRequest != download.file_id ||
+						loggingData.FileSectorNum < download.base)) {
+					// The GCS started over or asked for another file
+					PIOS_STREAMFS_Close(logging_com_id);
+					read_open = false;
+				}
 				if (!read_open) {
 					// Start reading
-					if (PIOS_STREAMFS_OpenRead(logging_com_id, loggingData.FileRequest) != 0) {
+					if (download_open(loggingData.FileRequest, loggingData.FileRequestSeq) != 0) {
 						loggingData.Operation = LOGGINGSTATS_OPERATION_ERROR;
+						LoggingStatsSet(&loggingData);
 					} else {
 						read_open = true;
-						read_sector = -1;
 					}
 				}
-				if (read_open && read_sector == loggingData.FileSectorNum) {
-					// Request received for same sector. Reupdate.
-					memcpy(loggingData.FileSector, read_data, LOGGINGSTATS_FILESECTOR_NUMELEM);
-					loggingData.Operation = LOGGINGSTATS_OPERATION_IDLE;
-
-				} else if (read_open && (read_sector + 1) == loggingData.FileSectorNum) {
-					int32_t bytes_read = PIOS_STREAMFS_Read(logging_com_id, loggingData.FileSector, LOGGINGSTATS_FILESECTOR_NUMELEM);
-					if (bytes_read < 0) {
-						// close on error
-						loggingData.Operation = LOGGINGSTATS_OPERATION_ERROR;
-						loggingData.FileSectorNum = 0xffff;
-						PIOS_STREAMFS_Close(logging_com_id);
-						read_open = false;
-					} else {
-						// Indicate sent
-						loggingData.Operation = LOGGINGSTATS_OPERATION_IDLE;
-
-						if (bytes_read < LOGGINGSTATS_FILESECTOR_NUMELEM) {
+				if (read_open) {
+					int32_t ret = download_step(&loggingData);
+					if (ret != 0) {
+						if (ret < 0) {
+							// close on error
+							loggingData.Operation = LOGGINGSTATS_OPERATION_ERROR;
+							loggingData.FileSectorNum = 0xffffffff;
+						} else {
 							// indicate end of file
 							loggingData.Operation = LOGGINGSTATS_OPERATION_COMPLETE;
-							PIOS_STREAMFS_Close(logging_com_id);
-							read_open = false;
 						}
-
+						PIOS_STREAMFS_Close(logging_com_id);
+						read_open = false;
+						LoggingStatsSet(&loggingData);
 					}
 				}
-				LoggingStatsSet(&loggingData);
-
-				// Store the data in case it's needed again /
-				// lost over telemetry link
-				memcpy(read_data, loggingData.FileSector, LOGGINGSTATS_FILESECTOR_NUMELEM);
-				read_sector = loggingData.FileSectorNum;
 			}
 #endif /* PIOS_INCLUDE_LOG_TO_FLASH */
 
@@ -412,6 +534,9 @@ static void loggingTask(void *parameters)
 			if (destination_onboard_flash) {
 				// Close the file if necessary
 				if (write_open) {
+					if (log_format != LOGGINGSETTINGS_FORMAT_UAVTALK) {
+						compactEndFile();
+					}
 					PIOS_STREAMFS_Close(logging_com_id);
 					loggingData.MinFileId = PIOS_STREAMFS_MinFileId(logging_com_id);
 					loggingData.MaxFileId = PIOS_STREAMFS_MaxFileId(logging_com_id);
@@ -424,13 +549,37 @@ static void loggingTask(void *parameters)
 	}
 }
 
+/**
+ * Update the bytes logged and dropped, and how long the flash takes to write
+ */
+static void updateWriteStats()
+{
+	uint32_t dropped = dropped_bytes;
+	uint32_t latency[LOGGINGSTATS_WRITELATENCY_NUMELEM] = { 0 };
+
+#ifdef PIOS_INCLUDE_LOG_TO_FLASH
+	struct pios_streamfs_stats stats;
+	if (destination_onboard_flash &&
+			PIOS_STREAMFS_GetStats(logging_com_id, &stats) == 0) {
+		dropped += stats.bytes_dropped;
+		latency[LOGGINGSTATS_WRITELATENCY_AVERAGE] = stats.write_latency_avg_us;
+		latency[LOGGINGSTATS_WRITELATENCY_MAX] = stats.write_latency_max_us;
+	}
+#endif /* PIOS_INCLUDE_LOG_TO_FLASH */
+
+	LoggingStatsBytesLoggedSet(&written_bytes);
+	LoggingStatsBytesDroppedSet(&dropped);
+	LoggingStatsBytesSavedSet(&saved_bytes);
+	LoggingStatsWriteLatencySet(latency);
+}
+
 /**
  * Log all objects' initial value.
  * \param[in] obj Object to log
 */
 static void logAll(UAVObjHandle obj)
 {
-	UAVTalkSendObjectTimestamped(uavTalkCon, obj, 0, false, 0);
+	logObject(obj, 0, false);
 }
 
  /**
@@ -440,8 +589,274 @@ static void logAll(UAVObjHandle obj)
 static void logSettings(UAVObjHandle obj)
 {
 	if (UAVObjIsSettings(obj)) {
-		UAVTalkSendObjectTimestamped(uavTalkCon, obj, 0, false, 0);
+		logObject(obj, 0, false);
+	}
+}
+
+/**
+ * Log an object instance in the format chosen for this file
+ * \param[in] obj Object to log
+ * \param[in] inst_id Instance to log
+ * \param[in] assign_code Whether the object is logged often enough to be
+ * worth a code of its own in the compact format
+ */
+static void logObject(UAVObjHandle obj, uint16_t inst_id, bool assign_code)
+{
+	if (log_format == LOGGINGSETTINGS_FORMAT_UAVTALK) {
+		UAVTalkSendObjectTimestamped(uavTalkCon, obj, inst_id, false, 0);
+	} else {
+		compactLogObject(obj, inst_id, assign_code);
+	}
+}
+
+/**
+ * Write a varint (little-endian base 128)
+ * \param[out] buf Where to write it, with room for LOGGING_VARINT_MAX bytes
+ * \param[in] value Value to write
+ * \return number of bytes written
+ */
+static uint32_t putVarint(uint8_t *buf, uint32_t value)
+{
+	uint32_t len = 0;
+
+	while (value >= 0x80) {
+		buf[len++] = (value & 0x7f) | 0x80;
+		value >>= 7;
+	}
+	buf[len++] = value;
+
+	return len;
+}
+
+/**
+ * Start a new file in the compact format, allocating the encoder the first
+ * time.  Entries keep their codes from file to file, as the heap can't give
+ * back their copies of the data, but each block defines them again.
+ * \return false if the encoder could not be allocated
+ */
+static bool compactStartFile()
+{
+	if (!compact) {
+		struct compact_state *state = PIOS_malloc_no_dma(sizeof(*state));
+		if (!state) {
+			return false;
+		}
+
+		memset(state, 0, sizeof(*state));
+
+		state->lock = PIOS_Mutex_Create();
+		if (!state->lock) {
+			PIOS_free(state);
+			return false;
+		}
+
+		compact = state;
+	}
+
+	PIOS_Mutex_Lock(compact->lock, PIOS_MUTEX_TIMEOUT_MAX);
+	compact->block_open = false;
+	PIOS_Mutex_Unlock(compact->lock);
+
+	return true;
+}
+
+/**
+ * Start a block, which forgets every definition.  Call with the lock held.
+ * \param[in] now Time of the block
+ * \return false if the block header could not be sent
+ */
+static bool compactStartBlock(uint32_t now)
+{
+	uint8_t header[sizeof(LOGGING_COMPACT_SYNC) + 4];
+
+	memcpy(header, LOGGING_COMPACT_SYNC, sizeof(LOGGING_COMPACT_SYNC));
+	header[4] = now & 0xff;
+	header[5] = (now >> 8) & 0xff;
+	header[6] = (now >> 16) & 0xff;
+	header[7] = (now >> 24) & 0xff;
+
+	if (send_data_nonblock(header, sizeof(header)) < 0) {
+		return false;
+	}
+
+	for (uint32_t i = 0; i < compact->num_entries; i++) {
+		compact->entries[i].defined = false;
+	}
+
+	compact->block_open = true;
+	compact->block_time = now;
+	compact->block_crc = PIOS_CRC16_CCITT_updateCRC(0, header, sizeof(header));
+	compact->last_time = now;
+
+	return true;
+}
+
+/**
+ * End the open block with its CRC.  Call with the lock held.
+ * \return false if the end of the block could not be sent
+ */
+static bool compactEndBlock()
+{
+	uint8_t trailer[3] = { LOGGING_COMPACT_END_KEY };
+	uint16_t crc = PIOS_CRC16_CCITT_updateCRC(compact->block_crc, trailer, 1);
+
+	trailer[1] = crc & 0xff;
+	trailer[2] = crc >> 8;
+
+	if (send_data_nonblock(trailer, sizeof(trailer)) < 0) {
+		return false;
+	}
+
+	compact->block_open = false;
+
+	return true;
+}
+
+/**
+ * End the last block of a file in the compact format, so that it can be
+ * checked like the others
+ */
+static void compactEndFile()
+{
+	if (!compact) {
+		return;
+	}
+
+	PIOS_Mutex_Lock(compact->lock, PIOS_MUTEX_TIMEOUT_MAX);
+
+	if (compact->block_open) {
+		compactEndBlock();
+	}
+
+	PIOS_Mutex_Unlock(compact->lock);
+}
+
+/**
+ * Find the entry of an object instance, giving it a code if it has none
+ * \param[in] obj Object to find
+ * \param[in] inst_id Instance to find
+ * \param[in] assign Whether to give it a code if it has none
+ * \return the entry, or NULL if it has none and can't or shouldn't get one
+ */
+static struct compact_entry *compactFindEntry(UAVObjHandle obj, uint16_t inst_id, bool assign)
+{
+	for (uint32_t i = 0; i < compact->num_entries; i++) {
+		if (compact->entries[i].obj == obj && compact->entries[i].inst_id == inst_id) {
+			return &compact->entries[i];
+		}
+	}
+
+	if (!assign || compact->num_entries >= LOGGING_COMPACT_CODES) {
+		return NULL;
+	}
+
+	struct compact_entry *entry = &compact->entries[compact->num_entries++];
+	entry->obj = obj;
+	entry->inst_id = inst_id;
+	entry->defined = false;
+	entry->last = NULL;
+
+	return entry;
+}
+
+/**
+ * Log an object instance in the compact format.  Nothing about the encoder
+ * changes unless the whole record is sent, so a dropped record doesn't
+ * leave the reader out of step; a block that is damaged after it was sent
+ * fails its CRC and the reader moves on to the next.
+ * \param[in] obj Object to log
+ * \param[in] inst_id Instance to log
+ * \param[in] assign_code Whether to give the object a code if it has none
+ */
+static void compactLogObject(UAVObjHandle obj, uint16_t inst_id, bool assign_code)
+{
+	uint32_t length = UAVObjGetNumBytes(obj);
+
+	if (length > UAVOBJECTS_LARGEST) {
+		return;
+	}
+
+	PIOS_Mutex_Lock(compact->lock, PIOS_MUTEX_TIMEOUT_MAX);
+
+	if (UAVObjGetInstanceData(obj, inst_id, compact->data) < 0) {
+		goto out_unlock;
+	}
+
+	uint32_t now = PIOS_Thread_Systime();
+
+	if (compact->block_open && now - compact->block_time >= LOGGING_COMPACT_BLOCK_MS &&
+			!compactEndBlock()) {
+		goto out_unlock;
+	}
+
+	if (!compact->block_open && !compactStartBlock(now)) {
+		goto out_unlock;
+	}
+
+	struct compact_entry *entry = compactFindEntry(obj, inst_id, assign_code);
+	uint32_t code = entry ? (entry - compact->entries) + 1 : 0;
+	bool defined = entry && entry->defined;
+	int32_t runs_length = -1;
+
+	// Deltas only pay off when the runs and their length come in shorter
+	if (defined && entry->last && length <= UAVTALK_DELTA_MAX_RUN + 1) {
+		runs_length = UAVTalkEncodeDelta(entry->last, compact->data, length,
+				compact->runs, (int32_t) length - 3);
+	} else if (entry && !defined && !entry->last &&
+			log_format == LOGGINGSETTINGS_FORMAT_COMPACTDELTA) {
+		entry->last = PIOS_malloc_no_dma(length);
+	}
+
+	uint8_t *record = compact->record;
+	uint32_t pos = 0;
+
+	pos += putVarint(&record[pos], (defined ? code << 1 : 0) | (runs_length >= 0));
+
+	if (!defined) {
+		uint32_t obj_id = UAVObjGetID(obj);
+
+		pos += putVarint(&record[pos], code);
+		record[pos++] = obj_id & 0xff;
+		record[pos++] = (obj_id >> 8) & 0xff;
+		record[pos++] = (obj_id >> 16) & 0xff;
+		record[pos++] = (obj_id >> 24) & 0xff;
+		pos += putVarint(&record[pos], inst_id);
+		pos += putVarint(&record[pos], length);
+	}
+
+	pos += putVarint(&record[pos], now - compact->last_time);
+
+	if (runs_length >= 0) {
+		pos += putVarint(&record[pos], runs_length);
+		memcpy(&record[pos], compact->runs, runs_length);
+		pos += runs_length;
+	} else {
+		memcpy(&record[pos], compact->data, length);
+		pos += length;
+	}
+
+	if (send_data_nonblock(record, pos) < 0) {
+		goto out_unlock;
+	}
+
+	compact->block_crc = PIOS_CRC16_CCITT_updateCRC(compact->block_crc, record, pos);
+	compact->last_time = now;
+
+	if (entry) {
+		entry->defined = true;
+		if (entry->last) {
+			memcpy(entry->last, compact->data, length);
+		}
 	}
+
+	// A record never comes out longer than its UAVTalk packet, as dt takes
+	// at most two bytes within a block.  The block framing isn't counted.
+	uint32_t uavtalk_length = LOGGING_UAVTALK_OVERHEAD + length +
+		(UAVObjIsSingleInstance(obj) ? 0 : 2);
+	saved_bytes += uavtalk_length - pos;
+
+out_unlock:
+	PIOS_Mutex_Unlock(compact->lock);
 }
 
 
@@ -454,8 +869,10 @@ static void logSettings(UAVObjHandle obj)
  */
 static int32_t send_data(uint8_t *data, int32_t length)
 {
-	if (PIOS_COM_SendBuffer(logging_com_id, data, length) < 0)
+	if (PIOS_COM_SendBuffer(logging_com_id, data, length) < 0) {
+		dropped_bytes += length;
 		return -1;
+	}
 
 	written_bytes += length;
 
@@ -464,8 +881,10 @@ static int32_t send_data(uint8_t *data, int32_t length)
 
 static int32_t send_data_nonblock(uint8_t *data, int32_t length)
 {
-	if (PIOS_COM_SendBufferNonBlocking(logging_com_id, data, length) < 0)
+	if (PIOS_COM_SendBufferNonBlocking(logging_com_id, data, length) < 0) {
+		dropped_bytes += length;
 		return -1;
+	}
 
 	written_bytes += length;
 
@@ -485,7 +904,7 @@ static void obj_updated_callback(UAVObjEvent * ev, void* cb_ctx, void *uavo_data
 		return;
 	}
 
-	UAVTalkSendObjectTimestamped(uavTalkCon, ev->obj, ev->instId, false, 0);
+	logObject(ev->obj, ev->instId, true);
 }
 
 
@@ -663,7 +1082,11 @@ static void writeHeader()
 
 	// Header
 	#define LOG_HEADER "dRonin git hash:\n"
-	send_data((uint8_t *)LOG_HEADER, strlen(LOG_HEADER));
+	if (log_format == LOGGINGSETTINGS_FORMAT_UAVTALK) {
+		send_data((uint8_t *)LOG_HEADER, strlen(LOG_HEADER));
+	} else {
+		send_data((uint8_t *)LOGGING_COMPACT_SIGNATURE, strlen(LOGGING_COMPACT_SIGNATURE));
+	}
 
 	// Commit tag name
 	// XXX all of thse should use the fw_version_info structure instead of
@@ -738,6 +1161,85 @@ static void updateSettings()
 	}
 }
 
+#ifdef PIOS_INCLUDE_LOG_TO_FLASH
+/**
+ * Open a log file for a windowed download
+ * \param[in] file_id File to download
+ * \param[in] request_seq Current request sequence number from the GCS
+ * \return 0 on success, -1 if the file could not be opened
+ */
+static int32_t download_open(uint16_t file_id, uint8_t request_seq)
+{
+	if (PIOS_STREAMFS_OpenRead(logging_com_id, file_id) != 0)
+		return -1;
+
+	download.file_id = file_id;
+	download.base = 0;
+	download.next = 0;
+	download.last = 0;
+	download.request_seq = request_seq;
+	download.eof = false;
+
+	return 0;
+}
+
+/**
+ * Advance the download window.  Sectors before FileSectorNum have
+ * arrived at the GCS and free their slot; sectors flagged in
+ * FileSectorResend were lost or corrupted and are sent again from
+ * the LoggingSector instance still holding them.  Free slots are
+ * then filled with fresh sectors read from flash.
+ * \param[in] stats Latest request from the GCS
+ * \return 0 while the download continues, 1 once the GCS has every
+ * sector, -1 on a read error
+ */
+static int32_t download_step(const LoggingStatsData *stats)
+{
+	if (stats->FileSectorNum > download.base)
+		download.base = MIN(stats->FileSectorNum, download.next);
+
+	if (download.eof && download.base > download.last)
+		return 1;
+
+	if (stats->FileRequestSeq != download.request_seq) {
+		download.request_seq = stats->FileRequestSeq;
+
+		for (uint32_t i = 0; i < LOGGING_DOWNLOAD_WINDOW; i++) {
+			uint32_t sector_num = download.base + i;
+
+			if ((stats->FileSectorResend & (1u << i)) && sector_num < download.next)
+				LoggingSectorInstUpdated(sector_num % LOGGING_DOWNLOAD_WINDOW);
+		}
+	}
+
+	while (!download.eof && download.next < download.base + LOGGING_DOWNLOAD_WINDOW) {
+		LoggingSectorData sector;
+
+		int32_t bytes_read = PIOS_STREAMFS_Read(logging_com_id, sector.Data, LOGGINGSECTOR_DATA_NUMELEM);
+		if (bytes_read < 0)
+			return -1;
+
+		memset(&sector.Data[bytes_read], 0, LOGGINGSECTOR_DATA_NUMELEM - bytes_read);
+		sector.SectorNum = download.next;
+		sector.Length = bytes_read;
+		sector.Crc = PIOS_CRC16_CCITT_updateCRC(0, sector.Data, bytes_read);
+
+		// Setting the instance queues it for telemetry
+		LoggingSectorInstSet(download.next % LOGGING_DOWNLOAD_WINDOW, &sector);
+
+		if (bytes_read < LOGGINGSECTOR_DATA_NUMELEM) {
+			// A short (possibly empty) sector marks the end of the file
+			download.eof = true;
+			download.last = download.next;
+		}
+
+		download.next++;
+	}
+
+	return 0;
+}
+#endif /* PIOS_INCLUDE_LOG_TO_FLASH */
+
 /**
   * @}
   * @}
@@ -64,6 +64,7 @@ extern uintptr_t external_i2c_adapter_id;
 #define TASK_PRIORITY PIOS_THREAD_PRIO_HIGH
 #define SENSOR_PERIOD 6		// this allows sensor data to arrive as slow as 166Hz
 #define REQUIRED_GOOD_CYCLES 50
+#define MAX_SAMPLES_PER_UPDATE 255	// what Gyros.samples and Accels.samples can count
 #define MAX_TIME_BETWEEN_VALID_BARO_DATAS_MS 100*1000  // we allow a pause time of 100 ms between two valid
                                                        // temperature/barometer dataa
 
@@ -77,8 +78,9 @@ enum mag_calibration_algo {
 static void SensorsTask(void *parameters);
 static void settingsUpdatedCb(UAVObjEvent * objEv, void *ctx, void *obj, int len);
 
-static void update_accels(struct pios_sensor_accel_data *accel);
-static void update_gyros(struct pios_sensor_gyro_data *gyro);
+static uint16_t update_jitter(uint32_t *last_update, uint32_t samples, enum pios_sensor_type type);
+static void update_accels(struct pios_sensor_accel_data *accel, uint32_t samples);
+static void update_gyros(struct pios_sensor_gyro_data *gyro, uint32_t samples);
 static void update_mags(struct pios_sensor_mag_data *mag);
 static void update_baro(struct pios_sensor_baro_data *baro);
 
@@ -119,6 +121,9 @@ static float gyro_temp_bias[3] = {0,0,0};
 static float z_accel_offset = 0;
 static float Rsb[3][3] = {{0}}; //! Rotation matrix that transforms from the body frame to the sensor board frame
 static int8_t rotate = 0;
+static uint32_t oversampling = 1;
+static uint32_t last_gyro_update;
+static uint32_t last_accel_update;
 
 //! Select the algorithm to try and null out the magnetometer bias error
 static enum mag_calibration_algo mag_calibration_algo = MAG_CALIBRATION_PRELEMARI;
@@ -236,6 +241,7 @@ static void SensorsTask(void *parameters)
 	lastSysTime = PIOS_Thread_Systime();
 	uint32_t good_runs = 1;
 	uint32_t last_baro_update_time = PIOS_DELAY_GetRaw();
+	last_gyro_update = last_accel_update = last_baro_update_time;
 
 	while (1) {
 		if (good_runs == 0) {
@@ -255,22 +261,34 @@ static void SensorsTask(void *parameters)
 		//Block on gyro data but nothing else
 		struct pios_queue *queue;
 		queue = PIOS_SENSORS_GetQueue(PIOS_SENSOR_GYRO);
-		if (queue == NULL || PIOS_Queue_Receive(queue, &gyros, SENSOR_PERIOD) == false) {
+		uint32_t gyro_samples = 0;
+		if (queue != NULL) {
+			gyro_samples = PIOS_SENSORS_ReceiveGyros(queue, oversampling, SENSOR_PERIOD, &gyros);
+		}
+		if (gyro_samples == 0) {
 			good_runs = 0;
 			continue;
 		}
 
 		queue = PIOS_SENSORS_GetQueue(PIOS_SENSOR_ACCEL);
-		if (queue == NULL || PIOS_Queue_Receive(queue, &accels, 0) == false) {
+		uint32_t accel_samples = 0;
+		if (queue != NULL) {
+			// When oversampling, average every accel sample queued
+			// since the last update
+			uint32_t max_samples = (oversampling > 1) ? MAX_SAMPLES_PER_UPDATE : 1;
+			accel_samples = PIOS_SENSORS_ReceiveAccels(queue, max_samples, &accels);
+		}
+		if (accel_samples == 0) {
 			//If no new accels data is ready, reuse the latest sample
+			accelsData.samples = 0;
 			AccelsSet(&accelsData);
 		}
 		else
-			update_accels(&accels);
+			update_accels(&accels, accel_samples);
 
 		// Update gyros after the accels since the rest of the code expects
 		// the accels to be available first
-		update_gyros(&gyros);
+		update_gyros(&gyros, gyro_samples);
 
 		bool test_good_run = good_runs > REQUIRED_GOOD_CYCLES;
 
@@ -342,17 +360,44 @@ static void SensorsTask(void *parameters)
 
 		// Check total time to get the sensors wasn't over the limit
 		uint32_t dT_us = PIOS_DELAY_DiffuS(timeval);
-		if (dT_us > (SENSOR_PERIOD * 1000))
+		if (dT_us > (SENSOR_PERIOD * 1000 * oversampling))
 			good_runs = 0;
 
 	}
 }
 
+/**
+ * @brief Measure how far the time since the last update strays from the
+ * time its samples cover at the sensor's nominal rate
+ * @param[in,out] last_update Raw time of the last update, moved to now
+ * @param[in] samples Number of samples in this update
+ * @param[in] type Sensor the samples came from
+ * @return the jitter in us
+ */
+static uint16_t update_jitter(uint32_t *last_update, uint32_t samples, enum pios_sensor_type type)
+{
+	uint32_t now = PIOS_DELAY_GetRaw();
+	int32_t interval = PIOS_DELAY_DiffuS2(*last_update, now);
+	uint32_t rate = PIOS_SENSORS_GetSampleRate(type);
+
+	*last_update = now;
+
+	if (rate == 0)
+		return 0;
+
+	int32_t jitter = interval - (int32_t) (samples * 1000000 / rate);
+	if (jitter < 0)
+		jitter = -jitter;
+
+	return MIN(jitter, UINT16_MAX);
+}
+
 /**
  * @brief Apply calibration and rotation to the raw accel data
  * @param[in] accels The raw accel data
+ * @param[in] samples Number of samples averaged into it
  */
-static void update_accels(struct pios_sensor_accel_data *accels)
+static void update_accels(struct pios_sensor_accel_data *accels, uint32_t samples)
 {
 	// Average and scale the accels before rotation
 	float accels_out[3] = {
@@ -377,6 +422,8 @@ static void update_accels(struct pios_sensor_accel_data *accels)
 
 	accelsData.z += z_accel_offset;
 	accelsData.temperature = accels->temperature;
+	accelsData.samples = samples;
+	accelsData.jitter = update_jitter(&last_accel_update, samples, PIOS_SENSOR_ACCEL);
 
 	AccelsSet(&accelsData);
 }
@@ -384,8 +431,9 @@ static void update_accels(struct pios_sensor_accel_data *accels)
 /**
  * @brief Apply calibration and rotation to the raw gyro data
  * @param[in] gyros The raw gyro data
+ * @param[in] samples Number of samples averaged into it
  */
-static void update_gyros(struct pios_sensor_gyro_data *gyros)
+static void update_gyros(struct pios_sensor_gyro_data *gyros, uint32_t samples)
 {
 	// Scale the gyros
 	float gyros_out[3] = {
@@ -398,6 +446,8 @@ static void update_gyros(struct pios_sensor_gyro_data *gyros)
 
 	GyrosData gyrosData;
 	gyrosData.temperature = gyros->temperature;
+	gyrosData.samples = samples;
+	gyrosData.jitter = update_jitter(&last_gyro_update, samples, PIOS_SENSOR_GYRO);
 
 	// Update the bias due to the temperature
 	updateTemperatureComp(gyrosData.temperature, gyro_temp_bias);
@@ -766,8 +816,13 @@ static void settingsUpdatedCb(UAVObjEvent * objEv, void *ctx, void *obj, int len
 		rotate = 1;
 	}
 
-	float gyro_dT = 1.0f / (float)PIOS_SENSORS_GetSampleRate(PIOS_SENSOR_GYRO);
-	float accel_dT = 1.0f / (float)PIOS_SENSORS_GetSampleRate(PIOS_SENSOR_ACCEL);
+	oversampling = MAX(sensorSettings.Oversampling, 1);
+
+	// The filters run once per update, and every gyro update averages
+	// exactly oversampling samples; the accels can't update more often
+	// than the gyros
+	float gyro_dT = PIOS_SENSORS_GetUpdatePeriod(PIOS_SENSOR_GYRO, oversampling);
+	float accel_dT = MAX(PIOS_SENSORS_GetUpdatePeriod(PIOS_SENSOR_ACCEL, 1), gyro_dT);
 
 	lpfilter_create(&gyro_filter, sensorSettings.LowpassCutoff, gyro_dT, sensorSettings.LowpassOrder, 3);
 	lpfilter_create(&accel_filter, sensorSettings.LowpassCutoff, accel_dT, sensorSettings.LowpassOrder, 3);
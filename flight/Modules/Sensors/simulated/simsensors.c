@@ -226,14 +226,14 @@ static void SensorsTask(void *parameters)
 
 static void simulateConstant()
 {
-	AccelsData accelsData; // Skip get as we set all the fields
+	AccelsData accelsData = { .samples = 1 }; // Skip get as we set all the other fields
 	accelsData.x = 0;
 	accelsData.y = 0;
 	accelsData.z = -GRAVITY;
 	accelsData.temperature = 0;
 	AccelsSet(&accelsData);
 
-	GyrosData gyrosData; // Skip get as we set all the fields
+	GyrosData gyrosData = { .samples = 1 }; // Skip get as we set all the other fields
 	gyrosData.x = 0;
 	gyrosData.y = 0;
 	gyrosData.z = 0;
@@ -282,7 +282,7 @@ static void simulateModelAgnostic()
 	q[3] = attitudeActual.q4;
 	Quaternion2R(q,Rbe);
 
-	AccelsData accelsData; // Skip get as we set all the fields
+	AccelsData accelsData = { .samples = 1 }; // Skip get as we set all the other fields
 	accelsData.x = -GRAVITY * Rbe[0][2];
 	accelsData.y = -GRAVITY * Rbe[1][2];
 	accelsData.z = -GRAVITY * Rbe[2][2];
@@ -292,7 +292,7 @@ static void simulateModelAgnostic()
 	RateDesiredData rateDesired;
 	RateDesiredGet(&rateDesired);
 
-	GyrosData gyrosData; // Skip get as we set all the fields
+	GyrosData gyrosData = { .samples = 1 }; // Skip get as we set all the other fields
 	gyrosData.x = rateDesired.Roll + rand_gauss();
 	gyrosData.y = rateDesired.Pitch + rand_gauss();
 	gyrosData.z = rateDesired.Yaw + rand_gauss();
@@ -369,7 +369,7 @@ static void simulateModelQuadcopter()
 	rpy[2] = control_scaling * actuatorDesired.Yaw * (1 - ACTUATOR_ALPHA) + rpy[2] * ACTUATOR_ALPHA;
 
 	temperature = 20;
-	GyrosData gyrosData; // Skip get as we set all the fields
+	GyrosData gyrosData = { .samples = 1 }; // Skip get as we set all the other fields
 	gyrosData.x = rpy[0] + rand_gauss() * GYRO_NOISE_SCALE + (temperature - 20) * 1 + powf(temperature - 20,2) * 0.11; // - powf(temperature - 20,3) * 0.05;;
 	gyrosData.y = rpy[1] + rand_gauss() * GYRO_NOISE_SCALE + (temperature - 20) * 1 + powf(temperature - 20,2) * 0.11;
 	gyrosData.z = rpy[2] + rand_gauss() * GYRO_NOISE_SCALE + (temperature - 20) * 1 + powf(temperature - 20,2) * 0.11;
@@ -443,7 +443,7 @@ static void simulateModelQuadcopter()
 	ned_accel[2] -= GRAVITY;
 
 	// Transform the accels back in to body frame
-	AccelsData accelsData; // Skip get as we set all the fields
+	AccelsData accelsData = { .samples = 1 }; // Skip get as we set all the other fields
 	accelsData.x = ned_accel[0] * Rbe[0][0] + ned_accel[1] * Rbe[0][1] + ned_accel[2] * Rbe[0][2] + accel_bias[0];
 	accelsData.y = ned_accel[0] * Rbe[1][0] + ned_accel[1] * Rbe[1][1] + ned_accel[2] * Rbe[1][2] + accel_bias[1];
 	accelsData.z = ned_accel[0] * Rbe[2][0] + ned_accel[1] * Rbe[2][1] + ned_accel[2] * Rbe[2][2] + accel_bias[2];
@@ -627,7 +627,7 @@ static void simulateModelAirplane()
 	rpy[2] += roll * ROLL_HEADING_COUPLING;
 
 
-	GyrosData gyrosData; // Skip get as we set all the fields
+	GyrosData gyrosData = { .samples = 1 }; // Skip get as we set all the other fields
 	gyrosData.x = rpy[0] + rand_gauss();
 	gyrosData.y = rpy[1] + rand_gauss();
 	gyrosData.z = rpy[2] + rand_gauss();
@@ -729,7 +729,7 @@ static void simulateModelAirplane()
 	ned_accel[2] -= GRAVITY;
 
 	// Transform the accels back in to body frame
-	AccelsData accelsData; // Skip get as we set all the fields
+	AccelsData accelsData = { .samples = 1 }; // Skip get as we set all the other fields
 	accelsData.x = ned_accel[0] * Rbe[0][0] + ned_accel[1] * Rbe[0][1] + ned_accel[2] * Rbe[0][2] + accel_bias[0];
 	accelsData.y = ned_accel[0] * Rbe[1][0] + ned_accel[1] * Rbe[1][1] + ned_accel[2] * Rbe[1][2] + accel_bias[1];
 	accelsData.z = ned_accel[0] * Rbe[2][0] + ned_accel[1] * Rbe[2][1] + ned_accel[2] * Rbe[2][2] + accel_bias[2];
@@ -913,7 +913,7 @@ static void simulateModelCar()
 	rpy[2] = (flightStatus.Armed == FLIGHTSTATUS_ARMED_ARMED) * rateDesired.Yaw * (1 - ACTUATOR_ALPHA) + rpy[2] * ACTUATOR_ALPHA;
 
 
-	GyrosData gyrosData; // Skip get as we set all the fields
+	GyrosData gyrosData = { .samples = 1 }; // Skip get as we set all the other fields
 	gyrosData.x = rpy[0] + rand_gauss();
 	gyrosData.y = rpy[1] + rand_gauss();
 	gyrosData.z = rpy[2] + rand_gauss();
@@ -995,7 +995,7 @@ static void simulateModelCar()
 	ned_accel[2] -= GRAVITY;
 
 	// Transform the accels back in to body frame
-	AccelsData accelsData; // Skip get as we set all the fields
+	AccelsData accelsData = { .samples = 1 }; // Skip get as we set all the other fields
 	accelsData.x = ned_accel[0] * Rbe[0][0] + ned_accel[1] * Rbe[0][1] + ned_accel[2] * Rbe[0][2] + accel_bias[0];
 	accelsData.y = ned_accel[0] * Rbe[1][0] + ned_accel[1] * Rbe[1][1] + ned_accel[2] * Rbe[1][2] + accel_bias[1];
 	accelsData.z = ned_accel[0] * Rbe[2][0] + ned_accel[1] * Rbe[2][1] + ned_accel[2] * Rbe[2][2] + accel_bias[2];
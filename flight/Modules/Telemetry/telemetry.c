@@ -40,10 +40,13 @@
 #include "sessionmanaging.h"
 #include "pios_thread.h"
 #include "pios_queue.h"
+#include "pios_mutex.h"
 
 #include "pios_hal.h"
+#include "misc_math.h"
 
 #include <uavtalk.h>
+#include <uavtalk_priv.h>
 
 // Private constants
 #define MAX_QUEUE_SIZE   TELEM_QUEUE_SIZE
@@ -56,6 +59,13 @@
 #define CONNECTION_TIMEOUT_MS 8000
 #define USB_ACTIVITY_TIMEOUT_MS 6000
 
+#ifndef TELEM_BATCH_MAX_BYTES
+#define TELEM_BATCH_MAX_BYTES 256
+#endif
+#ifndef TELEM_BATCH_DEADLINE_MS
+#define TELEM_BATCH_DEADLINE_MS 5
+#endif
+
 // Private types
 
 // Private variables
@@ -70,10 +80,26 @@ static UAVTalkConnection uavTalkCon;
 static volatile uint32_t usb_timeout_time;
 #endif
 
+/* Frames are gathered here and written to the port together, up to the
+ * port's batch size, to save framing and driver wakeups on radio links. */
+static struct pios_mutex *batch_lock;
+static uint8_t *batch_buf;
+static uint16_t batch_len;
+static uint16_t batch_frames;	// Already reported sent to UAVTalk
+static uint32_t batch_errors;	// Of those, lost to failed port writes
+static uintptr_t batch_port;
+static uint32_t batch_deadline;
+static uint16_t batch_size_usb;
+static uint16_t batch_size_serial;
+
 // Private functions
 static void telemetryTxTask(void *parameters);
 static void telemetryRxTask(void *parameters);
 static int32_t transmitData(uint8_t * data, int32_t length);
+static int32_t queueFrame(uintptr_t outputPort, uint8_t * data, int32_t length, bool bypass);
+static void flushBatch(bool force);
+static int32_t writeBatch();
+static uint32_t batchTimeout();
 static void registerObject(UAVObjHandle obj);
 static void updateObject(UAVObjHandle obj, int32_t eventType);
 static int32_t setUpdatePeriod(UAVObjHandle obj, int32_t updatePeriodMs);
@@ -135,6 +161,11 @@ int32_t TelemetryInitialize(void)
 	// Initialise UAVTalk
 	uavTalkCon = UAVTalkInitialize(&transmitData);
 
+	batch_lock = PIOS_Mutex_Create();
+	if (!batch_lock) {
+		return -1;
+	}
+
 	if (SessionManagingInitialize() == -1) {
 		return -1;
 	}
@@ -265,12 +296,15 @@ static void processObjEvent(UAVObjEvent * ev)
 		success = -1;
 		if (ev->event == EV_UPDATED || ev->event == EV_UPDATED_MANUAL ||
 				ev->event == EV_UPDATED_PERIODIC) {
+			bool acked = UAVObjGetTelemetryAcked(&metadata);
+
 			// Send update to GCS (with retries)
 			while (retries < MAX_RETRIES && success == -1) {
-				success = UAVTalkSendObject(uavTalkCon, ev->obj, ev->instId, UAVObjGetTelemetryAcked(&metadata), REQ_TIMEOUT_MS);	// call blocks until ack is received or timeout
+				success = UAVTalkSendObject(uavTalkCon, ev->obj, ev->instId, acked, REQ_TIMEOUT_MS);	// call blocks until ack is received or timeout
 
 				++retries;
 			}
+
 			// Update stats
 			txRetries += (retries - 1);
 			if (success == -1) {
@@ -297,11 +331,13 @@ static void telemetryTxTask(void *parameters)
 
 	// Loop forever
 	while (1) {
-		// Wait for queue message
-		if (PIOS_Queue_Receive(queue, &ev, PIOS_QUEUE_TIMEOUT_MAX) == true) {
+		// Wait for queue message, or until the batch is due
+		if (PIOS_Queue_Receive(queue, &ev, batchTimeout()) == true) {
 			// Process event
 			processObjEvent(&ev);
 		}
+
+		flushBatch(false);
 	}
 }
 
@@ -371,6 +407,9 @@ static void telemetryRxTask(void *parameters)
 					UAVTalkProcessInputStream(uavTalkCon,serial_data[i]);
 				}
 
+				// Don't hold back acks and replies to requests
+				flushBatch(true);
+
 #if defined(PIOS_INCLUDE_USB)
 				if (inputPort == PIOS_COM_TELEM_USB) {
 					processUsbActivity(true);
@@ -394,10 +433,130 @@ static int32_t transmitData(uint8_t * data, int32_t length)
 {
 	uintptr_t outputPort = getComPort();
 
-	if (outputPort)
-		return PIOS_COM_SendBuffer(outputPort, data, length);
+	if (!outputPort)
+		return -1;
+
+	// A send that waits for the reply can't sit in the batch
+	uint8_t type = (length > 1) ? (data[1] & ~UAVTALK_TIMESTAMPED) : 0;
+	bool bypass = (type == UAVTALK_TYPE_OBJ_ACK) || (type == UAVTALK_TYPE_OBJ_REQ);
+
+	return queueFrame(outputPort, data, length, bypass);
+}
+
+/**
+ * Add a frame to the batch, or write it straight to the port.
+ * \param[in] outputPort Port to send on
+ * \param[in] data Frame to send
+ * \param[in] length Length of the frame
+ * \param[in] bypass Write the frame (and whatever is pending) now
+ * \return -1 on failure
+ * \return number of bytes queued or transmitted on success
+ */
+static int32_t queueFrame(uintptr_t outputPort, uint8_t * data, int32_t length, bool bypass)
+{
+	uint16_t batch_size = batch_size_serial;
+
+#if defined(PIOS_INCLUDE_USB)
+	if (outputPort == PIOS_COM_TELEM_USB)
+		batch_size = batch_size_usb;
+#endif
+
+	int32_t rc;
+
+	PIOS_Mutex_Lock(batch_lock, PIOS_MUTEX_TIMEOUT_MAX);
+
+	bool direct = bypass || length > batch_size;
+
+	// Keep frames in order: whatever is pending goes out first
+	if (batch_len && (direct || outputPort != batch_port ||
+				batch_len + length > batch_size)) {
+		writeBatch();
+	}
+
+	if (direct) {
+		rc = PIOS_COM_SendBuffer(outputPort, data, length);
+	} else {
+		if (!batch_len) {
+			batch_port = outputPort;
+			batch_deadline = PIOS_Thread_Systime() + TELEM_BATCH_DEADLINE_MS;
+		}
+
+		memcpy(&batch_buf[batch_len], data, length);
+		batch_len += length;
+		rc = length;
+
+		if (batch_len == batch_size) {
+			// This frame goes out with the batch, so it answers
+			// for itself
+			if (writeBatch() < 0) {
+				rc = -1;
+			}
+		} else {
+			batch_frames++;
+		}
+	}
+
+	PIOS_Mutex_Unlock(batch_lock);
+
+	return rc;
+}
+
+/**
+ * Write out the frames gathered in the batch; batch_lock must be held.
+ * Frames that were already reported sent are counted as failures if the
+ * write fails.
+ * \return -1 on failure
+ * \return number of bytes transmitted on success
+ */
+static int32_t writeBatch()
+{
+	int32_t rc = PIOS_COM_SendBuffer(batch_port, batch_buf, batch_len);
+
+	if (rc < 0) {
+		batch_errors += batch_frames;
+	}
+
+	batch_len = 0;
+	batch_frames = 0;
+
+	return rc;
+}
+
+/**
+ * Write out the frames gathered in the batch, if any.
+ * \param[in] force Write them even if the batch deadline hasn't passed
+ */
+static void flushBatch(bool force)
+{
+	PIOS_Mutex_Lock(batch_lock, PIOS_MUTEX_TIMEOUT_MAX);
+
+	if (batch_len && (force ||
+			(int32_t)(PIOS_Thread_Systime() - batch_deadline) >= 0)) {
+		writeBatch();
+	}
+
+	PIOS_Mutex_Unlock(batch_lock);
+}
+
+/**
+ * How long the transmit task may wait before the batch is due.
+ * \return Time in ms, or PIOS_QUEUE_TIMEOUT_MAX if nothing is pending
+ */
+static uint32_t batchTimeout()
+{
+	uint32_t timeout = PIOS_QUEUE_TIMEOUT_MAX;
+
+	PIOS_Mutex_Lock(batch_lock, PIOS_MUTEX_TIMEOUT_MAX);
+
+	if (batch_len) {
+		int32_t remaining = batch_deadline - PIOS_Thread_Systime();
 
-	return -1;
+		timeout = (remaining > 0) ? remaining : 0;
+	}
+
+	PIOS_Mutex_Unlock(batch_lock);
+
+	return timeout;
 }
 
 /**
@@ -463,6 +622,11 @@ static void updateTelemetryStats()
 		flightStats.TxRetries += txRetries;
 		txErrors = 0;
 		txRetries = 0;
+
+		PIOS_Mutex_Lock(batch_lock, PIOS_MUTEX_TIMEOUT_MAX);
+		flightStats.TxFailures += batch_errors;
+		batch_errors = 0;
+		PIOS_Mutex_Unlock(batch_lock);
 	} else {
 		flightStats.RxDataRate = 0;
 		flightStats.TxDataRate = 0;
@@ -471,6 +635,10 @@ static void updateTelemetryStats()
 		flightStats.TxRetries = 0;
 		txErrors = 0;
 		txRetries = 0;
+
+		PIOS_Mutex_Lock(batch_lock, PIOS_MUTEX_TIMEOUT_MAX);
+		batch_errors = 0;
+		PIOS_Mutex_Unlock(batch_lock);
 	}
 
 	// Check for connection timeout
@@ -501,6 +669,8 @@ static void updateTelemetryStats()
 	} else if (flightStats.Status == FLIGHTTELEMETRYSTATS_STATUS_CONNECTED) {
 		if (gcsStats.Status != GCSTELEMETRYSTATS_STATUS_CONNECTED || connectionTimeout) {
 			flightStats.Status = FLIGHTTELEMETRYSTATS_STATUS_DISCONNECTED;
+			// The next GCS has to ask for deltas again
+			UAVTalkSetDeltaEnabled(uavTalkCon, false);
 		} else {
 			forceUpdate = 0;
 		}
@@ -536,6 +706,30 @@ static void updateSettings()
 
 		PIOS_HAL_ConfigureSerialSpeed(PIOS_COM_TELEM_RF, speed);
 	}
+
+	uint16_t batch_sizes[MODULESETTINGS_TELEMETRYBATCHSIZE_NUMELEM];
+	ModuleSettingsTelemetryBatchSizeGet(batch_sizes);
+
+	// Zero turns batching off for the port
+	uint16_t size_usb = MIN(batch_sizes[MODULESETTINGS_TELEMETRYBATCHSIZE_USB],
+			TELEM_BATCH_MAX_BYTES);
+	uint16_t size_serial = MIN(batch_sizes[MODULESETTINGS_TELEMETRYBATCHSIZE_SERIAL],
+			TELEM_BATCH_MAX_BYTES);
+
+	// Only spend the memory on the buffer when a port batches
+	if ((size_usb || size_serial) && !batch_buf) {
+		batch_buf = PIOS_malloc(TELEM_BATCH_MAX_BYTES);
+
+		if (!batch_buf) {
+			size_usb = 0;
+			size_serial = 0;
+		}
+	}
+
+	PIOS_Mutex_Lock(batch_lock, PIOS_MUTEX_TIMEOUT_MAX);
+	batch_size_usb = size_usb;
+	batch_size_serial = size_serial;
+	PIOS_Mutex_Unlock(batch_lock);
 }
 
 /**
@@ -583,6 +777,13 @@ static void session_managing_updated(UAVObjEvent * ev, void *ctx, void *obj, int
 			sessionManaging.ObjectID = UAVObjIDByIndex(index);
 			sessionManaging.ObjectInstances = UAVObjGetNumInstances(UAVObjGetByID(sessionManaging.ObjectID));
 		}
+
+		// The GCS asks for delta packets; echo back whether we'll send them
+		bool delta = sessionManaging.DeltaEncoding == SESSIONMANAGING_DELTAENCODING_ENABLED;
+		if (UAVTalkSetDeltaEnabled(uavTalkCon, delta) != 0) {
+			sessionManaging.DeltaEncoding = SESSIONMANAGING_DELTAENCODING_DISABLED;
+		}
+
 		SessionManagingSet(&sessionManaging);
 	}
 }
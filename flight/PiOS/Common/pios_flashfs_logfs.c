@@ -31,6 +31,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>		/* NULL */
+#include <string.h>		/* memmove */
 
 #define MIN(x,y) ((x) < (y) ? (x) : (y))
 
@@ -42,6 +43,17 @@ enum pios_flashfs_logfs_dev_magic {
 	PIOS_FLASHFS_LOGFS_DEV_MAGIC = 0x94938201,
 };
 
+/*
+ * One entry of the RAM index of active slots, so that finding an
+ * object doesn't need to read every slot header back from flash
+ */
+struct logfs_slot_entry {
+	uint32_t obj_id;
+	uint16_t obj_inst_id;
+	uint16_t obj_size;
+	uint16_t slot_id;
+};
+
 struct logfs_state {
 	enum pios_flashfs_logfs_dev_magic magic;
 	const struct flashfs_logfs_cfg *cfg;
@@ -54,6 +66,14 @@ struct logfs_state {
 	 */
 	uint16_t num_free_slots;   /* slots in free state */
 	uint16_t num_active_slots; /* slots in active state */
+	uint16_t num_gcs;          /* garbage collections run, for batch stats */
+
+	/*
+	 * One entry per active slot (num_active_slots long), sorted by
+	 * object id then instance id.  Built when the log is mounted and
+	 * kept up to date as slots are appended and obsoleted.
+	 */
+	struct logfs_slot_entry *index;
 
 	/* Underlying flash partition handle */
 	uintptr_t partition_id;
@@ -334,6 +354,98 @@ struct slot_header {
 	uint16_t obj_size;
 } __attribute__((packed));
 
+/*
+ * RAM slot index
+ */
+
+static int8_t logfs_index_compare(const struct logfs_slot_entry *entry, uint32_t obj_id, uint16_t obj_inst_id)
+{
+	if (entry->obj_id != obj_id)
+		return (entry->obj_id < obj_id) ? -1 : 1;
+
+	if (entry->obj_inst_id != obj_inst_id)
+		return (entry->obj_inst_id < obj_inst_id) ? -1 : 1;
+
+	return 0;
+}
+
+/**
+ * @brief Binary search for the first index entry not ordered before an object instance
+ * @return position in the index, num_active_slots if every entry is ordered before it
+ */
+static uint16_t logfs_index_lower_bound(const struct logfs_state *logfs, uint32_t obj_id, uint16_t obj_inst_id)
+{
+	uint16_t lo = 0;
+	uint16_t hi = logfs->num_active_slots;
+
+	while (lo < hi) {
+		uint16_t mid = lo + (hi - lo) / 2;
+		if (logfs_index_compare(&logfs->index[mid], obj_id, obj_inst_id) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/**
+ * @brief Find the active slot holding an object instance
+ * @return position in the index of the lowest numbered matching slot
+ * @return -1 if the object instance has no active slot
+ */
+static int32_t logfs_index_find(const struct logfs_state *logfs, uint32_t obj_id, uint16_t obj_inst_id)
+{
+	uint16_t pos = logfs_index_lower_bound(logfs, obj_id, obj_inst_id);
+
+	if (pos < logfs->num_active_slots &&
+		logfs_index_compare(&logfs->index[pos], obj_id, obj_inst_id) == 0) {
+		return pos;
+	}
+
+	return -1;
+}
+
+/**
+ * @brief Add a slot which has just become active to the index
+ */
+static void logfs_index_insert(struct logfs_state *logfs, const struct slot_header *slot_hdr, uint16_t slot_id)
+{
+	PIOS_Assert(logfs->num_active_slots < (logfs->cfg->arena_size / logfs->cfg->slot_size) - 1);
+
+	uint16_t pos = logfs_index_lower_bound(logfs, slot_hdr->obj_id, slot_hdr->obj_inst_id);
+
+	/* Should there be more than one active version, keep them in slot order */
+	while (pos < logfs->num_active_slots &&
+		logfs_index_compare(&logfs->index[pos], slot_hdr->obj_id, slot_hdr->obj_inst_id) == 0 &&
+		logfs->index[pos].slot_id < slot_id) {
+		pos++;
+	}
+
+	memmove(&logfs->index[pos + 1], &logfs->index[pos],
+		(logfs->num_active_slots - pos) * sizeof(*logfs->index));
+
+	logfs->index[pos].obj_id      = slot_hdr->obj_id;
+	logfs->index[pos].obj_inst_id = slot_hdr->obj_inst_id;
+	logfs->index[pos].obj_size    = slot_hdr->obj_size;
+	logfs->index[pos].slot_id     = slot_id;
+
+	logfs->num_active_slots++;
+}
+
+/**
+ * @brief Drop a slot which is no longer active from the index
+ */
+static void logfs_index_remove(struct logfs_state *logfs, uint16_t pos)
+{
+	PIOS_Assert(pos < logfs->num_active_slots);
+
+	logfs->num_active_slots--;
+
+	memmove(&logfs->index[pos], &logfs->index[pos + 1],
+		(logfs->num_active_slots - pos) * sizeof(*logfs->index));
+}
+
 /* NOTE: Must be called while holding the flash transaction lock */
 static int32_t logfs_raw_copy_bytes (const struct logfs_state *logfs, uintptr_t src_addr, uint16_t src_size, uintptr_t dst_addr)
 {
@@ -441,7 +553,7 @@ static int32_t logfs_mount_log(struct logfs_state *logfs, uint8_t arena_id)
 			logfs->num_free_slots++;
 			break;
 		case SLOT_STATE_ACTIVE:
-			logfs->num_active_slots++;
+			logfs_index_insert(logfs, &slot_hdr, slot_id);
 			break;
 		case SLOT_STATE_RESERVED:
 		case SLOT_STATE_OBSOLETE:
@@ -469,12 +581,15 @@ static struct logfs_state *PIOS_FLASHFS_Logfs_alloc(void)
 	if (!logfs) return (NULL);
 
 	logfs->magic = PIOS_FLASHFS_LOGFS_DEV_MAGIC;
+	logfs->index = NULL;
+	logfs->num_gcs = 0;
 	return(logfs);
 }
 static void PIOS_FLASHFS_Logfs_free(struct logfs_state *logfs)
 {
 	/* Invalidate the magic */
 	logfs->magic = ~PIOS_FLASHFS_LOGFS_DEV_MAGIC;
+	PIOS_free(logfs->index);
 	PIOS_free(logfs);
 }
 
@@ -520,6 +635,14 @@ int32_t PIOS_FLASHFS_Logfs_Init(uintptr_t *fs_id, const struct flashfs_logfs_cfg
 	logfs->partition_size = partition_size; /* size of underlying partition */
 	logfs->mounted        = false;
 
+	/* Room to index every slot but the first, which holds the arena header */
+	logfs->index = (struct logfs_slot_entry *)PIOS_malloc_no_dma(
+		((cfg->arena_size / cfg->slot_size) - 1) * sizeof(*logfs->index));
+	if (!logfs->index) {
+		rc = -1;
+		goto out_exit;
+	}
+
 	if (PIOS_FLASH_start_transaction(logfs->partition_id) != 0) {
 		rc = -1;
 		goto out_exit;
@@ -607,30 +730,21 @@ static int32_t logfs_garbage_collect (struct logfs_state *logfs) {
 		return -2;
 	}
 
-	/* Copy active slots from active arena to destination arena */
-	uint16_t dst_slot_id = 1;
-	for (uint16_t src_slot_id = 1;
-	     src_slot_id < (logfs->cfg->arena_size / logfs->cfg->slot_size);
-	     src_slot_id++) {
-		struct slot_header slot_hdr;
-		uintptr_t src_addr = logfs_get_addr (logfs, src_arena_id, src_slot_id);
-		if (PIOS_FLASH_read_data(logfs->partition_id,
+	/*
+	 * Copy active slots from active arena to destination arena.  The
+	 * index lists exactly the active slots so there's no need to read
+	 * the headers of the obsolete ones.
+	 */
+	for (uint16_t i = 0; i < logfs->num_active_slots; i++) {
+		const struct logfs_slot_entry *entry = &logfs->index[i];
+		uintptr_t src_addr = logfs_get_addr (logfs, src_arena_id, entry->slot_id);
+		uintptr_t dst_addr = logfs_get_addr (logfs, dst_arena_id, i + 1);
+		if (logfs_raw_copy_bytes(logfs,
 						src_addr,
-						(uint8_t *)&slot_hdr,
-						sizeof (slot_hdr)) != 0) {
-			return -3;
-		}
-
-		if (slot_hdr.state == SLOT_STATE_ACTIVE) {
-			uintptr_t dst_addr = logfs_get_addr (logfs, dst_arena_id, dst_slot_id);
-			if (logfs_raw_copy_bytes(logfs,
-							src_addr,
-							sizeof(slot_hdr) + slot_hdr.obj_size,
-							dst_addr) != 0) {
-				/* Failed to copy all bytes */
-				return -4;
-			}
-			dst_slot_id++;
+						sizeof(struct slot_header) + entry->obj_size,
+						dst_addr) != 0) {
+			/* Failed to copy all bytes */
+			return -4;
 		}
 	}
 
@@ -654,86 +768,33 @@ static int32_t logfs_garbage_collect (struct logfs_state *logfs) {
 		return -8;
 	}
 
+	logfs->num_gcs++;
+
 	return 0;
 }
 
 /* NOTE: Must be called while holding the flash transaction lock */
-static int16_t logfs_object_find_next (const struct logfs_state *logfs, struct slot_header *slot_hdr, uint16_t *curr_slot, uint32_t obj_id, uint16_t obj_inst_id)
+static int8_t logfs_delete_object (struct logfs_state *logfs, uint32_t obj_id, uint16_t obj_inst_id)
 {
-	PIOS_Assert(slot_hdr);
-	PIOS_Assert(curr_slot);
+	int32_t pos;
 
-	/* First slot in the arena is reserved for arena header, skip it. */
-	if (*curr_slot == 0) *curr_slot = 1;
+	while ((pos = logfs_index_find(logfs, obj_id, obj_inst_id)) >= 0) {
+		/* Found a matching slot.  Obsolete it. */
+		enum slot_state state = SLOT_STATE_OBSOLETE;
+		uintptr_t slot_addr = logfs_get_addr (logfs, logfs->active_arena_id, logfs->index[pos].slot_id);
 
-	for (uint16_t slot_id = *curr_slot;
-	     slot_id < (logfs->cfg->arena_size / logfs->cfg->slot_size);
-	     slot_id++) {
-		uintptr_t slot_addr = logfs_get_addr (logfs, logfs->active_arena_id, slot_id);
-
-		if (PIOS_FLASH_read_data(logfs->partition_id,
+		if (PIOS_FLASH_write_data(logfs->partition_id,
 						slot_addr,
-						(uint8_t *)slot_hdr,
-						sizeof (*slot_hdr)) != 0) {
+						(uint8_t *)&state,
+						sizeof(state)) != 0) {
 			return -2;
 		}
-		if (slot_hdr->state == SLOT_STATE_EMPTY) {
-			/* We hit the end of the log */
-			break;
-		}
-		if (slot_hdr->state == SLOT_STATE_ACTIVE &&
-			slot_hdr->obj_id      == obj_id &&
-			slot_hdr->obj_inst_id == obj_inst_id) {
-			/* Found what we were looking for */
-			*curr_slot = slot_id;
-			return 0;
-		}
-	}
-
-	/* No matching entry was found */
-	return -1;
-}
 
-/* NOTE: Must be called while holding the flash transaction lock */
-/* OPTIMIZE: could trust that there is at most one active version of every object and terminate the search when we find one */
-static int8_t logfs_delete_object (struct logfs_state *logfs, uint32_t obj_id, uint16_t obj_inst_id)
-{
-	int8_t rc;
-
-	bool more = true;
-	uint16_t curr_slot_id = 0;
-	do {
-		struct slot_header slot_hdr;
-		switch (logfs_object_find_next (logfs, &slot_hdr, &curr_slot_id, obj_id, obj_inst_id)) {
-		case 0:
-			/* Found a matching slot.  Obsolete it. */
-			slot_hdr.state = SLOT_STATE_OBSOLETE;
-			uintptr_t slot_addr = logfs_get_addr (logfs, logfs->active_arena_id, curr_slot_id);
-
-			if (PIOS_FLASH_write_data(logfs->partition_id,
-							slot_addr,
-							(uint8_t *)&slot_hdr,
-							sizeof(slot_hdr)) != 0) {
-				rc = -2;
-				goto out_exit;
-			}
-			/* Object has been successfully obsoleted and is no longer active */
-			logfs->num_active_slots--;
-			break;
-		case -1:
-			/* Search completed, object not found */
-			more = false;
-			rc = 0;
-			break;
-		default:
-			/* Error occurred during search */
-			rc = -1;
-			goto out_exit;
-		}
-	} while (more);
+		/* Object has been successfully obsoleted and is no longer active */
+		logfs_index_remove(logfs, pos);
+	}
 
-out_exit:
-	return rc;
+	return 0;
 }
 
 /* NOTE: Must be called while holding the flash transaction lock */
@@ -830,10 +891,89 @@ static int8_t logfs_append_to_log (struct logfs_state *logfs, uint32_t obj_id, u
 	}
 
 	/* Object has been successfully written to the slot */
-	logfs->num_active_slots++;
+	logfs_index_insert(logfs, &slot_hdr, free_slot_id);
+	return 0;
+}
+
+
+/* NOTE: Must be called while holding the flash transaction lock */
+static int8_t logfs_save_object (struct logfs_state *logfs, uint32_t obj_id, uint16_t obj_inst_id, uint8_t *obj_data, uint16_t obj_size)
+{
+	if (logfs_delete_object (logfs, obj_id, obj_inst_id) != 0) {
+		return -3;
+	}
+
+	/*
+	 * All old versions of this object + instance have been invalidated.
+	 * Write the new object.
+	 */
+
+	/* Check if the arena is entirely full. */
+	if (logfs_fs_is_full(logfs)) {
+		/* Note: Filesystem Full means we're full of *active* records so gc won't help at all. */
+		return -4;
+	}
+
+	/* Is garbage collection required? */
+	if (logfs_log_is_full(logfs)) {
+		/* Note: Log Full means the log is full but may contain obsolete slots so gc may free some space */
+		if (logfs_garbage_collect(logfs) != 0) {
+			return -5;
+		}
+		/* Check one more time just to be sure we actually free'd some space */
+		if (logfs_log_is_full(logfs)) {
+			/*
+			 * Log is still full even after gc!
+			 * NOTE: This should not happen since the filesystem wasn't full
+			 *       when we checked above so gc should have helped.
+			 */
+			PIOS_DEBUG_Assert(0);
+			return -6;
+		}
+	}
+
+	/* We have room for our new object.  Append it to the log. */
+	if (logfs_append_to_log(logfs, obj_id, obj_inst_id, obj_data, obj_size) != 0) {
+		/* Error during append */
+		return -7;
+	}
+
+	/* Object successfully written to the log */
 	return 0;
 }
 
+/* NOTE: Must be called while holding the flash transaction lock */
+static int8_t logfs_load_object (const struct logfs_state *logfs, uint32_t obj_id, uint16_t obj_inst_id, uint8_t *obj_data, uint16_t obj_size)
+{
+	/* Find the object in the log */
+	int32_t pos = logfs_index_find(logfs, obj_id, obj_inst_id);
+	if (pos < 0) {
+		/* Object does not exist in fs */
+		return -3;
+	}
+
+	/* Sanity check what we've found */
+	const struct logfs_slot_entry *entry = &logfs->index[pos];
+	if (entry->obj_size != obj_size) {
+		/* Object sizes don't match.  Not safe to copy contents. */
+		return -4;
+	}
+
+	/* Read the contents of the object from the log */
+	if (obj_size > 0) {
+		uintptr_t slot_addr = logfs_get_addr (logfs, logfs->active_arena_id, entry->slot_id);
+		if (PIOS_FLASH_read_data(logfs->partition_id,
+						slot_addr + sizeof(struct slot_header),
+						(uint8_t *)obj_data,
+						obj_size) != 0) {
+			/* Failed to read object data from the log */
+			return -5;
+		}
+	}
+
+	/* Object successfully loaded */
+	return 0;
+}
 
 /**********************************
  *
@@ -876,77 +1016,152 @@ int32_t PIOS_FLASHFS_ObjSave(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst
 		goto out_exit;
 	}
 
-	if (logfs_delete_object (logfs, obj_id, obj_inst_id) != 0) {
-		rc = -3;
-		goto out_end_trans;
+	rc = logfs_save_object(logfs, obj_id, obj_inst_id, obj_data, obj_size);
+
+	PIOS_FLASH_end_transaction(logfs->partition_id);
+
+out_exit:
+	return rc;
+}
+
+/**
+ * @brief Load one object instance from the filesystem
+ * @param[in] fs_id The filesystem to use for this action
+ * @param[in] obj UAVObject ID of the object to load
+ * @param[in] obj_inst_id The instance of the object to load
+ * @param[in] obj_data Buffer to hold the contents of the loaded object
+ * @param[in] obj_size Size of the object to be loaded
+ * @return 0 if success or error code
+ * @retval -1 if fs_id is not a valid filesystem instance
+ * @retval -2 if failed to start transaction
+ * @retval -3 if object not found in filesystem
+ * @retval -4 if object size in filesystem does not exactly match buffer size
+ * @retval -5 if reading the object data from flash fails
+ */
+int32_t PIOS_FLASHFS_ObjLoad(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst_id, uint8_t *obj_data, uint16_t obj_size)
+{
+	int8_t rc;
+
+	struct logfs_state *logfs = (struct logfs_state *)fs_id;
+
+	if (!PIOS_FLASHFS_Logfs_validate(logfs)) {
+		rc = -1;
+		goto out_exit;
 	}
 
-	/*
-	 * All old versions of this object + instance have been invalidated.
-	 * Write the new object.
-	 */
+	PIOS_Assert(obj_size <= (logfs->cfg->slot_size - sizeof(struct slot_header)));
 
-	/* Check if the arena is entirely full. */
-	if (logfs_fs_is_full(logfs)) {
-		/* Note: Filesystem Full means we're full of *active* records so gc won't help at all. */
-		rc = -4;
-		goto out_end_trans;
+	if (PIOS_FLASH_start_transaction(logfs->partition_id) != 0) {
+		rc = -2;
+		goto out_exit;
 	}
 
-	/* Is garbage collection required? */
-	if (logfs_log_is_full(logfs)) {
-		/* Note: Log Full means the log is full but may contain obsolete slots so gc may free some space */
+	rc = logfs_load_object(logfs, obj_id, obj_inst_id, obj_data, obj_size);
+
+	PIOS_FLASH_end_transaction(logfs->partition_id);
+
+out_exit:
+	return rc;
+}
+
+/**
+ * @brief Saves a batch of object instances to the filesystem in one transaction
+ *
+ * Every object takes a new slot, so if the log can't hold the whole batch
+ * any obsolete slots are garbage collected before the first write rather
+ * than partway through.  Only when the arena can't hold the batch on top
+ * of everything already active does garbage collection happen during it.
+ *
+ * @param[in] fs_id The filesystem to use for this action
+ * @param[in] num_objs Number of objects in the batch, used to reserve space
+ * @param[in] next Called for each object in turn, with the transaction held
+ * @param[in] ctx Passed through to next
+ * @param[out] stats Objects saved, garbage collections run and the time taken (may be NULL)
+ * @return 0 if success or error code
+ * @retval -1 if fs_id is not a valid filesystem instance
+ * @retval -2 if failed to start transaction
+ * @retval -3 if garbage collection before the batch failed
+ * @retval -4 if saving one of the objects failed, the ones before it were saved
+ */
+int32_t PIOS_FLASHFS_ObjSaveBatch(uintptr_t fs_id, uint16_t num_objs, pios_flashfs_next_obj next, void *ctx, struct pios_flashfs_batch_stats *stats)
+{
+	int8_t rc;
+	uint32_t start_time = PIOS_DELAY_GetRaw();
+	uint16_t num_saved = 0;
+	uint16_t num_gcs = 0;
+
+	struct logfs_state *logfs = (struct logfs_state *)fs_id;
+
+	if (!PIOS_FLASHFS_Logfs_validate(logfs)) {
+		rc = -1;
+		goto out_exit;
+	}
+
+	PIOS_Assert(next);
+
+	if (PIOS_FLASH_start_transaction(logfs->partition_id) != 0) {
+		rc = -2;
+		goto out_exit;
+	}
+
+	uint16_t gcs_before = logfs->num_gcs;
+	uint16_t num_slots = logfs->cfg->arena_size / logfs->cfg->slot_size;
+	uint16_t num_obsolete_slots = num_slots - 1 - logfs->num_active_slots - logfs->num_free_slots;
+
+	/* Reclaim the obsolete slots now if the batch won't fit in the free ones */
+	if (logfs->num_free_slots < num_objs && num_obsolete_slots > 0) {
 		if (logfs_garbage_collect(logfs) != 0) {
-			rc = -5;
+			rc = -3;
 			goto out_end_trans;
 		}
-		/* Check one more time just to be sure we actually free'd some space */
-		if (logfs_log_is_full(logfs)) {
-			/*
-			 * Log is still full even after gc!
-			 * NOTE: This should not happen since the filesystem wasn't full
-			 *       when we checked above so gc should have helped.
-			 */
-			PIOS_DEBUG_Assert(0);
-			rc = -6;
+	}
+
+	struct pios_flashfs_obj obj;
+	while (next(ctx, &obj)) {
+		PIOS_Assert(obj.obj_size <= (logfs->cfg->slot_size - sizeof(struct slot_header)));
+
+		if (logfs_save_object(logfs, obj.obj_id, obj.obj_inst_id, obj.obj_data, obj.obj_size) != 0) {
+			rc = -4;
 			goto out_end_trans;
 		}
-	}
 
-	/* We have room for our new object.  Append it to the log. */
-	if (logfs_append_to_log(logfs, obj_id, obj_inst_id, obj_data, obj_size) != 0) {
-		/* Error during append */
-		rc = -7;
-		goto out_end_trans;
+		num_saved++;
 	}
 
-	/* Object successfully written to the log */
+	/* Batch successfully written to the log */
 	rc = 0;
 
 out_end_trans:
+	num_gcs = logfs->num_gcs - gcs_before;
 	PIOS_FLASH_end_transaction(logfs->partition_id);
 
 out_exit:
+	if (stats) {
+		stats->num_objs    = num_saved;
+		stats->num_gcs     = num_gcs;
+		stats->duration_us = PIOS_DELAY_DiffuS(start_time);
+	}
+
 	return rc;
 }
 
 /**
- * @brief Load one object instance from the filesystem
+ * @brief Loads a batch of object instances from the filesystem in one transaction
  * @param[in] fs_id The filesystem to use for this action
- * @param[in] obj UAVObject ID of the object to load
- * @param[in] obj_inst_id The instance of the object to load
- * @param[in] obj_data Buffer to hold the contents of the loaded object
- * @param[in] obj_size Size of the object to be loaded
+ * @param[in] next Called for each object in turn, with the transaction held
+ * @param[in] done Called with the result of loading each object, with the transaction held (may be NULL)
+ * @param[in] ctx Passed through to next and done
+ * @param[out] stats Objects loaded and the time taken (may be NULL)
  * @return 0 if success or error code
  * @retval -1 if fs_id is not a valid filesystem instance
  * @retval -2 if failed to start transaction
- * @retval -3 if object not found in filesystem
- * @retval -4 if object size in filesystem does not exactly match buffer size
- * @retval -5 if reading the object data from flash fails
+ * @retval -3 if loading one of the objects failed, the ones before it were loaded
  */
-int32_t PIOS_FLASHFS_ObjLoad(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst_id, uint8_t *obj_data, uint16_t obj_size)
+int32_t PIOS_FLASHFS_ObjLoadBatch(uintptr_t fs_id, pios_flashfs_next_obj next, pios_flashfs_obj_done done, void *ctx, struct pios_flashfs_batch_stats *stats)
 {
 	int8_t rc;
+	uint32_t start_time = PIOS_DELAY_GetRaw();
+	uint16_t num_loaded = 0;
 
 	struct logfs_state *logfs = (struct logfs_state *)fs_id;
 
@@ -955,49 +1170,44 @@ int32_t PIOS_FLASHFS_ObjLoad(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst
 		goto out_exit;
 	}
 
-	PIOS_Assert(obj_size <= (logfs->cfg->slot_size - sizeof(struct slot_header)));
+	PIOS_Assert(next);
 
 	if (PIOS_FLASH_start_transaction(logfs->partition_id) != 0) {
 		rc = -2;
 		goto out_exit;
 	}
 
-	/* Find the object in the log */
-	uint16_t slot_id = 0;
-	struct slot_header slot_hdr;
-	if (logfs_object_find_next (logfs, &slot_hdr, &slot_id, obj_id, obj_inst_id) != 0) {
-		/* Object does not exist in fs */
-		rc = -3;
-		goto out_end_trans;
-	}
+	struct pios_flashfs_obj obj;
+	while (next(ctx, &obj)) {
+		PIOS_Assert(obj.obj_size <= (logfs->cfg->slot_size - sizeof(struct slot_header)));
 
-	/* Sanity check what we've found */
-	if (slot_hdr.obj_size != obj_size) {
-		/* Object sizes don't match.  Not safe to copy contents. */
-		rc = -4;
-		goto out_end_trans;
-	}
+		int8_t obj_rc = logfs_load_object(logfs, obj.obj_id, obj.obj_inst_id, obj.obj_data, obj.obj_size);
 
-	/* Read the contents of the object from the log */
-	if (obj_size > 0) {
-		uintptr_t slot_addr = logfs_get_addr (logfs, logfs->active_arena_id, slot_id);
-		if (PIOS_FLASH_read_data(logfs->partition_id,
-						slot_addr + sizeof(slot_hdr),
-						(uint8_t *)obj_data,
-						obj_size) != 0) {
-			/* Failed to read object data from the log */
-			rc = -5;
+		if (done) {
+			done(ctx, &obj, obj_rc);
+		}
+
+		if (obj_rc != 0) {
+			rc = -3;
 			goto out_end_trans;
 		}
+
+		num_loaded++;
 	}
 
-	/* Object successfully loaded */
+	/* Batch successfully loaded */
 	rc = 0;
 
 out_end_trans:
 	PIOS_FLASH_end_transaction(logfs->partition_id);
 
 out_exit:
+	if (stats) {
+		stats->num_objs    = num_loaded;
+		stats->num_gcs     = 0;
+		stats->duration_us = PIOS_DELAY_DiffuS(start_time);
+	}
+
 	return rc;
 }
 
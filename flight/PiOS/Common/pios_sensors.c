@@ -29,6 +29,7 @@
 
 #include "pios_sensors.h"
 #include <stddef.h>
+#include <string.h>
 
 //! The list of queue handles
 static struct pios_queue *queues[PIOS_SENSOR_LAST];
@@ -104,6 +105,89 @@ uint32_t PIOS_SENSORS_GetSampleRate(enum pios_sensor_type type)
 	return sample_rates[type];
 }
 
+/**
+ * @brief Get the time an update averaging a number of samples covers, at
+ * the sensor's sample rate
+ * @param[in] type The sensor
+ * @param[in] samples Samples in each update
+ * @return the update period in seconds
+ */
+float PIOS_SENSORS_GetUpdatePeriod(enum pios_sensor_type type, uint32_t samples)
+{
+	return samples / (float)PIOS_SENSORS_GetSampleRate(type);
+}
+
+/**
+ * @brief Take a number of gyro samples off a queue, waiting for each, and
+ * average them.  Any further queued samples are left for the next call, so
+ * every average covers the same time.
+ * @param[in] queue The gyro queue
+ * @param[in] samples How many samples to average
+ * @param[in] timeout_ms How long to wait for each sample
+ * @param[out] gyros Average of the samples
+ * @return samples, or 0 if they didn't all arrive in time
+ */
+uint32_t PIOS_SENSORS_ReceiveGyros(struct pios_queue *queue, uint32_t samples, uint32_t timeout_ms, struct pios_sensor_gyro_data *gyros)
+{
+	struct pios_sensor_gyro_data sample;
+
+	memset(gyros, 0, sizeof(*gyros));
+
+	if (samples == 0)
+		return 0;
+
+	for (uint32_t i = 0; i < samples; i++) {
+		if (PIOS_Queue_Receive(queue, &sample, timeout_ms) == false)
+			return 0;
+
+		gyros->x += sample.x;
+		gyros->y += sample.y;
+		gyros->z += sample.z;
+		gyros->temperature += sample.temperature;
+	}
+
+	gyros->x /= samples;
+	gyros->y /= samples;
+	gyros->z /= samples;
+	gyros->temperature /= samples;
+
+	return samples;
+}
+
+/**
+ * @brief Take the accel samples already on a queue, without waiting, and
+ * average them.
+ * @param[in] queue The accel queue
+ * @param[in] max_samples Most samples to take
+ * @param[out] accels Average of the samples
+ * @return number of samples averaged, 0 if none were queued
+ */
+uint32_t PIOS_SENSORS_ReceiveAccels(struct pios_queue *queue, uint32_t max_samples, struct pios_sensor_accel_data *accels)
+{
+	struct pios_sensor_accel_data sample;
+	uint32_t count = 0;
+
+	memset(accels, 0, sizeof(*accels));
+
+	while (count < max_samples && PIOS_Queue_Receive(queue, &sample, 0) != false) {
+		accels->x += sample.x;
+		accels->y += sample.y;
+		accels->z += sample.z;
+		accels->temperature += sample.temperature;
+		count++;
+	}
+
+	if (count == 0)
+		return 0;
+
+	accels->x /= count;
+	accels->y /= count;
+	accels->z /= count;
+	accels->temperature /= count;
+
+	return count;
+}
+
 void PIOS_SENSORS_SetMissing(enum pios_sensor_type type)
 {
 	PIOS_Assert(type < PIOS_SENSOR_LAST);
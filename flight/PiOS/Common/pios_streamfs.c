@@ -29,12 +29,14 @@
 
 #include "pios_flash.h"		     /* PIOS_FLASH_* */
 #include "pios_streamfs_priv.h" /* Internal API */
+#include "pios_streamfs.h"
 #include "pios_mutex.h"
 #include "pios_semaphore.h"
 #include "pios_thread.h"
 
 #include <stdbool.h>
 #include <stddef.h>		/* NULL */
+#include <string.h>		/* memset */
 
 #define MIN(x,y) ((x) < (y) ? (x) : (y))
 
@@ -50,6 +52,13 @@
  * sector has a footer to indicate the file id and the sector id.
  *
  * Arenas map onto sectors. 
+ *
+ * Writes are double buffered.  Data is moved out of the COM buffer into
+ * one buffer, from the sender's context as well as the task's, while the
+ * task programs the other one.  Each buffer ends on a write_size boundary
+ * or at the footer, so page programs stay aligned and never straddle a
+ * sector.  The task also erases the next sector whenever it has nothing
+ * to program, so crossing into it doesn't have to wait for the erase.
  */
 
 #include <pios_com.h>
@@ -87,7 +96,25 @@ struct streamfs_state {
 	uintptr_t rx_in_context;
 	pios_com_callback tx_out_cb;
 	uintptr_t tx_out_context;
-	uint8_t *com_buffer;
+
+	/*
+	 * Write buffers, protected by buf_mutex along with reads from the
+	 * COM buffer.  One is filled while the other waits to be, or is
+	 * being, programmed.
+	 */
+	struct pios_mutex *buf_mutex;
+	uint8_t *buffers[2];
+	uint8_t fill_buffer;
+	uint16_t fill_len;
+	uint16_t fill_size;          /* where this buffer has to end */
+	int32_t fill_arena_offset;   /* where this buffer will be written */
+	bool write_pending;
+	uint16_t write_len;
+
+	/* Whether the arena after the active one is ready to write */
+	bool next_arena_erased;
+
+	struct pios_streamfs_stats stats;
 
 	/* Information for current file handle */
 	bool file_open_writing;
@@ -186,6 +213,39 @@ static struct streamfs_state *streamfs_alloc(void)
 	return(streamfs);
 }
 
+/**
+ * Erase the arena after the active one, unless that has been done already
+ */
+/* NOTE: Must be called while holding the flash transaction lock */
+static int32_t streamfs_erase_next_arena(struct streamfs_state *streamfs)
+{
+	if (streamfs->next_arena_erased)
+		return 0;
+
+	uint32_t next_arena = (streamfs->active_file_arena + 1) % streamfs->partition_arenas;
+
+	// Test whether the sector has already been erased by checking the footer
+	struct streamfs_footer footer;
+	uint32_t start_address = streamfs_get_addr(streamfs, next_arena,
+			                                   streamfs->cfg->arena_size - sizeof(footer));
+	if (PIOS_FLASH_read_data(streamfs->partition_id, start_address, (uint8_t *) &footer, sizeof(footer)) != 0) {
+		return -1;
+	}
+
+	for (int i=0; i < sizeof(footer); i++) {
+		if (((uint8_t*)&footer)[i] != 0xFF) {
+			if (streamfs_erase_arena(streamfs, next_arena) != 0) {
+				return -2;
+			}
+			break;
+		}
+	}
+
+	streamfs->next_arena_erased = true;
+
+	return 0;
+}
+
 /**
  * Write footer to current sector and reset pointers for writing to
  * next sector
@@ -206,26 +266,16 @@ static int32_t streamfs_new_sector(struct streamfs_state *streamfs)
 		return -1;
 	}
 
+	// Make sure the next sector is erased, if the task hasn't got to it yet
+	if (streamfs_erase_next_arena(streamfs) != 0) {
+		return -2;
+	}
+
 	// Reset pointers for writing to next sector
 	streamfs->active_file_arena = (streamfs->active_file_arena + 1) % streamfs->partition_arenas;
 	streamfs->active_file_arena_offset = 0;
 	streamfs->active_file_segment++;
-
-	// Test whether the sector has already been erased by checking the footer
-	start_address = streamfs_get_addr(streamfs, streamfs->active_file_arena,
-			                          streamfs->cfg->arena_size - sizeof(footer));
-	if (PIOS_FLASH_read_data(streamfs->partition_id, start_address, (uint8_t *) &footer, sizeof(footer)) != 0) {
-		return -2;
-	}
-
-	for (int i=0; i < sizeof(footer); i++) {
-		if (((uint8_t*)&footer)[i] != 0xFF) {
-			if (streamfs_erase_arena(streamfs, streamfs->active_file_arena) != 0) {
-				return -3;
-			}
-			break;
-		}
-	}
+	streamfs->next_arena_erased = false;
 
 	return 0;
 }
@@ -510,6 +560,147 @@ static int32_t streamfs_scan_filesystem(struct streamfs_state *streamfs)
 	return 0;
 }
 
+/**
+ * Work out how much the fill buffer can take before it must be written,
+ * so that it ends on a write_size boundary and short of the footer
+ */
+static void streamfs_start_fill(struct streamfs_state *streamfs)
+{
+	uint32_t data_size = streamfs->cfg->arena_size - sizeof(struct streamfs_footer);
+
+	if (streamfs->fill_arena_offset >= data_size) {
+		streamfs->fill_arena_offset = 0;
+	}
+
+	streamfs->fill_len = 0;
+	streamfs->fill_size = MIN(streamfs->cfg->write_size - (streamfs->fill_arena_offset % streamfs->cfg->write_size),
+			data_size - streamfs->fill_arena_offset);
+}
+
+/**
+ * Reset the write buffers, for a newly opened file
+ */
+static void streamfs_reset_buffers(struct streamfs_state *streamfs)
+{
+	bool tmp = PIOS_Mutex_Lock(streamfs->buf_mutex, PIOS_MUTEX_TIMEOUT_MAX);
+	PIOS_Assert(tmp);
+
+	streamfs->write_pending = false;
+	streamfs->fill_arena_offset = 0;
+	streamfs_start_fill(streamfs);
+
+	PIOS_Mutex_Unlock(streamfs->buf_mutex);
+}
+
+/**
+ * Start the fill buffer over from where the file really ends, after a
+ * buffer failed to program.  What has been filled so far is kept if it
+ * still fits.
+ */
+/* NOTE: Must be called while holding buf_mutex */
+static void streamfs_rewind_fill(struct streamfs_state *streamfs)
+{
+	uint16_t fill_len = streamfs->fill_len;
+
+	streamfs->fill_arena_offset = streamfs->active_file_arena_offset;
+	streamfs_start_fill(streamfs);
+
+	if (fill_len <= streamfs->fill_size) {
+		streamfs->fill_len = fill_len;
+	} else {
+		streamfs->stats.bytes_dropped += fill_len;
+	}
+}
+
+/**
+ * Move data from the COM buffer into the fill buffer, handing it over to
+ * be programmed each time it's full.  Stops when the COM buffer is empty or
+ * both buffers are full.
+ * @param[in] timeout_ms How long to wait for the buffers
+ * @return true if there is a full buffer to be programmed
+ */
+static bool streamfs_fill(struct streamfs_state *streamfs, uint32_t timeout_ms)
+{
+	if (!PIOS_Mutex_Lock(streamfs->buf_mutex, timeout_ms)) {
+		return false;
+	}
+
+	while (streamfs->tx_out_cb) {
+		if (!streamfs->file_open_writing) {
+			// Drain out pending data while file not open
+			uint8_t *buf = streamfs->buffers[streamfs->fill_buffer];
+			if ((streamfs->tx_out_cb)(streamfs->tx_out_context, buf,
+					streamfs->cfg->write_size, NULL, NULL) == 0) {
+				break;
+			}
+			continue;
+		}
+
+		if (streamfs->fill_len == streamfs->fill_size) {
+			if (streamfs->write_pending) {
+				// Both buffers are full, leave the rest in the COM buffer
+				break;
+			}
+
+			streamfs->write_pending = true;
+			streamfs->write_len = streamfs->fill_len;
+			streamfs->fill_buffer ^= 1;
+			streamfs->fill_arena_offset += streamfs->write_len;
+			streamfs_start_fill(streamfs);
+		}
+
+		uint16_t bytes = (streamfs->tx_out_cb)(streamfs->tx_out_context,
+				&streamfs->buffers[streamfs->fill_buffer][streamfs->fill_len],
+				streamfs->fill_size - streamfs->fill_len, NULL, NULL);
+
+		if (bytes == 0) {
+			break;
+		}
+
+		streamfs->fill_len += bytes;
+	}
+
+	bool write_pending = streamfs->write_pending && streamfs->file_open_writing;
+
+	PIOS_Mutex_Unlock(streamfs->buf_mutex);
+
+	return write_pending;
+}
+
+/**
+ * Program a buffer into the open file, keeping track of how long it took
+ * @return 0 if success, < 0 on failure
+ */
+/* NOTE: Must be called while holding the flash transaction lock */
+static int32_t streamfs_write_buffer(struct streamfs_state *streamfs, uint8_t *data, uint16_t len, uint32_t start_time)
+{
+	if (len == 0) {
+		return 0;
+	}
+
+	if (streamfs_append_to_file(streamfs, data, len) != len) {
+		streamfs->stats.bytes_dropped += len;
+		return -1;
+	}
+
+	uint32_t latency_us = PIOS_DELAY_DiffuS(start_time);
+
+	streamfs->stats.bytes_written += len;
+	if (latency_us > streamfs->stats.write_latency_max_us) {
+		streamfs->stats.write_latency_max_us = latency_us;
+	}
+
+	// Average over the last few buffers
+	if (streamfs->stats.write_latency_avg_us == 0) {
+		streamfs->stats.write_latency_avg_us = latency_us;
+	} else {
+		streamfs->stats.write_latency_avg_us +=
+			((int32_t) latency_us - (int32_t) streamfs->stats.write_latency_avg_us) / 8;
+	}
+
+	return 0;
+}
+
 static void PIOS_STREAMFS_Task(void *parameters)
 {
 	struct streamfs_state *streamfs = parameters;
@@ -518,17 +709,10 @@ static void PIOS_STREAMFS_Task(void *parameters)
 	PIOS_Assert(tmp);
 
 	while (1) {
-		int32_t bytes_to_write = 0;
-
-		if (streamfs->tx_out_cb) {
-			bytes_to_write = (streamfs->tx_out_cb)(
-				streamfs->tx_out_context,
-				streamfs->com_buffer,
-				streamfs->cfg->write_size,
-				NULL, NULL);
-		}
+		bool write_pending = streamfs_fill(streamfs, PIOS_MUTEX_TIMEOUT_MAX);
 
-		if (bytes_to_write <= 0) {
+		if (!write_pending &&
+				(!streamfs->file_open_writing || streamfs->next_arena_erased)) {
 			// Block here until woken.
 			PIOS_Mutex_Unlock(streamfs->mutex);
 			PIOS_Semaphore_Take(streamfs->sem, PIOS_SEMAPHORE_TIMEOUT_MAX);
@@ -537,10 +721,7 @@ static void PIOS_STREAMFS_Task(void *parameters)
 			continue;
 		}
 
-		if (!streamfs->file_open_writing) {
-			// Drain out pending data while file not open
-			continue;
-		}
+		uint32_t start_time = PIOS_DELAY_GetRaw();
 
 		if (PIOS_FLASH_start_transaction(streamfs->partition_id) != 0) {
 			PIOS_Mutex_Unlock(streamfs->mutex);
@@ -550,18 +731,28 @@ static void PIOS_STREAMFS_Task(void *parameters)
 			continue;
 		}
 
-		// Flush available data from PIOS_COM interface to
-		// file system
-		while (bytes_to_write > 0) {
-			if (streamfs_append_to_file(streamfs, streamfs->com_buffer, bytes_to_write) != 0) {
-				break;
-			}
+		if (write_pending) {
+			// The sender keeps filling the other buffer meanwhile
+			int32_t ret = streamfs_write_buffer(streamfs,
+					streamfs->buffers[streamfs->fill_buffer ^ 1],
+					streamfs->write_len, start_time);
 
-			bytes_to_write = (streamfs->tx_out_cb)(
-					streamfs->tx_out_context,
-					streamfs->com_buffer,
-					streamfs->cfg->write_size,
-					NULL, NULL);
+			tmp = PIOS_Mutex_Lock(streamfs->buf_mutex, PIOS_MUTEX_TIMEOUT_MAX);
+			PIOS_Assert(tmp);
+			if (ret != 0) {
+				// The fill buffer was placed after the one just lost
+				streamfs_rewind_fill(streamfs);
+			}
+			streamfs->write_pending = false;
+			PIOS_Mutex_Unlock(streamfs->buf_mutex);
+		} else if (streamfs_erase_next_arena(streamfs) != 0) {
+			// Leave it for streamfs_new_sector to retry
+			PIOS_FLASH_end_transaction(streamfs->partition_id);
+			PIOS_Mutex_Unlock(streamfs->mutex);
+			PIOS_Thread_Sleep(50);	// Don't spin
+			tmp = PIOS_Mutex_Lock(streamfs->mutex, PIOS_MUTEX_TIMEOUT_MAX);
+			PIOS_Assert(tmp);
+			continue;
 		}
 
 		PIOS_FLASH_end_transaction(streamfs->partition_id);
@@ -610,11 +801,14 @@ int32_t PIOS_STREAMFS_Init(uintptr_t *fs_id, const struct streamfs_cfg *cfg, enu
 		goto out_exit;
 	}
 
-	streamfs->com_buffer = (uint8_t *)PIOS_malloc(cfg->write_size);
-	if (!streamfs->com_buffer) {
+	/* Allocated together, from memory the flash driver can DMA from */
+	streamfs->buffers[0] = (uint8_t *)PIOS_malloc(2 * cfg->write_size);
+	if (!streamfs->buffers[0]) {
 		PIOS_free(streamfs);
 		return -1;
 	}
+	streamfs->buffers[1] = streamfs->buffers[0] + cfg->write_size;
+	streamfs->fill_buffer = 0;
 
 	/* Bind configuration parameters to this filesystem instance */
 	streamfs->cfg            = cfg;	/* filesystem configuration */
@@ -627,6 +821,9 @@ int32_t PIOS_STREAMFS_Init(uintptr_t *fs_id, const struct streamfs_cfg *cfg, enu
 	streamfs->active_file_id           = 0;
 	streamfs->active_file_arena        = 0;
 	streamfs->active_file_arena_offset = 0;
+	streamfs->next_arena_erased        = false;
+
+	memset(&streamfs->stats, 0, sizeof(streamfs->stats));
 
 	streamfs->mutex = PIOS_Mutex_Create();
 
@@ -635,6 +832,15 @@ int32_t PIOS_STREAMFS_Init(uintptr_t *fs_id, const struct streamfs_cfg *cfg, enu
 		goto out_exit;
 	}
 
+	streamfs->buf_mutex = PIOS_Mutex_Create();
+
+	if (!streamfs->buf_mutex) {
+		rc = -1;
+		goto out_exit;
+	}
+
+	streamfs_reset_buffers(streamfs);
+
 	streamfs->sem = PIOS_Semaphore_Create();
 
 	if (!streamfs->sem) {
@@ -762,6 +968,8 @@ int32_t PIOS_STREAMFS_OpenWrite(uintptr_t fs_id)
 	streamfs->active_file_segment = 0;
 	streamfs->active_file_arena = streamfs_find_new_sector(streamfs);
 	streamfs->active_file_arena_offset = 0;
+	streamfs->next_arena_erased = false;
+	streamfs_reset_buffers(streamfs);
 	streamfs->file_open_writing = true;
 
 	// Erase this sector to prepare for streaming
@@ -856,6 +1064,27 @@ int32_t PIOS_STREAMFS_MinFileId(uintptr_t fs_id)
 	return streamfs->min_file_id;
 }
 
+/**
+ * Get the write statistics since the filesystem was initialised
+ *
+ * @param[in] fs_id the streaming device handle
+ * @param[out] stats the statistics
+ * @returns 0 if successful, <0 if not
+ */
+int32_t PIOS_STREAMFS_GetStats(uintptr_t fs_id, struct pios_streamfs_stats *stats)
+{
+	struct streamfs_state *streamfs = (struct streamfs_state *)
+		PIOS_COM_GetDriverCtx(fs_id);
+
+	if (!streamfs_validate(streamfs)) {
+		return -1;
+	}
+
+	*stats = streamfs->stats;
+
+	return 0;
+}
+
 int32_t PIOS_STREAMFS_MaxFileId(uintptr_t fs_id)
 {
 	struct streamfs_state *streamfs = (struct streamfs_state *)
@@ -905,6 +1134,26 @@ int32_t PIOS_STREAMFS_Close(uintptr_t fs_id)
 		goto out_exit;
 	}
 
+	// Flush whatever is still buffered, oldest first
+	bool tmp = PIOS_Mutex_Lock(streamfs->buf_mutex, PIOS_MUTEX_TIMEOUT_MAX);
+	PIOS_Assert(tmp);
+
+	uint32_t start_time = PIOS_DELAY_GetRaw();
+
+	if (streamfs->write_pending) {
+		if (streamfs_write_buffer(streamfs, streamfs->buffers[streamfs->fill_buffer ^ 1],
+				streamfs->write_len, start_time) != 0) {
+			streamfs_rewind_fill(streamfs);
+		}
+		streamfs->write_pending = false;
+	}
+
+	streamfs_write_buffer(streamfs, streamfs->buffers[streamfs->fill_buffer],
+			streamfs->fill_len, start_time);
+	streamfs->fill_len = 0;
+
+	PIOS_Mutex_Unlock(streamfs->buf_mutex);
+
 	if (streamfs->active_file_arena_offset != 0) {
 		// Close segment when something has been written. This avoids creating
 		// null files with an open/close operation
@@ -914,8 +1163,6 @@ int32_t PIOS_STREAMFS_Close(uintptr_t fs_id)
 		}
 	}
 
-
-	// TODO: make sure to flush remaining data
 	streamfs->file_open_writing = false;
 
 	if (streamfs_scan_filesystem(streamfs) != 0) {
@@ -1015,6 +1262,13 @@ static void PIOS_STREAMFS_TxStart(uintptr_t fs_id, uint16_t tx_bytes_avail)
 	bool valid = streamfs_validate(streamfs);
 	PIOS_Assert(valid);
 
+	/*
+	 * Move the data along from the sender's context, so it doesn't sit
+	 * in the COM buffer while the task programs flash.  If the task has
+	 * the buffers right now it will pick the data up itself.
+	 */
+	streamfs_fill(streamfs, 0);
+
 	PIOS_Semaphore_Give(streamfs->sem);
 }
 
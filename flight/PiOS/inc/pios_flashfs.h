@@ -26,11 +26,38 @@
 #ifndef PIOS_FLASHFS_H_
 #define PIOS_FLASHFS_H_
 
+#include <stdbool.h>
 #include <stdint.h>
 
+/*
+ * One object instance of a batch save or load
+ */
+struct pios_flashfs_obj {
+	uint32_t obj_id;
+	uint16_t obj_inst_id;
+	uint16_t obj_size;
+	uint8_t *obj_data;
+};
+
+/*
+ * Fills in the next object of a batch, returning false when there are no
+ * more.  These run with the flash transaction held so mustn't use the
+ * filesystem themselves.
+ */
+typedef bool (*pios_flashfs_next_obj)(void *ctx, struct pios_flashfs_obj *obj);
+typedef void (*pios_flashfs_obj_done)(void *ctx, const struct pios_flashfs_obj *obj, int32_t rc);
+
+struct pios_flashfs_batch_stats {
+	uint16_t num_objs;     /* objects saved or loaded */
+	uint16_t num_gcs;      /* garbage collections run */
+	uint32_t duration_us;  /* including waiting for the transaction */
+};
+
 int32_t PIOS_FLASHFS_Format(uintptr_t fs_id);
 int32_t PIOS_FLASHFS_ObjSave(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst_id, uint8_t * obj_data, uint16_t obj_size);
 int32_t PIOS_FLASHFS_ObjLoad(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst_id, uint8_t * obj_data, uint16_t obj_size);
 int32_t PIOS_FLASHFS_ObjDelete(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst_id);
+int32_t PIOS_FLASHFS_ObjSaveBatch(uintptr_t fs_id, uint16_t num_objs, pios_flashfs_next_obj next, void *ctx, struct pios_flashfs_batch_stats *stats);
+int32_t PIOS_FLASHFS_ObjLoadBatch(uintptr_t fs_id, pios_flashfs_next_obj next, pios_flashfs_obj_done done, void *ctx, struct pios_flashfs_batch_stats *stats);
 
 #endif	/* PIOS_FLASHFS_H_ */
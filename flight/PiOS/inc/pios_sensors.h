@@ -115,6 +115,15 @@ void PIOS_SENSORS_SetSampleRate(enum pios_sensor_type type, uint32_t sample_rate
 //! Get the sample rate of a sensor (Hz)
 uint32_t PIOS_SENSORS_GetSampleRate(enum pios_sensor_type type);
 
+//! Time an update made of a number of samples covers (s)
+float PIOS_SENSORS_GetUpdatePeriod(enum pios_sensor_type type, uint32_t samples);
+
+//! Wait for a number of gyro samples and average them
+uint32_t PIOS_SENSORS_ReceiveGyros(struct pios_queue *queue, uint32_t samples, uint32_t timeout_ms, struct pios_sensor_gyro_data *gyros);
+
+//! Average the accel samples already queued, up to a limit
+uint32_t PIOS_SENSORS_ReceiveAccels(struct pios_queue *queue, uint32_t max_samples, struct pios_sensor_accel_data *accels);
+
 //! Assert that an optional (non-accel/gyro), but expected sensor is missing
 void PIOS_SENSORS_SetMissing(enum pios_sensor_type type);
 
@@ -28,6 +28,13 @@
 
 #include <stdint.h>
 
+struct pios_streamfs_stats {
+	uint32_t bytes_written;
+	uint32_t bytes_dropped;        /* lost to failed flash writes */
+	uint32_t write_latency_avg_us; /* to program one buffer */
+	uint32_t write_latency_max_us;
+};
+
 /* fs_id here is actually the com driver ID, to avoid having to do too
  * much bookkeepin' */
 int32_t PIOS_STREAMFS_Format(uintptr_t fs_id);
@@ -37,6 +44,7 @@ int32_t PIOS_STREAMFS_MinFileId(uintptr_t fs_id);
 int32_t PIOS_STREAMFS_MaxFileId(uintptr_t fs_id);
 int32_t PIOS_STREAMFS_Close(uintptr_t fs_id);
 int32_t PIOS_STREAMFS_Read(uintptr_t fs_id, uint8_t *data, uint32_t len);
+int32_t PIOS_STREAMFS_GetStats(uintptr_t fs_id, struct pios_streamfs_stats *stats);
 
 
 #endif	/* PIOS_FLASHFS_STREAMFS_H_ */
@@ -0,0 +1,54 @@
+/**
+ ******************************************************************************
+ * @file       pios_deadline.h
+ * @author     dRonin, http://dronin.org Copyright (C) 2017
+ * @addtogroup PIOS PIOS Core hardware abstraction layer
+ * @{
+ * @addtogroup PIOS_Deadline Wait deadlines
+ * @{
+ * @brief Absolute deadlines for timed waits on the POSIX target
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef PIOS_DEADLINE_H_
+#define PIOS_DEADLINE_H_
+
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * Clock that condition variable waits are measured against.  Where the
+ * platform allows condvars on the monotonic clock we use it, so waits
+ * don't stretch or shrink when the wall clock is stepped.
+ */
+#ifdef __linux__
+#define PIOS_DEADLINE_CLOCK CLOCK_MONOTONIC
+#else
+#define PIOS_DEADLINE_CLOCK CLOCK_REALTIME
+#endif
+
+void PIOS_Deadline_Cond_Init(pthread_cond_t *cond);
+void PIOS_Deadline_From_Now(struct timespec *abstime, clockid_t clock,
+		uint32_t timeout_ms);
+int PIOS_Deadline_Mutex_Lock(pthread_mutex_t *mutex, uint32_t timeout_ms);
+
+#endif /* PIOS_DEADLINE_H_ */
+
+/**
+  * @}
+  * @}
+  */
@@ -0,0 +1,120 @@
+/**
+ ******************************************************************************
+ * @file       pios_deadline.c
+ * @author     dRonin, http://dronin.org Copyright (C) 2017
+ * @addtogroup PIOS PIOS Core hardware abstraction layer
+ * @{
+ * @addtogroup PIOS_Deadline Wait deadlines
+ * @{
+ * @brief Absolute deadlines for timed waits on the POSIX target
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#include <pios.h>
+#include <pios_deadline.h>
+
+#define NSEC_PER_SEC 1000000000
+
+/**
+ * Initialize a condition variable whose timed waits use
+ * PIOS_DEADLINE_CLOCK.
+ * \param[out] cond The condition variable
+ */
+void PIOS_Deadline_Cond_Init(pthread_cond_t *cond)
+{
+	pthread_condattr_t attr;
+
+	if (pthread_condattr_init(&attr)) {
+		abort();
+	}
+
+#ifdef __linux__
+	if (pthread_condattr_setclock(&attr, PIOS_DEADLINE_CLOCK)) {
+		abort();
+	}
+#endif
+
+	if (pthread_cond_init(cond, &attr)) {
+		abort();
+	}
+
+	pthread_condattr_destroy(&attr);
+}
+
+/**
+ * Compute the absolute time timeout_ms from now.
+ * \param[out] abstime The deadline
+ * \param[in] clock The clock the deadline will be compared against
+ * \param[in] timeout_ms Relative timeout
+ */
+void PIOS_Deadline_From_Now(struct timespec *abstime, clockid_t clock,
+		uint32_t timeout_ms)
+{
+	clock_gettime(clock, abstime);
+
+	abstime->tv_sec += timeout_ms / 1000;
+	abstime->tv_nsec += (timeout_ms % 1000) * 1000000;
+
+	/* tv_nsec must stay within [0, 1e9) or the wait fails with EINVAL */
+	if (abstime->tv_nsec >= NSEC_PER_SEC) {
+		abstime->tv_nsec -= NSEC_PER_SEC;
+		abstime->tv_sec += 1;
+	}
+}
+
+/**
+ * Lock a mutex, giving up after timeout_ms.
+ * \param[in] mutex The mutex
+ * \param[in] timeout_ms Relative timeout
+ * \return 0 if locked, otherwise an error number as from pthread_mutex_lock
+ */
+int PIOS_Deadline_Mutex_Lock(pthread_mutex_t *mutex, uint32_t timeout_ms)
+{
+	if (timeout_ms == 0) {
+		return pthread_mutex_trylock(mutex);
+	}
+
+#if defined(_GNU_SOURCE) && defined(__GLIBC__) && \
+	(__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 30))
+	struct timespec abstime;
+
+	PIOS_Deadline_From_Now(&abstime, CLOCK_MONOTONIC, timeout_ms);
+
+	return pthread_mutex_clocklock(mutex, CLOCK_MONOTONIC, &abstime);
+#elif defined(__linux__)
+	struct timespec abstime;
+
+	PIOS_Deadline_From_Now(&abstime, CLOCK_REALTIME, timeout_ms);
+
+	return pthread_mutex_timedlock(mutex, &abstime);
+#else
+	/* MacOSX does not have pthread_mutex_timedlock so these
+	 * semantics are not possible.
+	 */
+	abort();
+
+	return EINVAL;
+#endif
+}
+
+/**
+  * @}
+  * @}
+  */
@@ -17,6 +17,11 @@ struct flash_posix_dev {
 	const struct pios_flash_posix_cfg * cfg;
 	bool transaction_in_progress;
 	FILE * flash_file;
+	uint32_t read_count;
+	uint32_t write_count;
+#if defined(PIOS_FLASH_POSIX_FAULTS)
+	uint32_t writes_to_fail;
+#endif
 };
 
 static struct flash_posix_dev * PIOS_Flash_Posix_Alloc(void)
@@ -42,6 +47,11 @@ int32_t PIOS_Flash_Posix_Init(uintptr_t * chip_id, const struct pios_flash_posix
 
 	flash_dev->cfg = cfg;
 	flash_dev->transaction_in_progress = false;
+	flash_dev->read_count = 0;
+	flash_dev->write_count = 0;
+#if defined(PIOS_FLASH_POSIX_FAULTS)
+	flash_dev->writes_to_fail = 0;
+#endif
 
 	flash_dev->flash_file = fopen ("theflash.bin", "r+");
 	if (flash_dev->flash_file == NULL) {
@@ -68,6 +78,32 @@ void PIOS_Flash_Posix_Destroy(uintptr_t chip_id)
 	PIOS_free(flash_dev);
 }
 
+/* Number of reads since init, to check how much flash traffic an operation costs */
+uint32_t PIOS_Flash_Posix_GetReadCount(uintptr_t chip_id)
+{
+	struct flash_posix_dev * flash_dev = (struct flash_posix_dev *)chip_id;
+
+	return flash_dev->read_count;
+}
+
+/* Number of page programs since init, failed ones included */
+uint32_t PIOS_Flash_Posix_GetWriteCount(uintptr_t chip_id)
+{
+	struct flash_posix_dev * flash_dev = (struct flash_posix_dev *)chip_id;
+
+	return flash_dev->write_count;
+}
+
+#if defined(PIOS_FLASH_POSIX_FAULTS)
+/* Make the next few page programs fail without touching the flash */
+void PIOS_Flash_Posix_FailWrites(uintptr_t chip_id, uint32_t count)
+{
+	struct flash_posix_dev * flash_dev = (struct flash_posix_dev *)chip_id;
+
+	flash_dev->writes_to_fail = count;
+}
+#endif /* PIOS_FLASH_POSIX_FAULTS */
+
 /**********************************
  *
  * Provide a PIOS flash driver API
@@ -130,6 +166,15 @@ static int32_t PIOS_Flash_Posix_WriteData(uintptr_t chip_id, uint32_t chip_offse
 
 	assert(flash_dev->transaction_in_progress);
 
+	flash_dev->write_count++;
+
+#if defined(PIOS_FLASH_POSIX_FAULTS)
+	if (flash_dev->writes_to_fail > 0) {
+		flash_dev->writes_to_fail--;
+		return -1;
+	}
+#endif /* PIOS_FLASH_POSIX_FAULTS */
+
 	if (fseek (flash_dev->flash_file, chip_offset, SEEK_SET) != 0) {
 		assert(0);
 	}
@@ -153,6 +198,8 @@ static int32_t PIOS_Flash_Posix_ReadData(uintptr_t chip_id, uint32_t chip_offset
 
 	assert(flash_dev->transaction_in_progress);
 
+	flash_dev->read_count++;
+
 	if (fseek (flash_dev->flash_file, chip_offset, SEEK_SET) != 0) {
 		assert(0);
 	}
@@ -30,6 +30,7 @@
 
 #include <pios.h>
 #include <pios_mutex.h>
+#include <pios_deadline.h>
 
 struct pios_mutex {
 	pthread_mutex_t mutex;
@@ -72,30 +73,7 @@ bool PIOS_Mutex_Lock(struct pios_mutex *mtx, uint32_t timeout_ms)
 
 		PIOS_Assert(!ret);
 	} else {
-#ifdef __linux__
-		struct timespec abstime;
-
-		clock_gettime(CLOCK_REALTIME, &abstime);
-
-		abstime.tv_nsec += (timeout_ms % 1000) * 1000000;
-		abstime.tv_sec += timeout_ms / 1000;
-
-		if (abstime.tv_nsec > 1000000000) {
-			abstime.tv_nsec -= 1000000000;
-			abstime.tv_sec += 1;
-		}
-
-		ret = pthread_mutex_timedlock(&mtx->mutex, &abstime);
-#else
-		/* MacOSX does not have pthread_mutex_timedlock so these
-		 * semantics are not possible.
-		 */
-		if (timeout_ms == 0) {
-			ret = pthread_mutex_trylock(&mtx->mutex);
-		} else {
-			abort();
-		}
-#endif
+		ret = PIOS_Deadline_Mutex_Lock(&mtx->mutex, timeout_ms);
 	}
 
 	return (ret == 0);
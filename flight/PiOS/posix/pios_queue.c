@@ -30,50 +30,74 @@
 
 #include <pios_queue.h>
 #include <pios_thread.h>
+#include <pios_deadline.h>
 
+/*
+ * The queue contents are a circ_queue, which is safe without locks for one
+ * reader and one writer.  Senders serialize amongst themselves with
+ * send_lock and receivers with recv_lock; with a single producer and a
+ * single consumer those locks are never contended and stay in userspace.
+ *
+ * mutex and cond are only used to sleep when the queue is full or empty.
+ * Sleepers advertise themselves in waiters, and the other side only takes
+ * the mutex to wake them when that's nonzero.
+ */
 struct pios_queue {
 #define QUEUE_MAGIC 75657551	/* 'Queu' */
 	uint32_t magic;
 
+	pthread_mutex_t send_lock;
+	pthread_mutex_t recv_lock;
+
 	pthread_mutex_t mutex;
 	pthread_cond_t cond;
 
+	uint32_t waiters;
+
 	uint16_t item_size;
 	uint16_t q_len;
 
 	circ_queue_t queue;
 };
 
-struct pios_queue *PIOS_Queue_Create(size_t queue_length, size_t item_size)
+static void init_mutex(pthread_mutex_t *mutex)
 {
-	struct pios_queue *q = PIOS_malloc(sizeof(*q));
+	pthread_mutexattr_t attr;
 
-	if (!q) {
-		return NULL;
+	if (pthread_mutexattr_init(&attr)) {
+		abort();
 	}
 
-        pthread_mutexattr_t attr;
+	pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
 
-        if (pthread_mutexattr_init(&attr)) {
-                abort();
-        }
-
-        pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
-
-	if (pthread_mutex_init(&q->mutex, &attr)) {
+	if (pthread_mutex_init(mutex, &attr)) {
 		abort();
 	}
+}
 
-	if (pthread_cond_init(&q->cond, NULL)) {
-		abort();
+struct pios_queue *PIOS_Queue_Create(size_t queue_length, size_t item_size)
+{
+	struct pios_queue *q = PIOS_malloc(sizeof(*q));
+
+	if (!q) {
+		return NULL;
 	}
 
+	init_mutex(&q->send_lock);
+	init_mutex(&q->recv_lock);
+	init_mutex(&q->mutex);
+
+	PIOS_Deadline_Cond_Init(&q->cond);
+
+	q->waiters = 0;
 	q->item_size = item_size;
 	q->q_len = queue_length;
 
 	q->queue = circ_queue_new(item_size, queue_length+1);
 
 	if (!q->queue) {
+		pthread_mutex_destroy(&q->send_lock);
+		pthread_mutex_destroy(&q->recv_lock);
 		pthread_mutex_destroy(&q->mutex);
 		pthread_cond_destroy(&q->cond);
 
@@ -90,6 +114,8 @@ void PIOS_Queue_Delete(struct pios_queue *queuep)
 {
 	PIOS_Assert(queuep->magic == QUEUE_MAGIC);
 
+	pthread_mutex_destroy(&queuep->send_lock);
+	pthread_mutex_destroy(&queuep->recv_lock);
 	pthread_mutex_destroy(&queuep->mutex);
 	pthread_cond_destroy(&queuep->cond);
 
@@ -98,43 +124,98 @@ void PIOS_Queue_Delete(struct pios_queue *queuep)
 	free(queuep);
 }
 
-bool PIOS_Queue_Send(struct pios_queue *queuep,
-		const void *itemp, uint32_t timeout_ms)
+static bool try_send(struct pios_queue *queuep, void *itemp)
 {
-	PIOS_Assert(queuep->magic == QUEUE_MAGIC);
+	pthread_mutex_lock(&queuep->send_lock);
+	bool ret = circ_queue_write_data(queuep->queue, itemp, 1);
+	pthread_mutex_unlock(&queuep->send_lock);
 
-	struct timespec abstime;
+	return ret;
+}
 
-	if (timeout_ms != PIOS_QUEUE_TIMEOUT_MAX) {
-		clock_gettime(CLOCK_REALTIME, &abstime);
+static bool try_receive(struct pios_queue *queuep, void *itemp)
+{
+	pthread_mutex_lock(&queuep->recv_lock);
+	bool ret = circ_queue_read_data(queuep->queue, itemp, 1);
+	pthread_mutex_unlock(&queuep->recv_lock);
 
-		abstime.tv_nsec += (timeout_ms % 1000) * 1000000;
-		abstime.tv_sec += timeout_ms / 1000;
+	return ret;
+}
 
-		if (abstime.tv_nsec > 1000000000) {
-			abstime.tv_nsec -= 1000000000;
-			abstime.tv_sec += 1;
-		}
+/**
+ * Wake anyone sleeping on the other end of the queue after an item was
+ * added or removed.
+ */
+static void wake_waiters(struct pios_queue *queuep)
+{
+	/* Order our index update before looking for sleepers; pairs with
+	 * the increment in wait_for() before the sleeper's last retry. */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	if (__atomic_load_n(&queuep->waiters, __ATOMIC_RELAXED)) {
+		pthread_mutex_lock(&queuep->mutex);
+		pthread_cond_broadcast(&queuep->cond);
+		pthread_mutex_unlock(&queuep->mutex);
 	}
+}
+
+/**
+ * Sleep until op succeeds or the timeout expires.
+ */
+static bool wait_for(struct pios_queue *queuep,
+		bool (*op)(struct pios_queue *, void *), void *itemp,
+		uint32_t timeout_ms)
+{
+	struct timespec abstime;
+
+	if (timeout_ms != PIOS_QUEUE_TIMEOUT_MAX) {
+		PIOS_Deadline_From_Now(&abstime, PIOS_DEADLINE_CLOCK,
+				timeout_ms);
+	}
+
+	bool ret = true;
 
 	pthread_mutex_lock(&queuep->mutex);
 
-	while (!circ_queue_write_data(queuep->queue, itemp, 1)) {
+	__atomic_add_fetch(&queuep->waiters, 1, __ATOMIC_SEQ_CST);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	while (!op(queuep, itemp)) {
 		if (timeout_ms != PIOS_QUEUE_TIMEOUT_MAX) {
 			if (pthread_cond_timedwait(&queuep->cond,
 					&queuep->mutex, &abstime)) {
-				pthread_mutex_unlock(&queuep->mutex);
-				return false;
+				ret = false;
+				break;
 			}
 		} else {
 			pthread_cond_wait(&queuep->cond, &queuep->mutex);
 		}
 	}
 
-	pthread_cond_broadcast(&queuep->cond);
+	__atomic_sub_fetch(&queuep->waiters, 1, __ATOMIC_SEQ_CST);
 
 	pthread_mutex_unlock(&queuep->mutex);
 
+	return ret;
+}
+
+bool PIOS_Queue_Send(struct pios_queue *queuep,
+		const void *itemp, uint32_t timeout_ms)
+{
+	PIOS_Assert(queuep->magic == QUEUE_MAGIC);
+
+	if (!try_send(queuep, (void *) itemp)) {
+		if (timeout_ms == 0) {
+			return false;
+		}
+
+		if (!wait_for(queuep, try_send, (void *) itemp, timeout_ms)) {
+			return false;
+		}
+	}
+
+	wake_waiters(queuep);
+
 	return true;
 }
 
@@ -155,37 +236,17 @@ bool PIOS_Queue_Receive(struct pios_queue *queuep,
 {
 	PIOS_Assert(queuep->magic == QUEUE_MAGIC);
 
-	struct timespec abstime;
-
-	if (timeout_ms != PIOS_QUEUE_TIMEOUT_MAX) {
-		clock_gettime(CLOCK_REALTIME, &abstime);
-
-		abstime.tv_nsec += (timeout_ms % 1000) * 1000000;
-		abstime.tv_sec += timeout_ms / 1000;
-
-		if (abstime.tv_nsec > 1000000000) {
-			abstime.tv_nsec -= 1000000000;
-			abstime.tv_sec += 1;
+	if (!try_receive(queuep, itemp)) {
+		if (timeout_ms == 0) {
+			return false;
 		}
-	}
 
-	pthread_mutex_lock(&queuep->mutex);
-
-	while (!circ_queue_read_data(queuep->queue, itemp, 1)) {
-		if (timeout_ms != PIOS_QUEUE_TIMEOUT_MAX) {
-			if (pthread_cond_timedwait(&queuep->cond,
-					&queuep->mutex, &abstime)) {
-				pthread_mutex_unlock(&queuep->mutex);
-				return false;
-			}
-		} else {
-			pthread_cond_wait(&queuep->cond, &queuep->mutex);
+		if (!wait_for(queuep, try_receive, itemp, timeout_ms)) {
+			return false;
 		}
 	}
 
-	pthread_cond_broadcast(&queuep->cond);
-
-	pthread_mutex_unlock(&queuep->mutex);
+	wake_waiters(queuep);
 
 	return true;
 }
@@ -28,6 +28,7 @@
 
 #include <pios.h>
 #include <pios_semaphore.h>
+#include <pios_deadline.h>
 
 struct pios_semaphore {
 #define SEMAPHORE_MAGIC 0x616d6553	/* 'Sema' */
@@ -59,9 +60,7 @@ struct pios_semaphore *PIOS_Semaphore_Create(void)
 		abort();
 	}
 
-	if (pthread_cond_init(&s->cond, NULL)) {
-		abort();
-	}
+	PIOS_Deadline_Cond_Init(&s->cond);
 
 	s->given = true;
 
@@ -76,22 +75,15 @@ bool PIOS_Semaphore_Take(struct pios_semaphore *sema, uint32_t timeout_ms)
 
         struct timespec abstime;
 
-        if (timeout_ms != PIOS_QUEUE_TIMEOUT_MAX) {
-                clock_gettime(CLOCK_REALTIME, &abstime);
-
-                abstime.tv_nsec += (timeout_ms % 1000) * 1000000;
-                abstime.tv_sec += timeout_ms / 1000;
-
-                if (abstime.tv_nsec > 1000000000) {
-                        abstime.tv_nsec -= 1000000000;
-                        abstime.tv_sec += 1;
-                }
+        if (timeout_ms != PIOS_SEMAPHORE_TIMEOUT_MAX) {
+                PIOS_Deadline_From_Now(&abstime, PIOS_DEADLINE_CLOCK,
+                                timeout_ms);
         }
 
         pthread_mutex_lock(&sema->mutex);
 
         while (!sema->given) {
-                if (timeout_ms != PIOS_QUEUE_TIMEOUT_MAX) {
+                if (timeout_ms != PIOS_SEMAPHORE_TIMEOUT_MAX) {
                         if (pthread_cond_timedwait(&sema->cond,
                                         &sema->mutex, &abstime)) {
                                 pthread_mutex_unlock(&sema->mutex);
@@ -142,6 +142,15 @@ typedef struct {
 	uint32_t eventCallbackErrors;
 	uint32_t lastCallbackErrorID;
 	uint32_t lastQueueErrorID;
+	uint32_t readContentions;	/** Lock-free reads that raced a writer and fell back to the lock */
+	uint32_t lastReadContentionID;
+	uint32_t instanceBytesAllocated;	/** Heap used for instances 1 and up of multi instance objects */
+	uint32_t instanceBytesUsed;	/** Part of that holding created instances */
+	uint32_t eventsDispatched;	/** Events pumped to their queues and callbacks */
+	uint32_t eventsCoalesced;	/** Events merged into an identical pending one */
+	uint32_t settingsBatchObjs;	/** Objects in the last settings save or load */
+	uint32_t settingsBatchGCs;	/** Flash garbage collections it ran */
+	uint32_t settingsBatchUs;	/** How long it took, including waiting for the flash */
 } UAVObjStats;
 
 typedef void (*new_uavo_instance_cb_t)(uint32_t,uint32_t);
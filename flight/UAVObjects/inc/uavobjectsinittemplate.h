@@ -33,8 +33,15 @@
 
 void UAVObjectsInitializeAll();
 
+#include <stdint.h>
+
 #define UAVOBJECTS_LARGEST $(SIZECALCULATION)
 
+#define UAVOBJECTS_COUNT $(NUMOBJECTS)
+
+/* IDs of all data objects in ascending order (see uavobjectsindex.c) */
+extern const uint32_t uavo_sorted_ids[UAVOBJECTS_COUNT];
+
 #endif /* UAVOBJECTSINIT_H */
 
 /**
@@ -41,6 +41,7 @@
 #include "pios_mutex.h"
 #include "pios_queue.h"
 #include "misc_math.h"
+#include "uavobjectsinit.h"	/* UAVOBJECTS_COUNT, uavo_sorted_ids */
 
 extern uintptr_t pios_uavo_settings_fs_id;
 
@@ -128,29 +129,42 @@ struct UAVOData {
 struct UAVOSingle {
 	struct UAVOData   uavo;
 
-	uint8_t           instance0[];
-	/* 
-	 * Additional space will be malloc'd here to hold the
-	 * the data for this instance.
+	/*
+	 * Sequence count protecting instance0 for lock-free readers.
+	 * Odd while a write is in progress.  Writers must hold the mutex.
+	 * Word aligned, despite the packing, so that it is read and written
+	 * atomically and can't wrap round while a reader is preempted.
 	 */
-} __attribute__((packed));
+	uint32_t          seq __attribute__((aligned(4)));
 
-/* Part of a linked list of instances chained off of a multi instance UAVO. */
-struct UAVOMultiInst {
-	struct UAVOMultiInst * next;
-	uint8_t                instance[];
+	uint8_t           instance0[];
 	/* 
 	 * Additional space will be malloc'd here to hold the
 	 * the data for this instance.
 	 */
 } __attribute__((packed));
 
+/* Number of instances allocated together in one block of a multi instance UAVO */
+#define UAVO_INST_CHUNK 8
+
+/* Initial number of entries in the chunk table of a multi instance UAVO */
+#define UAVO_INST_TABLE_MIN 4
+
 /* Augmented type for Multi Instance Data UAVO */
 struct UAVOMulti {
 	struct UAVOData        uavo;
 
 	uint16_t               num_instances;
-	struct UAVOMultiInst   instance0;
+
+	/*
+	 * Instances 1 and up live in blocks of UAVO_INST_CHUNK instances,
+	 * so that instance N is found without walking anything.  The table
+	 * of blocks doubles in size as needed.
+	 */
+	uint16_t               num_chunks;
+	uint8_t **             chunks;
+
+	uint8_t                instance0[];
 	/*
 	 * Additional space will be malloc'd here to hold the
 	 * the data for instance 0.
@@ -168,11 +182,20 @@ struct UAVOMulti {
 #define LinkedMetaDataPtr(obj) ((UAVObjMetadata*)&((obj)->metaObj.instance0))
 #define MetaObjectId(id) ((id)+1)
 
+/**
+ * Single instance objects are word aligned for their sequence count, which
+ * the packed UAVO types they are handled as don't show.  They are all
+ * allocated as a struct UAVOSingle, so going back to one is safe.
+ */
+#define SingleObj(obj) ((struct UAVOSingle *) __builtin_assume_aligned((obj), 4))
+
 /** all information about instances are dependant on object type **/
 #define ObjSingleInstanceDataOffset(obj) ((void*)(&(( (struct UAVOSingle*)obj )->instance0)))
-#define InstanceDataOffset(inst) ((void*)&(( (struct UAVOMultiInst*)inst )->instance))
 #define InstanceData(instance) (void*)instance
 
+/** single instance data objects are read lock-free, see UAVObjReadSingle **/
+#define IsSingleData(obj) ((obj)->flags.isSingle && !(obj)->flags.isMeta)
+
 // Private functions
 static int32_t sendEvent(struct UAVOBase * obj, uint16_t instId,
 			UAVObjEventType event, void *obj_data, int len);
@@ -186,6 +209,15 @@ static int32_t disconnectObj(UAVObjHandle obj_handle, struct pios_queue *queue,
 
 // Private variables
 static struct UAVOData * uavo_list;
+
+/*
+ * Registered objects indexed by their position in uavo_sorted_ids.
+ * Entries are only ever set once, so lookups can read them without
+ * taking the mutex.
+ */
+static struct UAVOData * uavo_index[UAVOBJECTS_COUNT];
+/* Number of registered objects that are missing from uavo_sorted_ids */
+static uint16_t uavo_unindexed;
 static struct ObjectEventEntry * events_unused;
 static struct ObjectEventEntry * events_unused_throttled;
 static struct pios_recursive_mutex *mutex;
@@ -202,6 +234,8 @@ static const UAVObjMetadata defMetadata = {
 };
 
 static UAVObjStats stats;
+static uint32_t inst_bytes_allocated;
+static uint32_t inst_bytes_used;
 static new_uavo_instance_cb_t newUavObjInstanceCB;
 
 #define UAVO_CB_STACK_SIZE 512
@@ -217,6 +251,8 @@ int32_t UAVObjInitialize()
 {
 	// Initialize variables
 	uavo_list = NULL;
+	memset(uavo_index, 0, sizeof(uavo_index));
+	uavo_unindexed = 0;
 	events_unused = NULL;
 	events_unused_throttled = NULL;
 
@@ -229,6 +265,8 @@ int32_t UAVObjInitialize()
 	cb_stack += UAVO_CB_STACK_SIZE - 4;
 
 	memset(&stats, 0, sizeof(UAVObjStats));
+	inst_bytes_allocated = 0;
+	inst_bytes_used = 0;
 
 	// Create mutex
 	mutex = PIOS_Recursive_Mutex_Create();
@@ -250,6 +288,8 @@ void UAVObjGetStats(UAVObjStats * statsOut)
 {
 	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
 	memcpy(statsOut, &stats, sizeof(UAVObjStats));
+	statsOut->instanceBytesAllocated = inst_bytes_allocated;
+	statsOut->instanceBytesUsed = inst_bytes_used;
 	PIOS_Recursive_Mutex_Unlock(mutex);
 }
 
@@ -297,6 +337,7 @@ static struct UAVOData * UAVObjAllocSingle(uint32_t num_bytes)
 	uavo_base->next_event     = NULL;
 
 	/* Clear the instance data carried in the UAVO */
+	uavo_single->seq = 0;
 	memset(&(uavo_single->instance0), 0, num_bytes);
 
 	/* Give back the generic UAVO part */
@@ -321,15 +362,116 @@ static struct UAVOData * UAVObjAllocMulti(uint32_t num_bytes)
 
 	/* Set up the type-specific part of the UAVO */
 	uavo_multi->num_instances = 1;
+	uavo_multi->num_chunks = 0;
+	uavo_multi->chunks = NULL;
 
 	/* Clear the instance data carried in the UAVO */
-	uavo_multi->instance0.next = NULL;
-	memset (&(uavo_multi->instance0.instance), 0, num_bytes);
+	memset (&(uavo_multi->instance0), 0, num_bytes);
 
 	/* Give back the generic UAVO part */
 	return (&(uavo_multi->uavo));
 }
 
+/**
+ * Mark the start of a write to a single instance object's data.
+ * The caller must hold the mutex.
+ */
+static inline void UAVObjWriteBegin(struct UAVOBase *obj)
+{
+	if (!IsSingleData(obj))
+		return;
+
+	struct UAVOSingle *single = SingleObj(obj);
+
+	__atomic_store_n(&single->seq, single->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/**
+ * Mark the end of a write to a single instance object's data.
+ */
+static inline void UAVObjWriteEnd(struct UAVOBase *obj)
+{
+	if (!IsSingleData(obj))
+		return;
+
+	struct UAVOSingle *single = SingleObj(obj);
+
+	__atomic_store_n(&single->seq, single->seq + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Read a single instance object's data without taking the mutex.
+ *
+ * If a write is in progress or completes during the copy, this falls back
+ * to reading under the mutex rather than spinning: on a single core the
+ * writer can't make progress while we spin, and taking the mutex lets
+ * priority inheritance get it out of the way.
+ */
+static void UAVObjReadSingle(struct UAVOSingle *single, void *dataOut,
+		uint32_t offset, uint32_t size)
+{
+	uint32_t seq = __atomic_load_n(&single->seq, __ATOMIC_ACQUIRE);
+
+	if (!(seq & 1)) {
+		memcpy(dataOut, single->instance0 + offset, size);
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+		if (__atomic_load_n(&single->seq, __ATOMIC_RELAXED) == seq)
+			return;
+	}
+
+	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
+
+	stats.readContentions++;
+	stats.lastReadContentionID = single->uavo.id;
+
+	memcpy(dataOut, single->instance0 + offset, size);
+
+	PIOS_Recursive_Mutex_Unlock(mutex);
+}
+
+/**
+ * Find an object ID in the generated table of known object IDs
+ * \param[in] id The object ID
+ * \return The position of the ID in uavo_sorted_ids, or -1 if not found
+ */
+static int32_t UAVObjIndexFind(uint32_t id)
+{
+	int32_t low = 0;
+	int32_t high = UAVOBJECTS_COUNT - 1;
+
+	while (low <= high) {
+		int32_t mid = (low + high) / 2;
+
+		if (uavo_sorted_ids[mid] == id) {
+			return mid;
+		} else if (uavo_sorted_ids[mid] < id) {
+			low = mid + 1;
+		} else {
+			high = mid - 1;
+		}
+	}
+
+	return -1;
+}
+
+/**
+ * Look up a registered object in the index, without locking
+ * \param[in] id The object ID
+ * \return The object, or NULL if it is not known or not registered yet
+ */
+static struct UAVOData * UAVObjIndexGet(uint32_t id)
+{
+	int32_t pos = UAVObjIndexFind(id);
+
+	if (pos < 0)
+		return NULL;
+
+	return __atomic_load_n(&uavo_index[pos], __ATOMIC_ACQUIRE);
+}
+
 /**************************
  * UAVObject Database APIs
  *************************/
@@ -380,6 +522,14 @@ UAVObjHandle UAVObjRegister(uint32_t id,
 	/* Add the newly created object to the global list of objects */
 	LL_APPEND(uavo_list, uavo_data);
 
+	/* And publish it in the index for lock-free lookup by ID */
+	int32_t index_pos = UAVObjIndexFind(id);
+	if (index_pos >= 0) {
+		__atomic_store_n(&uavo_index[index_pos], uavo_data, __ATOMIC_RELEASE);
+	} else {
+		uavo_unindexed++;
+	}
+
 	/* Initialize object fields and metadata to default values */
 	if (initCb)
 		initCb((UAVObjHandle) uavo_data, 0);
@@ -409,6 +559,20 @@ UAVObjHandle UAVObjGetByID(uint32_t id)
 {
 	UAVObjHandle found_obj = NULL;
 
+	// Look in the index first, this needs no lock
+	struct UAVOData * idx_obj = UAVObjIndexGet(id);
+	if (idx_obj)
+		return &idx_obj->base;
+
+	// Meta objects are not in the index, but their parents are
+	idx_obj = UAVObjIndexGet(id - 1);
+	if (idx_obj && MetaObjectId(idx_obj->id) == id)
+		return &(idx_obj->metaObj.base);
+
+	// Only objects the generator doesn't know about need a list walk
+	if (!uavo_unindexed)
+		return NULL;
+
 	// Get lock
 	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
 
@@ -657,7 +821,9 @@ int32_t UAVObjUnpack(UAVObjHandle obj_handle, uint16_t instId,
 		len = obj->instance_size;
 	}
 
+	UAVObjWriteBegin(obj_handle);
 	memcpy(target, dataIn, len);
+	UAVObjWriteEnd(obj_handle);
 
 	// Fire event
 	sendEvent((struct UAVOBase*)obj_handle, instId, EV_UNPACKED,
@@ -824,10 +990,13 @@ int32_t UAVObjLoad(UAVObjHandle obj_handle, uint16_t instId)
 
 	void *target;
 	int len;
+	int32_t rc = -1;
+
+	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
 
 	if (UAVObjIsMetaobject(obj_handle)) {
 		if (instId != 0)
-			return -1;
+			goto unlock_exit;
 
 		target = MetaDataPtr((struct UAVOMeta *)obj_handle);
 		len = UAVObjGetNumBytes(obj_handle);
@@ -836,37 +1005,44 @@ int32_t UAVObjLoad(UAVObjHandle obj_handle, uint16_t instId)
 		InstanceHandle instEntry = getInstance( (struct UAVOData *)obj_handle, instId);
 
 		if (instEntry == NULL)
-			return -1;
+			goto unlock_exit;
 
 		target = InstanceData(instEntry);
 		len = UAVObjGetNumBytes(obj_handle);
 	}
 
 	// Load the object from the filesystem
-	int32_t rc;
 #if defined(PIOS_INCLUDE_FASTHEAP)
 	rc = PIOS_FLASHFS_ObjLoad(pios_uavo_settings_fs_id,
 			UAVObjGetID(obj_handle),
 			instId,
 			uavobj_load_trampoline,
 			len);
+
+	if (rc != 0)
+		goto unlock_exit;
+
+	UAVObjWriteBegin(obj_handle);
+	memcpy(target, uavobj_load_trampoline, len);
+	UAVObjWriteEnd(obj_handle);
 #else  /* PIOS_INCLUDE_FASTHEAP */
+	UAVObjWriteBegin(obj_handle);
 	rc = PIOS_FLASHFS_ObjLoad(pios_uavo_settings_fs_id,
 			UAVObjGetID(obj_handle),
 			instId,
 			target,
 			len);
-#endif  /* PIOS_INCLUDE_FASTHEAP */
+	UAVObjWriteEnd(obj_handle);
 
 	if (rc != 0)
-		return -1;
-
-#if defined(PIOS_INCLUDE_FASTHEAP)
-	memcpy(target, uavobj_load_trampoline, len);
+		goto unlock_exit;
 #endif  /* PIOS_INCLUDE_FASTHEAP */
 
 	sendEvent((struct UAVOBase*)obj_handle, instId, EV_UNPACKED, target, len);
-	return 0;
+
+unlock_exit:
+	PIOS_Recursive_Mutex_Unlock(mutex);
+	return rc == 0 ? 0 : -1;
 }
 
 /**
@@ -882,31 +1058,96 @@ int32_t UAVObjDeleteById(uint32_t obj_id, uint16_t inst_id)
 	return 0;
 }
 
+/**
+ * Step a batch cursor on to the next settings object.
+ * @param[in] obj The current object, or NULL to start at the beginning
+ * @return the next settings object or NULL at the end of the list
+ */
+static struct UAVOData *nextSettingsObj(struct UAVOData *obj)
+{
+	for (obj = obj ? obj->next : uavo_list; obj; obj = obj->next) {
+		if (UAVObjIsSettings(&obj->base))
+			return obj;
+	}
+
+	return NULL;
+}
+
+/**
+ * Hand the next settings object to a batch save.  Called from within
+ * the flash transaction, one object at a time, so the trampoline can
+ * be reused for each.
+ */
+static bool saveSettingsNext(void *ctx, struct pios_flashfs_obj *fs_obj)
+{
+	struct UAVOData **cursor = (struct UAVOData **) ctx;
+
+	*cursor = nextSettingsObj(*cursor);
+	if (*cursor == NULL)
+		return false;
+
+	InstanceHandle instEntry = getInstance(*cursor, 0);
+	if (instEntry == NULL)
+		return false;
+
+	fs_obj->obj_id = UAVObjGetID((UAVObjHandle) *cursor);
+	fs_obj->obj_inst_id = 0;
+	fs_obj->obj_size = UAVObjGetNumBytes((UAVObjHandle) *cursor);
+#if defined(PIOS_INCLUDE_FASTHEAP)
+	memcpy(uavobj_save_trampoline, InstanceData(instEntry), fs_obj->obj_size);
+	fs_obj->obj_data = uavobj_save_trampoline;
+#else /* PIOS_INCLUDE_FASTHEAP */
+	fs_obj->obj_data = InstanceData(instEntry);
+#endif /* PIOS_INCLUDE_FASTHEAP */
+
+	return true;
+}
+
+/**
+ * Keep how the last settings batch went in the manager statistics.
+ */
+static void recordBatchStats(const struct pios_flashfs_batch_stats *batch)
+{
+	stats.settingsBatchObjs = batch->num_objs;
+	stats.settingsBatchGCs = batch->num_gcs;
+	stats.settingsBatchUs = batch->duration_us;
+}
+
 /**
  * Save all settings objects to the SD card.
+ * They are written in one filesystem transaction, which makes room for
+ * all of them before writing any.
  * @return 0 if success or -1 if failure
  */
 int32_t UAVObjSaveSettings()
 {
 	struct UAVOData *obj;
+	uint16_t num_settings = 0;
 
 	// Get lock
 	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
 
 	int32_t rc = -1;
 
-	// Save all settings objects
 	LL_FOREACH(uavo_list, obj) {
-		// Check if this is a settings object
-		if (UAVObjIsSettings(&obj->base)) {
-			// Save object
-			if (UAVObjSave(&obj->base, 0) ==
-				-1) {
-				goto unlock_exit;
-			}
-		}
+		if (UAVObjIsSettings(&obj->base))
+			num_settings++;
 	}
 
+	// Save all settings objects
+	struct UAVOData *cursor = NULL;
+	struct pios_flashfs_batch_stats batch;
+	int32_t batch_rc = PIOS_FLASHFS_ObjSaveBatch(pios_uavo_settings_fs_id,
+				num_settings, saveSettingsNext, &cursor, &batch);
+	recordBatchStats(&batch);
+
+	if (batch_rc != 0)
+		goto unlock_exit;
+
+	// A settings object without data ends the batch early
+	if (batch.num_objs != num_settings)
+		goto unlock_exit;
+
 	rc = 0;
 
 unlock_exit:
@@ -914,36 +1155,83 @@ unlock_exit:
 	return rc;
 }
 
+/**
+ * Point a batch load at the next settings object.
+ */
+static bool loadSettingsNext(void *ctx, struct pios_flashfs_obj *fs_obj)
+{
+	struct UAVOData **cursor = (struct UAVOData **) ctx;
+
+	*cursor = nextSettingsObj(*cursor);
+	if (*cursor == NULL)
+		return false;
+
+	InstanceHandle instEntry = getInstance(*cursor, 0);
+	if (instEntry == NULL)
+		return false;
+
+	fs_obj->obj_id = UAVObjGetID((UAVObjHandle) *cursor);
+	fs_obj->obj_inst_id = 0;
+	fs_obj->obj_size = UAVObjGetNumBytes((UAVObjHandle) *cursor);
+#if defined(PIOS_INCLUDE_FASTHEAP)
+	fs_obj->obj_data = uavobj_load_trampoline;
+#else /* PIOS_INCLUDE_FASTHEAP */
+	UAVObjWriteBegin(&(*cursor)->base);
+	fs_obj->obj_data = InstanceData(instEntry);
+#endif /* PIOS_INCLUDE_FASTHEAP */
+
+	return true;
+}
+
+/**
+ * Finish loading the current settings object, as UAVObjLoad does.
+ */
+static void loadSettingsDone(void *ctx, const struct pios_flashfs_obj *fs_obj, int32_t rc)
+{
+	struct UAVOData **cursor = (struct UAVOData **) ctx;
+
+#if defined(PIOS_INCLUDE_FASTHEAP)
+	if (rc != 0)
+		return;
+
+	UAVObjWriteBegin(&(*cursor)->base);
+	memcpy(InstanceData(getInstance(*cursor, 0)), uavobj_load_trampoline,
+			fs_obj->obj_size);
+	UAVObjWriteEnd(&(*cursor)->base);
+#else /* PIOS_INCLUDE_FASTHEAP */
+	UAVObjWriteEnd(&(*cursor)->base);
+#endif /* PIOS_INCLUDE_FASTHEAP */
+}
+
 /**
  * Load all settings objects from the SD card.
+ * They are read in one filesystem transaction.
  * @return 0 if success or -1 if failure
  */
 int32_t UAVObjLoadSettings()
 {
-	struct UAVOData *obj;
-
 	// Get lock
 	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
 
-	int32_t rc = -1;
-
-	// Load all settings objects
-	LL_FOREACH(uavo_list, obj) {
-		// Check if this is a settings object
-		if (UAVObjIsSettings(&obj->base)) {
-			// Load object
-			if (UAVObjLoad((UAVObjHandle) obj, 0) ==
-				-1) {
-				goto unlock_exit;
-			}
-		}
+	// Load all settings objects, stopping at the first failure
+	struct UAVOData *cursor = NULL;
+	struct pios_flashfs_batch_stats batch;
+	int32_t rc = PIOS_FLASHFS_ObjLoadBatch(pios_uavo_settings_fs_id,
+				loadSettingsNext, loadSettingsDone, &cursor, &batch);
+	recordBatchStats(&batch);
+
+	// Send the events once out of the flash transaction, so that
+	// callbacks are free to use the filesystem
+	cursor = NULL;
+	for (uint16_t i = 0; i < batch.num_objs; i++) {
+		cursor = nextSettingsObj(cursor);
+		sendEvent(&cursor->base, 0, EV_UNPACKED,
+				InstanceData(getInstance(cursor, 0)),
+				UAVObjGetNumBytes((UAVObjHandle) cursor));
 	}
 
-	rc = 0;
-
-unlock_exit:
 	PIOS_Recursive_Mutex_Unlock(mutex);
-	return rc;
+	return rc == 0 ? 0 : -1;
 }
 
 /**
@@ -1187,7 +1475,9 @@ int32_t UAVObjSetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, con
 	}
 
 	// Set data
+	UAVObjWriteBegin(obj_handle);
 	memcpy(target + offset, dataIn, size);
+	UAVObjWriteEnd(obj_handle);
 
 	// Fire event
 	sendEvent((struct UAVOBase *)obj_handle, instId, EV_UPDATED,
@@ -1211,6 +1501,17 @@ int32_t UAVObjGetInstanceData(UAVObjHandle obj_handle, uint16_t instId,
 {
 	PIOS_Assert(obj_handle);
 
+	if (IsSingleData((struct UAVOBase *) obj_handle)) {
+		if (instId != 0)
+			return -1;
+
+		struct UAVOSingle *single = SingleObj(obj_handle);
+
+		UAVObjReadSingle(single, dataOut, 0, single->uavo.instance_size);
+
+		return 0;
+	}
+
 	// Lock
 	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
 
@@ -1257,6 +1558,21 @@ int32_t UAVObjGetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, voi
 {
 	PIOS_Assert(obj_handle);
 
+	if (IsSingleData((struct UAVOBase *) obj_handle)) {
+		struct UAVOSingle *single = SingleObj(obj_handle);
+
+		if (instId != 0)
+			return -1;
+
+		// Check for overrun
+		if ((size + offset) > single->uavo.instance_size)
+			return -1;
+
+		UAVObjReadSingle(single, dataOut, offset, size);
+
+		return 0;
+	}
+
 	// Lock
 	PIOS_Recursive_Mutex_Lock(mutex, PIOS_MUTEX_TIMEOUT_MAX);
 
@@ -1757,6 +2073,11 @@ static int32_t pumpOneEvent(UAVObjEvent msg, void *obj_data, int len) {
 	return 0;
 }
 
+/* Depth of the ring of events waiting to be pumped, see sendEvent */
+#ifndef UAVO_EVENT_RING_LEN
+#define UAVO_EVENT_RING_LEN 16
+#endif
+
 /**
  * Send a triggered event to all event queues registered on the object.
  */
@@ -1764,13 +2085,14 @@ static int32_t sendEvent(struct UAVOBase * obj, uint16_t instId,
 			UAVObjEventType triggered_event,
 			void *obj_data, int len)
 {
+	static uint8_t pending_head = 0;
 	static uint8_t num_pending = 0;
 
 	static struct PendEvent {
 		UAVObjEvent msg;
 		void *obj_data;
 		int len;
-	} pending_events[3];
+	} pending_events[UAVO_EVENT_RING_LEN];
 
 	/* The logic to spool up callbacks here may be a little confusing.
 	 * basically, this relies on the fact that we are in a re-entrant
@@ -1781,8 +2103,10 @@ static int32_t sendEvent(struct UAVOBase * obj, uint16_t instId,
 	 * In other words, while executing a callback it did a uav object
 	 * update that will trigger in turn more callbacks.
 	 *
-	 * To handle this, we have a small buffer to store the pending
-	 * callbacks.
+	 * To handle this, we have a ring of pending events which the
+	 * outermost call pumps in order.  An event identical to one that is
+	 * already pending (same object, instance and event type) is merged
+	 * into it, since its callbacks would see the same data anyway.
 	 *
 	 * We also make the point of disallowing a callback from generating
 	 * the exact same callback.  This is relevant to things like
@@ -1794,7 +2118,27 @@ static int32_t sendEvent(struct UAVOBase * obj, uint16_t instId,
 	 * trigger callback B which triggers callback A.  Don't do that.
 	 */
 
-	if (num_pending >= 3) {
+	static struct UAVOBase *in_progress = NULL;
+
+	if (in_progress == obj) {
+		return -1;	/* We don't fire events
+				 * of the same type generated by
+				 * an event callback. */
+	}
+
+	for (uint8_t i = 0; i < num_pending; i++) {
+		struct PendEvent *pend = &pending_events[
+			(pending_head + i) % UAVO_EVENT_RING_LEN];
+
+		if ((pend->msg.obj == obj) && (pend->msg.instId == instId) &&
+				(pend->msg.event == triggered_event)) {
+			stats.eventsCoalesced++;
+
+			return 0;
+		}
+	}
+
+	if (num_pending >= UAVO_EVENT_RING_LEN) {
 		/* Unable to pump event; backlog too long */
 		stats.eventCallbackErrors++;
 		stats.lastCallbackErrorID = UAVObjGetID(obj);
@@ -1802,43 +2146,42 @@ static int32_t sendEvent(struct UAVOBase * obj, uint16_t instId,
 		return -1;
 	}
 
-	static struct UAVOBase *in_progress = NULL;
+	struct PendEvent *pend = &pending_events[
+		(pending_head + num_pending) % UAVO_EVENT_RING_LEN];
 
-	if (num_pending) {
-		if (in_progress == obj) {
-			return -1;	/* We don't fire events
-					 * of the same type generated by
-					 * an event callback. */
-		}
-	}
-
-	pending_events[num_pending].msg = (UAVObjEvent) {
+	pend->msg = (UAVObjEvent) {
 		.obj    = obj,
 		.event  = triggered_event,
 		.instId = instId
 	};
 
-	pending_events[num_pending].obj_data = obj_data;
-	pending_events[num_pending].len = len;
+	pend->obj_data = obj_data;
+	pend->len = len;
 
 	num_pending++;
 
-	/* Only enter the section of pumping events if we are the "first event" */
-	if (!in_progress) {
-		/* While there are events to pump.. */
-		while (num_pending) {
-			/* Deallocate the top one.. */
-			num_pending--;
-
-			/* Mask off events of the same type resulting from
-			 * the callback... */
-			in_progress = pending_events[num_pending].msg.obj;
-
-			/* And pump the event. */
-			pumpOneEvent(pending_events[num_pending].msg,
-				pending_events[num_pending].obj_data,
-				pending_events[num_pending].len);
-		}
+	/* Only pump events if we are the "first event"; nested calls
+	 * just leave theirs in the ring for the loop below. */
+	if (in_progress) {
+		return 0;
+	}
+
+	/* While there are events to pump.. */
+	while (num_pending) {
+		/* Copy out and deallocate the oldest one.. */
+		struct PendEvent next = pending_events[pending_head];
+
+		pending_head = (pending_head + 1) % UAVO_EVENT_RING_LEN;
+		num_pending--;
+
+		/* Mask off events of the same type resulting from
+		 * the callback... */
+		in_progress = next.msg.obj;
+
+		/* And pump the event. */
+		pumpOneEvent(next.msg, next.obj_data, next.len);
+
+		stats.eventsDispatched++;
 	}
 
 	in_progress = NULL;
@@ -1851,7 +2194,7 @@ static int32_t sendEvent(struct UAVOBase * obj, uint16_t instId,
  */
 static InstanceHandle createInstance(struct UAVOData * obj, uint16_t instId)
 {
-	struct UAVOMultiInst *instEntry;
+	struct UAVOMulti *uavo_multi = (struct UAVOMulti *) obj;
 
 	/* Don't allow more than one instance for single instance objects */
 	if (UAVObjIsSingleInstance(&(obj->base))) {
@@ -1876,14 +2219,52 @@ static InstanceHandle createInstance(struct UAVOData * obj, uint16_t instId)
 		}
 	}
 
-	/* Create the actual instance */
-	instEntry = (struct UAVOMultiInst *) PIOS_malloc_no_dma(sizeof(struct UAVOMultiInst)+obj->instance_size);
-	if (!instEntry)
-		return NULL;
-	memset(InstanceDataOffset(instEntry), 0, obj->instance_size);
-	LL_APPEND(( (struct UAVOMulti*)obj )->instance0.next, instEntry);
+	/* Instance 0 is embedded in the object; find the block for this one */
+	uint16_t chunk = (instId - 1) / UAVO_INST_CHUNK;
+	uint16_t slot = (instId - 1) % UAVO_INST_CHUNK;
 
-	( (struct UAVOMulti*)obj )->num_instances++;
+	/* Grow the table of blocks if needed */
+	if (chunk >= uavo_multi->num_chunks) {
+		uint16_t num_chunks = uavo_multi->num_chunks ?
+			uavo_multi->num_chunks * 2 : UAVO_INST_TABLE_MIN;
+
+		uint8_t **chunks = PIOS_malloc_no_dma(num_chunks * sizeof(*chunks));
+		if (!chunks)
+			return NULL;
+
+		memset(chunks, 0, num_chunks * sizeof(*chunks));
+
+		if (uavo_multi->chunks) {
+			memcpy(chunks, uavo_multi->chunks,
+					uavo_multi->num_chunks * sizeof(*chunks));
+			PIOS_free(uavo_multi->chunks);
+		}
+
+		inst_bytes_allocated += (num_chunks - uavo_multi->num_chunks) *
+			sizeof(*chunks);
+
+		uavo_multi->chunks = chunks;
+		uavo_multi->num_chunks = num_chunks;
+	}
+
+	/* Allocate the block on its first instance */
+	if (!uavo_multi->chunks[chunk]) {
+		uint32_t chunk_size = UAVO_INST_CHUNK * obj->instance_size;
+
+		uavo_multi->chunks[chunk] = PIOS_malloc_no_dma(chunk_size);
+		if (!uavo_multi->chunks[chunk])
+			return NULL;
+
+		memset(uavo_multi->chunks[chunk], 0, chunk_size);
+
+		inst_bytes_allocated += chunk_size;
+	}
+
+	uint8_t *instance = uavo_multi->chunks[chunk] + slot * obj->instance_size;
+
+	inst_bytes_used += obj->instance_size;
+
+	uavo_multi->num_instances++;
 
 	// Fire event
 	UAVObjInstanceUpdated((UAVObjHandle) obj, instId);
@@ -1892,7 +2273,7 @@ static InstanceHandle createInstance(struct UAVOData * obj, uint16_t instId)
 	if (newUavObjInstanceCB) {
 		newUavObjInstanceCB(obj->id, UAVObjGetNumInstances(&obj->base));
 	}
-	return InstanceDataOffset(instEntry);
+	return instance;
 }
 
 /**
@@ -1917,7 +2298,7 @@ static InstanceHandle getInstance(struct UAVOData * obj, uint16_t instId)
 			return NULL;
 
 		/* Augment our pointer to reflect the proper type */
-		struct UAVOSingle * uavo_single = (struct UAVOSingle *) obj;
+		struct UAVOSingle * uavo_single = SingleObj(obj);
 		return (&(uavo_single->instance0));
 	} else {
 		/* Multi Instance */
@@ -1926,17 +2307,11 @@ static InstanceHandle getInstance(struct UAVOData * obj, uint16_t instId)
 		if (instId >= uavo_multi->num_instances)
 			return NULL;
 
-		// Look for specified instance ID
-		uint16_t instance = 0;
-		struct UAVOMultiInst *instEntry;
-		LL_FOREACH(&(uavo_multi->instance0), instEntry) {
-			if (instance++ == instId) {
-				/* Found it */
-				return &(instEntry->instance);
-			}
-		}
-		/* Instance was not found */
-		return NULL;
+		if (instId == 0)
+			return (&(uavo_multi->instance0));
+
+		return uavo_multi->chunks[(instId - 1) / UAVO_INST_CHUNK] +
+			((instId - 1) % UAVO_INST_CHUNK) * obj->instance_size;
 	}
 }
 
@@ -0,0 +1,42 @@
+/**
+ ******************************************************************************
+ * @addtogroup TauLabsCore Tau Labs Core components
+ * @{
+ * @addtogroup UAVObjectHandling UAVObject handling code
+ * @{
+ *
+ * @file       uavobjectsindex.c
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @brief      Sorted table of all object IDs, used by the object manager
+ *             to look objects up by ID without walking the object list.
+ *             Automatically generated by the UAVObjectGenerator.
+ *
+ * @note       This is an automatically generated file.
+ *             DO NOT modify manually.
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "uavobjectsinit.h"
+
+const uint32_t uavo_sorted_ids[UAVOBJECTS_COUNT] = {
+$(OBJIDS)};
+
+/**
+ * @}
+ * @}
+ */
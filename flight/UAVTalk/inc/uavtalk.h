@@ -30,6 +30,10 @@
 #ifndef UAVTALK_H
 #define UAVTALK_H
 
+// Public constants
+#define UAVTALK_DELTA_RUN_HEADER_LENGTH 2	//! (offset, length) before each run of a delta
+#define UAVTALK_DELTA_MAX_RUN           255
+
 // Public types
 typedef int32_t (*UAVTalkOutputStream)(uint8_t* data, int32_t length);
 
@@ -43,6 +47,10 @@ typedef struct {
 	uint32_t txObjects;
 	uint32_t txErrors;
 	uint32_t rxErrors;
+	uint32_t txDeltaObjects;
+	uint32_t txDeltaBytesSaved;	/** Payload bytes not sent thanks to delta packets */
+	uint32_t rxDeltaObjects;
+	uint32_t rxDeltaErrors;	/** Delta packets that didn't match our copy */
 } UAVTalkStats;
 
 typedef void* UAVTalkConnection;
@@ -70,6 +78,8 @@ void UAVTalkResetStats(UAVTalkConnection connection);
 void UAVTalkGetLastTimestamp(UAVTalkConnection connection, uint16_t *timestamp);
 uint32_t UAVTalkGetPacketObjId(UAVTalkConnection connection);
 uint32_t UAVTalkGetPacketInstId(UAVTalkConnection connection);
+int32_t UAVTalkSetDeltaEnabled(UAVTalkConnection connection, bool enabled);
+int32_t UAVTalkEncodeDelta(const uint8_t *base, const uint8_t *current, int32_t length, uint8_t *out, int32_t maxLength);
 
 #endif // UAVTALK_H
 /**
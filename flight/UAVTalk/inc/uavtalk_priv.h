@@ -79,6 +79,15 @@ typedef struct {
 	uint16_t rxPacketLength;
 } UAVTalkInputProcessor;
 
+//! Last copy of an object sent in full or as a delta, used as the delta base
+typedef struct {
+	UAVObjHandle obj;
+	uint16_t instId;
+	uint8_t sendsSinceFull;
+	uint32_t lastUsed;
+	uint8_t *data;
+} UAVTalkDeltaBase;
+
 //! Information for the physical link
 typedef struct {
 	uint8_t canari;
@@ -93,6 +102,9 @@ typedef struct {
 	uint8_t *rxBuffer;
 	uint32_t txSize;
 	uint8_t *txBuffer;
+	bool deltaEnabled;
+	UAVTalkDeltaBase *deltaBases;
+	uint8_t *deltaBuffer;
 } UAVTalkConnectionData;
 
 #define UAVTALK_CANARI         0xCA
@@ -107,9 +119,25 @@ typedef struct {
 #define UAVTALK_TYPE_OBJ_ACK   (UAVTALK_TYPE_VER | 0x02)
 #define UAVTALK_TYPE_ACK       (UAVTALK_TYPE_VER | 0x03)
 #define UAVTALK_TYPE_NACK      (UAVTALK_TYPE_VER | 0x04)
+#define UAVTALK_TYPE_OBJ_DELTA (UAVTALK_TYPE_VER | 0x05)
 #define UAVTALK_TYPE_OBJ_TS       (UAVTALK_TIMESTAMPED | UAVTALK_TYPE_OBJ)
 #define UAVTALK_TYPE_OBJ_ACK_TS   (UAVTALK_TIMESTAMPED | UAVTALK_TYPE_OBJ_ACK)
 
+/*
+ * Delta packets carry the CRC-16-CCITT (little endian) of the copy of the
+ * object they apply to, followed by runs of (offset, length, bytes) to
+ * overwrite in it; see UAVTalkEncodeDelta().
+ */
+
+#define UAVTALK_DELTA_BASE_CRC_LENGTH  2
+
+#ifndef UAVTALK_DELTA_SLOTS
+#define UAVTALK_DELTA_SLOTS            4	//! Objects tracked for delta sends
+#endif
+#define UAVTALK_DELTA_MIN_LENGTH       32	//! Smaller objects are always sent in full
+#define UAVTALK_DELTA_FULL_INTERVAL    16	//! Send in full at least this often
+#define UAVTALK_DELTA_IDLE_MS          1000	//! Before a base may be replaced
+
 //macros
 #define CHECKCONHANDLE(handle,variable,failcommand) \
 	variable = (UAVTalkConnectionData*) handle; \
@@ -44,6 +44,9 @@ static int32_t sendSingleObject(UAVTalkConnectionData *connection, UAVObjHandle
 static int32_t sendNack(UAVTalkConnectionData *connection, uint32_t objId);
 static int32_t receiveObject(UAVTalkConnectionData *connection, uint8_t type, uint32_t objId, uint16_t instId, uint8_t* data, int32_t length);
 static void updateAck(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId);
+static int32_t receiveDelta(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId, uint8_t* data, int32_t length);
+static UAVTalkDeltaBase *findDeltaBase(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId, bool assign);
+static void forgetDeltaBases(UAVTalkConnectionData *connection, UAVObjHandle obj);
 
 /**
  * Initialize the UAVTalk library
@@ -72,6 +75,9 @@ UAVTalkConnection UAVTalkInitialize(UAVTalkOutputStream outputStream)
 	if (!connection->txBuffer) return 0;
 	connection->respSema = PIOS_Semaphore_Create();
 	PIOS_Semaphore_Take(connection->respSema, 0); // reset to zero
+	connection->deltaEnabled = false;
+	connection->deltaBases = NULL;
+	connection->deltaBuffer = NULL;
 	UAVTalkResetStats( (UAVTalkConnection) connection );
 	return (UAVTalkConnection) connection;
 }
@@ -371,6 +377,11 @@ UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connectionHandle
 		if (iproc->type == UAVTALK_TYPE_OBJ_REQ || iproc->type == UAVTALK_TYPE_ACK || iproc->type == UAVTALK_TYPE_NACK) {
 			iproc->length = 0;
 			iproc->instanceLength = 0;
+		} else if (iproc->type == UAVTALK_TYPE_OBJ_DELTA) {
+			// Delta packets are variable length
+			iproc->instanceLength = (iproc->obj && !UAVObjIsSingleInstance(iproc->obj)) ? 2 : 0;
+			iproc->timestampLength = 0;
+			iproc->length = iproc->packet_size - iproc->rxPacketLength - iproc->instanceLength;
 		} else {
 			if (iproc->obj) {
 				iproc->length = UAVObjGetNumBytes(iproc->obj);
@@ -674,6 +685,57 @@ uint32_t UAVTalkGetPacketInstId(UAVTalkConnection connectionHandle)
 	return connection->iproc.instId;
 }
 
+/**
+ * Allow or stop sending objects as deltas against the copy last sent.
+ * Should only be enabled once the other end is known to understand delta
+ * packets; they are always accepted on receive.
+ * \param[in] connectionHandle UAVTalkConnection to be used
+ * \param[in] enabled Whether delta packets may be sent
+ * \return 0 Success
+ * \return -1 Failure (could not allocate the delta bases)
+ */
+int32_t UAVTalkSetDeltaEnabled(UAVTalkConnection connectionHandle, bool enabled)
+{
+	UAVTalkConnectionData *connection;
+
+	CHECKCONHANDLE(connectionHandle, connection, return -1);
+
+	int32_t ret = 0;
+
+	PIOS_Recursive_Mutex_Lock(connection->lock, PIOS_MUTEX_TIMEOUT_MAX);
+
+	// Allocated once, as the heap can't give them back
+	if (enabled && !connection->deltaBases) {
+		UAVTalkDeltaBase *bases = PIOS_malloc(sizeof(*bases) * UAVTALK_DELTA_SLOTS);
+
+		if (!bases) {
+			ret = -1;
+			goto unlock_exit;
+		}
+
+		for (int i = 0; i < UAVTALK_DELTA_SLOTS; i++) {
+			bases[i].data = PIOS_malloc(UAVOBJECTS_LARGEST);
+
+			if (!bases[i].data) {
+				ret = -1;
+				goto unlock_exit;
+			}
+		}
+
+		connection->deltaBases = bases;
+	}
+
+	// Whatever the other end had from before is no longer known
+	forgetDeltaBases(connection, NULL);
+
+	connection->deltaEnabled = enabled;
+
+unlock_exit:
+	PIOS_Recursive_Mutex_Unlock(connection->lock);
+
+	return ret;
+}
+
 /**
  * Process an byte from the telemetry stream, sending the packet out the output stream when it's complete
  * This allows the interlieving of packets on an output UAVTalk stream, and is used by the OPLink device to
@@ -868,12 +930,30 @@ static int32_t receiveObject(UAVTalkConnectionData *connection, uint8_t type, ui
 			ret = -1;
 		}
 		break;
+	case UAVTALK_TYPE_OBJ_DELTA:
+		if (obj && (instId != UAVOBJ_ALL_INSTANCES)) {
+			if (receiveDelta(connection, obj, instId, data, length) == 0) {
+				updateAck(connection, obj, instId);
+			} else {
+				// Our copy isn't what the delta was made against;
+				// ask for the whole object.
+				sendObject(connection, obj, instId, UAVTALK_TYPE_OBJ_REQ);
+				ret = -1;
+			}
+		} else {
+			ret = -1;
+		}
+		break;
 	case UAVTALK_TYPE_OBJ_REQ:
 		// Send requested object if message is of type OBJ_REQ
 		if (obj == 0)
 			sendNack(connection, objId);
-		else
+		else {
+			// The requester may not have what we last sent, so
+			// answer in full
+			forgetDeltaBases(connection, obj);
 			sendObject(connection, obj, instId, UAVTALK_TYPE_OBJ);
+		}
 		break;
 	case UAVTALK_TYPE_NACK:
 		// Do nothing on flight side, let it time out.
@@ -908,6 +988,177 @@ static void updateAck(UAVTalkConnectionData *connection, UAVObjHandle obj, uint1
 	}
 }
 
+/**
+ * Apply a received delta packet to our copy of an object instance.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object
+ * \param[in] instId The instance ID
+ * \param[in] data Delta payload (base CRC followed by runs)
+ * \param[in] length Payload length
+ * \return 0 Success
+ * \return -1 Failure (malformed, or our copy differs from the delta base)
+ */
+static int32_t receiveDelta(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId, uint8_t* data, int32_t length)
+{
+	int32_t objLength = UAVObjGetNumBytes(obj);
+
+	if (!connection->deltaBuffer) {
+		connection->deltaBuffer = PIOS_malloc(UAVTALK_MAX_PAYLOAD_LENGTH);
+
+		if (!connection->deltaBuffer)
+			return -1;
+	}
+
+	uint8_t *current = connection->deltaBuffer;
+
+	if ((length < UAVTALK_DELTA_BASE_CRC_LENGTH) || (UAVObjPack(obj, instId, current) < 0)) {
+		connection->stats.rxDeltaErrors++;
+		return -1;
+	}
+
+	uint16_t baseCrc = data[0] | (data[1] << 8);
+
+	if (PIOS_CRC16_CCITT_updateCRC(0, current, objLength) != baseCrc) {
+		connection->stats.rxDeltaErrors++;
+		return -1;
+	}
+
+	for (int32_t pos = UAVTALK_DELTA_BASE_CRC_LENGTH; pos < length; ) {
+		if (pos + UAVTALK_DELTA_RUN_HEADER_LENGTH > length) {
+			connection->stats.rxDeltaErrors++;
+			return -1;
+		}
+
+		uint8_t offset = data[pos];
+		uint8_t runLength = data[pos + 1];
+
+		pos += UAVTALK_DELTA_RUN_HEADER_LENGTH;
+
+		if ((runLength == 0) || (offset + runLength > objLength) ||
+				(pos + runLength > length)) {
+			connection->stats.rxDeltaErrors++;
+			return -1;
+		}
+
+		memcpy(&current[offset], &data[pos], runLength);
+
+		pos += runLength;
+	}
+
+	connection->stats.rxDeltaObjects++;
+
+	return UAVObjUnpack(obj, instId, current);
+}
+
+/**
+ * Find the delta base kept for an object instance.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object
+ * \param[in] instId The instance ID
+ * \param[in] assign If not found, take over the least recently used base
+ * if it has been idle long enough
+ * \return The base, or NULL
+ */
+static UAVTalkDeltaBase *findDeltaBase(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId, bool assign)
+{
+	UAVTalkDeltaBase *oldest = NULL;
+	uint32_t now = PIOS_Thread_Systime();
+
+	for (int i = 0; i < UAVTALK_DELTA_SLOTS; i++) {
+		UAVTalkDeltaBase *base = &connection->deltaBases[i];
+
+		if (base->obj == obj && base->instId == instId) {
+			base->lastUsed = now;
+			return base;
+		}
+
+		if (!oldest || !base->obj ||
+				(oldest->obj && (base->lastUsed < oldest->lastUsed))) {
+			oldest = base;
+		}
+	}
+
+	if (!assign)
+		return NULL;
+
+	// Don't let objects sent in rotation keep evicting each other
+	if (oldest->obj && (now - oldest->lastUsed) < UAVTALK_DELTA_IDLE_MS)
+		return NULL;
+
+	oldest->obj = obj;
+	oldest->instId = instId;
+	oldest->sendsSinceFull = UAVTALK_DELTA_FULL_INTERVAL;
+	oldest->lastUsed = now;
+
+	return oldest;
+}
+
+/**
+ * Drop the delta bases of an object so that it is next sent in full.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object, or NULL for all objects
+ */
+static void forgetDeltaBases(UAVTalkConnectionData *connection, UAVObjHandle obj)
+{
+	if (!connection->deltaBases)
+		return;
+
+	for (int i = 0; i < UAVTALK_DELTA_SLOTS; i++) {
+		if (!obj || connection->deltaBases[i].obj == obj) {
+			connection->deltaBases[i].obj = NULL;
+		}
+	}
+}
+
+/**
+ * Encode the difference between two copies of an object as runs of
+ * (offset, length, bytes).  Runs separated by fewer unchanged bytes than a
+ * run header are merged.
+ * \param[in] base Copy the other end (or the log reader) already has
+ * \param[in] current Copy to send
+ * \param[in] length Object length
+ * \param[out] out Where to write the runs
+ * \param[in] maxLength Give up if the runs need more than this
+ * \return Length of the runs, or -1 if they didn't fit
+ */
+int32_t UAVTalkEncodeDelta(const uint8_t *base, const uint8_t *current, int32_t length, uint8_t *out, int32_t maxLength)
+{
+	int32_t outLength = 0;
+	int32_t pos = 0;
+
+	while (pos < length) {
+		if (base[pos] == current[pos]) {
+			pos++;
+			continue;
+		}
+
+		int32_t start = pos;
+		int32_t end = pos + 1;
+
+		for (int32_t i = end; (i < length) && (i - start < UAVTALK_DELTA_MAX_RUN); i++) {
+			if (base[i] != current[i]) {
+				end = i + 1;
+			} else if (i - end >= UAVTALK_DELTA_RUN_HEADER_LENGTH) {
+				break;
+			}
+		}
+
+		int32_t runLength = end - start;
+
+		if (outLength + UAVTALK_DELTA_RUN_HEADER_LENGTH + runLength > maxLength)
+			return -1;
+
+		out[outLength++] = start;
+		out[outLength++] = runLength;
+		memcpy(&out[outLength], &current[start], runLength);
+		outLength += runLength;
+
+		pos = end;
+	}
+
+	return outLength;
+}
+
 /**
  * Send an object through the telemetry link.
  * \param[in] connection UAVTalkConnection to be used
@@ -1016,6 +1267,52 @@ static int32_t sendSingleObject(UAVTalkConnectionData *connection, UAVObjHandle
 		}
 	}
 
+	// Send only what changed since the last copy, if that's smaller
+	UAVTalkDeltaBase *base = NULL;
+	int32_t fullLength = length;
+
+	if (connection->deltaEnabled && type == UAVTALK_TYPE_OBJ &&
+			length >= UAVTALK_DELTA_MIN_LENGTH &&
+			length <= UAVTALK_DELTA_MAX_RUN + 1) {
+		base = findDeltaBase(connection, obj, instId, true);
+	}
+
+	if (base) {
+		uint8_t *current = &connection->txBuffer[dataOffset];
+		int32_t deltaLength = -1;
+
+		if (!connection->deltaBuffer) {
+			connection->deltaBuffer = PIOS_malloc(UAVTALK_MAX_PAYLOAD_LENGTH);
+		}
+
+		if (connection->deltaBuffer &&
+				base->sendsSinceFull < UAVTALK_DELTA_FULL_INTERVAL) {
+			uint16_t baseCrc = PIOS_CRC16_CCITT_updateCRC(0, base->data, length);
+
+			connection->deltaBuffer[0] = baseCrc & 0xFF;
+			connection->deltaBuffer[1] = baseCrc >> 8;
+
+			// Only worth it if it comes out shorter than the object
+			deltaLength = UAVTalkEncodeDelta(base->data, current, length,
+					&connection->deltaBuffer[UAVTALK_DELTA_BASE_CRC_LENGTH],
+					length - UAVTALK_DELTA_BASE_CRC_LENGTH - 1);
+		}
+
+		// Whatever goes out becomes the other end's copy
+		memcpy(base->data, current, length);
+
+		if (deltaLength >= 0) {
+			deltaLength += UAVTALK_DELTA_BASE_CRC_LENGTH;
+			memcpy(current, connection->deltaBuffer, deltaLength);
+
+			connection->txBuffer[1] = UAVTALK_TYPE_OBJ_DELTA;
+			length = deltaLength;
+			base->sendsSinceFull++;
+		} else {
+			base->sendsSinceFull = 0;
+		}
+	}
+
 	// Store the packet length
 	connection->txBuffer[2] = (uint8_t)((dataOffset+length) & 0xFF);
 	connection->txBuffer[3] = (uint8_t)(((dataOffset+length) >> 8) & 0xFF);
@@ -1031,6 +1328,14 @@ static int32_t sendSingleObject(UAVTalkConnectionData *connection, UAVObjHandle
 		++connection->stats.txObjects;
 		connection->stats.txBytes += tx_msg_len;
 		connection->stats.txObjectBytes += length;
+
+		if (length != fullLength) {
+			++connection->stats.txDeltaObjects;
+			connection->stats.txDeltaBytesSaved += fullLength - length;
+		}
+	} else if (base) {
+		// The other end may not have it; start over with a full send
+		base->obj = NULL;
 	}
 
 	// Done
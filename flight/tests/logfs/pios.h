@@ -13,6 +13,12 @@
 
 #include <pios_heap.h>
 
+#if defined(PIOS_INCLUDE_DELAY)
+#include <stdio.h>		/* perror */
+#include <stdlib.h>		/* abort */
+#include <pios_delay.h>
+#endif
+
 /* Would be from pios_debug.h but that file pulls on way too many dependencies */
 #define PIOS_Assert(x) if (!(x)) { while (1) ; }
 #define PIOS_DEBUG_Assert(x) PIOS_Assert(x)
@@ -1,2 +1,3 @@
 #define PIOS_INCLUDE_FLASH
 #define PIOS_INCLUDE_FREERTOS
+#define PIOS_INCLUDE_DELAY
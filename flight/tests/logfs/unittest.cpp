@@ -332,6 +332,231 @@ TEST_F(LogfsTestCooked, WriteManyVerify) {
   EXPECT_EQ(0, memcmp(obj3, obj3_check, sizeof(obj3)));
 }
 
+TEST_F(LogfsTestCooked, FlashReadsPerOperation) {
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, 0, obj1, sizeof(obj1)));
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ2_ID, 0, obj2, sizeof(obj2)));
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ0_ID, 0, NULL, 0));
+
+  uint32_t reads;
+  unsigned char obj1_check[OBJ1_SIZE];
+
+  /* Loading reads the object data and nothing else */
+  reads = PIOS_Flash_Posix_GetReadCount(pios_posix_flash_id);
+  memset(obj1_check, 0, sizeof(obj1_check));
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 0, obj1_check, sizeof(obj1_check)));
+  EXPECT_EQ(0, memcmp(obj1, obj1_check, sizeof(obj1)));
+  EXPECT_EQ(1U, PIOS_Flash_Posix_GetReadCount(pios_posix_flash_id) - reads);
+
+  /* Missing and zero length objects are answered from RAM */
+  reads = PIOS_Flash_Posix_GetReadCount(pios_posix_flash_id);
+  EXPECT_EQ(-3, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 1, obj1_check, sizeof(obj1_check)));
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ0_ID, 0, NULL, 0));
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjDelete(fs_id, OBJ2_ID, 0));
+  EXPECT_EQ(0U, PIOS_Flash_Posix_GetReadCount(pios_posix_flash_id) - reads);
+
+  /* Saving only checks that the slot it's about to use is empty */
+  reads = PIOS_Flash_Posix_GetReadCount(pios_posix_flash_id);
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, 0, obj1_alt, sizeof(obj1_alt)));
+  EXPECT_EQ(1U, PIOS_Flash_Posix_GetReadCount(pios_posix_flash_id) - reads);
+}
+
+TEST_F(LogfsTestCooked, FlashReadsRemountLoadAll) {
+  const uint32_t num_slots = flashfs_config_settings.arena_size / flashfs_config_settings.slot_size;
+  const uint32_t num_objs = 100;
+
+  /* Save in descending order, so the index is built from front inserts */
+  for (uint32_t i = num_objs; i > 0; i--) {
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, i - 1, obj1, sizeof(obj1)));
+  }
+
+  /* Remount, as at boot: the arena header, then every slot header once */
+  PIOS_FLASHFS_Logfs_Destroy(fs_id);
+  uint32_t reads = PIOS_Flash_Posix_GetReadCount(pios_posix_flash_id);
+  EXPECT_EQ(0, PIOS_FLASHFS_Logfs_Init(&fs_id, &flashfs_config_settings, FLASH_PARTITION_LABEL_SETTINGS));
+  EXPECT_EQ(num_slots, PIOS_Flash_Posix_GetReadCount(pios_posix_flash_id) - reads);
+
+  /* Then loading every object reads its data once, however full the log */
+  reads = PIOS_Flash_Posix_GetReadCount(pios_posix_flash_id);
+  for (uint32_t i = 0; i < num_objs; i++) {
+    unsigned char obj1_check[OBJ1_SIZE];
+    memset(obj1_check, 0, sizeof(obj1_check));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, i, obj1_check, sizeof(obj1_check)));
+    EXPECT_EQ(0, memcmp(obj1, obj1_check, sizeof(obj1)));
+  }
+  EXPECT_EQ(num_objs, PIOS_Flash_Posix_GetReadCount(pios_posix_flash_id) - reads);
+}
+
+TEST_F(LogfsTestCooked, GarbageCollectRemountVerify) {
+  /* Enough saves of a few objects to go through garbage collection several times */
+  for (uint32_t i = 0; i < 1000; i++) {
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, i % 3, (i % 2) ? obj1_alt : obj1, sizeof(obj1)));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ2_ID, 0, obj2, sizeof(obj2)));
+  }
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjDelete(fs_id, OBJ1_ID, 2));
+
+  PIOS_FLASHFS_Logfs_Destroy(fs_id);
+  EXPECT_EQ(0, PIOS_FLASHFS_Logfs_Init(&fs_id, &flashfs_config_settings, FLASH_PARTITION_LABEL_SETTINGS));
+
+  unsigned char obj1_check[OBJ1_SIZE];
+
+  /* Instance 0 was last saved at i = 999, instance 1 at i = 997 */
+  memset(obj1_check, 0, sizeof(obj1_check));
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 0, obj1_check, sizeof(obj1_check)));
+  EXPECT_EQ(0, memcmp(obj1_alt, obj1_check, sizeof(obj1_alt)));
+
+  memset(obj1_check, 0, sizeof(obj1_check));
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 1, obj1_check, sizeof(obj1_check)));
+  EXPECT_EQ(0, memcmp(obj1_alt, obj1_check, sizeof(obj1_alt)));
+
+  EXPECT_EQ(-3, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, 2, obj1_check, sizeof(obj1_check)));
+
+  unsigned char obj2_check[OBJ2_SIZE];
+  memset(obj2_check, 0, sizeof(obj2_check));
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ2_ID, 0, obj2_check, sizeof(obj2_check)));
+  EXPECT_EQ(0, memcmp(obj2, obj2_check, sizeof(obj2)));
+}
+
+/* Walks an array of objects for the batch calls, recording each load result */
+struct batch_ctx {
+  struct pios_flashfs_obj *objs;
+  uint16_t num_objs;
+  uint16_t next;
+  uint16_t num_done;
+  int32_t last_rc;
+};
+
+static bool batch_next(void *ctx, struct pios_flashfs_obj *obj)
+{
+  struct batch_ctx *batch = (struct batch_ctx *)ctx;
+
+  if (batch->next >= batch->num_objs)
+    return false;
+
+  *obj = batch->objs[batch->next++];
+  return true;
+}
+
+static void batch_done(void *ctx, const struct pios_flashfs_obj *obj, int32_t rc)
+{
+  struct batch_ctx *batch = (struct batch_ctx *)ctx;
+
+  (void)obj;
+  batch->num_done++;
+  batch->last_rc = rc;
+}
+
+TEST_F(LogfsTestCooked, BatchSaveLoadVerify) {
+  const uint16_t num_objs = 20;
+  struct pios_flashfs_obj objs[num_objs];
+  unsigned char obj1_check[num_objs][OBJ1_SIZE];
+
+  for (uint16_t i = 0; i < num_objs; i++) {
+    objs[i].obj_id = OBJ1_ID;
+    objs[i].obj_inst_id = i;
+    objs[i].obj_size = sizeof(obj1);
+    objs[i].obj_data = (i % 2) ? obj1_alt : obj1;
+  }
+
+  struct batch_ctx batch = { objs, num_objs, 0, 0, 0 };
+  struct pios_flashfs_batch_stats stats;
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjSaveBatch(fs_id, num_objs, batch_next, &batch, &stats));
+  EXPECT_EQ(num_objs, stats.num_objs);
+  EXPECT_EQ(0U, stats.num_gcs);
+
+  /* Load them all back into separate buffers */
+  memset(obj1_check, 0, sizeof(obj1_check));
+  for (uint16_t i = 0; i < num_objs; i++) {
+    objs[i].obj_data = obj1_check[i];
+  }
+
+  batch = (struct batch_ctx) { objs, num_objs, 0, 0, 0 };
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjLoadBatch(fs_id, batch_next, batch_done, &batch, &stats));
+  EXPECT_EQ(num_objs, stats.num_objs);
+  EXPECT_EQ(num_objs, batch.num_done);
+  for (uint16_t i = 0; i < num_objs; i++) {
+    EXPECT_EQ(0, memcmp((i % 2) ? obj1_alt : obj1, obj1_check[i], sizeof(obj1)));
+  }
+
+  /* A missing object stops the load there */
+  objs[5].obj_inst_id = 1000;
+  batch = (struct batch_ctx) { objs, num_objs, 0, 0, 0 };
+  EXPECT_EQ(-3, PIOS_FLASHFS_ObjLoadBatch(fs_id, batch_next, batch_done, &batch, &stats));
+  EXPECT_EQ(5U, stats.num_objs);
+  EXPECT_EQ(6U, batch.num_done);
+  EXPECT_EQ(-3, batch.last_rc);
+}
+
+TEST_F(LogfsTestCooked, BatchSaveGarbageCollectsFirst) {
+  const uint32_t num_slots = flashfs_config_settings.arena_size / flashfs_config_settings.slot_size;
+  const uint16_t num_objs = 20;
+
+  /* Leave only a few free slots, the rest of the log obsolete */
+  for (uint32_t i = 0; i < num_slots - 1 - (num_objs / 2); i++) {
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, 0, obj1, sizeof(obj1)));
+  }
+
+  struct pios_flashfs_obj objs[num_objs];
+  for (uint16_t i = 0; i < num_objs; i++) {
+    objs[i].obj_id = OBJ1_ID;
+    objs[i].obj_inst_id = i;
+    objs[i].obj_size = sizeof(obj1);
+    objs[i].obj_data = obj1_alt;
+  }
+
+  /*
+   * One garbage collection up front.  If it had waited for the log to
+   * fill, the slots left after it would already hold half the batch.
+   */
+  struct batch_ctx batch = { objs, num_objs, 0, 0, 0 };
+  struct pios_flashfs_batch_stats stats;
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjSaveBatch(fs_id, num_objs, batch_next, &batch, &stats));
+  EXPECT_EQ(num_objs, stats.num_objs);
+  EXPECT_EQ(1U, stats.num_gcs);
+
+  /* The whole batch went into the fresh arena, after the one object copied over */
+  uint32_t writes_left = num_slots - 1 - 1 - num_objs;
+  for (uint32_t i = 0; i < writes_left; i++) {
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ2_ID, 0, obj2, sizeof(obj2)));
+  }
+  batch = (struct batch_ctx) { objs, 1, 0, 0, 0 };
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjSaveBatch(fs_id, 1, batch_next, &batch, &stats));
+  EXPECT_EQ(1U, stats.num_gcs);
+
+  unsigned char obj1_check[OBJ1_SIZE];
+  for (uint16_t i = 0; i < num_objs; i++) {
+    memset(obj1_check, 0, sizeof(obj1_check));
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, i, obj1_check, sizeof(obj1_check)));
+    EXPECT_EQ(0, memcmp(obj1_alt, obj1_check, sizeof(obj1_alt)));
+  }
+}
+
+TEST_F(LogfsTestCooked, BatchSaveFilesystemFull) {
+  const uint32_t num_slots = flashfs_config_settings.arena_size / flashfs_config_settings.slot_size;
+
+  /* Fill the filesystem with active objects, leaving room for just one more */
+  for (uint32_t i = 0; i < num_slots - 2; i++) {
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, i, obj1, sizeof(obj1)));
+  }
+
+  struct pios_flashfs_obj objs[2] = {
+    { OBJ2_ID, 0, OBJ2_SIZE, obj2 },
+    { OBJ2_ID, 1, OBJ2_SIZE, obj2 },
+  };
+
+  /* The first new object fits, the second doesn't */
+  struct batch_ctx batch = { objs, 2, 0, 0, 0 };
+  struct pios_flashfs_batch_stats stats;
+  EXPECT_EQ(-4, PIOS_FLASHFS_ObjSaveBatch(fs_id, 2, batch_next, &batch, &stats));
+  EXPECT_EQ(1U, stats.num_objs);
+  EXPECT_EQ(0U, stats.num_gcs);
+
+  unsigned char obj2_check[OBJ2_SIZE];
+  memset(obj2_check, 0, sizeof(obj2_check));
+  EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ2_ID, 0, obj2_check, sizeof(obj2_check)));
+  EXPECT_EQ(0, memcmp(obj2, obj2_check, sizeof(obj2)));
+  EXPECT_EQ(-3, PIOS_FLASHFS_ObjLoad(fs_id, OBJ2_ID, 1, obj2_check, sizeof(obj2_check)));
+}
+
 class LogfsTestCookedMultiPart : public LogfsTestRaw {
 protected:
   virtual void SetUp() {
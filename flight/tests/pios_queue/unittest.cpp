@@ -0,0 +1,385 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2017
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test for the POSIX PiOS queue and timed waits
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* qsort */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+#include <time.h>		/* clock_gettime */
+#include <unistd.h>		/* usleep */
+#include <pthread.h>		/* pthread_create */
+
+extern "C" {
+
+#include "pios.h"
+#include "pios_queue.h"
+#include "pios_semaphore.h"
+#include "pios_mutex.h"
+#include "pios_deadline.h"
+
+}
+
+static uint64_t now_us(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class QueueTest : public testing::Test {
+protected:
+  virtual void SetUp() {
+    queue = PIOS_Queue_Create(QUEUE_LEN, sizeof(uint32_t));
+    ASSERT_TRUE(queue != NULL);
+  }
+
+  virtual void TearDown() {
+    PIOS_Queue_Delete(queue);
+  }
+
+  static const int QUEUE_LEN = 8;
+
+  struct pios_queue *queue;
+};
+
+TEST_F(QueueTest, SendReceiveInOrder) {
+  for (uint32_t i = 0; i < QUEUE_LEN; i++) {
+    EXPECT_TRUE(PIOS_Queue_Send(queue, &i, 0));
+  }
+
+  for (uint32_t i = 0; i < QUEUE_LEN; i++) {
+    uint32_t val;
+
+    ASSERT_TRUE(PIOS_Queue_Receive(queue, &val, 0));
+    EXPECT_EQ(i, val);
+  }
+}
+
+TEST_F(QueueTest, FullAndEmptyTimeout) {
+  uint32_t val = 0;
+
+  /* Empty */
+  EXPECT_FALSE(PIOS_Queue_Receive(queue, &val, 0));
+
+  uint64_t start = now_us();
+  EXPECT_FALSE(PIOS_Queue_Receive(queue, &val, 20));
+  EXPECT_GE(now_us() - start, 20000u);
+
+  for (int i = 0; i < QUEUE_LEN; i++) {
+    EXPECT_TRUE(PIOS_Queue_Send(queue, &val, 0));
+  }
+
+  /* Full */
+  EXPECT_FALSE(PIOS_Queue_Send(queue, &val, 0));
+
+  start = now_us();
+  EXPECT_FALSE(PIOS_Queue_Send(queue, &val, 20));
+  EXPECT_GE(now_us() - start, 20000u);
+}
+
+struct producer_args {
+  struct pios_queue *queue;
+  uint32_t first;
+  uint32_t count;
+  uint32_t period_us;
+};
+
+static void *producer_thread(void *ctx)
+{
+  struct producer_args *args = (struct producer_args *) ctx;
+
+  for (uint32_t i = 0; i < args->count; i++) {
+    uint32_t val = args->first + i;
+
+    if (args->period_us) {
+      usleep(args->period_us);
+    }
+
+    /* Send a timestamp when pacing, as a sensor sample would */
+    if (args->period_us) {
+      val = (uint32_t) now_us();
+    }
+
+    PIOS_Queue_Send(args->queue, &val, PIOS_QUEUE_TIMEOUT_MAX);
+  }
+
+  return NULL;
+}
+
+TEST_F(QueueTest, SingleProducerSingleConsumer) {
+  const uint32_t count = 200000;
+
+  struct producer_args args = { queue, 0, count, 0 };
+  pthread_t producer;
+
+  uint64_t start = now_us();
+
+  ASSERT_EQ(0, pthread_create(&producer, NULL, producer_thread, &args));
+
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t val;
+
+    ASSERT_TRUE(PIOS_Queue_Receive(queue, &val, 1000));
+    ASSERT_EQ(i, val);
+  }
+
+  uint64_t elapsed = now_us() - start;
+
+  pthread_join(producer, NULL);
+
+  printf("SPSC: %.0f items/sec\n", count * 1e6 / elapsed);
+}
+
+TEST_F(QueueTest, MultipleProducers) {
+  const uint32_t count = 50000;
+
+  struct producer_args args[2] = {
+    { queue, 0, count, 0 },
+    { queue, count, count, 0 },
+  };
+  pthread_t producers[2];
+
+  for (int i = 0; i < 2; i++) {
+    ASSERT_EQ(0, pthread_create(&producers[i], NULL, producer_thread, &args[i]));
+  }
+
+  uint32_t next[2] = { 0, count };
+
+  for (uint32_t i = 0; i < count * 2; i++) {
+    uint32_t val;
+
+    ASSERT_TRUE(PIOS_Queue_Receive(queue, &val, 1000));
+
+    /* Each producer's items arrive in its own order */
+    int p = val >= count;
+    ASSERT_EQ(next[p], val);
+    next[p]++;
+  }
+
+  for (int i = 0; i < 2; i++) {
+    pthread_join(producers[i], NULL);
+  }
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+  uint32_t x = *(const uint32_t *) a, y = *(const uint32_t *) b;
+
+  return (x > y) - (x < y);
+}
+
+/*
+ * Models the simulator's sensor to attitude path: samples are produced at
+ * 2kHz and the consumer blocks on the queue waiting for each one, so every
+ * item has to wake a sleeping consumer.
+ */
+TEST_F(QueueTest, SensorToAttitudeLatency) {
+  const uint32_t count = 1000;
+
+  struct producer_args args = { queue, 0, count, 500 };
+  pthread_t producer;
+
+  static uint32_t latency[count];
+
+  ASSERT_EQ(0, pthread_create(&producer, NULL, producer_thread, &args));
+
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t stamp;
+
+    ASSERT_TRUE(PIOS_Queue_Receive(queue, &stamp, 1000));
+    latency[i] = (uint32_t) now_us() - stamp;
+  }
+
+  pthread_join(producer, NULL);
+
+  qsort(latency, count, sizeof(latency[0]), compare_u32);
+
+  uint64_t total = 0;
+
+  for (uint32_t i = 0; i < count; i++) {
+    total += latency[i];
+  }
+
+  printf("Sensor to attitude latency: avg %u us, p50 %u us, p99 %u us, max %u us\n",
+      (uint32_t) (total / count), latency[count / 2],
+      latency[count * 99 / 100], latency[count - 1]);
+}
+
+TEST(DeadlineTest, NanosecondsNormalized) {
+  for (uint32_t timeout_ms = 0; timeout_ms < 2000; timeout_ms += 7) {
+    struct timespec abstime;
+
+    PIOS_Deadline_From_Now(&abstime, CLOCK_MONOTONIC, timeout_ms);
+
+    ASSERT_GE(abstime.tv_nsec, 0);
+    ASSERT_LT(abstime.tv_nsec, 1000000000);
+  }
+}
+
+#define HIST_BUCKETS 8
+
+/*
+ * Histogram of how late a timed wait returns, in 250us buckets; the last
+ * bucket collects everything later than that.
+ */
+struct wake_hist {
+  uint32_t buckets[HIST_BUCKETS];
+  uint32_t early;
+  uint32_t max_late_us;
+};
+
+static void hist_add(struct wake_hist *hist, uint32_t requested_ms,
+    uint64_t elapsed_us)
+{
+  int64_t late_us = (int64_t) elapsed_us - requested_ms * 1000;
+
+  if (late_us < 0) {
+    hist->early++;
+    return;
+  }
+
+  uint32_t bucket = late_us / 250;
+
+  if (bucket >= HIST_BUCKETS) {
+    bucket = HIST_BUCKETS - 1;
+  }
+
+  hist->buckets[bucket]++;
+
+  if (late_us > hist->max_late_us) {
+    hist->max_late_us = late_us;
+  }
+}
+
+static void hist_print(const char *name, const struct wake_hist *hist)
+{
+  printf("%s wake lateness (250us buckets):", name);
+
+  for (int i = 0; i < HIST_BUCKETS; i++) {
+    printf(" %u", hist->buckets[i]);
+  }
+
+  printf(", max %u us\n", hist->max_late_us);
+}
+
+static const uint32_t wait_times_ms[] = { 1, 2, 5 };
+static const int wait_reps = 20;
+
+TEST(DeadlineTest, QueueReceiveLatency) {
+  struct pios_queue *queue = PIOS_Queue_Create(1, sizeof(uint32_t));
+  ASSERT_TRUE(queue != NULL);
+
+  struct wake_hist hist = {};
+
+  for (uint32_t t : wait_times_ms) {
+    for (int n = 0; n < wait_reps; n++) {
+      uint32_t val;
+      uint64_t start = now_us();
+
+      EXPECT_FALSE(PIOS_Queue_Receive(queue, &val, t));
+      hist_add(&hist, t, now_us() - start);
+    }
+  }
+
+  EXPECT_EQ(0u, hist.early);
+  hist_print("Queue", &hist);
+
+  PIOS_Queue_Delete(queue);
+}
+
+TEST(DeadlineTest, SemaphoreTakeLatency) {
+  struct pios_semaphore *sema = PIOS_Semaphore_Create();
+  ASSERT_TRUE(sema != NULL);
+
+  /* Created given */
+  ASSERT_TRUE(PIOS_Semaphore_Take(sema, 0));
+
+  struct wake_hist hist = {};
+
+  for (uint32_t t : wait_times_ms) {
+    for (int n = 0; n < wait_reps; n++) {
+      uint64_t start = now_us();
+
+      EXPECT_FALSE(PIOS_Semaphore_Take(sema, t));
+      hist_add(&hist, t, now_us() - start);
+    }
+  }
+
+  EXPECT_EQ(0u, hist.early);
+  hist_print("Semaphore", &hist);
+}
+
+static void *hold_mutex(void *ctx)
+{
+  struct pios_mutex *mtx = (struct pios_mutex *) ctx;
+
+  PIOS_Mutex_Lock(mtx, PIOS_MUTEX_TIMEOUT_MAX);
+  usleep(200000);
+  PIOS_Mutex_Unlock(mtx);
+
+  return NULL;
+}
+
+TEST(DeadlineTest, MutexLockLatency) {
+  struct pios_mutex *mtx = PIOS_Mutex_Create();
+  ASSERT_TRUE(mtx != NULL);
+
+  pthread_t holder;
+  ASSERT_EQ(0, pthread_create(&holder, NULL, hold_mutex, mtx));
+
+  /* Give the holder time to take it */
+  usleep(20000);
+
+  struct wake_hist hist = {};
+
+  for (uint32_t t : wait_times_ms) {
+    for (int n = 0; n < 5; n++) {
+      uint64_t start = now_us();
+
+      EXPECT_FALSE(PIOS_Mutex_Lock(mtx, t));
+      hist_add(&hist, t, now_us() - start);
+    }
+  }
+
+  pthread_join(holder, NULL);
+
+  EXPECT_TRUE(PIOS_Mutex_Lock(mtx, 10));
+  PIOS_Mutex_Unlock(mtx);
+
+  EXPECT_EQ(0u, hist.early);
+  hist_print("Mutex", &hist);
+}
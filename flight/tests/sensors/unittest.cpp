@@ -0,0 +1,165 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2017
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test for averaging gyro and accel samples
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* abort */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+
+#include <vector>
+
+extern "C" {
+
+#include "pios.h"
+#include "pios_queue.h"
+#include "pios_sensors.h"
+
+}
+
+class SensorAverage : public testing::Test {
+protected:
+  virtual void SetUp() {
+    gyro_queue = PIOS_Queue_Create(QUEUE_LEN, sizeof(struct pios_sensor_gyro_data));
+    ASSERT_TRUE(gyro_queue != NULL);
+    accel_queue = PIOS_Queue_Create(QUEUE_LEN, sizeof(struct pios_sensor_accel_data));
+    ASSERT_TRUE(accel_queue != NULL);
+  }
+
+  virtual void TearDown() {
+    PIOS_Queue_Delete(gyro_queue);
+    PIOS_Queue_Delete(accel_queue);
+  }
+
+  /* Sample i reads i on every axis */
+  void QueueGyros(int first, int count) {
+    for (int i = first; i < first + count; i++) {
+      struct pios_sensor_gyro_data sample = { (float) i, (float) i, (float) i, (float) i };
+      ASSERT_TRUE(PIOS_Queue_Send(gyro_queue, &sample, 0));
+    }
+  }
+
+  void QueueAccels(int first, int count) {
+    for (int i = first; i < first + count; i++) {
+      struct pios_sensor_accel_data sample = { (float) i, (float) -i, (float) i, (float) i };
+      ASSERT_TRUE(PIOS_Queue_Send(accel_queue, &sample, 0));
+    }
+  }
+
+  /* Empties a queue, returning how much was left on it */
+  static int Drain(struct pios_queue *queue, size_t item_size) {
+    std::vector<uint8_t> item(item_size);
+    int count = 0;
+    while (PIOS_Queue_Receive(queue, &item[0], 0))
+      count++;
+    return count;
+  }
+
+  static const int QUEUE_LEN = 32;
+
+  struct pios_queue *gyro_queue;
+  struct pios_queue *accel_queue;
+};
+
+TEST_F(SensorAverage, GyrosAverageOneSample) {
+  QueueGyros(5, 1);
+
+  struct pios_sensor_gyro_data gyros;
+  EXPECT_EQ(1U, PIOS_SENSORS_ReceiveGyros(gyro_queue, 1, 0, &gyros));
+  EXPECT_FLOAT_EQ(5, gyros.x);
+  EXPECT_FLOAT_EQ(5, gyros.y);
+  EXPECT_FLOAT_EQ(5, gyros.z);
+  EXPECT_FLOAT_EQ(5, gyros.temperature);
+}
+
+TEST_F(SensorAverage, GyrosTakeOnlyTheOversampledCount) {
+  // A backlog of three updates' worth
+  QueueGyros(0, 12);
+
+  struct pios_sensor_gyro_data gyros;
+  for (int update = 0; update < 3; update++) {
+    EXPECT_EQ(4U, PIOS_SENSORS_ReceiveGyros(gyro_queue, 4, 0, &gyros));
+
+    // Mean of 4u .. 4u + 3
+    EXPECT_FLOAT_EQ(update * 4 + 1.5f, gyros.x);
+    EXPECT_FLOAT_EQ(update * 4 + 1.5f, gyros.z);
+  }
+
+  EXPECT_EQ(0, Drain(gyro_queue, sizeof(gyros)));
+}
+
+TEST_F(SensorAverage, GyrosTimeOutShort) {
+  QueueGyros(0, 3);
+
+  struct pios_sensor_gyro_data gyros;
+  EXPECT_EQ(0U, PIOS_SENSORS_ReceiveGyros(gyro_queue, 4, 1, &gyros));
+  EXPECT_EQ(0U, PIOS_SENSORS_ReceiveGyros(gyro_queue, 0, 1, &gyros));
+}
+
+TEST_F(SensorAverage, AccelsAverageWhatIsQueued) {
+  struct pios_sensor_accel_data accels;
+  EXPECT_EQ(0U, PIOS_SENSORS_ReceiveAccels(accel_queue, 255, &accels));
+
+  QueueAccels(1, 3);
+  EXPECT_EQ(3U, PIOS_SENSORS_ReceiveAccels(accel_queue, 255, &accels));
+  EXPECT_FLOAT_EQ(2, accels.x);
+  EXPECT_FLOAT_EQ(-2, accels.y);
+  EXPECT_FLOAT_EQ(2, accels.temperature);
+
+  // One at a time without oversampling
+  QueueAccels(1, 3);
+  EXPECT_EQ(1U, PIOS_SENSORS_ReceiveAccels(accel_queue, 1, &accels));
+  EXPECT_FLOAT_EQ(1, accels.x);
+  EXPECT_EQ(2, Drain(accel_queue, sizeof(accels)));
+}
+
+TEST_F(SensorAverage, UpdatePeriodMatchesSamplesTaken) {
+  PIOS_SENSORS_SetSampleRate(PIOS_SENSOR_GYRO, 8000);
+  PIOS_SENSORS_SetSampleRate(PIOS_SENSOR_ACCEL, 1000);
+
+  EXPECT_FLOAT_EQ(1 / 8000.0f, PIOS_SENSORS_GetUpdatePeriod(PIOS_SENSOR_GYRO, 1));
+  EXPECT_FLOAT_EQ(8 / 8000.0f, PIOS_SENSORS_GetUpdatePeriod(PIOS_SENSOR_GYRO, 8));
+  EXPECT_FLOAT_EQ(1 / 1000.0f, PIOS_SENSORS_GetUpdatePeriod(PIOS_SENSOR_ACCEL, 1));
+
+  // However far behind the task is, an update covers the samples it
+  // averaged and no more, so the filters' dT holds
+  QueueGyros(0, 20);
+  struct pios_sensor_gyro_data gyros;
+  uint32_t samples = PIOS_SENSORS_ReceiveGyros(gyro_queue, 8, 0, &gyros);
+  EXPECT_FLOAT_EQ(PIOS_SENSORS_GetUpdatePeriod(PIOS_SENSOR_GYRO, 8),
+      PIOS_SENSORS_GetUpdatePeriod(PIOS_SENSOR_GYRO, samples));
+  EXPECT_EQ(12, Drain(gyro_queue, sizeof(gyros)));
+}
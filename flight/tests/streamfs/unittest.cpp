@@ -0,0 +1,205 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2017
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* abort */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+#include <unistd.h>		/* unlink, usleep */
+
+extern "C" {
+
+#include "pios_flash.h"		/* PIOS_FLASH_* API */
+
+#include "pios_flash_priv.h"	/* struct pios_flash_partition */
+
+extern const struct pios_flash_partition pios_flash_partition_table[];
+extern uint32_t pios_flash_partition_table_size;
+
+#include "pios_flash_posix_priv.h"
+
+extern uintptr_t pios_posix_flash_id;
+extern struct pios_flash_posix_cfg flash_config;
+
+#include "pios_com.h"		/* struct pios_com_driver */
+#include "pios_streamfs_priv.h"
+#include "pios_streamfs.h"	/* PIOS_STREAMFS_* */
+
+extern struct streamfs_cfg streamfs_config;
+
+}
+
+/* Bytes of each arena before its footer */
+#define ARENA_DATA_SIZE (0x10000 - 14)
+
+/* The buffer that ends at the footer is short */
+#define LAST_BUFFER_SIZE (ARENA_DATA_SIZE % 0x100)
+
+#define STREAM_SIZE (2 * 0x10000)
+
+static uint8_t stream[STREAM_SIZE];
+static volatile uint32_t stream_sent;
+static volatile uint32_t stream_avail;
+
+/* Stands in for the COM buffer that the logger writes into */
+static uint16_t stream_tx_out(uintptr_t, uint8_t *buf, uint16_t buf_len, uint16_t *, bool *)
+{
+  uint32_t len = stream_avail - stream_sent;
+
+  if (len > buf_len) {
+    len = buf_len;
+  }
+
+  memcpy(buf, &stream[stream_sent], len);
+  stream_sent += len;
+
+  return len;
+}
+
+class StreamfsTestRaw : public testing::Test {
+protected:
+  virtual void SetUp() {
+    /* create an empty, appropriately sized flash filesystem */
+    FILE * theflash = fopen("theflash.bin", "w");
+    uint8_t sector[flash_config.size_of_sector];
+    memset(sector, 0xFF, sizeof(sector));
+    for (uint32_t i = 0; i < flash_config.size_of_flash / flash_config.size_of_sector; i++) {
+      fwrite(sector, sizeof(sector), 1, theflash);
+    }
+    fclose(theflash);
+
+    /* Nothing repeats on a page, so misplaced data shows */
+    for (uint32_t i = 0; i < sizeof(stream); i++) {
+      stream[i] = i + i / 251;
+    }
+    stream_sent = 0;
+    stream_avail = 0;
+
+    ASSERT_EQ(0, PIOS_Flash_Posix_Init(&pios_posix_flash_id, &flash_config));
+
+    /* Register the partition table */
+    PIOS_FLASH_register_partition_table(pios_flash_partition_table, pios_flash_partition_table_size);
+
+    ASSERT_EQ(0, PIOS_STREAMFS_Init(&fs_id, &streamfs_config, FLASH_PARTITION_LABEL_LOG));
+    ASSERT_EQ(0, PIOS_STREAMFS_Format(fs_id));
+
+    pios_streamfs_com_driver.bind_tx_cb(fs_id, stream_tx_out, 0);
+  }
+
+  virtual void TearDown() {
+    PIOS_Flash_Posix_Destroy(pios_posix_flash_id);
+    unlink("theflash.bin");
+  }
+
+  /* Let the logger have this much of the stream in total */
+  void Stream(uint32_t total) {
+    stream_avail = total;
+    pios_streamfs_com_driver.tx_start(fs_id, 0);
+  }
+
+  /* Wait for the streamfs task to get through its buffers */
+  bool WaitForStats(uint32_t written, uint32_t dropped) {
+    struct pios_streamfs_stats stats;
+
+    for (int i = 0; i < 2000; i++) {
+      EXPECT_EQ(0, PIOS_STREAMFS_GetStats(fs_id, &stats));
+      if (stats.bytes_written == written && stats.bytes_dropped == dropped) {
+        return true;
+      }
+      usleep(1000);
+    }
+
+    printf("written %u dropped %u\n", stats.bytes_written, stats.bytes_dropped);
+    return false;
+  }
+
+  /* Read back the whole of the newest file */
+  uint32_t ReadBack(uint8_t *data, uint32_t len) {
+    EXPECT_EQ(0, PIOS_STREAMFS_OpenRead(fs_id, PIOS_STREAMFS_MaxFileId(fs_id)));
+    int32_t read = PIOS_STREAMFS_Read(fs_id, data, len);
+    EXPECT_EQ(0, PIOS_STREAMFS_Close(fs_id));
+
+    return read < 0 ? 0 : read;
+  }
+
+  uintptr_t fs_id;
+};
+
+TEST_F(StreamfsTestRaw, WriteRead) {
+  const uint32_t len = 3 * 0x100 + 17;
+
+  ASSERT_EQ(0, PIOS_STREAMFS_OpenWrite(fs_id));
+  Stream(len);
+  EXPECT_TRUE(WaitForStats(3 * 0x100, 0));
+  EXPECT_EQ(0, PIOS_STREAMFS_Close(fs_id));
+
+  uint8_t data[len + 1];
+  ASSERT_EQ(len, ReadBack(data, sizeof(data)));
+  EXPECT_EQ(0, memcmp(data, stream, len));
+}
+
+TEST_F(StreamfsTestRaw, WriteAfterFailedWrite) {
+  ASSERT_EQ(0, PIOS_STREAMFS_OpenWrite(fs_id));
+
+  /* Everything up to the buffer that ends at the footer */
+  const uint32_t full = ARENA_DATA_SIZE - LAST_BUFFER_SIZE;
+  Stream(full + 1);
+  ASSERT_TRUE(WaitForStats(full, 0));
+
+  /* Lose that buffer */
+  PIOS_Flash_Posix_FailWrites(pios_posix_flash_id, 1);
+  Stream(full + LAST_BUFFER_SIZE + 1);
+  ASSERT_TRUE(WaitForStats(full, LAST_BUFFER_SIZE));
+
+  /*
+   * The next buffer takes its place, then the file carries on in the
+   * next arena one page program per buffer.
+   */
+  uint32_t writes = PIOS_Flash_Posix_GetWriteCount(pios_posix_flash_id);
+  const uint32_t len = full + 2 * LAST_BUFFER_SIZE + 4 * 0x100 + 1;
+  Stream(len);
+  EXPECT_TRUE(WaitForStats(full + LAST_BUFFER_SIZE + 4 * 0x100, LAST_BUFFER_SIZE));
+
+  /* The buffer, the footer, then the four buffers in the next arena */
+  EXPECT_EQ(writes + 2 + 4, PIOS_Flash_Posix_GetWriteCount(pios_posix_flash_id));
+
+  EXPECT_EQ(0, PIOS_STREAMFS_Close(fs_id));
+
+  /* The file is the stream with just the lost buffer missing */
+  static uint8_t data[STREAM_SIZE];
+  ASSERT_EQ(len - LAST_BUFFER_SIZE, ReadBack(data, sizeof(data)));
+  EXPECT_EQ(0, memcmp(data, stream, full));
+  EXPECT_EQ(0, memcmp(&data[full], &stream[full + LAST_BUFFER_SIZE],
+      len - full - LAST_BUFFER_SIZE));
+}
@@ -0,0 +1,77 @@
+/**
+ ******************************************************************************
+ * @file       unittest_mocks.c
+ * @author     dRonin, http://dronin.org Copyright (C) 2017
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Host implementations of the PiOS services used by streamfs
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "pios.h"
+#include "pios_com.h"
+#include "pios_thread.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+void * PIOS_malloc(size_t size)
+{
+	return malloc(size);
+}
+
+void * PIOS_malloc_no_dma(size_t size)
+{
+	return malloc(size);
+}
+
+void PIOS_free(void * buf)
+{
+	free(buf);
+}
+
+/* The tests hand streamfs its own handle rather than a COM port's */
+uintptr_t PIOS_COM_GetDriverCtx(uintptr_t com_id)
+{
+	return com_id;
+}
+
+struct pios_thread {
+	pthread_t thread;
+};
+
+struct pios_thread *PIOS_Thread_Create(void (*fp)(void *), const char *namep, size_t stack_bytes, void *argp, enum pios_thread_prio_e prio)
+{
+	struct pios_thread *thread = malloc(sizeof(*thread));
+
+	if (pthread_create(&thread->thread, NULL, (void *(*)(void *)) fp, argp)) {
+		free(thread);
+		return NULL;
+	}
+
+	/* The streamfs task never returns; let it go with the process */
+	pthread_detach(thread->thread);
+
+	return thread;
+}
+
+void PIOS_Thread_Sleep(uint32_t time_ms)
+{
+	usleep(1000 * time_ms);
+}
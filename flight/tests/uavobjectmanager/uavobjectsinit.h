@@ -0,0 +1,41 @@
+/**
+ ******************************************************************************
+ * @file       uavobjectsinit.h
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Stand-in for the generated object table used by the object manager
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef UAVOBJECTSINIT_H
+#define UAVOBJECTSINIT_H
+
+#include <stdint.h>
+
+#define UAVOBJECTS_LARGEST 256
+
+/* Roughly the number of objects in a full firmware build */
+#define UAVOBJECTS_COUNT 160
+
+/* Evenly spread, ascending, even IDs so that no ID collides with a meta ID */
+#define UT_OBJ_ID(i) (0x10000000 + (uint32_t)(i) * 0x01000002)
+
+extern const uint32_t uavo_sorted_ids[UAVOBJECTS_COUNT];
+
+#endif /* UAVOBJECTSINIT_H */
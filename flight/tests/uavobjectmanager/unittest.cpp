@@ -0,0 +1,361 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2016
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test for the flight object manager
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* abort */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+#include <time.h>		/* clock_gettime */
+#include <pthread.h>	/* pthread_create */
+
+extern "C" {
+
+#include "openpilot.h"
+#include "uavobjectsinit.h"	/* UAVOBJECTS_COUNT, UT_OBJ_ID */
+
+}
+
+#define OBJ_SIZE 32
+
+/* An ID the generated table doesn't know about */
+#define UNINDEXED_ID 0x12345678
+
+static double now_seconds(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class UAVObjManagerTest : public testing::Test {
+protected:
+  virtual void SetUp() {
+    ASSERT_EQ(0, UAVObjInitialize());
+  }
+};
+
+TEST_F(UAVObjManagerTest, GetByIdRegistered) {
+  UAVObjHandle obj = UAVObjRegister(UT_OBJ_ID(10), 1, 0, OBJ_SIZE, NULL);
+  ASSERT_TRUE(obj != NULL);
+
+  EXPECT_EQ(obj, UAVObjGetByID(UT_OBJ_ID(10)));
+  EXPECT_EQ(UT_OBJ_ID(10), UAVObjGetID(obj));
+}
+
+TEST_F(UAVObjManagerTest, GetByIdMeta) {
+  UAVObjHandle obj = UAVObjRegister(UT_OBJ_ID(20), 0, 0, OBJ_SIZE, NULL);
+  ASSERT_TRUE(obj != NULL);
+
+  UAVObjHandle meta = UAVObjGetByID(UT_OBJ_ID(20) + 1);
+  ASSERT_TRUE(meta != NULL);
+  EXPECT_TRUE(UAVObjIsMetaobject(meta));
+  EXPECT_EQ(meta, UAVObjGetLinkedObj(obj));
+}
+
+TEST_F(UAVObjManagerTest, GetByIdNotRegistered) {
+  ASSERT_TRUE(UAVObjRegister(UT_OBJ_ID(30), 1, 0, OBJ_SIZE, NULL) != NULL);
+
+  /* Known to the table, but never registered */
+  EXPECT_EQ(NULL, UAVObjGetByID(UT_OBJ_ID(31)));
+  EXPECT_EQ(NULL, UAVObjGetByID(UT_OBJ_ID(31) + 1));
+
+  /* Not known at all */
+  EXPECT_EQ(NULL, UAVObjGetByID(UNINDEXED_ID));
+  EXPECT_EQ(NULL, UAVObjGetByID(0));
+  EXPECT_EQ(NULL, UAVObjGetByID(0xFFFFFFFF));
+}
+
+TEST_F(UAVObjManagerTest, GetByIdUnindexed) {
+  UAVObjHandle obj = UAVObjRegister(UNINDEXED_ID, 1, 0, OBJ_SIZE, NULL);
+  ASSERT_TRUE(obj != NULL);
+
+  EXPECT_EQ(obj, UAVObjGetByID(UNINDEXED_ID));
+  EXPECT_EQ(UAVObjGetLinkedObj(obj), UAVObjGetByID(UNINDEXED_ID + 1));
+}
+
+TEST_F(UAVObjManagerTest, DuplicateRegister) {
+  ASSERT_TRUE(UAVObjRegister(UT_OBJ_ID(40), 1, 0, OBJ_SIZE, NULL) != NULL);
+  EXPECT_EQ(NULL, UAVObjRegister(UT_OBJ_ID(40), 1, 0, OBJ_SIZE, NULL));
+}
+
+TEST_F(UAVObjManagerTest, GetByIdRate) {
+  for (int i = 0; i < UAVOBJECTS_COUNT; i++) {
+    ASSERT_TRUE(UAVObjRegister(UT_OBJ_ID(i), 1, 0, OBJ_SIZE, NULL) != NULL);
+  }
+
+  const int iterations = 200;
+  uint32_t found = 0;
+
+  double start = now_seconds();
+
+  for (int n = 0; n < iterations; n++) {
+    for (int i = 0; i < UAVOBJECTS_COUNT; i++) {
+      /* Look up both the object and its meta object */
+      found += UAVObjGetByID(UT_OBJ_ID(i)) != NULL;
+      found += UAVObjGetByID(UT_OBJ_ID(i) + 1) != NULL;
+    }
+  }
+
+  double elapsed = now_seconds() - start;
+
+  EXPECT_EQ((uint32_t) iterations * UAVOBJECTS_COUNT * 2, found);
+
+  printf("UAVObjGetByID: %.0f lookups/sec over %d objects\n",
+      found / elapsed, UAVOBJECTS_COUNT);
+}
+
+TEST_F(UAVObjManagerTest, SingleSetGet) {
+  UAVObjHandle obj = UAVObjRegister(UT_OBJ_ID(50), 1, 0, OBJ_SIZE, NULL);
+  ASSERT_TRUE(obj != NULL);
+
+  uint8_t in[OBJ_SIZE], out[OBJ_SIZE];
+
+  for (int i = 0; i < OBJ_SIZE; i++) {
+    in[i] = i;
+  }
+
+  ASSERT_EQ(0, UAVObjSetData(obj, in));
+  ASSERT_EQ(0, UAVObjGetData(obj, out));
+  EXPECT_EQ(0, memcmp(in, out, OBJ_SIZE));
+
+  uint8_t field[4];
+  ASSERT_EQ(0, UAVObjGetDataField(obj, field, 8, sizeof(field)));
+  EXPECT_EQ(0, memcmp(in + 8, field, sizeof(field)));
+
+  /* Overrun and bad instance are still rejected on the lock-free path */
+  EXPECT_EQ(-1, UAVObjGetDataField(obj, field, OBJ_SIZE - 2, sizeof(field)));
+  EXPECT_EQ(-1, UAVObjGetInstanceData(obj, 1, out));
+}
+
+struct writer_args {
+  UAVObjHandle obj;
+  volatile bool stop;
+};
+
+static void *writer_thread(void *ctx)
+{
+  struct writer_args *args = (struct writer_args *) ctx;
+  uint8_t data[OBJ_SIZE];
+  uint8_t n = 0;
+
+  while (!args->stop) {
+    n++;
+    memset(data, n, sizeof(data));
+    UAVObjSetData(args->obj, data);
+  }
+
+  return NULL;
+}
+
+TEST_F(UAVObjManagerTest, SingleReadsNeverTorn) {
+  UAVObjHandle obj = UAVObjRegister(UT_OBJ_ID(60), 1, 0, OBJ_SIZE, NULL);
+  ASSERT_TRUE(obj != NULL);
+
+  UAVObjClearStats();
+
+  struct writer_args args = { obj, false };
+  pthread_t writer;
+
+  ASSERT_EQ(0, pthread_create(&writer, NULL, writer_thread, &args));
+
+  const int iterations = 200000;
+  int torn = 0;
+
+  for (int n = 0; n < iterations; n++) {
+    uint8_t out[OBJ_SIZE];
+
+    ASSERT_EQ(0, UAVObjGetData(obj, out));
+
+    for (int i = 1; i < OBJ_SIZE; i++) {
+      if (out[i] != out[0]) {
+        torn++;
+        break;
+      }
+    }
+  }
+
+  args.stop = true;
+  pthread_join(writer, NULL);
+
+  EXPECT_EQ(0, torn);
+
+  UAVObjStats stats;
+  UAVObjGetStats(&stats);
+
+  if (stats.readContentions) {
+    EXPECT_EQ(UT_OBJ_ID(60), stats.lastReadContentionID);
+  }
+
+  printf("UAVObjGetData: %u of %d reads fell back to the lock\n",
+      stats.readContentions, iterations);
+}
+
+TEST_F(UAVObjManagerTest, MultiInstanceData) {
+  UAVObjHandle obj = UAVObjRegister(UT_OBJ_ID(70), 0, 0, OBJ_SIZE, NULL);
+  ASSERT_TRUE(obj != NULL);
+
+  const int num_instances = 50;
+
+  for (int i = 1; i < num_instances; i++) {
+    ASSERT_EQ(i, UAVObjCreateInstance(obj, NULL));
+  }
+  ASSERT_EQ(num_instances, UAVObjGetNumInstances(obj));
+
+  for (int i = 0; i < num_instances; i++) {
+    uint8_t in[OBJ_SIZE];
+
+    memset(in, i, sizeof(in));
+    ASSERT_EQ(0, UAVObjSetInstanceData(obj, i, in));
+  }
+
+  for (int i = 0; i < num_instances; i++) {
+    uint8_t in[OBJ_SIZE], out[OBJ_SIZE];
+
+    memset(in, i, sizeof(in));
+    ASSERT_EQ(0, UAVObjGetInstanceData(obj, i, out));
+    EXPECT_EQ(0, memcmp(in, out, OBJ_SIZE)) << "instance " << i;
+  }
+
+  uint8_t out[OBJ_SIZE];
+  EXPECT_EQ(-1, UAVObjGetInstanceData(obj, num_instances, out));
+
+  UAVObjStats stats;
+  UAVObjGetStats(&stats);
+
+  EXPECT_EQ((uint32_t) (num_instances - 1) * OBJ_SIZE, stats.instanceBytesUsed);
+  EXPECT_GE(stats.instanceBytesAllocated, stats.instanceBytesUsed);
+
+  printf("Multi instance storage: %u bytes used, %u allocated\n",
+      stats.instanceBytesUsed, stats.instanceBytesAllocated);
+}
+
+TEST_F(UAVObjManagerTest, MultiInstanceCreateSparse) {
+  UAVObjHandle obj = UAVObjRegister(UT_OBJ_ID(80), 0, 0, OBJ_SIZE, NULL);
+  ASSERT_TRUE(obj != NULL);
+
+  uint8_t in[OBJ_SIZE], out[OBJ_SIZE];
+  memset(in, 0xa5, sizeof(in));
+
+  /* Unpacking a far instance creates all those before it */
+  ASSERT_EQ(0, UAVObjUnpack(obj, 100, in));
+  EXPECT_EQ(101, UAVObjGetNumInstances(obj));
+
+  ASSERT_EQ(0, UAVObjGetInstanceData(obj, 100, out));
+  EXPECT_EQ(0, memcmp(in, out, OBJ_SIZE));
+
+  ASSERT_EQ(0, UAVObjGetInstanceData(obj, 99, out));
+  EXPECT_EQ(0, out[0]);
+}
+
+#define FANOUT_OBJS 10
+
+static UAVObjHandle fanout_objs[FANOUT_OBJS];
+static int fanout_calls[FANOUT_OBJS];
+
+static void fanout_source_cb(UAVObjEvent *, void *, void *, int)
+{
+  uint8_t buf[OBJ_SIZE] = { 0 };
+
+  /* Update every target twice; the second update of each should merge
+   * into the first while it is still pending. */
+  for (int n = 0; n < 2; n++) {
+    for (int i = 0; i < FANOUT_OBJS; i++) {
+      UAVObjSetData(fanout_objs[i], buf);
+    }
+  }
+}
+
+static void fanout_target_cb(UAVObjEvent *, void *ctx, void *, int)
+{
+  fanout_calls[(intptr_t) ctx]++;
+}
+
+TEST_F(UAVObjManagerTest, EventFanoutCoalesced) {
+  UAVObjHandle source = UAVObjRegister(UT_OBJ_ID(90), 1, 0, OBJ_SIZE, NULL);
+  ASSERT_TRUE(source != NULL);
+  ASSERT_EQ(0, UAVObjConnectCallback(source, fanout_source_cb, NULL,
+        EV_UPDATED));
+
+  for (int i = 0; i < FANOUT_OBJS; i++) {
+    fanout_objs[i] = UAVObjRegister(UT_OBJ_ID(100 + i), 1, 0, OBJ_SIZE, NULL);
+    ASSERT_TRUE(fanout_objs[i] != NULL);
+    ASSERT_EQ(0, UAVObjConnectCallback(fanout_objs[i], fanout_target_cb,
+          (void *) (intptr_t) i, EV_UPDATED));
+    fanout_calls[i] = 0;
+  }
+
+  UAVObjClearStats();
+
+  uint8_t buf[OBJ_SIZE] = { 0 };
+  ASSERT_EQ(0, UAVObjSetData(source, buf));
+
+  for (int i = 0; i < FANOUT_OBJS; i++) {
+    EXPECT_EQ(1, fanout_calls[i]) << "object " << i;
+  }
+
+  UAVObjStats stats;
+  UAVObjGetStats(&stats);
+
+  EXPECT_EQ(0u, stats.eventCallbackErrors);
+  EXPECT_EQ((uint32_t) FANOUT_OBJS + 1, stats.eventsDispatched);
+  EXPECT_EQ((uint32_t) FANOUT_OBJS, stats.eventsCoalesced);
+}
+
+static int self_update_calls;
+
+static void self_update_cb(UAVObjEvent *ev, void *, void *, int)
+{
+  uint8_t buf[OBJ_SIZE] = { 0 };
+
+  self_update_calls++;
+
+  /* Not allowed to retrigger ourselves */
+  UAVObjSetData(ev->obj, buf);
+}
+
+TEST_F(UAVObjManagerTest, EventNoSelfRetrigger) {
+  UAVObjHandle obj = UAVObjRegister(UT_OBJ_ID(120), 1, 0, OBJ_SIZE, NULL);
+  ASSERT_TRUE(obj != NULL);
+  ASSERT_EQ(0, UAVObjConnectCallback(obj, self_update_cb, NULL, EV_UPDATED));
+
+  self_update_calls = 0;
+
+  uint8_t buf[OBJ_SIZE] = { 0 };
+  ASSERT_EQ(0, UAVObjSetData(obj, buf));
+
+  EXPECT_EQ(1, self_update_calls);
+}
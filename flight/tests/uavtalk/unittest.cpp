@@ -0,0 +1,211 @@
+/**
+ ******************************************************************************
+ * @file       unittest.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2017
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Unit test
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+/*
+ * NOTE: This program uses the Google Test infrastructure to drive the unit test
+ *
+ * Main site for Google Test: http://code.google.com/p/googletest/
+ * Documentation and examples: http://code.google.com/p/googletest/wiki/Documentation
+ */
+
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* abort */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+
+#include <vector>
+
+extern "C" {
+
+#include "openpilot.h"
+#include "uavobjectsinit.h"	/* UT_OBJ_ID */
+#include "uavtalk.h"
+#include "uavtalk_priv.h"	/* UAVTALK_TYPE_* */
+
+}
+
+#define OBJ_SIZE 64
+
+/* Sync, type, length, object ID */
+#define HEADER_LENGTH 8
+
+static std::vector<std::vector<uint8_t> > sent_packets;
+
+static int32_t capture_packet(uint8_t *data, int32_t length)
+{
+  sent_packets.push_back(std::vector<uint8_t>(data, data + length));
+
+  return length;
+}
+
+class UAVTalkDelta : public testing::Test {
+protected:
+  static void SetUpTestCase() {
+    ASSERT_EQ(0, UAVObjInitialize());
+
+    obj = UAVObjRegister(UT_OBJ_ID(0), 1, 0, OBJ_SIZE, NULL);
+    ASSERT_TRUE(obj != NULL);
+  }
+
+  virtual void SetUp() {
+    sent_packets.clear();
+
+    for (int i = 0; i < OBJ_SIZE; i++) {
+      v1[i] = i * 7;
+    }
+
+    /* A few fields change between updates */
+    memcpy(v2, v1, sizeof(v2));
+    v2[3] ^= 0x55;
+    v2[40] ^= 0xAA;
+  }
+
+  /* Send v1 then v2 with deltas on, and return the packet for v2 */
+  std::vector<uint8_t> SendDelta() {
+    UAVTalkConnection tx = UAVTalkInitialize(capture_packet);
+    EXPECT_TRUE(tx != NULL);
+    EXPECT_EQ(0, UAVTalkSetDeltaEnabled(tx, true));
+
+    EXPECT_EQ(0, UAVObjSetData(obj, v1));
+    EXPECT_EQ(0, UAVTalkSendObject(tx, obj, 0, 0, 0));
+    EXPECT_EQ(0, UAVObjSetData(obj, v2));
+    EXPECT_EQ(0, UAVTalkSendObject(tx, obj, 0, 0, 0));
+
+    EXPECT_EQ(2U, sent_packets.size());
+    EXPECT_EQ(UAVTALK_TYPE_OBJ, sent_packets[0][1]);
+    EXPECT_EQ(UAVTALK_TYPE_OBJ_DELTA, sent_packets[1][1]);
+    EXPECT_LT(sent_packets[1].size(), sent_packets[0].size());
+
+    std::vector<uint8_t> delta = sent_packets[1];
+    sent_packets.clear();
+
+    return delta;
+  }
+
+  /* Feed a packet to a fresh receiving connection */
+  UAVTalkStats Receive(const std::vector<uint8_t> &packet) {
+    UAVTalkConnection rx = UAVTalkInitialize(capture_packet);
+    EXPECT_TRUE(rx != NULL);
+
+    UAVTalkRxState state = UAVTALK_STATE_ERROR;
+    for (size_t i = 0; i < packet.size(); i++) {
+      state = UAVTalkProcessInputStream(rx, packet[i]);
+    }
+    EXPECT_EQ(UAVTALK_STATE_COMPLETE, state);
+
+    UAVTalkStats stats;
+    UAVTalkGetStats(rx, &stats);
+
+    return stats;
+  }
+
+  static UAVObjHandle obj;
+
+  uint8_t v1[OBJ_SIZE];
+  uint8_t v2[OBJ_SIZE];
+};
+
+UAVObjHandle UAVTalkDelta::obj;
+
+TEST_F(UAVTalkDelta, AppliedToMatchingBase) {
+  std::vector<uint8_t> delta = SendDelta();
+
+  ASSERT_EQ(0, UAVObjSetData(obj, v1));
+  UAVTalkStats stats = Receive(delta);
+
+  EXPECT_EQ(1U, stats.rxDeltaObjects);
+  EXPECT_EQ(0U, stats.rxDeltaErrors);
+
+  uint8_t data[OBJ_SIZE];
+  ASSERT_EQ(0, UAVObjGetData(obj, data));
+  EXPECT_EQ(0, memcmp(data, v2, sizeof(data)));
+
+  /* Nothing to ask for */
+  EXPECT_EQ(0U, sent_packets.size());
+}
+
+TEST_F(UAVTalkDelta, RejectedOnMismatchedBase) {
+  std::vector<uint8_t> delta = SendDelta();
+
+  /*
+   * A copy that differs from v1 but has the same CRC-8, which is all the
+   * base check used to go on.  Changing two neighbouring bytes always
+   * finds one.
+   */
+  uint8_t v3[OBJ_SIZE];
+  memcpy(v3, v1, sizeof(v3));
+  v3[20] ^= 0xFF;
+
+  uint8_t crc8 = PIOS_CRC_updateCRC(0, v1, sizeof(v1));
+  int tries;
+  for (tries = 0; tries < 256; tries++) {
+    v3[21] = tries;
+    if (PIOS_CRC_updateCRC(0, v3, sizeof(v3)) == crc8) {
+      break;
+    }
+  }
+  ASSERT_LT(tries, 256);
+  ASSERT_NE(PIOS_CRC16_CCITT_updateCRC(0, v1, sizeof(v1)),
+      PIOS_CRC16_CCITT_updateCRC(0, v3, sizeof(v3)));
+
+  ASSERT_EQ(0, UAVObjSetData(obj, v3));
+  UAVTalkStats stats = Receive(delta);
+
+  EXPECT_EQ(0U, stats.rxDeltaObjects);
+  EXPECT_EQ(1U, stats.rxDeltaErrors);
+
+  /* Our copy is left alone ... */
+  uint8_t data[OBJ_SIZE];
+  ASSERT_EQ(0, UAVObjGetData(obj, data));
+  EXPECT_EQ(0, memcmp(data, v3, sizeof(data)));
+
+  /* ... and we ask for the whole object */
+  ASSERT_EQ(1U, sent_packets.size());
+  ASSERT_LE((size_t)HEADER_LENGTH, sent_packets[0].size());
+  EXPECT_EQ(UAVTALK_TYPE_OBJ_REQ, sent_packets[0][1]);
+
+  uint32_t objId = sent_packets[0][4] | (sent_packets[0][5] << 8) |
+      (sent_packets[0][6] << 16) | ((uint32_t)sent_packets[0][7] << 24);
+  EXPECT_EQ(UT_OBJ_ID(0), objId);
+}
+
+TEST_F(UAVTalkDelta, RejectedOnCorruptBaseCrc) {
+  std::vector<uint8_t> delta = SendDelta();
+
+  /* Flip a bit of the base CRC and fix up the packet CRC to match */
+  delta[HEADER_LENGTH] ^= 0x01;
+  delta[delta.size() - 1] = PIOS_CRC_updateCRC(0, &delta[0], delta.size() - 1);
+
+  ASSERT_EQ(0, UAVObjSetData(obj, v1));
+  UAVTalkStats stats = Receive(delta);
+
+  EXPECT_EQ(1U, stats.rxDeltaErrors);
+
+  uint8_t data[OBJ_SIZE];
+  ASSERT_EQ(0, UAVObjGetData(obj, data));
+  EXPECT_EQ(0, memcmp(data, v1, sizeof(data)));
+}
@@ -0,0 +1,160 @@
+/**
+ ******************************************************************************
+ * @file       unittest_mocks.c
+ * @author     dRonin, http://dronin.org Copyright (C) 2017
+ * @addtogroup UnitTests
+ * @{
+ * @addtogroup UnitTests
+ * @{
+ * @brief Host implementations of the PiOS services used by UAVTalk and the object manager
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "pios.h"
+#include "uavobjectsinit.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define UT_OBJ_ID4(i) UT_OBJ_ID(i), UT_OBJ_ID(i + 1), UT_OBJ_ID(i + 2), UT_OBJ_ID(i + 3)
+#define UT_OBJ_ID16(i) UT_OBJ_ID4(i), UT_OBJ_ID4(i + 4), UT_OBJ_ID4(i + 8), UT_OBJ_ID4(i + 12)
+
+const uint32_t uavo_sorted_ids[UAVOBJECTS_COUNT] = {
+	UT_OBJ_ID16(0),   UT_OBJ_ID16(16),  UT_OBJ_ID16(32),  UT_OBJ_ID16(48),
+	UT_OBJ_ID16(64),  UT_OBJ_ID16(80),  UT_OBJ_ID16(96),  UT_OBJ_ID16(112),
+	UT_OBJ_ID16(128), UT_OBJ_ID16(144),
+};
+
+uintptr_t pios_uavo_settings_fs_id;
+
+void * PIOS_malloc(size_t size)
+{
+	return malloc(size);
+}
+
+void * PIOS_malloc_no_dma(size_t size)
+{
+	return malloc(size);
+}
+
+void PIOS_free(void * buf)
+{
+	free(buf);
+}
+
+struct pios_recursive_mutex {
+	pthread_mutex_t mutex;
+};
+
+struct pios_recursive_mutex *PIOS_Recursive_Mutex_Create(void)
+{
+	struct pios_recursive_mutex *mtx = malloc(sizeof(*mtx));
+	pthread_mutexattr_t attr;
+
+	if (mtx == NULL)
+		return NULL;
+
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&mtx->mutex, &attr);
+	pthread_mutexattr_destroy(&attr);
+
+	return mtx;
+}
+
+bool PIOS_Recursive_Mutex_Lock(struct pios_recursive_mutex *mtx, uint32_t timeout_ms)
+{
+	return pthread_mutex_lock(&mtx->mutex) == 0;
+}
+
+bool PIOS_Recursive_Mutex_Unlock(struct pios_recursive_mutex *mtx)
+{
+	return pthread_mutex_unlock(&mtx->mutex) == 0;
+}
+
+/* Nothing here waits on a response, so a flag does */
+struct pios_semaphore {
+	bool given;
+};
+
+struct pios_semaphore *PIOS_Semaphore_Create(void)
+{
+	struct pios_semaphore *sema = malloc(sizeof(*sema));
+
+	if (sema != NULL)
+		sema->given = true;
+
+	return sema;
+}
+
+bool PIOS_Semaphore_Take(struct pios_semaphore *sema, uint32_t timeout_ms)
+{
+	bool given = sema->given;
+
+	sema->given = false;
+
+	return given;
+}
+
+bool PIOS_Semaphore_Give(struct pios_semaphore *sema)
+{
+	sema->given = true;
+
+	return true;
+}
+
+bool PIOS_Queue_Send(struct pios_queue *queuep, const void *itemp, uint32_t timeout_ms)
+{
+	return true;
+}
+
+uint32_t PIOS_Thread_Systime(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* No settings storage, everything comes up with defaults */
+int32_t PIOS_FLASHFS_ObjSave(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst_id, uint8_t * obj_data, uint16_t obj_size)
+{
+	return -1;
+}
+
+int32_t PIOS_FLASHFS_ObjLoad(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst_id, uint8_t * obj_data, uint16_t obj_size)
+{
+	return -1;
+}
+
+int32_t PIOS_FLASHFS_ObjDelete(uintptr_t fs_id, uint32_t obj_id, uint16_t obj_inst_id)
+{
+	return -1;
+}
+
+int32_t PIOS_FLASHFS_ObjSaveBatch(uintptr_t fs_id, uint16_t num_objs, pios_flashfs_next_obj next, void *ctx, struct pios_flashfs_batch_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+	return -1;
+}
+
+int32_t PIOS_FLASHFS_ObjLoadBatch(uintptr_t fs_id, pios_flashfs_next_obj next, pios_flashfs_obj_done done, void *ctx, struct pios_flashfs_batch_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+	return -1;
+}
@@ -31,15 +31,92 @@
 namespace core {
     qlonglong PureImageCache::ConnCounter=0;
 
-    PureImageCache::PureImageCache()
+    PureImageCache::PureImageCache() : generation(0)
     {
 
     }
 
+    PureImageCache::Connection::~Connection()
+    {
+        insertTile=QSqlQuery();
+        insertData=QSqlQuery();
+        selectTile=QSqlQuery();
+        existsTile=QSqlQuery();
+        db.close();
+        db=QSqlDatabase();
+        QSqlDatabase::removeDatabase(name);
+    }
+
+    /**
+     * Get this thread's connection to the cache database, opening it if
+     * needed. Must be called with lock held.
+     * @return The connection, or NULL if the database can't be opened
+     */
+    PureImageCache::Connection *PureImageCache::connection()
+    {
+        Connection *cn=connections.localData();
+        if(cn && cn->generation==generation)
+            return cn;
+        // Deletes the connection to the old cache, if any
+        connections.setLocalData(NULL);
+
+        Mcounter.lock();
+        qlonglong id=++ConnCounter;
+        Mcounter.unlock();
+
+        cn=new Connection;
+        cn->name=QString("PureImageCache%1").arg(id);
+        cn->generation=generation;
+        cn->db=QSqlDatabase::addDatabase("QSQLITE",cn->name);
+        cn->db.setDatabaseName(gtilecache+"Data.qmdb");
+        if(!cn->db.open())
+        {
+#ifdef DEBUG_PUREIMAGECACHE
+            qDebug()<<"connection: Unable to open database "<<cn->db.lastError().driverText();
+#endif //DEBUG_PUREIMAGECACHE
+            delete cn;
+            return NULL;
+        }
+
+        // With a write-ahead log readers don't block the writer, and a batch
+        // of tiles costs one sync rather than one per tile
+        QSqlQuery query(cn->db);
+        query.exec("PRAGMA journal_mode=WAL");
+        query.exec("PRAGMA synchronous=NORMAL");
+        // Older caches were created without an index, making every lookup a table scan
+        query.exec("CREATE INDEX IF NOT EXISTS IndexOfTiles ON Tiles (X, Y, Zoom, Type)");
+        query.finish();
+
+        cn->insertTile=QSqlQuery(cn->db);
+        cn->insertTile.prepare("INSERT INTO Tiles(X, Y, Zoom, Type,Date) VALUES(?, ?, ?, ?,?)");
+        cn->insertData=QSqlQuery(cn->db);
+        cn->insertData.prepare("INSERT INTO TilesData(id, Tile) VALUES(?, ?)");
+        cn->selectTile=QSqlQuery(cn->db);
+        cn->selectTile.prepare("SELECT Tile FROM TilesData WHERE id = (SELECT id FROM Tiles WHERE X=? AND Y=? AND Zoom=? AND Type=?)");
+        cn->existsTile=QSqlQuery(cn->db);
+        cn->existsTile.prepare("SELECT 1 FROM Tiles WHERE X=? AND Y=? AND Zoom=? AND Type=? LIMIT 1");
+
+        connections.setLocalData(cn);
+        return cn;
+    }
+
+    /**
+     * Close the calling thread's connection now rather than when the thread
+     * exits. Loader pool threads keep theirs across tiles, and QThreadStorage
+     * closes it when the pool retires the thread. Dedicated workers call this
+     * when they finish, and the map calls it from its own thread when it shuts
+     * down, as the main thread's data outlives the database driver.
+     */
+    void PureImageCache::CloseThreadConnection()
+    {
+        connections.setLocalData(NULL);
+    }
+
     void PureImageCache::setGtileCache(const QString &value)
     {
         lock.lockForWrite();
         gtilecache=value;
+        generation++;
         QDir d;
         if(!d.exists(gtilecache))
         {
@@ -171,91 +248,110 @@ namespace core {
         QSqlDatabase::removeDatabase(QLatin1String("CreateConn"));
         return true;
     }
+    bool PureImageCache::insertTile(Connection *cn, const QByteArray &tile, const MapType::Types &type, const Point &pos, const int &zoom, const QString &date)
+    {
+        cn->insertTile.addBindValue(pos.X());
+        cn->insertTile.addBindValue(pos.Y());
+        cn->insertTile.addBindValue(zoom);
+        cn->insertTile.addBindValue((int)type);
+        cn->insertTile.addBindValue(date);
+        if(!cn->insertTile.exec())
+        {
+#ifdef DEBUG_PUREIMAGECACHE
+            qDebug()<<"insertTile: "<<cn->insertTile.lastError().driverText();
+#endif //DEBUG_PUREIMAGECACHE
+            return false;
+        }
+
+        cn->insertData.addBindValue(cn->insertTile.lastInsertId());
+        cn->insertData.addBindValue(tile);
+        if(!cn->insertData.exec())
+        {
+#ifdef DEBUG_PUREIMAGECACHE
+            qDebug()<<"insertTile: "<<cn->insertData.lastError().driverText();
+#endif //DEBUG_PUREIMAGECACHE
+            return false;
+        }
+        return true;
+    }
     bool PureImageCache::PutImageToCache(const QByteArray &tile, const MapType::Types &type,const Point &pos,const int &zoom)
+    {
+        CacheItemQueue item(type,pos,tile,zoom);
+        return PutImagesToCache(QList<CacheItemQueue*>()<<&item);
+    }
+    /**
+     * Store several tiles in one transaction, which is much faster than a
+     * transaction per tile.
+     */
+    bool PureImageCache::PutImagesToCache(const QList<CacheItemQueue*> &tiles)
     {
         if(gtilecache.isEmpty()|gtilecache.isNull())
             return false;
         lock.lockForRead();
 #ifdef DEBUG_PUREIMAGECACHE
-        qDebug()<<"PutImageToCache Start:";//<<pos;
+        qDebug()<<"PutImagesToCache Start:"<<tiles.count();
 #endif //DEBUG_PUREIMAGECACHE
-        Mcounter.lock();
-        qlonglong id=++ConnCounter;
-        Mcounter.unlock();
+        Connection *cn=connection();
+        if(cn)
         {
-            QSqlDatabase cn;
-            cn = QSqlDatabase::addDatabase("QSQLITE",QString::number(id));
-            QString db=gtilecache+"Data.qmdb";
-            cn.setDatabaseName(db);
-            cn.setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-            if(cn.open())
+            QString date=QDateTime::currentDateTime().toString();
+            cn->db.transaction();
+            foreach(CacheItemQueue *item,tiles)
             {
-                {
-                    QSqlQuery query(cn);
-                    query.prepare("INSERT INTO Tiles(X, Y, Zoom, Type,Date) VALUES(?, ?, ?, ?,?)");
-                    query.addBindValue(pos.X());
-                    query.addBindValue(pos.Y());
-                    query.addBindValue(zoom);
-
-                    query.addBindValue((int)type);
-                    query.addBindValue(QDateTime::currentDateTime().toString());
-                    query.exec();
-                }
-                {
-                    QSqlQuery query(cn);
-                    query.prepare("INSERT INTO TilesData(id, Tile) VALUES((SELECT last_insert_rowid()), ?)");
-                    query.addBindValue(tile);
-                    query.exec();
-                }
-                cn.close();
+                if(!insertTile(cn,item->GetImg(),item->GetMapType(),item->GetPosition(),item->GetZoom(),date))
+                    break;
             }
+            cn->db.commit();
         }
-        QSqlDatabase::removeDatabase(QString::number(id));
         lock.unlock();
         return true;
     }
     QByteArray PureImageCache::GetImageFromCache(MapType::Types type, Point pos, int zoom)
     {
-        lock.lockForRead();
         QByteArray ar;
         if(gtilecache.isEmpty()|gtilecache.isNull())
             return ar;
-        QString dir=gtilecache;
-        Mcounter.lock();
-        qlonglong id=++ConnCounter;
-        Mcounter.unlock();
+        lock.lockForRead();
 #ifdef DEBUG_PUREIMAGECACHE
-        qDebug()<<"Cache dir="<<dir<<" Try to GET:"<<pos.X()+","+pos.Y();
+        qDebug()<<"Cache dir="<<gtilecache<<" Try to GET:"<<pos.X()+","+pos.Y();
 #endif //DEBUG_PUREIMAGECACHE
-
+        Connection *cn=connection();
+        if(cn)
         {
-            QString db=dir+"Data.qmdb";
-            {
-                QSqlDatabase cn;
-
-                cn = QSqlDatabase::addDatabase("QSQLITE",QString::number(id));
-
-                cn.setDatabaseName(db);
-                cn.setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-                if(cn.open())
-                {
-                    {
-                        QSqlQuery query(cn);
-                        query.exec(QString("SELECT Tile FROM TilesData WHERE id = (SELECT id FROM Tiles WHERE X=%1 AND Y=%2 AND Zoom=%3 AND Type=%4)").arg(pos.X()).arg(pos.Y()).arg(zoom).arg((int) type));
-                        query.next();
-                        if(query.isValid())
-                        {
-                            ar=query.value(0).toByteArray();
-                        }
-                    }
-                    cn.close();
-                }
-            }
+            cn->selectTile.addBindValue(pos.X());
+            cn->selectTile.addBindValue(pos.Y());
+            cn->selectTile.addBindValue(zoom);
+            cn->selectTile.addBindValue((int)type);
+            if(cn->selectTile.exec() && cn->selectTile.next())
+                ar=cn->selectTile.value(0).toByteArray();
+            cn->selectTile.finish();
         }
-        QSqlDatabase::removeDatabase(QString::number(id));
         lock.unlock();
         return ar;
     }
+    /**
+     * Check whether a tile is cached without reading it, answered from the
+     * Tiles index alone.
+     */
+    bool PureImageCache::IsImageInCache(MapType::Types type, Point pos, int zoom)
+    {
+        bool found=false;
+        if(gtilecache.isEmpty()|gtilecache.isNull())
+            return found;
+        lock.lockForRead();
+        Connection *cn=connection();
+        if(cn)
+        {
+            cn->existsTile.addBindValue(pos.X());
+            cn->existsTile.addBindValue(pos.Y());
+            cn->existsTile.addBindValue(zoom);
+            cn->existsTile.addBindValue((int)type);
+            found=cn->existsTile.exec() && cn->existsTile.next();
+            cn->existsTile.finish();
+        }
+        lock.unlock();
+        return found;
+    }
     void PureImageCache::deleteOlderTiles(int const& days)
     {
         if(gtilecache.isEmpty()|gtilecache.isNull())
@@ -42,6 +42,8 @@
 #include <QList>
 #include <QMutex>
 #include <QReadWriteLock>
+#include <QThreadStorage>
+#include "cacheitemqueue.h"
 namespace core {
     class PureImageCache
     {
@@ -50,16 +52,41 @@ namespace core {
         PureImageCache();
         static bool CreateEmptyDB(const QString &file);
         bool PutImageToCache(const QByteArray &tile,const MapType::Types &type,const core::Point &pos, const int &zoom);
+        bool PutImagesToCache(const QList<CacheItemQueue*> &tiles);
         QByteArray GetImageFromCache(MapType::Types type, core::Point pos, int zoom);
+        bool IsImageInCache(MapType::Types type, core::Point pos, int zoom);
         QString GtileCache();
         void setGtileCache(const QString &value);
         static bool ExportMapDataToDB(QString sourceFile, QString destFile);
         void deleteOlderTiles(int const& days);
+        void CloseThreadConnection();
     private:
+        /**
+         * A database connection can only be used by the thread that opened
+         * it, so each thread keeps its own, with its statements prepared,
+         * until it exits or the cache directory changes.
+         */
+        struct Connection
+        {
+            ~Connection();
+            QString name;
+            int generation;
+            QSqlDatabase db;
+            QSqlQuery insertTile;
+            QSqlQuery insertData;
+            QSqlQuery selectTile;
+            QSqlQuery existsTile;
+        };
+        Connection *connection();
+        bool insertTile(Connection *cn, const QByteArray &tile, const MapType::Types &type, const core::Point &pos, const int &zoom, const QString &date);
+
         QString gtilecache;
         QMutex Mcounter;
         QReadWriteLock lock;
         static qlonglong ConnCounter;
+        //! Bumped when gtilecache changes, so threads reopen their connection
+        int generation;
+        QThreadStorage<Connection *> connections;
 
     };
 
@@ -79,21 +79,23 @@ void TileCacheQueue::run()
 #endif //DEBUG_TILECACHEQUEUE
     while(true)
     {
-        CacheItemQueue *task;
+        QList<CacheItemQueue*> tasks;
 #ifdef DEBUG_TILECACHEQUEUE
         qDebug()<<"Cache";
 #endif //DEBUG_TILECACHEQUEUE
-        if(tileCacheQueue.count()>0)
+        // Take everything queued, up to a batch, and store it in one transaction
+        mutex.lock();
+        while(tileCacheQueue.count()>0 && tasks.count()<MAX_BATCH)
+            tasks.append(tileCacheQueue.dequeue());
+        mutex.unlock();
+        if(tasks.count()>0)
         {
-            mutex.lock();
-            task=tileCacheQueue.dequeue();
-            mutex.unlock();
 #ifdef DEBUG_TILECACHEQUEUE
-            qDebug()<<"Cache engine Put:"<<task->GetPosition().X()<<","<<task->GetPosition().Y();
+            qDebug()<<"Cache engine Put:"<<tasks.count()<<"tiles";
 #endif //DEBUG_TILECACHEQUEUE
-            Cache::Instance()->ImageCache.PutImageToCache(task->GetImg(),task->GetMapType(),task->GetPosition(),task->GetZoom());
+            Cache::Instance()->ImageCache.PutImagesToCache(tasks);
             usleep(44);
-            delete task;
+            qDeleteAll(tasks);
         }
 
         else
@@ -123,6 +125,8 @@ void TileCacheQueue::run()
             waitmutex.unlock();
         }
     }
+    // Started again the next time a tile is queued
+    Cache::Instance()->ImageCache.CloseThreadConnection();
 #ifdef DEBUG_TILECACHEQUEUE
     qDebug()<<"Cache Engine Stopped";
 #endif //DEBUG_TILECACHEQUEUE
@@ -50,6 +50,8 @@ namespace core {
     protected:
         QQueue<CacheItemQueue*> tileCacheQueue;
     private:
+        //! Most tiles written to the cache in one transaction
+        static const int MAX_BATCH = 64;
         void run();
         QMutex mutex;
         QMutex waitmutex;
@@ -0,0 +1,189 @@
+/**
+******************************************************************************
+*
+* @file       tileseeder.cpp
+* @author     dRonin, http://dronin.org Copyright (C) 2017
+* @brief      Fetches a list of tiles into the cache from a pool of threads
+* @see        The GNU Public License (GPL) Version 3
+* @defgroup   TLMapWidget
+* @{
+*
+*****************************************************************************/
+/*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, see <http://www.gnu.org/licenses/>
+*/
+#include "tileseeder.h"
+#include "tlmaps.h"
+#include "cache.h"
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+
+//#define DEBUG_TILESEEDER
+namespace core {
+    class TileSeederWorker:public QRunnable
+    {
+    public:
+        TileSeederWorker(TileSeeder *seeder):seeder(seeder){}
+        void run()
+        {
+            seeder->FetchLoop();
+            Cache::Instance()->ImageCache.CloseThreadConnection();
+        }
+    private:
+        TileSeeder *seeder;
+    };
+
+    TileSeeder::TileSeeder(QObject *parent):QObject(parent),type(MapType::GoogleMap),threads(4),maxRate(0),retries(3),next(0),done(0),cancel(false),nextSlotMs(0)
+    {
+        stats.total=stats.fetched=stats.cached=stats.failed=0;
+        stats.elapsedMs=0;
+    }
+
+    /**
+     * Fetch all the tiles, blocking until they are done or Cancel() is
+     * called. The signals are emitted from the worker threads.
+     */
+    void TileSeeder::Run()
+    {
+        mutex.lock();
+        next=0;
+        done=0;
+        cancel=false;
+        nextSlotMs=0;
+        stats.total=tiles.count();
+        stats.fetched=stats.cached=stats.failed=0;
+        clock.start();
+        mutex.unlock();
+
+        emit numberOfTilesChanged(tiles.count(),0);
+
+        QThreadPool pool;
+        pool.setMaxThreadCount(threads);
+        for(int i=0;i<threads;i++)
+            pool.start(new TileSeederWorker(this));
+        pool.waitForDone();
+
+        mutex.lock();
+        stats.elapsedMs=clock.elapsed();
+        mutex.unlock();
+    }
+
+    TileSeeder::Stats TileSeeder::GetStats()
+    {
+        QMutexLocker locker(&mutex);
+        return stats;
+    }
+
+    void TileSeeder::Cancel()
+    {
+        QMutexLocker locker(&mutex);
+        cancel=true;
+    }
+
+    bool TileSeeder::Cancelled()
+    {
+        QMutexLocker locker(&mutex);
+        return cancel;
+    }
+
+    bool TileSeeder::TakeTile(Tile *tile)
+    {
+        QMutexLocker locker(&mutex);
+        if(cancel || next>=tiles.count())
+            return false;
+        *tile=tiles.at(next++);
+        return true;
+    }
+
+    void TileSeeder::FetchLoop()
+    {
+        QVector<MapType::Types> types=TLMaps::Instance()->GetAllLayersOfType(type);
+        Tile tile;
+        while(TakeTile(&tile))
+        {
+            Fetch(tile,types);
+
+            mutex.lock();
+            int total=tiles.count();
+            int actual=++done;
+            mutex.unlock();
+            emit numberOfTilesChanged(total,actual);
+            emit percentageChanged(actual*100/total);
+        }
+    }
+
+    /**
+     * Wait for this thread's turn under the rate limit.
+     * @return false if cancelled while waiting
+     */
+    bool TileSeeder::WaitForSlot()
+    {
+        if(maxRate<=0)
+            return !Cancelled();
+
+        mutex.lock();
+        qint64 now=clock.elapsed();
+        qint64 slot=qMax(now,nextSlotMs);
+        nextSlotMs=slot+(qint64)(1000/maxRate);
+        mutex.unlock();
+
+        if(slot>now)
+            QThread::msleep(slot-now);
+        return !Cancelled();
+    }
+
+    bool TileSeeder::Fetch(const Tile &tile,const QVector<MapType::Types> &types)
+    {
+        bool fetched=false;
+        foreach(MapType::Types layer,types)
+        {
+            if(Cache::Instance()->ImageCache.IsImageInCache(layer,tile.pos,tile.zoom))
+                continue;
+
+            emit providerChanged(MapType::StrByType(layer),tile.zoom);
+            bool good=false;
+            for(int attempt=0;attempt<=retries && !good;attempt++)
+            {
+                if(attempt>0)
+                {
+#ifdef DEBUG_TILESEEDER
+                    qDebug()<<"TileSeeder retry"<<attempt<<tile.pos.ToString()<<tile.zoom;
+#endif //DEBUG_TILESEEDER
+                    // Back off, in small steps so cancelling stays responsive
+                    for(int i=0;i<attempt*10 && !Cancelled();i++)
+                        QThread::msleep(100);
+                }
+                if(!WaitForSlot())
+                    return false;
+                good=!TLMaps::Instance()->GetImageFromServer(layer,tile.pos,tile.zoom).isEmpty();
+            }
+
+            if(!good)
+            {
+                QMutexLocker locker(&mutex);
+                stats.failed++;
+                return false;
+            }
+            fetched=true;
+        }
+
+        QMutexLocker locker(&mutex);
+        if(fetched)
+            stats.fetched++;
+        else
+            stats.cached++;
+        return true;
+    }
+}
@@ -0,0 +1,106 @@
+/**
+******************************************************************************
+*
+* @file       tileseeder.h
+* @author     dRonin, http://dronin.org Copyright (C) 2017
+* @brief      Fetches a list of tiles into the cache from a pool of threads
+* @see        The GNU Public License (GPL) Version 3
+* @defgroup   TLMapWidget
+* @{
+*
+*****************************************************************************/
+/*
+* This program is free software; you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation; either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+* or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+* for more details.
+*
+* You should have received a copy of the GNU General Public License along
+* with this program; if not, see <http://www.gnu.org/licenses/>
+*/
+#ifndef TILESEEDER_H
+#define TILESEEDER_H
+
+#include <QObject>
+#include <QList>
+#include <QMutex>
+#include <QElapsedTimer>
+#include "maptype.h"
+#include "point.h"
+#include "corecommon.h"
+
+namespace core {
+    /**
+     * Fetches tiles of every layer of a map type into the cache, from a
+     * bounded pool of threads sharing one request rate limit. Tiles already
+     * in the cache are skipped, so running the same list again resumes an
+     * interrupted seed. A tile that can't be fetched is retried a few times
+     * with an increasing delay, then counted as failed.
+     */
+    class TLMAPWIDGET_EXPORT TileSeeder:public QObject
+    {
+        Q_OBJECT
+    public:
+        struct Tile
+        {
+            core::Point pos;
+            int zoom;
+        };
+        struct Stats
+        {
+            int total;
+            int fetched;  //!< Fetched from the server
+            int cached;   //!< Skipped as they were already cached
+            int failed;
+            qint64 elapsedMs;
+        };
+
+        TileSeeder(QObject *parent=0);
+        void SetMapType(const MapType::Types &value){type=value;}
+        void SetTiles(const QList<Tile> &value){tiles=value;}
+        void SetThreads(int value){threads=value;}
+        //! Most requests started per second across all threads, 0 for no limit
+        void SetMaxRate(double value){maxRate=value;}
+        void SetRetries(int value){retries=value;}
+        int Count()const{return tiles.count();}
+
+        void Run();
+        Stats GetStats();
+
+    public slots:
+        void Cancel();
+
+    signals:
+        void percentageChanged(int const& perc);
+        void numberOfTilesChanged(int const& total,int const& actual);
+        void providerChanged(QString const& prov,int const& zoom);
+
+    private:
+        friend class TileSeederWorker;
+        void FetchLoop();
+        bool TakeTile(Tile *tile);
+        bool Fetch(const Tile &tile,const QVector<MapType::Types> &types);
+        bool WaitForSlot();
+        bool Cancelled();
+
+        MapType::Types type;
+        QList<Tile> tiles;
+        int threads;
+        double maxRate;
+        int retries;
+
+        QMutex mutex;
+        int next;
+        int done;
+        bool cancel;
+        qint64 nextSlotMs;
+        QElapsedTimer clock;
+        Stats stats;
+    };
+}
+#endif // TILESEEDER_H
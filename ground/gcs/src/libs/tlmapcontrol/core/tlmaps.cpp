@@ -294,6 +294,18 @@ namespace core {
         LanguageStr=LanguageType().toShortString(Language);
     }
 
+    void TLMaps::setUseMemoryCache(const bool &value)
+    {
+        QMutexLocker locker(&settingsProtect);
+        useMemoryCache=value;
+    }
+
+    void TLMaps::setAccessMode(const AccessMode::Types &mode)
+    {
+        QMutexLocker locker(&settingsProtect);
+        accessmode=mode;
+    }
+
 
     /**
      * @brief OPMaps::GetImageFromServer
@@ -304,7 +316,6 @@ namespace core {
      */
     QByteArray TLMaps::GetImageFromServer(const MapType::Types &type,const Point &pos,const int &zoom)
     {
-        QMutexLocker locker(&settingsProtect);
 #ifdef DEBUG_TIMINGS
         QTime time;
         time.restart();
@@ -314,7 +325,25 @@ namespace core {
 #endif //DEBUG_GMAPS
         QByteArray ret;
 
-        if(useMemoryCache)
+        // Take all the settings at once, so that a tile is fetched with one
+        // consistent set even if they change while we wait on the network
+        bool memoryCache;
+        AccessMode::Types mode;
+        QNetworkProxy proxy;
+        QString language;
+        QByteArray userAgent;
+        int timeout;
+        {
+            QMutexLocker locker(&settingsProtect);
+            memoryCache=useMemoryCache;
+            mode=accessmode;
+            proxy=Proxy;
+            language=LanguageStr;
+            userAgent=UserAgent;
+            timeout=Timeout;
+        }
+
+        if(memoryCache)
         {
 #ifdef DEBUG_GMAPS
             qDebug()<<"Try Tile from memory:Size="<<TilesInMemory.MemoryCacheSize();
@@ -335,7 +364,7 @@ namespace core {
 #endif //DEBUG_GMAPS
 
             //Attempt to read tile from cache
-            if(accessmode != (AccessMode::ServerOnly) && type != MapType::UserImage) //Don't use cache if the user supplies a file. This is because
+            if(mode != (AccessMode::ServerOnly) && type != MapType::UserImage) //Don't use cache if the user supplies a file. This is because
             {
 #ifdef DEBUG_GMAPS
                 qDebug()<<"Try tile from DataBase";
@@ -349,7 +378,7 @@ namespace core {
 #ifdef DEBUG_GMAPS
                     qDebug()<<"Tile found in Database";
 #endif //DEBUG_GMAPS
-                    if(useMemoryCache)
+                    if(memoryCache)
                     {
 #ifdef DEBUG_GMAPS
                         qDebug()<<"Add Tile to memory";
@@ -361,7 +390,7 @@ namespace core {
             }
 
             //Attempt to read file from original source
-            if(accessmode!=AccessMode::CacheOnly)
+            if(mode!=AccessMode::CacheOnly)
             {
                 { //Otherwise, we're getting the tiles from the internet
                     QEventLoop q;
@@ -373,20 +402,26 @@ namespace core {
                     connect(&network, SIGNAL(finished(QNetworkReply*)),
                             &q, SLOT(quit()));
                     connect(&tT, SIGNAL(timeout()), &q, SLOT(quit()));
-                    network.setProxy(Proxy);
     #ifdef DEBUG_GMAPS
                     qDebug()<<"Try Tile from the Internet";
     #endif //DEBUG_GMAPS
     #ifdef DEBUG_TIMINGS
                     qDebug()<<"opmaps before make image url"<<time.elapsed();
     #endif
-                    QString url=MakeImageUrl(type,pos,zoom,LanguageStr);
+                    // Only hold the settings while reading them, so that
+                    // several threads can wait on the network at once
+                    QString url;
+                    {
+                        QMutexLocker locker(&settingsProtect);
+                        url=MakeImageUrl(type,pos,zoom,language);
+                    }
+                    network.setProxy(proxy);
     #ifdef DEBUG_TIMINGS
                     qDebug()<<"opmaps after make image url"<<time.elapsed();
     #endif		//url	"http://vec02.maps.yandex.ru/tiles?l=map&v=2.10.2&x=7&y=5&z=3"	string
                     //"http://map3.pergo.com.tr/tile/02/000/000/007/000/000/002.png"
                     qheader.setUrl(QUrl(url));
-                    qheader.setRawHeader("User-Agent",UserAgent);
+                    qheader.setRawHeader("User-Agent",userAgent);
                     qheader.setRawHeader("Accept","*/*");
                     switch(type)
                     {
@@ -462,7 +497,7 @@ namespace core {
                     qDebug() << "qheader: " << qheader.url();
 #endif //DEBUG_GMAPS
                     reply=network.get(qheader);
-                    tT.start(Timeout);
+                    tT.start(timeout);
                     q.exec();
 
                     if(!tT.isActive()){
@@ -502,7 +537,7 @@ namespace core {
                 errorvars.unlock();
 
                 //Save tile to cache
-                if (useMemoryCache)
+                if (memoryCache)
                 {
 #ifdef DEBUG_GMAPS
                     qDebug()<<"Add Tile to memory cache";
@@ -511,7 +546,7 @@ namespace core {
                 }
 
                 //Save tile to database
-                if(accessmode!=AccessMode::ServerOnly)
+                if(mode!=AccessMode::ServerOnly)
                 {
 #ifdef DEBUG_GMAPS
                     qDebug()<<"Add tile to DataBase";
@@ -68,11 +68,11 @@ namespace core {
         QByteArray GetImageFromServer(const MapType::Types &type,const core::Point &pos,const int &zoom);
         QByteArray GetImageFromFile(const MapType::Types &type,const core::Point &pos,const int &zoom, double hScale, double vScale, QString userImageFileName, internals::PureProjection *projection);
         bool UseMemoryCache(){return useMemoryCache;}//TODO
-        void setUseMemoryCache(const bool& value){useMemoryCache=value;}
+        void setUseMemoryCache(const bool& value);
         void setLanguage(const LanguageType::Types& language);
         LanguageType::Types GetLanguage(){return Language;}//TODO
         AccessMode::Types GetAccessMode()const{return accessmode;}
-        void setAccessMode(const AccessMode::Types& mode){accessmode=mode;}
+        void setAccessMode(const AccessMode::Types& mode);
         int RetryLoadTile;
         diagnostics GetDiagnostics();
         bool useMemoryCache;
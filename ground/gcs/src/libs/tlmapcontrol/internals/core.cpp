@@ -50,6 +50,8 @@ namespace internals {
     Core::~Core()
     {
         ProcessLoadTaskCallback.waitForDone();
+        // The map is shutting down, so is this thread's use of the cache
+        Cache::Instance()->ImageCache.CloseThreadConnection();
     }
 
     void Core::run()
@@ -28,25 +28,53 @@
 namespace mapcontrol
 {
 
-MapRipper::MapRipper(internals::Core * core, const internals::RectLatLng & rect):sleep(100),cancel(false),progressForm(0),core(core),yesToAll(false)
+MapRipper::MapRipper(internals::Core * core, const internals::RectLatLng & rect):progressForm(0)
     {
         if(!rect.IsEmpty())
         {
-            type=core->GetMapType();
+            // Queue every zoom level from the current one down at once
+            int zoom=core->Zoom();
+            int maxzoom=core->MaxZoom();
+            QList<core::TileSeeder::Tile> current;
+            QList<core::TileSeeder::Tile> tiles;
+            for(int z=zoom;z<=maxzoom;z++)
+            {
+                foreach(core::Point p,core->Projection()->GetAreaTileList(rect,z,0))
+                {
+                    core::TileSeeder::Tile tile={p,z};
+                    tiles.append(tile);
+                    if(z==zoom)
+                        current.append(tile);
+                }
+            }
+
+            QMessageBox msgBox;
+            msgBox.setText(QString("Pre-cache %1 tiles at zoom levels %2 to %3?").arg(tiles.count()).arg(zoom).arg(maxzoom));
+            msgBox.setInformativeText(QString("Choose No to only cache the %1 tiles of zoom level %2. "
+                                              "Tiles already cached are skipped, so ripping the same area again resumes an interrupted rip.")
+                                      .arg(current.count()).arg(zoom));
+            msgBox.setStandardButtons(QMessageBox::Yes | QMessageBox::No | QMessageBox::Cancel);
+            msgBox.setDefaultButton(QMessageBox::Yes);
+            int ret=msgBox.exec();
+            if(ret==QMessageBox::Cancel)
+            {
+                this->deleteLater();
+                return;
+            }
+
+            seeder.SetMapType(core->GetMapType());
+            seeder.SetTiles(ret==QMessageBox::Yes?tiles:current);
+            seeder.SetThreads(FETCH_THREADS);
+            seeder.SetMaxRate(MAX_RATE);
+
             progressForm=new MapRipForm;
             connect(progressForm,SIGNAL(cancelRequest()),this,SLOT(stopFetching()));
-            area=rect;
-            zoom=core->Zoom();
-            maxzoom=core->MaxZoom();
-            points=core->Projection()->GetAreaTileList(area,zoom,0);
-            this->start();
-            cancel=false;
-            progressForm->show();
-            connect(this,SIGNAL(percentageChanged(int)),progressForm,SLOT(SetPercentage(int)));
-            connect(this,SIGNAL(numberOfTilesChanged(int,int)),progressForm,SLOT(SetNumberOfTiles(int,int)));
-            connect(this,SIGNAL(providerChanged(QString,int)),progressForm,SLOT(SetProvider(QString,int)));
+            connect(&seeder,SIGNAL(percentageChanged(int)),progressForm,SLOT(SetPercentage(int)));
+            connect(&seeder,SIGNAL(numberOfTilesChanged(int,int)),progressForm,SLOT(SetNumberOfTiles(int,int)));
+            connect(&seeder,SIGNAL(providerChanged(QString,int)),progressForm,SLOT(SetProvider(QString,int)));
             connect(this,SIGNAL(finished()),this,SLOT(finish()));
-            emit numberOfTilesChanged(0,0);
+            progressForm->show();
+            this->start();
         }
         else
 #ifdef Q_OS_DARWIN
@@ -57,100 +85,23 @@ MapRipper::MapRipper(internals::Core * core, const internals::RectLatLng & rect)
     }
 void MapRipper::finish()
 {
-    if(zoom<maxzoom && !cancel)
-    {
-        ++zoom;
-        int ret;
-        if(!yesToAll)
-        {
-            QMessageBox msgBox;
-            msgBox.setText(QString("Continue Ripping at zoom level %1?").arg(zoom));
-            // msgBox.setInformativeText("Do you want to save your changes?");
-            msgBox.setStandardButtons(QMessageBox::Yes | QMessageBox::No | QMessageBox::YesAll);
-            msgBox.setDefaultButton(QMessageBox::Yes);
-            ret = msgBox.exec();
-        }
-        else
-            ret=QMessageBox::Yes;
-        if(ret==QMessageBox::Yes)
-        {
-            points.clear();
-            points=core->Projection()->GetAreaTileList(area,zoom,0);
-            this->start();
-        }
-        else if(ret==QMessageBox::YesAll)
-        {
-            yesToAll=true;
-            points.clear();
-            points=core->Projection()->GetAreaTileList(area,zoom,0);
-            this->start();
-        }
-        else
-        {
-            progressForm->close();
-            delete progressForm;
-            this->deleteLater();
-        }
-    }
-    else
-    {
-        yesToAll=false;
-        progressForm->close();
-        delete progressForm;
-        this->deleteLater();
-    }
+    core::TileSeeder::Stats stats=seeder.GetStats();
+    if(stats.failed>0)
+        QMessageBox::warning(progressForm,"Map ripping",QString("%1 of %2 tiles could not be fetched. "
+                                                                 "Rip the same area again to retry them.").arg(stats.failed).arg(stats.total));
+    progressForm->close();
+    delete progressForm;
+    this->deleteLater();
 }
 
 
     void MapRipper::run()
     {
-        int countOk = 0;
-        bool goodtile=false;
-        //  Stuff.Shuffle<Point>(ref list);
-        QVector<core::MapType::Types> types = TLMaps::Instance()->GetAllLayersOfType(type);
-        int all=points.count();
-        for(int i = 0; i < all; i++)
-        {
-            emit numberOfTilesChanged(all,i+1);
-            if(cancel)
-                break;
-
-            core::Point p = points[i];
-            {
-                //qDebug()<<"offline fetching:"<<p.ToString();
-                foreach(core::MapType::Types type,types)
-                {
-                    emit providerChanged(core::MapType::StrByType(type),zoom);
-                    QByteArray img = TLMaps::Instance()->GetImageFromServer(type, p, zoom);
-                    if(img.length()!=0)
-                    {
-                        goodtile=true;
-                        img=NULL;
-                    }
-                    else
-                        goodtile=false;
-                }
-                if(goodtile)
-                {
-                    countOk++;
-                }
-                else
-                {
-                    i--;
-                    QThread::msleep(1000);
-                    continue;
-                }
-            }
-            emit percentageChanged((int) ((i+1)*100/all));//, i+1);
-            // worker.ReportProgress((int) ((i+1)*100/all), i+1);
-
-            QThread::msleep(sleep);
-        }
+        seeder.Run();
     }
 
     void MapRipper::stopFetching()
     {
-        QMutexLocker locker(&mutex);
-        cancel=true;
+        seeder.Cancel();
     }
 }
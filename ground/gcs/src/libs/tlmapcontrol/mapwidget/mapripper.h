@@ -33,6 +33,7 @@
 #include <QObject>
 #include <QMessageBox>
 #include "../core/corecommon.h"
+#include "../core/tileseeder.h"
 
 namespace mapcontrol
 {
@@ -43,23 +44,12 @@ namespace mapcontrol
         MapRipper(internals::Core *,internals::RectLatLng const&);
         void run();
     private:
-        QList<core::Point> points;
-        int zoom;
-        core::MapType::Types type;
-        int sleep;
-        internals::RectLatLng area;
-        bool cancel;
-        MapRipForm * progressForm;
-        int maxzoom;
-        internals::Core * core;
-        bool yesToAll;
-        QMutex mutex;
-
-    signals:
-        void percentageChanged(int const& perc);
-        void numberOfTilesChanged(int const& total,int const& actual);
-        void providerChanged(QString const& prov,int const& zoom);
+        //! Tiles fetched in parallel, and most requests started per second
+        static const int FETCH_THREADS = 4;
+        static const int MAX_RATE = 20;
 
+        core::TileSeeder seeder;
+        MapRipForm * progressForm;
 
     public slots:
         void stopFetching();
@@ -0,0 +1,99 @@
+/**
+ ******************************************************************************
+ * @file       main.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2017
+ * @brief      Throughput benchmark of the map tile cache
+ * @see        The GNU Public License (GPL) Version 3
+ * @defgroup   TLMapWidget
+ * @{
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "pureimagecache.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+using namespace core;
+
+static QTextStream out(stdout);
+
+static void report(const QString &name, int tiles, qint64 elapsedMs)
+{
+    double seconds = qMax<qint64>(elapsedMs, 1) / 1000.0;
+
+    out << QString("%0: %1 tiles in %2 s, %3 tiles/s")
+           .arg(name, -26)
+           .arg(tiles)
+           .arg(seconds, 0, 'f', 2)
+           .arg(tiles / seconds, 0, 'f', 0) << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    int tiles = argc > 1 ? QString(argv[1]).toInt() : 2000;
+    const int batch = 64;
+
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        out << "Can't create a temporary directory" << endl;
+        return 1;
+    }
+
+    PureImageCache cache;
+    cache.setGtileCache(dir.path() + "/");
+
+    // A typical 256x256 satellite tile is around 20 kB
+    QByteArray tile(20 * 1024, 'x');
+    QElapsedTimer timer;
+
+    timer.start();
+    for (int i = 0; i < tiles; i++)
+        cache.PutImageToCache(tile, MapType::GoogleSatellite, Point(i, 0), 17);
+    report("Put, one per transaction", tiles, timer.elapsed());
+
+    QList<CacheItemQueue *> items;
+    for (int i = 0; i < tiles; i++)
+        items.append(new CacheItemQueue(MapType::GoogleSatellite, Point(i, 1), tile, 17));
+    timer.start();
+    for (int i = 0; i < tiles; i += batch)
+        cache.PutImagesToCache(items.mid(i, batch));
+    report(QString("Put, %0 per transaction").arg(batch), tiles, timer.elapsed());
+    qDeleteAll(items);
+
+    int found = 0;
+    timer.start();
+    for (int i = 0; i < tiles; i++)
+        found += !cache.GetImageFromCache(MapType::GoogleSatellite, Point(i, 1), 17).isEmpty();
+    report("Get", tiles, timer.elapsed());
+
+    cache.CloseThreadConnection();
+
+    if (found != tiles) {
+        out << "Only " << found << " of " << tiles << " tiles read back" << endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @}
+ */
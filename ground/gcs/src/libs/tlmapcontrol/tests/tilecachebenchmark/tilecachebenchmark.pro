@@ -0,0 +1,25 @@
+# Throughput benchmark of the map tile cache against a local SQLite file:
+#   qmake tilecachebenchmark.pro && make && ./tilecachebenchmark [tiles]
+include(../../../../../gcs.pri)
+
+QT += sql
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+TARGET = tilecachebenchmark
+TEMPLATE = app
+
+# Built from the cache sources rather than linked, the library doesn't
+# export PureImageCache
+DEFINES += TLMAPWIDGET_LIBRARY
+INCLUDEPATH += ../../core
+
+SOURCES += main.cpp \
+    ../../core/pureimagecache.cpp \
+    ../../core/cacheitemqueue.cpp \
+    ../../core/point.cpp \
+    ../../core/size.cpp
+
+HEADERS += ../../core/maptype.h \
+    ../../core/pureimagecache.h
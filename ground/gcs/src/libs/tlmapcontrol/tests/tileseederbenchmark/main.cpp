@@ -0,0 +1,156 @@
+/**
+ ******************************************************************************
+ * @file       main.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2017
+ * @brief      Tiles/s benchmark of TileSeeder against a local tile server
+ * @see        The GNU Public License (GPL) Version 3
+ * @defgroup   TLMapWidget
+ * @{
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "tileseeder.h"
+#include "cache.h"
+
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QNetworkProxy>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+#include <QTimer>
+
+using namespace core;
+
+static QTextStream out(stdout);
+
+/**
+ * Stands in for every tile server: the tile URLs still name the real
+ * providers, but all requests go through this as the HTTP proxy and get
+ * the same tile back after a fixed latency.
+ */
+static void startTileServer(QTcpServer *server, int latencyMs)
+{
+    static const QByteArray tile(20 * 1024, 'x');
+
+    QObject::connect(server, &QTcpServer::newConnection, [server, latencyMs]() {
+        while (QTcpSocket *socket = server->nextPendingConnection()) {
+            QObject::connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+            QObject::connect(socket, &QTcpSocket::readyRead, [socket, latencyMs]() {
+                QByteArray request = socket->property("request").toByteArray() + socket->readAll();
+                socket->setProperty("request", request);
+                if (!request.contains("\r\n\r\n"))
+                    return;
+                socket->setProperty("request", QByteArray());
+
+                QTimer::singleShot(latencyMs, socket, [socket]() {
+                    socket->write("HTTP/1.1 200 OK\r\n"
+                                  "Content-Type: image/png\r\n"
+                                  "Content-Length: " + QByteArray::number(tile.size()) + "\r\n"
+                                  "Connection: close\r\n\r\n");
+                    socket->write(tile);
+                    socket->disconnectFromHost();
+                });
+            });
+        }
+    });
+}
+
+class SeedThread : public QThread
+{
+public:
+    SeedThread(TileSeeder *seeder) : seeder(seeder) {}
+    void run() { seeder->Run(); }
+private:
+    TileSeeder *seeder;
+};
+
+static void seed(TileSeeder *seeder, const QString &name)
+{
+    SeedThread thread(seeder);
+    QEventLoop loop;
+    QObject::connect(&thread, &QThread::finished, &loop, &QEventLoop::quit);
+    thread.start();
+    loop.exec();
+
+    TileSeeder::Stats stats = seeder->GetStats();
+    double seconds = qMax<qint64>(stats.elapsedMs, 1) / 1000.0;
+    out << QString("%0: %1 tiles in %2 s, %3 tiles/s (%4 fetched, %5 cached, %6 failed)")
+           .arg(name, -20)
+           .arg(stats.total)
+           .arg(seconds, 0, 'f', 2)
+           .arg(stats.total / seconds, 0, 'f', 1)
+           .arg(stats.fetched)
+           .arg(stats.cached)
+           .arg(stats.failed) << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    int count = argc > 1 ? QString(argv[1]).toInt() : 200;
+    int latencyMs = argc > 2 ? QString(argv[2]).toInt() : 50;
+
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        out << "Can't create a temporary directory" << endl;
+        return 1;
+    }
+    Cache::Instance()->setCacheLocation(dir.path() + "/");
+
+    QTcpServer server;
+    startTileServer(&server, latencyMs);
+    if (!server.listen(QHostAddress::LocalHost)) {
+        out << "Can't start the tile server" << endl;
+        return 1;
+    }
+    QNetworkProxy::setApplicationProxy(QNetworkProxy(QNetworkProxy::HttpProxy, "127.0.0.1", server.serverPort()));
+
+    out << count << " tiles per run, " << latencyMs << " ms server latency" << endl;
+
+    TileSeeder seeder;
+    seeder.SetMapType(MapType::OpenStreetMap);
+    QList<TileSeeder::Tile> tiles;
+
+    // A fresh zoom level for each run, so nothing is cached yet
+    int zoom = 10;
+    for (int threads = 1; threads <= 8; threads *= 2, zoom++) {
+        tiles.clear();
+        for (int i = 0; i < count; i++) {
+            TileSeeder::Tile tile = {Point(i % 32, i / 32), zoom};
+            tiles.append(tile);
+        }
+        seeder.SetTiles(tiles);
+        seeder.SetThreads(threads);
+        seed(&seeder, QString("%0 thread(s)").arg(threads));
+    }
+
+    // The last level again, which should all be skipped. Cached tiles are
+    // written in the background, so give the queue a moment first.
+    QThread::sleep(5);
+    seed(&seeder, "Resumed, all cached");
+
+    Cache::Instance()->ImageCache.CloseThreadConnection();
+
+    return 0;
+}
+
+/**
+ * @}
+ */
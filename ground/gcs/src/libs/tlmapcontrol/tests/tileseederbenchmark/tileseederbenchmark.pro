@@ -0,0 +1,22 @@
+# Tiles/s benchmark of TileSeeder, the map ripper's fetch pool, against a
+# local stand-in tile server. Build against a GCS build of tlmapwidget:
+#   qmake tileseederbenchmark.pro && make && ./tileseederbenchmark [tiles] [latency ms]
+include(../../../../../gcs.pri)
+
+QT += network sql widgets xml svg
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+TARGET = tileseederbenchmark
+TEMPLATE = app
+
+INCLUDEPATH += ../../core
+LIBS += -L$$GCS_LIBRARY_PATH
+include(../../tlmapcontrol.pri)
+
+linux-* {
+    QMAKE_LFLAGS += \'-Wl,-rpath,$$GCS_LIBRARY_PATH\'
+}
+
+SOURCES += main.cpp
@@ -34,6 +34,7 @@ SOURCES += mapwidget/mapgraphicitem.cpp \
     core/kibertilecache.cpp \
     core/diagnostics.cpp \
     core/tlmaps.cpp \
+    core/tileseeder.cpp \
     internals/core.cpp \
     internals/rectangle.cpp \
     internals/tile.cpp \
@@ -90,6 +91,7 @@ HEADERS += mapwidget/mapgraphicitem.h \
     core/debugheader.h \
     core/diagnostics.h \
     core/tlmaps.h \
+    core/tileseeder.h \
     internals/core.h \
     internals/mousewheelzoomtype.h \
     internals/rectangle.h \
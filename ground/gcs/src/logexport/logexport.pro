@@ -0,0 +1,30 @@
+# Not part of the default GCS build, add it with
+#   make gcs GCS_QMAKE_OPTS="CONFIG+=LOGEXPORT"
+include(../../gcs.pri)
+include(../rpath.pri)
+
+QT += widgets network concurrent
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+TARGET = logexport
+TEMPLATE = app
+DESTDIR = $$GCS_APP_PATH
+macx {
+DESTDIR = $$GCS_BIN_PATH
+}
+
+# The UAVObjects and UAVTalk plugins are linked as plain libraries
+LIBS += -L$$GCS_PLUGIN_PATH/dRonin
+INCLUDEPATH *= $$GCS_SOURCE_TREE/src/plugins
+include(../plugins/uavtalk/uavtalk.pri)
+
+linux-* {
+    QMAKE_LFLAGS += \'-Wl,-rpath,\$\$ORIGIN/../$$GCS_LIBRARY_BASENAME/$$GCS_PROJECT_BRANDING/plugins/dRonin\'
+}
+
+SOURCES += main.cpp \
+    logexporter.cpp
+
+HEADERS += logexporter.h
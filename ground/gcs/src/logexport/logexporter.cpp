@@ -0,0 +1,584 @@
+/**
+ ******************************************************************************
+ * @file       logexporter.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2017
+ * @addtogroup logexport
+ * @{
+ * @addtogroup LogExporter
+ * @{
+ * @brief Decode GCS log files into per-object CSV or columnar files
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "logexporter.h"
+
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QtEndian>
+#include <QQueue>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#include "uavobjects/uavobjectmanager.h"
+#include "uavobjects/uavobjectsinit.h"
+#include "uavtalk/uavtalk.h"
+
+/**
+ * Runs the records through the UAVTalk plugin's parser. The object
+ * updates it accepts become rows instead of updating the objects, so
+ * one object manager can be shared by all the decode threads.
+ */
+class LogExporter::Decoder : public UAVTalk
+{
+public:
+    Decoder(QIODevice *io, const LogExporter *exporter, int formats, ChunkResult *result) :
+        UAVTalk(io, exporter->objMngr),
+        timestamp(0),
+        exporter(exporter),
+        formats(formats),
+        result(result)
+    {
+    }
+
+    //! Log time of the record being decoded, in ms
+    quint32 timestamp;
+
+protected:
+    bool receiveObject(quint8 type, quint32 objId, quint16 instId, quint8 *data, qint32 length)
+    {
+        Q_UNUSED(length);
+
+        // Requests, acks and deltas don't hold a whole object
+        if (type != TYPE_OBJ && type != TYPE_OBJ_ACK)
+            return true;
+
+        // Metadata has no table
+        QHash<quint32, Table>::const_iterator table = exporter->tables.constFind(objId);
+        if (table == exporter->tables.constEnd())
+            return true;
+
+        exporter->appendRow(&result->tables[objId], *table, formats, timestamp, instId, data);
+        result->objects++;
+        return true;
+    }
+
+private:
+    const LogExporter *exporter;
+    int formats;
+    ChunkResult *result;
+};
+
+//! The manager doesn't own its objects, so free them before it goes
+static void deleteObjects(UAVObjectManager *objMngr)
+{
+    foreach (const QVector<UAVObject *> &instances, objMngr->getObjectsVector())
+        qDeleteAll(instances);
+}
+
+LogExporter::LogExporter() :
+    objMngr(NULL),
+    logData(NULL),
+    logSize(0),
+    dataStart(0)
+{
+}
+
+LogExporter::~LogExporter()
+{
+    close();
+}
+
+/**
+ * Open a log and find where its records start
+ * @param fileName The .drlog to read
+ * @param error Set to the reason on failure
+ * @return true on success
+ */
+bool LogExporter::open(const QString &fileName, QString *error)
+{
+    close();
+
+    file.setFileName(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = file.errorString();
+        return false;
+    }
+
+    logSize = file.size();
+    logData = file.map(0, logSize);
+    if (logData == NULL) {
+        *error = QString("Unable to map %0").arg(fileName);
+        file.close();
+        return false;
+    }
+
+    // Header: "dRonin git hash:", the git hash, the UAVO hash, then "##"
+    QList<QByteArray> lines;
+    qint64 pos = 0;
+    while (pos < logSize && lines.size() < 13) {
+        const quint8 *eol = (const quint8 *) memchr(&logData[pos], '\n', logSize - pos);
+        if (eol == NULL)
+            break;
+
+        lines.append(QByteArray((const char *) &logData[pos], eol - &logData[pos]).trimmed());
+        pos = eol - logData + 1;
+
+        if (lines.last() == "##")
+            break;
+    }
+
+    if (!lines.isEmpty() && lines.last() == "##") {
+        dataStart = pos;
+        if (lines.size() >= 3) {
+            logGitHash = QString::fromLatin1(lines.at(1));
+            logUavoHash = QString::fromLatin1(lines.at(2));
+        }
+    } else {
+        // No header; try the whole file
+        dataStart = 0;
+    }
+
+    buildTables();
+    splitChunks();
+
+    return true;
+}
+
+void LogExporter::close()
+{
+    outputs.clear();
+    chunks.clear();
+    tables.clear();
+
+    if (objMngr != NULL) {
+        deleteObjects(objMngr);
+        delete objMngr;
+        objMngr = NULL;
+    }
+
+    if (logData != NULL)
+        file.unmap(const_cast<quint8 *>(logData));
+    file.close();
+
+    logData = NULL;
+    logSize = 0;
+    dataStart = 0;
+    logGitHash.clear();
+    logUavoHash.clear();
+}
+
+/**
+ * Find the next well-formed record, skipping a byte at a time past
+ * anything that isn't one.
+ * @param offset Where to start looking
+ * @param timestamp Set to the record's timestamp
+ * @param size Set to the record's packet size
+ * @return Offset of the record, or -1 if there are no more
+ */
+qint64 LogExporter::nextRecord(qint64 offset, quint32 *timestamp, qint64 *size) const
+{
+    for (; offset >= 0 && offset + RECORD_HEADER_LENGTH <= logSize; offset++) {
+        qint64 dataSize;
+        memcpy(timestamp, &logData[offset], sizeof(*timestamp));
+        memcpy(&dataSize, &logData[offset + sizeof(*timestamp)], sizeof(dataSize));
+
+        if (dataSize >= 1 && dataSize <= MAX_RECORD_SIZE &&
+                offset + RECORD_HEADER_LENGTH + dataSize <= logSize) {
+            *size = dataSize;
+            return offset;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Set up the objects UAVTalk parses against, and work out the columns
+ * of every data object once so the decode threads only have to copy
+ * bytes out of the packed object.
+ */
+void LogExporter::buildTables()
+{
+    objMngr = new UAVObjectManager;
+    UAVObjectsInitialize(objMngr);
+
+    foreach (const QVector<UAVDataObject *> &instances, objMngr->getDataObjectsVector()) {
+        if (instances.isEmpty())
+            continue;
+
+        UAVDataObject *obj = instances.first();
+        Table table;
+        table.name = obj->getName();
+
+        foreach (UAVObjectField *field, obj->getFields()) {
+            Column column;
+            column.type = field->getType();
+            column.typeName = field->getTypeAsString();
+            column.options = field->getOptions();
+            column.bit = 0;
+
+            if (column.type == UAVObjectField::STRING) {
+                // The whole string is one value
+                column.name = field->getName();
+                column.offset = field->getDataOffset();
+                column.size = field->getNumElements();
+                table.columns.append(column);
+                continue;
+            }
+
+            quint32 numElements = field->getNumElements();
+            quint32 elementSize = field->getNumBytes() / numElements;
+            for (quint32 i = 0; i < numElements; i++) {
+                column.name = field->getName();
+                if (numElements > 1)
+                    column.name += "." + field->getElementName(i);
+
+                if (column.type == UAVObjectField::BITFIELD) {
+                    column.offset = field->getDataOffset() + i / 8;
+                    column.bit = i % 8;
+                    column.size = 1;
+                } else {
+                    column.offset = field->getDataOffset() + i * elementSize;
+                    column.size = elementSize;
+                }
+                table.columns.append(column);
+            }
+        }
+
+        tables.insert(obj->getObjID(), table);
+    }
+}
+
+/**
+ * Split the log into decode jobs of about CHUNK_SIZE bytes, each
+ * starting on a record boundary so it can be decoded independently.
+ */
+void LogExporter::splitChunks()
+{
+    quint32 timestamp;
+    qint64 size;
+    qint64 pos = dataStart;
+    Chunk chunk;
+    chunk.begin = dataStart;
+
+    while ((pos = nextRecord(pos, &timestamp, &size)) >= 0) {
+        pos += RECORD_HEADER_LENGTH + size;
+
+        if (pos - chunk.begin >= CHUNK_SIZE) {
+            chunk.end = pos;
+            chunks.append(chunk);
+            chunk.begin = pos;
+        }
+    }
+
+    if (chunk.begin < logSize) {
+        chunk.end = logSize;
+        chunks.append(chunk);
+    }
+}
+
+/**
+ * Decode one chunk. This runs on a pool thread and only reads shared
+ * state.
+ */
+LogExporter::ChunkResult LogExporter::decodeChunk(const Chunk &chunk, int formats) const
+{
+    ChunkResult result;
+    result.records = 0;
+    result.objects = 0;
+    result.errors = 0;
+    result.firstTimestamp = 0;
+    result.lastTimestamp = 0;
+
+    // Nothing is sent back while decoding, but UAVTalk wants a device
+    QBuffer io;
+    io.open(QIODevice::WriteOnly);
+    Decoder decoder(&io, this, formats, &result);
+
+    quint32 timestamp;
+    qint64 size;
+    qint64 pos = chunk.begin;
+    while ((pos = nextRecord(pos, &timestamp, &size)) >= 0 && pos < chunk.end) {
+        if (result.records == 0)
+            result.firstTimestamp = timestamp;
+        result.lastTimestamp = timestamp;
+
+        decoder.timestamp = timestamp;
+        decoder.processInputBytes(&logData[pos + RECORD_HEADER_LENGTH], size);
+        result.records++;
+        pos += RECORD_HEADER_LENGTH + size;
+    }
+
+    // Garbage, bad packets and unknown objects
+    result.errors = decoder.getStats().rxErrors;
+
+    return result;
+}
+
+/**
+ * Add one decoded object to a chunk's output
+ * @param out Rows for this object
+ * @param table Columns of the object
+ * @param formats Which outputs to build
+ * @param timestamp Log time of the record, in ms
+ * @param instId Object instance
+ * @param data The object packed as on the wire
+ */
+void LogExporter::appendRow(ChunkTable *out, const Table &table, int formats, quint32 timestamp,
+                            quint16 instId, const quint8 *data) const
+{
+    out->rows++;
+
+    if (formats & FORMAT_COLUMNAR) {
+        if (out->columns.isEmpty())
+            out->columns.resize(table.columns.size() + 2);
+
+        out->columns[0].append((const char *) &timestamp, sizeof(timestamp));
+        out->columns[1].append((const char *) &instId, sizeof(instId));
+
+        for (int i = 0; i < table.columns.size(); i++) {
+            const Column &column = table.columns.at(i);
+            if (column.type == UAVObjectField::BITFIELD) {
+                char bit = (data[column.offset] >> column.bit) & 1;
+                out->columns[i + 2].append(bit);
+            } else {
+                out->columns[i + 2].append((const char *) &data[column.offset], column.size);
+            }
+        }
+    }
+
+    if (formats & FORMAT_CSV) {
+        QByteArray &csv = out->csv;
+        csv.append(QByteArray::number(timestamp));
+        csv.append(',');
+        csv.append(QByteArray::number(instId));
+
+        foreach (const Column &column, table.columns) {
+            const quint8 *value = &data[column.offset];
+            csv.append(',');
+
+            switch (column.type) {
+            case UAVObjectField::INT8:
+                csv.append(QByteArray::number(*(const qint8 *) value));
+                break;
+            case UAVObjectField::INT16:
+                csv.append(QByteArray::number(qFromLittleEndian<qint16>(value)));
+                break;
+            case UAVObjectField::INT32:
+                csv.append(QByteArray::number(qFromLittleEndian<qint32>(value)));
+                break;
+            case UAVObjectField::UINT8:
+                csv.append(QByteArray::number(*value));
+                break;
+            case UAVObjectField::UINT16:
+                csv.append(QByteArray::number(qFromLittleEndian<quint16>(value)));
+                break;
+            case UAVObjectField::UINT32:
+                csv.append(QByteArray::number(qFromLittleEndian<quint32>(value)));
+                break;
+            case UAVObjectField::FLOAT32:
+            {
+                quint32 bits = qFromLittleEndian<quint32>(value);
+                float f;
+                memcpy(&f, &bits, sizeof(f));
+                csv.append(QByteArray::number(f, 'g', 9));
+                break;
+            }
+            case UAVObjectField::ENUM:
+                if (*value < column.options.size())
+                    csv.append(column.options.at(*value).toUtf8());
+                else
+                    csv.append(QByteArray::number(*value));
+                break;
+            case UAVObjectField::BITFIELD:
+                csv.append((*value >> column.bit) & 1 ? '1' : '0');
+                break;
+            case UAVObjectField::STRING:
+                csv.append('"');
+                csv.append(QByteArray((const char *) value, qstrnlen((const char *) value, column.size)).replace('"', "\"\""));
+                csv.append('"');
+                break;
+            }
+        }
+
+        csv.append('\n');
+    }
+}
+
+/**
+ * Open the output files for an object the first time it shows up
+ * @return The object's outputs, or NULL on failure
+ */
+LogExporter::Output *LogExporter::openOutput(quint32 objId, const QDir &dir, int formats, QString *error)
+{
+    QHash<quint32, Output>::iterator output = outputs.find(objId);
+    if (output != outputs.end())
+        return &output.value();
+
+    const Table &table = tables[objId];
+    Output out;
+
+    if (formats & FORMAT_CSV) {
+        out.csv = QSharedPointer<QFile>(new QFile(dir.filePath(table.name + ".csv")));
+        if (!out.csv->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            *error = QString("%0: %1").arg(out.csv->fileName()).arg(out.csv->errorString());
+            return NULL;
+        }
+
+        QByteArray header("timestamp,instance");
+        foreach (const Column &column, table.columns)
+            header.append(',').append(column.name.toUtf8());
+        out.csv->write(header.append('\n'));
+    }
+
+    if (formats & FORMAT_COLUMNAR) {
+        if (!dir.mkpath(table.name)) {
+            *error = QString("Unable to create %0").arg(dir.filePath(table.name));
+            return NULL;
+        }
+        QDir objDir(dir.filePath(table.name));
+
+        QStringList names;
+        QByteArray schema("timestamp uint32\ninstance uint16\n");
+        names << "timestamp" << "instance";
+        foreach (const Column &column, table.columns) {
+            schema.append(column.name.toUtf8()).append(' ').append(column.typeName.toUtf8());
+            if (column.type == UAVObjectField::ENUM)
+                schema.append(' ').append(column.options.join(',').toUtf8());
+            else if (column.type == UAVObjectField::STRING)
+                schema.append(' ').append(QByteArray::number(column.size));
+            schema.append('\n');
+            names << column.name;
+        }
+
+        QFile schemaFile(objDir.filePath("columns.txt"));
+        if (!schemaFile.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+                schemaFile.write(schema) != schema.size()) {
+            *error = QString("%0: %1").arg(schemaFile.fileName()).arg(schemaFile.errorString());
+            return NULL;
+        }
+
+        foreach (const QString &name, names) {
+            QSharedPointer<QFile> columnFile(new QFile(objDir.filePath(name + ".bin")));
+            if (!columnFile->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+                *error = QString("%0: %1").arg(columnFile->fileName()).arg(columnFile->errorString());
+                return NULL;
+            }
+            out.columns.append(columnFile);
+        }
+    }
+
+    return &outputs.insert(objId, out).value();
+}
+
+//! Append a decoded chunk to the output files
+bool LogExporter::writeResult(const ChunkResult &result, const QDir &dir, int formats, QString *error)
+{
+    for (QHash<quint32, ChunkTable>::const_iterator table = result.tables.constBegin();
+         table != result.tables.constEnd(); ++table) {
+        Output *out = openOutput(table.key(), dir, formats, error);
+        if (out == NULL)
+            return false;
+
+        bool ok = true;
+        if (out->csv)
+            ok &= out->csv->write(table->csv) == table->csv.size();
+        for (int i = 0; i < out->columns.size() && i < table->columns.size(); i++)
+            ok &= out->columns[i]->write(table->columns[i]) == table->columns[i].size();
+
+        if (!ok) {
+            *error = QString("Write failed for %0").arg(tables[table.key()].name);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Decode the whole log
+ * @param outDir Directory for the output files; if empty everything is
+ * decoded and formatted but nothing is written, for benchmarking
+ * @param formats Bitmask of Format
+ * @param threads Number of decode threads
+ * @param stats Filled in with what was decoded and how long it took
+ * @param error Set to the reason on failure
+ * @return true on success
+ */
+bool LogExporter::exportTo(const QString &outDir, int formats, int threads, Stats *stats, QString *error)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    memset(stats, 0, sizeof(*stats));
+    outputs.clear();
+
+    QDir dir(outDir);
+    bool write = !outDir.isEmpty();
+    if (write && !dir.mkpath(".")) {
+        *error = QString("Unable to create %0").arg(outDir);
+        return false;
+    }
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMax(1, threads));
+
+    // Keep a couple of chunks per thread queued, and write them back in
+    // log order as they complete
+    QQueue<QFuture<ChunkResult> > inFlight;
+    quint32 firstTimestamp = 0;
+    int next = 0;
+    bool ok = true;
+
+    while (ok && (next < chunks.size() || !inFlight.isEmpty())) {
+        while (next < chunks.size() && inFlight.size() < pool.maxThreadCount() * 2) {
+            Chunk chunk = chunks.at(next++);
+            inFlight.enqueue(QtConcurrent::run(&pool, [this, chunk, formats]() {
+                return decodeChunk(chunk, formats);
+            }));
+        }
+
+        ChunkResult result = inFlight.dequeue().result();
+        if (result.records > 0) {
+            if (stats->records == 0)
+                firstTimestamp = result.firstTimestamp;
+            stats->logMs = result.lastTimestamp - firstTimestamp;
+        }
+        stats->records += result.records;
+        stats->objects += result.objects;
+        stats->errors += result.errors;
+
+        if (write)
+            ok = writeResult(result, dir, formats, error);
+    }
+
+    // Don't leave jobs running against the mapped log on failure
+    foreach (QFuture<ChunkResult> future, inFlight)
+        future.waitForFinished();
+
+    outputs.clear();
+
+    stats->bytes = logSize - dataStart;
+    stats->elapsedMs = timer.elapsed();
+
+    return ok;
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,160 @@
+/**
+ ******************************************************************************
+ * @file       logexporter.h
+ * @author     dRonin, http://dronin.org Copyright (C) 2017
+ * @addtogroup logexport
+ * @{
+ * @addtogroup LogExporter
+ * @{
+ * @brief Decode GCS log files into per-object CSV or columnar files
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef LOGEXPORTER_H
+#define LOGEXPORTER_H
+
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "uavobjects/uavobjectfield.h"
+
+class UAVObjectManager;
+
+/**
+ * Decodes a log written by the GCS logging plugin as fast as the disk
+ * allows. The log is split into chunks on record boundaries and each
+ * chunk is decoded on its own thread, then the rows are written out in
+ * log order. The records are parsed by the UAVTalk plugin, but the
+ * objects it receives are copied straight into rows rather than unpacked.
+ *
+ * Every object gets a CSV file, \<Object\>.csv, and/or a columnar
+ * directory, \<Object\>/, holding one raw little-endian array per
+ * column (\<column\>.bin) and a columns.txt listing the column names
+ * and types in order.
+ */
+class LogExporter
+{
+public:
+    enum Format {
+        FORMAT_CSV = 0x01,
+        FORMAT_COLUMNAR = 0x02
+    };
+
+    struct Stats {
+        qint64 bytes;
+        qint64 records;
+        qint64 objects;
+        qint64 errors;
+        qint64 logMs;     //!< Log time covered, to compare with replaying it
+        qint64 elapsedMs;
+    };
+
+    LogExporter();
+    ~LogExporter();
+
+    bool open(const QString &fileName, QString *error);
+    void close();
+
+    QString gitHash() const { return logGitHash; }
+    QString uavoHash() const { return logUavoHash; }
+
+    bool exportTo(const QString &outDir, int formats, int threads, Stats *stats, QString *error);
+
+private:
+    static const qint64 RECORD_HEADER_LENGTH = sizeof(quint32) + sizeof(qint64);
+    static const qint64 MAX_RECORD_SIZE = 1024 * 1024;
+    //! Bytes of log per decode job
+    static const qint64 CHUNK_SIZE = 1024 * 1024;
+
+    struct Chunk {
+        qint64 begin;
+        qint64 end;
+    };
+
+    //! One output column: a single element of a field
+    struct Column {
+        QString name;
+        UAVObjectField::FieldType type;
+        QString typeName;
+        quint32 offset; //!< Byte offset in the packed object
+        quint32 bit;    //!< Bit within that byte, for bitfields
+        quint32 size;   //!< Bytes per value
+        QStringList options;
+    };
+
+    struct Table {
+        QString name;
+        QVector<Column> columns;
+    };
+
+    //! The rows one chunk produced for one object
+    struct ChunkTable {
+        ChunkTable() : rows(0) {}
+        quint32 rows;
+        QByteArray csv;
+        QVector<QByteArray> columns;
+    };
+
+    struct ChunkResult {
+        QHash<quint32, ChunkTable> tables;
+        qint64 records;
+        qint64 objects;
+        qint64 errors;
+        quint32 firstTimestamp;
+        quint32 lastTimestamp;
+    };
+
+    struct Output {
+        QSharedPointer<QFile> csv;
+        QVector<QSharedPointer<QFile> > columns;
+    };
+
+    qint64 nextRecord(qint64 offset, quint32 *timestamp, qint64 *size) const;
+    void buildTables();
+    void splitChunks();
+    ChunkResult decodeChunk(const Chunk &chunk, int formats) const;
+    void appendRow(ChunkTable *out, const Table &table, int formats, quint32 timestamp,
+                   quint16 instId, const quint8 *data) const;
+    bool writeResult(const ChunkResult &result, const QDir &dir, int formats, QString *error);
+    Output *openOutput(quint32 objId, const QDir &dir, int formats, QString *error);
+
+    class Decoder;
+
+    UAVObjectManager *objMngr;
+    QFile file;
+    const quint8 *logData;
+    qint64 logSize;
+    qint64 dataStart;
+    QString logGitHash;
+    QString logUavoHash;
+
+    QVector<Chunk> chunks;
+    QHash<quint32, Table> tables;
+    QHash<quint32, Output> outputs;
+};
+
+#endif // LOGEXPORTER_H
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,166 @@
+/**
+ ******************************************************************************
+ * @file       main.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2017
+ * @addtogroup logexport
+ * @{
+ * @addtogroup
+ * @{
+ * @brief Command line tool to convert GCS logs for offline analysis
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "logexporter.h"
+
+#include <extensionsystem/pluginmanager.h>
+#include <coreplugin/generalsettings.h>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QThread>
+
+static void printStats(QTextStream &out, const QString &label, const LogExporter::Stats &stats)
+{
+    double seconds = qMax<qint64>(stats.elapsedMs, 1) / 1000.0;
+
+    out << QString("%0%1 MB, %2 records, %3 objects, %4 errors in %5 s: %6 MB/s, %7 records/s")
+           .arg(label)
+           .arg(stats.bytes / 1e6, 0, 'f', 1)
+           .arg(stats.records)
+           .arg(stats.objects)
+           .arg(stats.errors)
+           .arg(seconds, 0, 'f', 2)
+           .arg(stats.bytes / 1e6 / seconds, 0, 'f', 1)
+           .arg(stats.records / seconds, 0, 'f', 0)
+        << endl;
+    out << QString("    %0 s of log, %1x faster than replaying it")
+           .arg(stats.logMs / 1000.0, 0, 'f', 1)
+           .arg(stats.logMs / 1000.0 / seconds, 0, 'f', 0)
+        << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("logexport");
+
+    // UAVTalk looks up the general settings, as it would in the GCS
+    ExtensionSystem::PluginManager pm;
+    pm.addObject(new Core::Internal::GeneralSettings);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Decode a GCS log into one CSV file and/or one directory "
+                                     "of binary columns per object.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("log", "Log file (.drlog) to decode.");
+    parser.addPositionalArgument("outdir", "Output directory, by default the log name without its extension.");
+
+    QCommandLineOption formatOption(QStringList() << "f" << "format",
+                                    "Output format: csv, columnar or both.", "format", "csv");
+    QCommandLineOption threadsOption(QStringList() << "j" << "threads",
+                                     "Number of decode threads.", "threads",
+                                     QString::number(QThread::idealThreadCount()));
+    QCommandLineOption benchmarkOption("benchmark",
+                                       "Decode and format the log with 1, 2, 4... threads "
+                                       "up to --threads, without writing anything, and "
+                                       "report the throughput of each.");
+    parser.addOption(formatOption);
+    parser.addOption(threadsOption);
+    parser.addOption(benchmarkOption);
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QStringList args = parser.positionalArguments();
+    if (args.isEmpty() || args.size() > 2)
+        parser.showHelp(1);
+
+    int formats;
+    QString format = parser.value(formatOption);
+    if (format == "csv") {
+        formats = LogExporter::FORMAT_CSV;
+    } else if (format == "columnar") {
+        formats = LogExporter::FORMAT_COLUMNAR;
+    } else if (format == "both") {
+        formats = LogExporter::FORMAT_CSV | LogExporter::FORMAT_COLUMNAR;
+    } else {
+        err << "Unknown format " << format << endl;
+        return 1;
+    }
+
+    bool ok;
+    int threads = parser.value(threadsOption).toInt(&ok);
+    if (!ok || threads < 1) {
+        err << "Invalid thread count " << parser.value(threadsOption) << endl;
+        return 1;
+    }
+
+    LogExporter exporter;
+    QString error;
+    if (!exporter.open(args.at(0), &error)) {
+        err << args.at(0) << ": " << error << endl;
+        return 1;
+    }
+
+    out << "Log git hash " << exporter.gitHash() << ", UAVO hash " << exporter.uavoHash() << endl;
+
+    LogExporter::Stats stats;
+
+    if (parser.isSet(benchmarkOption)) {
+        qint64 baseMs = 0;
+        for (int n = 1; ; n = qMin(n * 2, threads)) {
+            if (!exporter.exportTo(QString(), formats, n, &stats, &error)) {
+                err << error << endl;
+                return 1;
+            }
+
+            if (n == 1)
+                baseMs = stats.elapsedMs;
+            printStats(out, QString("%0 thread(s): ").arg(n), stats);
+            out << QString("    speedup %0x").arg((double) baseMs / qMax<qint64>(stats.elapsedMs, 1), 0, 'f', 2) << endl;
+
+            if (n == threads)
+                break;
+        }
+        return 0;
+    }
+
+    QString outDir;
+    if (args.size() > 1) {
+        outDir = args.at(1);
+    } else {
+        QFileInfo info(args.at(0));
+        outDir = info.dir().filePath(info.completeBaseName());
+    }
+
+    if (!exporter.exportTo(outDir, formats, threads, &stats, &error)) {
+        err << error << endl;
+        return 1;
+    }
+
+    printStats(out, "", stats);
+    out << "Written to " << outDir << endl;
+
+    return 0;
+}
+
+/**
+ * @}
+ * @}
+ */
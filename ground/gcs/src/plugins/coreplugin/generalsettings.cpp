@@ -51,7 +51,8 @@ GeneralSettings::GeneralSettings():
     m_dialog(0),
     m_proxyType(QNetworkProxy::NoProxy),
     m_proxyPort(0),
-    m_useSessionManaging(true)
+    m_useSessionManaging(true),
+    m_useDeltaEncoding(true)
 {
 }
 
@@ -134,6 +135,7 @@ QWidget *GeneralSettings::createPage(QWidget *parent)
     m_page->cbUseUDPMirror->setChecked(m_useUDPMirror);
     m_page->cbExpertMode->setChecked(m_useExpertMode);
     m_page->cbSessionMessaging->setChecked(m_useSessionManaging);
+    m_page->cbDeltaEncoding->setChecked(m_useDeltaEncoding);
     m_page->colorButton->setColor(StyleHelper::baseColor());
     m_page->proxyTypeCB->setCurrentIndex(m_page->proxyTypeCB->findData(m_proxyType));
     m_page->portLE->setText(QString::number(m_proxyPort));
@@ -157,6 +159,7 @@ void GeneralSettings::apply()
     m_useUDPMirror = m_page->cbUseUDPMirror->isChecked();
     m_useExpertMode = m_page->cbExpertMode->isChecked();
     m_useSessionManaging = m_page->cbSessionMessaging->isChecked();
+    m_useDeltaEncoding = m_page->cbDeltaEncoding->isChecked();
     m_autoConnect = m_page->checkAutoConnect->isChecked();
     m_autoSelect = m_page->checkAutoSelect->isChecked();
     m_proxyType = m_page->proxyTypeCB->itemData(m_page->proxyTypeCB->currentIndex()).toInt();
@@ -183,6 +186,7 @@ void GeneralSettings::readSettings(QSettings* qs)
     m_useUDPMirror = qs->value(QLatin1String("UDPMirror"),m_useUDPMirror).toBool();
     m_useExpertMode = qs->value(QLatin1String("ExpertMode"),m_useExpertMode).toBool();
     m_useSessionManaging = qs->value(QLatin1String("UseSessionManaging"), m_useSessionManaging).toBool();
+    m_useDeltaEncoding = qs->value(QLatin1String("UseDeltaEncoding"), m_useDeltaEncoding).toBool();
     m_proxyType = qs->value(QLatin1String("proxytype"),m_proxyType).toInt();
     m_proxyPort = qs->value(QLatin1String("proxyport"),m_proxyPort).toInt();
     m_proxyHostname = qs->value(QLatin1String("proxyhostname"),m_proxyHostname).toString();
@@ -216,6 +220,7 @@ void GeneralSettings::saveSettings(QSettings* qs)
     qs->setValue(QLatin1String("UDPMirror"), m_useUDPMirror);
     qs->setValue(QLatin1String("ExpertMode"), m_useExpertMode);
     qs->setValue(QLatin1String("UseSessionManaging"), m_useSessionManaging);
+    qs->setValue(QLatin1String("UseDeltaEncoding"), m_useDeltaEncoding);
 
     qs->setValue(QLatin1String("proxytype"), m_proxyType);
     qs->setValue(QLatin1String("proxyport"), m_proxyPort);
@@ -296,6 +301,11 @@ bool GeneralSettings::useSessionManaging() const
     return m_useSessionManaging;
 }
 
+bool GeneralSettings::useDeltaEncoding() const
+{
+    return m_useDeltaEncoding;
+}
+
 bool GeneralSettings::useExpertMode() const
 {
     return m_useExpertMode;
@@ -62,6 +62,7 @@ public:
     bool autoSelect() const;
     bool useUDPMirror() const;
     bool useSessionManaging() const;
+    bool useDeltaEncoding() const;
     void readSettings(QSettings* qs);
     void saveSettings(QSettings* qs);
     bool useExpertMode() const;
@@ -121,6 +122,7 @@ private:
     QString m_escs;
     QString m_props;
     bool m_useSessionManaging;
+    bool m_useDeltaEncoding;
 };
 } // namespace Internal
 } // namespace Core
@@ -0,0 +1,339 @@
+/**
+ ******************************************************************************
+ *
+ * @file       compactlog.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2017
+ * @see        The GNU Public License (GPL) Version 3
+ * @brief      Decoder for flight logs in the compact format
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup   Logging
+ * @{
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+#include "compactlog.h"
+
+#include <uavobjectmanager.h>
+#include <uavtalk/uavtalk.h>
+
+#include <QHash>
+#include <QDebug>
+
+static const QByteArray COMPACT_SIGNATURE("dRonin compact log:\n");
+static const QByteArray UAVTALK_SIGNATURE("dRonin git hash:\n");
+
+//! Lines of the header after the signature: git hash, UAVO hash
+static const int HEADER_LINES = 2;
+
+//! Starts each block, followed by a uint32 of ms
+static const QByteArray BLOCK_SYNC("\xd5\x1c\xb7\x3a", 4);
+
+//! Key that ends a block, followed by the block's CRC-16
+static const quint32 END_KEY = 1;
+
+namespace {
+
+//! An object instance defined in the log
+struct Entry {
+    quint32 objId;
+    quint16 instId;
+    int length;
+    QByteArray last; //!< Data last logged under its code
+};
+
+//! Reads the fields of a record; every read fails once past the end
+class Reader
+{
+public:
+    Reader(const QByteArray &log, int pos) : log(log), pos(pos), ok(true) {}
+
+    quint32 varint()
+    {
+        quint32 value = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            if (!ensure(1))
+                return 0;
+            quint8 b = log.at(pos++);
+            value |= (quint32)(b & 0x7f) << shift;
+            if (!(b & 0x80))
+                return value;
+        }
+        ok = false;
+        return 0;
+    }
+
+    quint32 uint32()
+    {
+        if (!ensure(4))
+            return 0;
+        const quint8 *p = (const quint8 *)log.constData() + pos;
+        pos += 4;
+        return p[0] | (p[1] << 8) | (p[2] << 16) | ((quint32)p[3] << 24);
+    }
+
+    QByteArray bytes(int length)
+    {
+        if (!ensure(length))
+            return QByteArray();
+        pos += length;
+        return log.mid(pos - length, length);
+    }
+
+    const QByteArray &log;
+    int pos;
+    bool ok;
+
+private:
+    bool ensure(int length)
+    {
+        if (ok && length >= 0 && pos + length <= log.size())
+            return true;
+        ok = false;
+        return false;
+    }
+};
+
+//! What became of a block
+enum BlockResult {
+    BLOCK_OK,       //!< Complete, and the CRC matches
+    BLOCK_SHORT,    //!< The log ends before the block does
+    BLOCK_DAMAGED   //!< Anything else
+};
+
+//! The UAVTalk packets decoded from a block
+struct Block {
+    Block() : end(0), skipped(0) {}
+    QByteArray packets;
+    int end;      //!< Where the next block should start
+    int skipped;  //!< Updates of objects this GCS doesn't know
+};
+
+}
+
+/**
+ * Build the timestamped UAVTalk packet a flight log would have had for an
+ * update
+ */
+static QByteArray timestampedPacket(UAVObject *obj, const Entry &entry, quint32 timestamp,
+                                    const QByteArray &data)
+{
+    QByteArray packet;
+    packet.append((char)UAVTalk::SYNC_VAL);
+    packet.append((char)(UAVTalk::TYPE_OBJ | UAVTalk::TYPE_TIMESTAMPED));
+    packet.append((char)0); // length, filled in below
+    packet.append((char)0);
+    for (int i = 0; i < 4; i++)
+        packet.append((char)(entry.objId >> (8 * i)));
+    if (!obj->isSingleInstance()) {
+        packet.append((char)(entry.instId & 0xff));
+        packet.append((char)(entry.instId >> 8));
+    }
+    packet.append((char)(timestamp & 0xff));
+    packet.append((char)((timestamp >> 8) & 0xff));
+    packet.append(data);
+    packet[2] = (char)(packet.size() & 0xff);
+    packet[3] = (char)(packet.size() >> 8);
+    packet.append((char)UAVTalk::updateCRC(0, (const quint8 *)packet.constData(), packet.size()));
+
+    return packet;
+}
+
+/**
+ * Decode the block starting at a sync.  Nothing it holds can be trusted
+ * until its CRC has been checked, so the packets are only returned.
+ * @param log the whole log
+ * @param start where the sync is
+ * @param objMngr where to look up the logged objects
+ * @param block gets the packets of the records read, even if the block
+ * turns out to be short or damaged
+ */
+static BlockResult decodeBlock(const QByteArray &log, int start, UAVObjectManager *objMngr,
+                               Block *block)
+{
+    Reader reader(log, start + BLOCK_SYNC.size());
+    quint32 timestamp = reader.uint32();
+
+    QHash<quint32, Entry> codes;
+
+    while (reader.ok) {
+        int pos = reader.pos;
+        quint32 key = reader.varint();
+
+        if (reader.ok && key == END_KEY) {
+            QByteArray crc = reader.bytes(2);
+            if (!reader.ok)
+                break;
+
+            quint16 expected = UAVTalk::updateCRC16(0, (const quint8 *)log.constData() + start,
+                                                    reader.pos - 2 - start);
+            if ((quint8)crc.at(0) != (expected & 0xff) || (quint8)crc.at(1) != (expected >> 8))
+                return BLOCK_DAMAGED;
+
+            block->end = reader.pos;
+            return BLOCK_OK;
+        }
+
+        quint32 code = key >> 1;
+        bool isDelta = key & 1;
+
+        Entry entry = Entry();
+        quint32 definedCode = 0;
+
+        if (code == 0) {
+            definedCode = reader.varint();
+            entry.objId = reader.uint32();
+            entry.instId = reader.varint();
+            entry.length = reader.varint();
+        } else if (codes.contains(code)) {
+            entry = codes.value(code);
+        } else if (reader.ok) {
+            qDebug() << "Compact log uses undefined code" << code << "at" << pos;
+            return BLOCK_DAMAGED;
+        }
+
+        quint32 dt = reader.varint();
+        QByteArray data;
+
+        if (isDelta) {
+            QByteArray runs = reader.bytes(reader.varint());
+            if (!reader.ok)
+                break;
+
+            if (entry.last.size() != entry.length) {
+                qDebug() << "Compact log has a delta without a base at" << pos;
+                return BLOCK_DAMAGED;
+            }
+
+            data = entry.last;
+            int i = 0;
+            while (i < runs.size()) {
+                if (i + 2 > runs.size())
+                    break;
+                int offset = (quint8)runs.at(i);
+                int length = (quint8)runs.at(i + 1);
+                if (offset + length > data.size() || i + 2 + length > runs.size())
+                    break;
+                data.replace(offset, length, runs.mid(i + 2, length));
+                i += 2 + length;
+            }
+
+            if (i != runs.size()) {
+                qDebug() << "Compact log has a bad delta at" << pos;
+                return BLOCK_DAMAGED;
+            }
+        } else {
+            data = reader.bytes(entry.length);
+        }
+
+        if (!reader.ok)
+            break;
+
+        timestamp += dt;
+        entry.last = data;
+        if (code != 0)
+            codes[code] = entry;
+        else if (definedCode != 0)
+            codes[definedCode] = entry;
+
+        UAVObject *obj = objMngr->getObject(entry.objId);
+        if (!obj || (int)obj->getNumBytes() != entry.length) {
+            block->skipped++;
+            continue;
+        }
+
+        block->packets.append(timestampedPacket(obj, entry, timestamp, data));
+    }
+
+    return BLOCK_SHORT;
+}
+
+bool CompactLog::isCompact(const QByteArray &log)
+{
+    return log.startsWith(COMPACT_SIGNATURE);
+}
+
+bool CompactLog::toUAVTalk(const QByteArray &log, UAVObjectManager *objMngr, QByteArray *out,
+                           int *lost)
+{
+    out->clear();
+    *lost = 0;
+
+    if (!isCompact(log))
+        return false;
+
+    // The header stays as it was, bar the signature
+    int pos = COMPACT_SIGNATURE.size();
+    for (int i = 0; i < HEADER_LINES; i++) {
+        pos = log.indexOf('\n', pos);
+        if (pos < 0)
+            return false;
+        pos++;
+    }
+    out->append(UAVTALK_SIGNATURE);
+    out->append(log.mid(COMPACT_SIGNATURE.size(), pos - COMPACT_SIGNATURE.size()));
+
+    int skipped = 0;
+    bool synced = true;
+
+    while (pos < log.size()) {
+        int start = log.indexOf(BLOCK_SYNC, pos);
+        if (start < 0) {
+            if (synced)
+                (*lost)++;
+            break;
+        }
+
+        // Anything between blocks is what's left of a damaged one
+        if (start != pos && synced)
+            (*lost)++;
+
+        Block block;
+        BlockResult result = decodeBlock(log, start, objMngr, &block);
+
+        // A block cut short can only be the last one, lost with the power;
+        // keep what there is of it
+        if (result == BLOCK_SHORT && log.indexOf(BLOCK_SYNC, start + 1) < 0) {
+            out->append(block.packets);
+            skipped += block.skipped;
+            break;
+        }
+
+        if (result != BLOCK_OK) {
+            // Look for the next block from just past this sync
+            if (synced)
+                (*lost)++;
+            synced = false;
+            pos = start + 1;
+            continue;
+        }
+
+        out->append(block.packets);
+        skipped += block.skipped;
+        synced = true;
+        pos = block.end;
+    }
+
+    if (skipped)
+        qDebug() << "Left" << skipped << "updates of unknown objects out of the compact log";
+
+    return true;
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,67 @@
+/**
+ ******************************************************************************
+ *
+ * @file       compactlog.h
+ * @author     dRonin, http://dronin.org Copyright (C) 2017
+ * @see        The GNU Public License (GPL) Version 3
+ * @brief      Decoder for flight logs in the compact format
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup   Logging
+ * @{
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+#ifndef COMPACTLOG_H
+#define COMPACTLOG_H
+
+#include <QByteArray>
+
+class UAVObjectManager;
+
+/**
+ * Converts flight logs written in the compact format (LoggingSettings.Format
+ * Compact or CompactDelta) back into timestamped UAVTalk, so they open like
+ * any other flight log.  See the Logging module for the record layout.
+ */
+class CompactLog
+{
+public:
+    //! Whether a log starts with the compact format's header
+    static bool isCompact(const QByteArray &log);
+
+    /**
+     * Convert a compact log to UAVTalk.  Objects this GCS doesn't know are
+     * left out, as it can't tell whether their packets need an instance id.
+     * Damaged blocks are left out too, and decoding picks up again at the
+     * next block that checks out.
+     * @param log the log as downloaded
+     * @param objMngr where to look up the logged objects
+     * @param out set to the converted log
+     * @param lost set to the number of stretches of the log left out as
+     * damaged
+     * @return false if the log doesn't start with a compact header
+     */
+    static bool toUAVTalk(const QByteArray &log, UAVObjectManager *objMngr, QByteArray *out,
+                          int *lost);
+};
+
+#endif // COMPACTLOG_H
+
+/**
+ * @}
+ * @}
+ */
@@ -28,11 +28,14 @@
  */
 #include "flightlogdownload.h"
 #include "ui_flightlogdownload.h"
+#include "compactlog.h"
 
 #include <uavobjectmanager.h>
+#include <uavtalk/uavtalk.h>
 #include "uavobjectutil/uavobjectutilmanager.h"
 #include <extensionsystem/pluginmanager.h>
 
+#include "loggingsector.h"
 #include "loggingstats.h"
 
 #include <QDateTime>
@@ -47,6 +50,15 @@ FlightLogDownload::FlightLogDownload(QWidget *parent) :
     ui->setupUi(this);
 
     dl_state = DL_IDLE;
+    logFile = NULL;
+    fileId = 0;
+    sectorBase = 0;
+    ackedBase = 0;
+    lastSector = -1;
+    window = 1;
+    requestSeq = 0;
+    resends = 0;
+    crcErrors = 0;
 
     ExtensionSystem::PluginManager *pm = ExtensionSystem::PluginManager::instance();
     UAVObjectManager *uavoManager = pm->getObject<UAVObjectManager>();
@@ -63,6 +75,15 @@ FlightLogDownload::FlightLogDownload(QWidget *parent) :
     // Get the current status
     connect(loggingStats, SIGNAL(objectUnpacked(UAVObject*)), this, SLOT(updateReceived()));
     loggingStats->requestUpdate();
+
+    // Each LoggingSector instance is one slot of the download window, and
+    // the flight side creates them, so pick them up as they appear
+    connect(uavoManager, SIGNAL(newInstance(UAVObject*)), this, SLOT(newInstance(UAVObject*)));
+    for (int i = 0; i < LoggingSector::getNumInstances(uavoManager); i++)
+        newInstance(LoggingSector::GetInstance(uavoManager, i));
+
+    progressTimer.setInterval(PROGRESS_PERIOD_MS);
+    connect(&progressTimer, SIGNAL(timeout()), this, SLOT(checkProgress()));
 }
 
 FlightLogDownload::~FlightLogDownload()
@@ -102,50 +123,180 @@ void FlightLogDownload::updateReceived()
         break;
     }
 
-    UAVObject::Metadata mdata;
-
-    switch (logging.Operation) {
-    case LoggingStats::OPERATION_IDLE:
-        log.append((char *) logging.FileSector, LoggingStats::FILESECTOR_NUMELEM);
-        logging.Operation = LoggingStats::OPERATION_DOWNLOAD;
-        logging.FileSectorNum++;
-        loggingStats->setData(logging);
-        loggingStats->updated();
-        ui->sectorLabel->setText(QString::number(logging.FileSectorNum));
-        qDebug() << "Requesting sector num: " << logging.FileSectorNum;
-
-        ui->lb_operationStatus->setText("Downloading...");
-        break;
-    case LoggingStats::OPERATION_COMPLETE:
-    {
-        log.append((char *) logging.FileSector, LoggingStats::FILESECTOR_NUMELEM);
-
+    if (logging.Operation == LoggingStats::OPERATION_ERROR) {
         dl_state = DL_IDLE;
+        progressTimer.stop();
 
-        mdata = loggingStats->getMetadata();
+        UAVObject::Metadata mdata = loggingStats->getMetadata();
         UAVObject::SetFlightTelemetryUpdateMode(mdata, UAVObject::UPDATEMODE_MANUAL);
         loggingStats->setMetadata(mdata);
 
-        logFile->write(log);
-        logFile->close();
+        ui->lb_operationStatus->setText("Download error.");
+    }
+}
 
-        ui->lb_operationStatus->setText("Download complete.");
-        break;
+//! Listen to every LoggingSector instance
+void FlightLogDownload::newInstance(UAVObject *obj)
+{
+    if (qobject_cast<LoggingSector *>(obj))
+        connect(obj, SIGNAL(objectUnpacked(UAVObject*)), this, SLOT(sectorReceived(UAVObject*)), Qt::UniqueConnection);
+}
+
+/**
+ * @brief FlightLogDownload::sectorReceived store a sector sent by
+ * the flight side. Sectors may arrive out of order after a resend, so
+ * those beyond the first gap wait in pending until it is filled.
+ */
+void FlightLogDownload::sectorReceived(UAVObject *obj)
+{
+    if (dl_state != DL_DOWNLOADING)
+        return;
+
+    LoggingSector *sector = qobject_cast<LoggingSector *>(obj);
+    if (sector == NULL)
+        return;
+
+    LoggingSector::DataFields data = sector->getData();
+
+    // Duplicate, or left over from an earlier download
+    if (data.SectorNum < sectorBase || data.SectorNum >= sectorBase + window ||
+            pending.contains(data.SectorNum))
+        return;
+
+    sinceSector.restart();
+
+    if (data.Length > LoggingSector::DATA_NUMELEM ||
+            UAVTalk::updateCRC16(0, data.Data, data.Length) != data.Crc) {
+        // Ask for it again now rather than waiting for the timeout
+        crcErrors++;
+        sendRequest(1u << (data.SectorNum - sectorBase));
+        return;
     }
-    case LoggingStats::OPERATION_ERROR:
-        dl_state = DL_IDLE;
 
-        mdata = loggingStats->getMetadata();
-        UAVObject::SetFlightTelemetryUpdateMode(mdata, UAVObject::UPDATEMODE_MANUAL);
-        loggingStats->setMetadata(mdata);
+    pending.insert(data.SectorNum, QByteArray((const char *) data.Data, data.Length));
+    if (data.Length < LoggingSector::DATA_NUMELEM)
+        lastSector = data.SectorNum;
 
-        ui->lb_operationStatus->setText("Download error.");
-        break;
-    default:
-        qDebug() << "Unhandled";
+    while (pending.contains(sectorBase))
+        log.append(pending.take(sectorBase++));
+
+    ui->sectorLabel->setText(QString::number(sectorBase));
+
+    if (lastSector >= 0 && sectorBase > (quint32) lastSector) {
+        finishDownload();
+    } else if (sectorBase - ackedBase >= (window + 1) / 2) {
+        // Ack every half window so the flight side never runs dry
+        sendRequest(0);
     }
 }
 
+/**
+ * @brief FlightLogDownload::checkProgress periodically ack what has
+ * arrived, and once nothing has arrived for a while ask for every
+ * sector still missing from the window.
+ */
+void FlightLogDownload::checkProgress()
+{
+    if (dl_state != DL_DOWNLOADING) {
+        progressTimer.stop();
+        return;
+    }
+
+    updateThroughput();
+
+    if (sinceSector.elapsed() < RESEND_TIMEOUT_MS) {
+        if (sectorBase != ackedBase)
+            sendRequest(0);
+        return;
+    }
+
+    quint32 resend = 0;
+    for (quint32 i = 0; i < window; i++) {
+        quint32 num = sectorBase + i;
+        if (lastSector >= 0 && num > (quint32) lastSector)
+            break;
+        if (!pending.contains(num))
+            resend |= 1u << i;
+    }
+
+    resends++;
+    sendRequest(resend);
+    sinceSector.restart();
+}
+
+/**
+ * @brief FlightLogDownload::sendRequest ack everything before
+ * sectorBase and ask the flight side to resend some sectors
+ * @param resend bit i requests sector sectorBase + i again
+ */
+void FlightLogDownload::sendRequest(quint32 resend)
+{
+    LoggingStats::DataFields logging = loggingStats->getData();
+    logging.Operation = LoggingStats::OPERATION_DOWNLOAD;
+    logging.FileRequest = fileId;
+    logging.FileSectorNum = sectorBase;
+    logging.FileSectorResend = resend;
+    logging.FileRequestSeq = ++requestSeq;
+    loggingStats->setData(logging);
+    loggingStats->updated();
+
+    ackedBase = sectorBase;
+}
+
+//! Write out the log once every sector has arrived
+void FlightLogDownload::finishDownload()
+{
+    // The final ack lets the flight side close the file
+    sendRequest(0);
+
+    dl_state = DL_IDLE;
+    progressTimer.stop();
+    updateThroughput();
+
+    UAVObject::Metadata mdata = loggingStats->getMetadata();
+    UAVObject::SetFlightTelemetryUpdateMode(mdata, UAVObject::UPDATEMODE_MANUAL);
+    loggingStats->setMetadata(mdata);
+
+    // Compact logs are saved as UAVTalk, which everything can read
+    int lost = 0;
+    if (CompactLog::isCompact(log)) {
+        QByteArray converted;
+        UAVObjectManager *uavoManager = ExtensionSystem::PluginManager::instance()->getObject<UAVObjectManager>();
+        if (CompactLog::toUAVTalk(log, uavoManager, &converted, &lost)) {
+            if (lost)
+                qWarning() << "Left" << lost << "damaged stretches out of the compact log";
+
+            qDebug() << "Converted" << log.size() << "compact bytes to" << converted.size() << "bytes of UAVTalk";
+            log = converted;
+        } else {
+            qWarning() << "Compact log has no header, saving it as it is";
+        }
+    }
+
+    logFile->write(log);
+    logFile->close();
+
+    qDebug() << "Downloaded" << log.size() << "bytes in" << sinceStart.elapsed() << "ms,"
+             << resends << "resends," << crcErrors << "CRC errors";
+
+    if (lost)
+        ui->lb_operationStatus->setText(QString("Download complete, %0 damaged parts of the log left out.").arg(lost));
+    else
+        ui->lb_operationStatus->setText("Download complete.");
+}
+
+//! Show the measured download rate
+void FlightLogDownload::updateThroughput()
+{
+    qint64 ms = sinceStart.elapsed();
+    if (ms <= 0)
+        return;
+
+    double rate = log.size() / 1024.0 * 1000.0 / ms;
+    ui->rateLabel->setText(QString("%0 kB/s (%1 resends, %2 CRC errors)")
+                           .arg(rate, 0, 'f', 1).arg(resends).arg(crcErrors));
+}
+
 /**
  * @brief FlightLogDownload::startDownload set up the metadata
  * on the logging object and start a download after checking the
@@ -178,11 +329,21 @@ void FlightLogDownload::startDownload()
 
     qDebug() << "Download file id: " << file_id;
     dl_state = DL_DOWNLOADING;
-    logging.Operation = LoggingStats::OPERATION_DOWNLOAD;
-    logging.FileRequest = file_id;
-    logging.FileSectorNum = 0;
-    loggingStats->setData(logging);
-    loggingStats->updated();
+    fileId = file_id;
+    pending.clear();
+    sectorBase = 0;
+    ackedBase = 0;
+    lastSector = -1;
+    window = qBound(1, (int) logging.FileSectorWindow, 32);
+    requestSeq = logging.FileRequestSeq;
+    resends = 0;
+    crcErrors = 0;
+    sinceStart.start();
+    sinceSector.start();
+    progressTimer.start();
+
+    sendRequest(0);
+    ui->lb_operationStatus->setText("Downloading...");
 }
 
 /**
@@ -30,7 +30,11 @@
 
 #include <QDialog>
 #include <QByteArray>
+#include <QElapsedTimer>
 #include <QFile>
+#include <QMap>
+#include <QTimer>
+#include "loggingsector.h"
 #include "loggingstats.h"
 
 namespace Ui {
@@ -47,14 +51,44 @@ public:
 
 private slots:
     void updateReceived();
+    void sectorReceived(UAVObject *obj);
+    void newInstance(UAVObject *obj);
+    void checkProgress();
     void startDownload();
     void getFilename();
 
 private:
+    void sendRequest(quint32 resend);
+    void finishDownload();
+    void updateThroughput();
+
+    //! Resend sectors when nothing has arrived for this long
+    static const int RESEND_TIMEOUT_MS = 250;
+    //! Period of the ack/resend check
+    static const int PROGRESS_PERIOD_MS = 50;
+
     LoggingStats *loggingStats;
     QByteArray log;
     QFile *logFile;
 
+    quint16 fileId;
+    //! Sectors received ahead of the first missing one
+    QMap<quint32, QByteArray> pending;
+    //! First sector not yet received; everything before is in log
+    quint32 sectorBase;
+    //! sectorBase last acknowledged to the flight side
+    quint32 ackedBase;
+    //! Final (short) sector of the file, or -1 while unknown
+    qint32 lastSector;
+    //! Sectors the flight side may have outstanding
+    quint32 window;
+    quint8 requestSeq;
+    quint32 resends;
+    quint32 crcErrors;
+    QTimer progressTimer;
+    QElapsedTimer sinceStart;
+    QElapsedTimer sinceSector;
+
     enum LOG_DL_STATE {DL_IDLE, DL_DOWNLOADING, DL_COMPLETE} dl_state;
 
     Ui::FlightLogDownload *ui;
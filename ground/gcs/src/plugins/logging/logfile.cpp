@@ -29,13 +29,32 @@
 #include <QtGlobal>
 #include <QTextStream>
 #include <QMessageBox>
+#include <QtEndian>
+#include <QElapsedTimer>
+#include <algorithm>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 #include <coreplugin/coreconstants.h>
 
 LogFile::LogFile(QObject *parent) :
     QIODevice(parent),
-    timestampBufferIdx(0)
+    dataStart(0),
+    recordCount(0),
+    logData(NULL),
+    logSize(0),
+    replayPos(0),
+    firstTimestamp(0),
+    writer(this),
+    writeHead(0),
+    writeTail(0),
+    writerStop(false)
 {
+    memset(&writeStats, 0, sizeof(writeStats));
     connect(&timer, SIGNAL(timeout()), this, SLOT(timerFired()));
 }
 
@@ -80,6 +99,27 @@ bool LogFile::open(OpenMode mode) {
         QTextStream out(&file);
 
         out << "dRonin git hash:\n" <<  gitHash << "\n" << uavoHash << "\n##\n";
+        out.flush();
+
+        // Index the log as it is written
+        dataStart = file.pos();
+        recordCount = 0;
+        latestOffsets.clear();
+        timeIndex.clear();
+        checkpoints.clear();
+        indexFile.setFileName(file.fileName() + ".idx");
+        if (indexFile.open(QIODevice::WriteOnly))
+            writeIndexHeader();
+        else
+            qDebug() << "Unable to open " << indexFile.fileName() << ", the log will be indexed on replay";
+
+        // Start writing behind
+        writeBuffer.resize(WRITE_BUFFER_SIZE);
+        writeHead = 0;
+        writeTail = 0;
+        writerStop = false;
+        memset(&writeStats, 0, sizeof(writeStats));
+        writer.start();
     }
     else if(mode == QIODevice::ReadOnly)
     {
@@ -120,6 +160,8 @@ bool LogFile::open(OpenMode mode) {
             file.seek(0);
         }
 
+        dataStart = file.pos();
+
     }
     else
     {
@@ -140,7 +182,23 @@ void LogFile::close()
 
     if (timer.isActive())
         timer.stop();
+
+    // Let the writer finish what's buffered
+    if (writer.isRunning())
+    {
+        writeLock.lock();
+        writerStop = true;
+        writeWake.wakeOne();
+        writeLock.unlock();
+        writer.wait();
+        writeBuffer.clear();
+    }
+
+    indexFile.close();
     file.close();
+    logData = NULL;
+    logSize = 0;
+    unmappedData.clear();
     QIODevice::close();
 }
 
@@ -150,136 +208,251 @@ qint64 LogFile::writeData(const char * data, qint64 dataSize) {
 
     quint32 timeStamp = myTime.elapsed();
 
-    file.write((char *) &timeStamp,sizeof(timeStamp));
-    file.write((char *) &dataSize, sizeof(dataSize));
+    {
+        QMutexLocker locker(&writeLock);
+
+        // Better to lose a packet than to stall the caller
+        if (writeHead - writeTail + RECORD_HEADER_LENGTH + dataSize > WRITE_BUFFER_SIZE)
+        {
+            writeStats.droppedPackets++;
+            return dataSize;
+        }
+
+        appendToWriteBuffer((const char *) &timeStamp, sizeof(timeStamp));
+        appendToWriteBuffer((const char *) &dataSize, sizeof(dataSize));
+        appendToWriteBuffer(data, dataSize);
+
+        if (writeHead - writeTail >= WRITE_BLOCK_SIZE)
+            writeWake.wakeOne();
+    }
 
-    qint64 written = file.write(data, dataSize);
-    if(written != -1)
-        emit bytesWritten(written);
+    emit bytesWritten(dataSize);
 
     return dataSize;
 }
 
-qint64 LogFile::readData(char * data, qint64 maxSize) {
-    QMutexLocker locker(&mutex);
-    qint64 toRead = qMin(maxSize,(qint64)dataBuffer.size());
-    memcpy(data,dataBuffer.data(),toRead);
-    dataBuffer.remove(0,toRead);
-    return toRead;
+/**
+ * Copy into the write buffer, wrapping around its end. writeLock must be
+ * held and there must be room.
+ */
+void LogFile::appendToWriteBuffer(const char *data, qint64 length)
+{
+    qint64 start = writeHead % WRITE_BUFFER_SIZE;
+    qint64 first = qMin(length, WRITE_BUFFER_SIZE - start);
+
+    // data() doesn't reallocate, the buffer isn't shared
+    memcpy(writeBuffer.data() + start, data, first);
+    memcpy(writeBuffer.data(), data + first, length - first);
+
+    writeHead += length;
 }
 
-qint64 LogFile::bytesAvailable() const
+/**
+ * Copy out of the write buffer, wrapping around its end.
+ * @param pos Total bytes buffered before the data
+ */
+void LogFile::readWriteBuffer(qint64 pos, char *data, qint64 length) const
 {
-    return dataBuffer.size();
+    qint64 start = pos % WRITE_BUFFER_SIZE;
+    qint64 first = qMin(length, WRITE_BUFFER_SIZE - start);
+
+    memcpy(data, writeBuffer.constData() + start, first);
+    memcpy(data + first, writeBuffer.constData(), length - first);
 }
 
-void LogFile::timerFired()
+/**
+ * Index the records between tail and head of the write buffer, which
+ * only ever holds whole records. Called by the writer as it writes them
+ * out, so the index file is never written from writeData().
+ */
+void LogFile::indexWriteBuffer(qint64 tail, qint64 head)
 {
-    qint64 dataSize;
+    while (tail < head)
+    {
+        quint32 timestamp;
+        qint64 size;
+        readWriteBuffer(tail, (char *) &timestamp, sizeof(timestamp));
+        readWriteBuffer(tail + sizeof(timestamp), (char *) &size, sizeof(size));
+
+        // The object ID follows sync, type and length in the UAVTalk header
+        quint32 objId = 0;
+        if (size >= 8)
+        {
+            readWriteBuffer(tail + RECORD_HEADER_LENGTH + 4, (char *) &objId, sizeof(objId));
+            objId = qFromLittleEndian(objId);
+        }
+
+        indexRecord(timestamp, dataStart + tail, objId);
+        tail += RECORD_HEADER_LENGTH + size;
+    }
+}
 
-    if(file.bytesAvailable() > 4)
+void LogWriterThread::run()
+{
+    log->writerLoop();
+}
+
+/**
+ * Write out and index buffered records until the log is closed. The
+ * writer only reads between writeTail and writeHead, which writeData()
+ * leaves alone, and is the only user of the index while logging.
+ */
+void LogFile::writerLoop()
+{
+    QElapsedTimer sinceSync;
+    sinceSync.start();
+
+    QMutexLocker locker(&writeLock);
+
+    while (true)
     {
+        if (!writerStop && writeHead - writeTail < WRITE_BLOCK_SIZE)
+            writeWake.wait(&writeLock, FLUSH_INTERVAL_MS);
 
-        int time;
-        time = myTime.elapsed();
+        qint64 head = writeHead;
+        qint64 tail = writeTail;
+        bool stop = writerStop;
+        const char *buffer = writeBuffer.constData();
 
-        //Read packets
-        while ((lastPlayTime + ((time - lastPlayTimeOffset)* playbackSpeed) > (lastTimeStamp-firstTimestamp)))
+        if (head == tail)
         {
-            lastPlayTime += ((time - lastPlayTimeOffset)* playbackSpeed);
-            if(file.bytesAvailable() < 4) {
-                stopReplay();
-                return;
-            }
+            if (stop)
+                break;
+            continue;
+        }
 
-            file.seek(lastTimeStampPos+sizeof(lastTimeStamp));
+        locker.unlock();
 
-            file.read((char *) &dataSize, sizeof(dataSize));
+        QElapsedTimer flushTime;
+        flushTime.start();
 
-            if (dataSize<1 || dataSize>(1024*1024)) {
-                qDebug() << "Error: Logfile corrupted! Unlikely packet size: " << dataSize << "\n";
-                stopReplay();
-                return;
-            }
-            if(file.bytesAvailable() < dataSize) {
-                stopReplay();
-                return;
-            }
+        qint64 start = tail % WRITE_BUFFER_SIZE;
+        qint64 length = head - tail;
+        qint64 first = qMin(length, WRITE_BUFFER_SIZE - start);
 
-            mutex.lock();
-            dataBuffer.append(file.read(dataSize));
-            mutex.unlock();
-            emit readyRead();
+        file.write(buffer + start, first);
+        if (length > first)
+            file.write(buffer, length - first);
+        file.flush();
 
-            if(file.bytesAvailable() < 4) {
-                stopReplay();
-                return;
-            }
+        indexWriteBuffer(tail, head);
+        if (indexFile.isOpen())
+            indexFile.flush();
 
-            lastTimeStampPos = timestampPos[timestampBufferIdx];
-            lastTimeStamp = timestampBuffer[timestampBufferIdx];
-            timestampBufferIdx++;
+        if (stop || sinceSync.elapsed() >= SYNC_INTERVAL_MS)
+        {
+            syncFile();
+            sinceSync.restart();
+        }
 
-            lastPlayTimeOffset = time;
-            time = myTime.elapsed();
+        quint32 elapsed = flushTime.elapsed();
 
-        }
-    } else {
-        stopReplay();
+        locker.relock();
+
+        writeTail = head;
+        writeStats.bytesWritten += length;
+        writeStats.flushes++;
+        writeStats.lastFlushMs = elapsed;
+        writeStats.maxFlushMs = qMax(writeStats.maxFlushMs, elapsed);
     }
+}
 
+/**
+ * Get the log to disk, so that little is lost if the machine goes down
+ */
+void LogFile::syncFile()
+{
+#ifdef Q_OS_WIN
+    _commit(file.handle());
+#else
+    fsync(file.handle());
+#endif
 }
 
-bool LogFile::startReplay() {
-    dataBuffer.clear();
-    myTime.restart();
-    lastPlayTimeOffset = 0;
-    lastPlayTime = 0;
-    playbackSpeed = 1;
+LogFile::WriteStats LogFile::getWriteStats()
+{
+    QMutexLocker locker(&writeLock);
 
-    //Read all log timestamps into array
-    timestampBuffer.clear(); //Save beginning of log for later use
-    timestampPos.clear();
-    quint64 logFileStartIdx = file.pos();
-    timestampBufferIdx = 0;
-    lastTimeStamp = 0;
+    WriteStats stats = writeStats;
+    stats.bufferedBytes = writeHead - writeTail;
+    return stats;
+}
 
-    while (!file.atEnd()){
-        qint64 dataSize;
+qint64 LogFile::readData(char * data, qint64 maxSize) {
+    QMutexLocker locker(&mutex);
+    qint64 toRead = qMin(maxSize,(qint64)dataBuffer.size());
+    memcpy(data,dataBuffer.data(),toRead);
+    dataBuffer.remove(0,toRead);
+    return toRead;
+}
 
-        //Get time stamp position
-        timestampPos.append(file.pos());
+qint64 LogFile::bytesAvailable() const
+{
+    return dataBuffer.size();
+}
 
-        //Read timestamp and logfile packet size
-        file.read((char *) &lastTimeStamp, sizeof(lastTimeStamp));
-        file.read((char *) &dataSize, sizeof(dataSize));
+void LogFile::timerFired()
+{
+    int time = myTime.elapsed();
+    lastPlayTime += (time - lastPlayTimeOffset) * playbackSpeed;
+    lastPlayTimeOffset = time;
+
+    // Pass on every packet that is due
+    QByteArray packets;
+    quint32 timestamp;
+    qint64 size;
+    qint64 pos;
+    while ((pos = nextRecord(replayPos, &timestamp, &size)) >= 0 &&
+           (qint64) timestamp - firstTimestamp <= lastPlayTime)
+    {
+        packets.append((const char *) &logData[pos + RECORD_HEADER_LENGTH], size);
+        lastTimeStamp = timestamp;
+        replayPos = pos + RECORD_HEADER_LENGTH + size;
+    }
 
-        //Check if dataSize sync bytes are correct.
-        //TODO: LIKELY AS NOT, THIS WILL FAIL TO RESYNC BECAUSE THERE IS TOO LITTLE INFORMATION IN THE STRING OF SIX 0x00
-        if ((dataSize & 0xFFFFFFFFFFFF0000)!=0){
-            qDebug() << "Wrong sync byte. At file location 0x"  << QString("%1").arg(file.pos(),0,16) << "Got 0x" << QString("%1").arg(dataSize & 0xFFFFFFFFFFFF0000,0,16) << ", but expected 0x""00"".";
-            file.seek(timestampPos.last()+1);
-            timestampPos.pop_back();
-            continue;
-        }
+    if (!packets.isEmpty())
+    {
+        mutex.lock();
+        dataBuffer.append(packets);
+        mutex.unlock();
+        emit readyRead();
+    }
 
-        //Check if timestamps are sequential.
-        if (!timestampBuffer.isEmpty() && lastTimeStamp < timestampBuffer.last()){
-            QMessageBox msgBox;
-            msgBox.setText("Corrupted file.");
-            msgBox.setInformativeText("Timestamps are not sequential. Playback may have unexpected behavior"); //<--TODO: add hyperlink to webpage with better description.
-            msgBox.exec();
+    if (pos < 0)
+        stopReplay();
+}
 
-            qDebug() << "Timestamp: " << timestampBuffer.last() << " " << lastTimeStamp;
-        }
+bool LogFile::startReplay() {
+    dataBuffer.clear();
+    myTime.restart();
+    lastPlayTimeOffset = 0;
+    lastPlayTime = 0;
+    playbackSpeed = 1;
 
-        timestampBuffer.append(lastTimeStamp);
+    // Map the log instead of reading it in, if we can
+    logSize = file.size();
+    logData = file.map(0, logSize);
+    if (logData == NULL)
+    {
+        file.seek(0);
+        unmappedData = file.readAll();
+        logData = (const uchar *) unmappedData.constData();
+        logSize = unmappedData.size();
+    }
 
-        file.seek(timestampPos.last()+sizeof(lastTimeStamp)+sizeof(dataSize)+dataSize);
+    recordCount = 0;
+    latestOffsets.clear();
+    if (!loadIndex())
+    {
+        timeIndex.clear();
+        checkpoints.clear();
+        buildIndex();
     }
 
     //Check if any timestamps were successfully read
-    if (timestampBuffer.size() == 0){
+    qint64 size;
+    replayPos = nextRecord(dataStart, &firstTimestamp, &size);
+    if (replayPos < 0){
         QMessageBox msgBox;
         msgBox.setText("Empty logfile.");
         msgBox.setInformativeText("No log data can be found.");
@@ -289,12 +462,7 @@ bool LogFile::startReplay() {
         return false;
     }
 
-    //Reset to log beginning.
-    file.seek(logFileStartIdx+sizeof(lastTimeStamp));
-    lastTimeStampPos = timestampPos[0];
-    lastTimeStamp = timestampBuffer[0];
-    firstTimestamp = timestampBuffer[0];
-    timestampBufferIdx = 1;
+    lastTimeStamp = firstTimestamp;
 
     timer.setInterval(10);
     timer.start();
@@ -325,17 +493,266 @@ void LogFile::resumeReplay()
  */
 void LogFile::setReplayTime(double val)
 {
-    quint32 tmpIdx=0;
-    while(timestampBuffer[tmpIdx++] <= val*1000 && tmpIdx <= timestampBufferIdx){
-    }
+    quint32 target = firstTimestamp + qMax(val, 0.0) * 1000;
+
+    // Start from the last indexed record before the target, and walk
+    // forward to the first record at or after it
+    QVector<IndexEntry>::const_iterator iter = std::lower_bound(timeIndex.constBegin(), timeIndex.constEnd(), target,
+            [](const IndexEntry &entry, quint32 timestamp) { return entry.timestamp < timestamp; });
+    qint64 pos = (iter == timeIndex.constBegin()) ? dataStart : (iter - 1)->offset;
 
-    lastTimeStampPos=timestampPos[tmpIdx];
-    lastTimeStamp=timestampBuffer[tmpIdx];
-    timestampBufferIdx=tmpIdx;
+    quint32 timestamp;
+    qint64 size;
+    while ((pos = nextRecord(pos, &timestamp, &size)) >= 0 && timestamp < target)
+        pos += RECORD_HEADER_LENGTH + size;
 
+    if (pos < 0)
+        pos = logSize;
+
+    restoreObjects(pos);
+
+    replayPos = pos;
+    lastTimeStamp = target;
     lastPlayTimeOffset = myTime.elapsed();
-    lastPlayTime=lastTimeStamp;
+    lastPlayTime = target - firstTimestamp;
 
     qDebug() << "Replaying at: " << lastTimeStamp << ", but requestion at" << val*1000;
 }
 
+/**
+ * Pass on the latest packet of every object before a seek point, so that
+ * objects which rarely change (settings in particular) are up to date.
+ * @param offset The seek point
+ */
+void LogFile::restoreObjects(qint64 offset)
+{
+    QHash<quint32, qint64> latest;
+    qint64 pos = dataStart;
+
+    QVector<Checkpoint>::const_iterator checkpoint = std::upper_bound(checkpoints.constBegin(), checkpoints.constEnd(), offset,
+            [](qint64 seekOffset, const Checkpoint &entry) { return seekOffset < entry.offset; });
+    if (checkpoint != checkpoints.constBegin())
+    {
+        --checkpoint;
+        latest = checkpoint->latest;
+        pos = checkpoint->offset;
+    }
+
+    quint32 timestamp;
+    qint64 size;
+    while ((pos = nextRecord(pos, &timestamp, &size)) >= 0 && pos < offset)
+    {
+        latest.insert(recordObjId(pos, size), pos);
+        pos += RECORD_HEADER_LENGTH + size;
+    }
+
+    // In log order, so e.g. metadata stays ahead of what it applies to
+    QList<qint64> offsets = latest.values();
+    std::sort(offsets.begin(), offsets.end());
+
+    QByteArray packets;
+    foreach (qint64 recordOffset, offsets)
+    {
+        if (nextRecord(recordOffset, &timestamp, &size) == recordOffset)
+            packets.append((const char *) &logData[recordOffset + RECORD_HEADER_LENGTH], size);
+    }
+
+    if (!packets.isEmpty())
+    {
+        mutex.lock();
+        dataBuffer.append(packets);
+        mutex.unlock();
+        emit readyRead();
+    }
+}
+
+/**
+ * Find the next well-formed record, skipping a byte at a time past
+ * anything that isn't one.
+ * @param offset Where to start looking
+ * @param timestamp Set to the record's timestamp
+ * @param size Set to the record's packet size
+ * @return Offset of the record, or -1 if there are no more
+ */
+qint64 LogFile::nextRecord(qint64 offset, quint32 *timestamp, qint64 *size) const
+{
+    for (; offset >= 0 && offset + RECORD_HEADER_LENGTH <= logSize; offset++)
+    {
+        qint64 dataSize;
+        memcpy(timestamp, &logData[offset], sizeof(*timestamp));
+        memcpy(&dataSize, &logData[offset + sizeof(*timestamp)], sizeof(dataSize));
+
+        if (dataSize >= 1 && dataSize <= MAX_RECORD_SIZE &&
+                offset + RECORD_HEADER_LENGTH + dataSize <= logSize)
+        {
+            *size = dataSize;
+            return offset;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @return The object ID of the UAVTalk packet in a record, or 0 if it is
+ * too short to have one
+ */
+quint32 LogFile::recordObjId(qint64 offset, qint64 size) const
+{
+    if (size < 8)
+        return 0;
+
+    return qFromLittleEndian<quint32>(&logData[offset + RECORD_HEADER_LENGTH + 4]);
+}
+
+/**
+ * Add a record to the index, and to the sidecar index file if it is open.
+ * @param timestamp The record's timestamp
+ * @param offset The record's offset in the log
+ * @param objId The object ID of the record's packet
+ */
+void LogFile::indexRecord(quint32 timestamp, qint64 offset, quint32 objId)
+{
+    // Checkpoint the latest record of each object before this one
+    if (checkpoints.isEmpty() || timestamp - checkpoints.last().timestamp >= CHECKPOINT_INTERVAL_MS)
+    {
+        Checkpoint checkpoint;
+        checkpoint.timestamp = timestamp;
+        checkpoint.offset = offset;
+        checkpoint.latest = latestOffsets;
+        checkpoints.append(checkpoint);
+
+        if (indexFile.isOpen())
+        {
+            indexStream << INDEX_CHECKPOINT << timestamp << offset << (quint32) latestOffsets.size();
+            for (QHash<quint32, qint64>::const_iterator iter = latestOffsets.constBegin(); iter != latestOffsets.constEnd(); ++iter)
+                indexStream << iter.key() << iter.value();
+        }
+    }
+
+    if (recordCount % INDEX_INTERVAL == 0)
+    {
+        IndexEntry entry;
+        entry.timestamp = timestamp;
+        entry.offset = offset;
+        timeIndex.append(entry);
+
+        if (indexFile.isOpen())
+            indexStream << INDEX_RECORD << timestamp << offset;
+    }
+
+    latestOffsets.insert(objId, offset);
+    recordCount++;
+}
+
+void LogFile::writeIndexHeader()
+{
+    indexStream.setDevice(&indexFile);
+    indexStream.setByteOrder(QDataStream::LittleEndian);
+    indexStream << INDEX_MAGIC << dataStart;
+}
+
+/**
+ * Read the sidecar index of the log being replayed. An index cut short
+ * (e.g. by a crash while logging) is used as far as it goes.
+ * @return true if an index was found
+ */
+bool LogFile::loadIndex()
+{
+    QFile idx(file.fileName() + ".idx");
+    if (!idx.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&idx);
+    in.setByteOrder(QDataStream::LittleEndian);
+
+    quint32 magic;
+    qint64 start;
+    in >> magic >> start;
+    if (in.status() != QDataStream::Ok || magic != INDEX_MAGIC || start != dataStart)
+        return false;
+
+    qint64 lastOffset = dataStart;
+    bool valid = true;
+    while (valid && !in.atEnd())
+    {
+        quint8 type;
+        quint32 timestamp;
+        qint64 offset;
+        in >> type >> timestamp >> offset;
+        if (in.status() != QDataStream::Ok || offset < lastOffset || offset >= logSize)
+            break;
+
+        if (type == INDEX_RECORD)
+        {
+            IndexEntry entry;
+            entry.timestamp = timestamp;
+            entry.offset = offset;
+            timeIndex.append(entry);
+        }
+        else if (type == INDEX_CHECKPOINT)
+        {
+            Checkpoint checkpoint;
+            checkpoint.timestamp = timestamp;
+            checkpoint.offset = offset;
+
+            quint32 count;
+            in >> count;
+            for (quint32 i = 0; valid && i < count; i++)
+            {
+                quint32 objId;
+                qint64 objOffset;
+                in >> objId >> objOffset;
+                valid = in.status() == QDataStream::Ok && objOffset < offset;
+                checkpoint.latest.insert(objId, objOffset);
+            }
+
+            if (valid)
+                checkpoints.append(checkpoint);
+        }
+        else
+        {
+            break;
+        }
+
+        lastOffset = offset;
+    }
+
+    return !timeIndex.isEmpty();
+}
+
+/**
+ * Index a log that has no sidecar index (e.g. one from before they were
+ * written) by walking its records, and write the index out for next time.
+ */
+void LogFile::buildIndex()
+{
+    indexFile.setFileName(file.fileName() + ".idx");
+    if (indexFile.open(QIODevice::WriteOnly))
+        writeIndexHeader();
+
+    bool warned = false;
+    quint32 lastTimestamp = 0;
+    quint32 timestamp;
+    qint64 size;
+    qint64 pos = dataStart;
+    while ((pos = nextRecord(pos, &timestamp, &size)) >= 0)
+    {
+        //Check if timestamps are sequential.
+        if (recordCount > 0 && timestamp < lastTimestamp && !warned){
+            QMessageBox msgBox;
+            msgBox.setText("Corrupted file.");
+            msgBox.setInformativeText("Timestamps are not sequential. Playback may have unexpected behavior"); //<--TODO: add hyperlink to webpage with better description.
+            msgBox.exec();
+
+            qDebug() << "Timestamp: " << lastTimestamp << " " << timestamp;
+            warned = true;
+        }
+
+        indexRecord(timestamp, pos, recordObjId(pos, size));
+        lastTimestamp = timestamp;
+        pos += RECORD_HEADER_LENGTH + size;
+    }
+
+    indexFile.close();
+}
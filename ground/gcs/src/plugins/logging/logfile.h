@@ -33,16 +33,50 @@
 #include <QMutexLocker>
 #include <QDebug>
 #include <QBuffer>
+#include <QDataStream>
+#include <QHash>
+#include <QVector>
+#include <QThread>
+#include <QWaitCondition>
 #include "uavobjectmanager.h"
 #include <math.h>
 
+class LogFile;
+
+/**
+ * Writes the buffered records of a LogFile out to disk, so that callers
+ * of LogFile::writeData() never wait on the file.
+ */
+class LogWriterThread : public QThread
+{
+public:
+    explicit LogWriterThread(LogFile *log) : log(log) {}
+
+protected:
+    void run();
+
+private:
+    LogFile *log;
+};
+
 class LogFile : public QIODevice
 {
     Q_OBJECT
+    friend class LogWriterThread;
 public:
+    typedef struct {
+        quint64 bytesWritten;
+        quint32 droppedPackets; /** Records that didn't fit in the buffer */
+        quint32 flushes;
+        quint32 lastFlushMs;
+        quint32 maxFlushMs;
+        quint32 bufferedBytes;
+    } WriteStats;
+
     explicit LogFile(QObject *parent = 0);
     qint64 bytesAvailable() const;
-    qint64 bytesToWrite() const { return file.bytesToWrite(); }
+    // Records are buffered, and dropped if the buffer is full
+    qint64 bytesToWrite() const { return 0; }
     bool open(OpenMode mode);
     void setFileName(QString name) { file.setFileName(name); }
     void close();
@@ -52,6 +86,8 @@ public:
     bool startReplay();
     bool stopReplay();
 
+    WriteStats getWriteStats();
+
 public slots:
     void setReplaySpeed(double val) { playbackSpeed = val; qDebug() << "New playback speed: " << playbackSpeed; }
     void setReplayTime(double val);
@@ -72,7 +108,7 @@ protected:
     QTime myTime;
     QFile file;
     quint32 lastTimeStamp;
-    quint32 lastPlayTime;
+    double lastPlayTime;
     QMutex mutex;
 
 
@@ -80,10 +116,71 @@ protected:
     double playbackSpeed;
 
 private:
-    QList<quint32> timestampBuffer;
-    QList<quint32> timestampPos;
-    quint32 timestampBufferIdx;
-    quint32 lastTimeStampPos;
+    /* Records are a timestamp, a size and a UAVTalk packet. A sidecar
+     * <log>.idx lists the offset of every INDEX_INTERVAL'th record, and
+     * every CHECKPOINT_INTERVAL_MS the offset of each object's latest
+     * record, so replay can seek without reading the whole log. */
+    static const quint32 INDEX_MAGIC = 0x3158444c; // "LDX1"
+    static const quint8 INDEX_RECORD = 'R';
+    static const quint8 INDEX_CHECKPOINT = 'C';
+    static const int INDEX_INTERVAL = 64;
+    static const quint32 CHECKPOINT_INTERVAL_MS = 10000;
+    static const int RECORD_HEADER_LENGTH = sizeof(quint32) + sizeof(qint64);
+    static const qint64 MAX_RECORD_SIZE = 1024 * 1024;
+
+    /* Records are packed into a ring buffer and written out and indexed
+     * by the writer thread once WRITE_BLOCK_SIZE is pending or every
+     * FLUSH_INTERVAL_MS, and synced to disk every SYNC_INTERVAL_MS. */
+    static const int WRITE_BUFFER_SIZE = 4 * 1024 * 1024;
+    static const int WRITE_BLOCK_SIZE = 64 * 1024;
+    static const unsigned long FLUSH_INTERVAL_MS = 500;
+    static const int SYNC_INTERVAL_MS = 5000;
+
+    typedef struct {
+        quint32 timestamp;
+        qint64 offset;
+    } IndexEntry;
+
+    typedef struct {
+        quint32 timestamp;
+        qint64 offset;
+        QHash<quint32, qint64> latest; /** Keyed by object ID */
+    } Checkpoint;
+
+    void indexRecord(quint32 timestamp, qint64 offset, quint32 objId);
+    void writeIndexHeader();
+    bool loadIndex();
+    void buildIndex();
+    qint64 nextRecord(qint64 offset, quint32 *timestamp, qint64 *size) const;
+    quint32 recordObjId(qint64 offset, qint64 size) const;
+    void restoreObjects(qint64 offset);
+    void appendToWriteBuffer(const char *data, qint64 length);
+    void readWriteBuffer(qint64 pos, char *data, qint64 length) const;
+    void indexWriteBuffer(qint64 tail, qint64 head);
+    void writerLoop();
+    void syncFile();
+
+    QFile indexFile;
+    QDataStream indexStream;
+    qint64 dataStart;
+    quint32 recordCount;
+    QHash<quint32, qint64> latestOffsets;
+
+    LogWriterThread writer;
+    QMutex writeLock;
+    QWaitCondition writeWake;
+    QByteArray writeBuffer;
+    qint64 writeHead; /** Total bytes buffered, written at writeHead % WRITE_BUFFER_SIZE */
+    qint64 writeTail; /** Total bytes written out */
+    bool writerStop;
+    WriteStats writeStats;
+
+    const uchar *logData;
+    qint64 logSize;
+    QByteArray unmappedData;
+    QVector<IndexEntry> timeIndex;
+    QVector<Checkpoint> checkpoints;
+    qint64 replayPos;
     quint32 firstTimestamp;
 };
 
@@ -42,6 +42,7 @@ LoggingGadgetWidget::LoggingGadgetWidget(QWidget *parent) : QLabel(parent)
     ExtensionSystem::PluginManager *pm = ExtensionSystem::PluginManager::instance();
     scpPlugin = pm->getObject<ScopeGadgetFactory>();
 
+    connect(&writeStatsTimer, SIGNAL(timeout()), this, SLOT(updateWriteStats()));
 }
 
 LoggingGadgetWidget::~LoggingGadgetWidget()
@@ -66,6 +67,33 @@ void LoggingGadgetWidget::setPlugin(LoggingPlugin * p)
 void LoggingGadgetWidget::stateChanged(QString status)
 {
     m_logging->statusLabel->setText(status);
+
+    if (status == "LOGGING")
+        writeStatsTimer.start(1000);
+    else
+        writeStatsTimer.stop();
+    updateWriteStats();
+}
+
+/**
+  * Show how the log is keeping up with the telemetry
+  */
+void LoggingGadgetWidget::updateWriteStats()
+{
+    LogFile::WriteStats stats;
+
+    if (!loggingPlugin->getWriteStats(&stats))
+    {
+        m_logging->writeStatsLabel->setText("-");
+        return;
+    }
+
+    m_logging->writeStatsLabel->setText(tr("%1 kB, %2 dropped, flush %3 ms (max %4 ms), %5 kB buffered")
+                                        .arg(stats.bytesWritten / 1024)
+                                        .arg(stats.droppedPackets)
+                                        .arg(stats.lastFlushMs)
+                                        .arg(stats.maxFlushMs)
+                                        .arg(stats.bufferedBytes / 1024));
 }
 
 /**
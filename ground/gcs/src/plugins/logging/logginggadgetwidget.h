@@ -28,6 +28,7 @@
 #define LoggingGADGETWIDGET_H_
 
 #include <QLabel>
+#include <QTimer>
 #include "extensionsystem/pluginmanager.h"
 #include "scope/scopeplugin.h"
 #include "scope/scopegadgetfactory.h"
@@ -47,6 +48,7 @@ public:
 
 protected slots:
     void stateChanged(QString status);
+    void updateWriteStats();
 
 signals:
     void pause();
@@ -56,6 +58,7 @@ private:
     Ui_Logging *m_logging;
     LoggingPlugin * loggingPlugin;
     ScopeGadgetFactory * scpPlugin;
+    QTimer writeStatsTimer;
 
 
 };
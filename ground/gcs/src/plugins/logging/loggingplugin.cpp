@@ -455,6 +455,19 @@ void LoggingPlugin::loggingStopped()
     loggingThread = NULL;
 }
 
+/**
+  * Get the statistics of the log being written
+  * @return false if not logging
+  */
+bool LoggingPlugin::getWriteStats(LogFile::WriteStats *stats)
+{
+    if (state != LOGGING || loggingThread == NULL)
+        return false;
+
+    *stats = loggingThread->getWriteStats();
+    return true;
+}
+
 /**
   * Received the replay stopped signal from the LogFile
   */
@@ -88,6 +88,7 @@ Q_OBJECT
 public:
     ~LoggingThread();
     bool openFile(QString file, LoggingPlugin * parent);
+    LogFile::WriteStats getWriteStats() { return logFile.getWriteStats(); }
 
 private slots:
     void objectUpdated(UAVObject * obj);
@@ -126,6 +127,7 @@ public:
     LoggingConnection* getLogConnection() { return logConnection; }
     LogFile* getLogfile() { return logConnection->getLogfile();}
     void setLogMenuTitle(QString str);
+    bool getWriteStats(LogFile::WriteStats *stats);
 
 
 signals:
@@ -58,8 +58,6 @@ Plot2dData::Plot2dData(QString p_uavObject, QString p_uavFieldName):
         haveSubField = false;
     }
 
-    xData = new QVector<double>();
-    yData = new QVector<double>();
     yDataHistory = new QVector<double>();
 
     scalePower = 0;
@@ -97,8 +95,6 @@ Plot3dData::Plot3dData(QString p_uavObject, QString p_uavFieldName):
         haveSubField = false;
     }
 
-    xData = new QVector<double>();
-    yData = new QVector<double>();
     zData = new QVector<double>();
     zDataHistory = new QVector<double>();
     timeDataHistory = new QVector<double>();
@@ -119,10 +115,6 @@ Plot3dData::Plot3dData(QString p_uavObject, QString p_uavFieldName):
 
 Plot2dData::~Plot2dData()
 {
-    if (xData != NULL)
-        delete xData;
-    if (yData != NULL)
-        delete yData;
     if (yDataHistory != NULL)
         delete yDataHistory;
 }
@@ -130,10 +122,6 @@ Plot2dData::~Plot2dData()
 
 Plot3dData::~Plot3dData()
 {
-    if (xData != NULL)
-        delete xData;
-    if (yData != NULL)
-        delete yData;
     if (zData != NULL)
         delete zData;
     if (zDataHistory != NULL)
@@ -143,24 +131,47 @@ Plot3dData::~Plot3dData()
 }
 
 
+PlotData::PlotData() :
+    plottedObjectIdKnown(false),
+    plottedObjectId(0),
+    plottedObject(NULL),
+    plottedFieldPtr(NULL)
+{
+}
+
+
 /**
- * @brief valueAsDouble Fetch the value from the UAVO and return it as a double
+ * @brief plottedField Find the plotted field in a received UAVO. The
+ * object ID, field and element are looked up once and cached, so this is
+ * cheap enough to call for every received object.
  * @param obj UAVO
- * @param field UAVO field
- * @param haveSubField TRUE if UAVO has subfield. FALSE if not.
- * @param uavSubFieldName UAVO subfield, if it exists
- * @return
+ * @return The plotted field, or NULL if obj is not the plotted UAVO
  */
-double PlotData::valueAsDouble(UAVObject* obj, UAVObjectField* field, bool haveSubField, QString uavSubFieldName)
+UAVObjectField *PlotData::plottedField(UAVObject *obj)
 {
-    Q_UNUSED(obj);
-    QVariant value;
+    if (obj == plottedObject)
+        return plottedFieldPtr;
+
+    if (plottedObjectIdKnown) {
+        if (obj->getObjID() != plottedObjectId)
+            return NULL;
+    } else {
+        if (uavObjectName != obj->getName())
+            return NULL;
+        plottedObjectId = obj->getObjID();
+        plottedObjectIdKnown = true;
+    }
+
+    // A new instance of the plotted object, resolve the field on it
+    plottedObject = obj;
+    plottedFieldPtr = obj->getField(uavFieldName);
+    plottedReader = UAVObjectFieldReader();
 
-    if(haveSubField){
-        int indexOfSubField = field->getElementNames().indexOf(QRegExp(uavSubFieldName, Qt::CaseSensitive, QRegExp::FixedString));
-        value = field->getValue(indexOfSubField);
-    }else
-        value = field->getValue();
+    if (plottedFieldPtr) {
+        int index = haveSubField ? plottedFieldPtr->getElementNames().indexOf(uavSubFieldName) : 0;
+        if (index >= 0)
+            plottedReader = plottedFieldPtr->reader(index);
+    }
 
-    return value.toDouble();
+    return plottedFieldPtr;
 }
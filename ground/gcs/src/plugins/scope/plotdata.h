@@ -32,6 +32,7 @@ class ScopeGadgetWidget;
 class ScopeConfig;
 
 #include "uavobject.h"
+#include "uavobjectfield.h"
 
 #include "qwt/src/qwt_color_map.h"
 #include "qwt/src/qwt_scale_widget.h"
@@ -45,7 +46,11 @@ class PlotData : public QObject
 {
     Q_OBJECT
 public:
-    double valueAsDouble(UAVObject* obj, UAVObjectField* field, bool haveSubField, QString uavSubFieldName);
+    PlotData();
+
+    UAVObjectField *plottedField(UAVObject *obj);
+    //! Current value of the plotted element, valid after plottedField() found it
+    double plottedValue() const {return plottedReader.toDouble();}
 
     //Setter functions
     void setXMinimum(double val){xMinimum=val;}
@@ -73,9 +78,6 @@ public:
     int getMeanSamples(){return meanSamples;}
     QString getMathFunction(){return mathFunction;}
 
-    QVector<double>* getXData(){return xData;}
-    QVector<double>* getYData(){return yData;}
-
     virtual bool append(UAVObject* obj) = 0;
     virtual void removeStaleData() = 0;
     virtual void setUpdatedFlagToTrue() = 0;
@@ -87,9 +89,6 @@ public:
     QwtScaleWidget *rightAxis;
 
 protected:
-    QVector<double>* xData;    //Data vector for plots
-    QVector<double>* yData;    //Used vector for plots
-
     double m_xWindowSize;
     double xMinimum;
     double xMaximum;
@@ -110,7 +109,12 @@ protected:
     int correctionCount;
 
 private:
-
+    //! Cached lookup of the plotted object, field and element
+    bool plottedObjectIdKnown;
+    quint32 plottedObjectId;
+    UAVObject *plottedObject;
+    UAVObjectField *plottedFieldPtr;
+    UAVObjectFieldReader plottedReader;
 };
 
 /**
@@ -125,6 +125,7 @@ QWidget* ScopeGadgetOptionsPage::createPage(QWidget *parent)
 
     options_page->mathFunctionComboBox->addItems(mathFunctions);
     options_page->cmbMathFunctionSpectrogram->addItems(mathFunctions);
+    options_page->cmbMathFunctionSpectrogram->addItems(QStringList() << "FFT (Welch)" << "FFT (dB)");
 
     // Check that an index is currently selected, and update if true
     if(options_page->cmbUAVObjects->currentIndex() >= 0){
@@ -78,8 +78,10 @@ void HistogramData::plotNewData(PlotData* plot2dData, ScopeConfig *scopeConfig,
     Q_UNUSED(scopeConfig);
 
     //Plot new data
-    histogram->setData(intervalSeriesData);
-    intervalSeriesData->setSamples(*histogramBins);
+    if (readAndResetUpdatedFlag() == true) {
+        histogram->setData(intervalSeriesData);
+        intervalSeriesData->setSamples(*histogramBins);
+    }
 }
 
 
@@ -90,84 +92,75 @@ void HistogramData::plotNewData(PlotData* plot2dData, ScopeConfig *scopeConfig,
  */
 bool HistogramData::append(UAVObject* obj)
 {
+    //Get the field of interest
+    UAVObjectField* field = plottedField(obj);
+
+    //Bad place to do this
+    double step = binWidth;
+    if (step < 1e-6) //Don't allow step size to be 0.
+        step =1e-6;
+
+    if (numberOfBins > MAX_NUMBER_OF_INTERVALS)
+        numberOfBins = MAX_NUMBER_OF_INTERVALS;
+
+    if (field) {
+        double currentValue = plottedValue() * pow(10, scalePower);
+
+        // Extend interval, if necessary
+        if(!histogramInterval->empty()){
+            while (currentValue < histogramInterval->front().minValue()
+                   && histogramInterval->size() <= (int) numberOfBins){
+                histogramInterval->prepend(QwtInterval(histogramInterval->front().minValue() - step, histogramInterval->front().minValue()));
+                histogramBins->prepend(QwtIntervalSample(0,histogramInterval->front()));
+            }
 
-    //Empty histogram data set
-    xData->clear();
-    yData->clear();
-
-    if (uavObjectName == obj->getName()) {
-
-        //Get the field of interest
-        UAVObjectField* field =  obj->getField(uavFieldName);
-
-        //Bad place to do this
-        double step = binWidth;
-        if (step < 1e-6) //Don't allow step size to be 0.
-            step =1e-6;
-
-        if (numberOfBins > MAX_NUMBER_OF_INTERVALS)
-            numberOfBins = MAX_NUMBER_OF_INTERVALS;
-
-        if (field) {
-            double currentValue = valueAsDouble(obj, field, haveSubField, uavSubFieldName) * pow(10, scalePower);
-
-            // Extend interval, if necessary
-            if(!histogramInterval->empty()){
-                while (currentValue < histogramInterval->front().minValue()
-                       && histogramInterval->size() <= (int) numberOfBins){
-                    histogramInterval->prepend(QwtInterval(histogramInterval->front().minValue() - step, histogramInterval->front().minValue()));
-                    histogramBins->prepend(QwtIntervalSample(0,histogramInterval->front()));
-                }
+            while (currentValue > histogramInterval->back().maxValue()
+                   && histogramInterval->size() <= (int) numberOfBins){
+                histogramInterval->append(QwtInterval(histogramInterval->back().maxValue(), histogramInterval->back().maxValue() + step));
+                histogramBins->append(QwtIntervalSample(0,histogramInterval->back()));
+            }
 
-                while (currentValue > histogramInterval->back().maxValue()
-                       && histogramInterval->size() <= (int) numberOfBins){
-                    histogramInterval->append(QwtInterval(histogramInterval->back().maxValue(), histogramInterval->back().maxValue() + step));
-                    histogramBins->append(QwtIntervalSample(0,histogramInterval->back()));
-                }
+            // If the histogram reaches its max size, pop one off the end and return
+            // This is a graceful way not to lock up the GCS if the bin width
+            // is inappropriate, or if there is an extremely distant outlier.
+            if (histogramInterval->size() > (int) numberOfBins )
+            {
+                histogramBins->pop_back();
+                histogramInterval->pop_back();
+                return false;
+            }
 
-                // If the histogram reaches its max size, pop one off the end and return
-                // This is a graceful way not to lock up the GCS if the bin width
-                // is inappropriate, or if there is an extremely distant outlier.
-                if (histogramInterval->size() > (int) numberOfBins )
-                {
-                    histogramBins->pop_back();
-                    histogramInterval->pop_back();
-                    return false;
+            // All intervals are one step wide, so index the bin directly. Check
+            // the neighbours too, as rounding can put the value just across an edge.
+            int bin = (int) floor((currentValue - histogramInterval->front().minValue()) / step);
+            for (int i = qMax(bin - 1, 0); i <= qMin(bin + 1, histogramInterval->size() - 1); i++) {
+                if(histogramInterval->at(i).contains(currentValue)){
+                    (*histogramBins)[i].value += 1;
+                    break;
                 }
-
-                // Test all intervals. This isn't particularly effecient, especially if we have just
-                // extended the interval and thus know for sure that the point lies on the extremity.
-                // On top of that, some kind of search by bisection would be better.
-                for (int i=0; i < histogramInterval->size(); i++ ){
-                    if(histogramInterval->at(i).contains(currentValue)){
-                        histogramBins->replace(i, QwtIntervalSample(histogramBins->at(i).value + 1, histogramInterval->at(i)));
-                        break;
-                    }
-
+            }
+        }
+        else{
+            // Create first interval
+            double tmp=0;
+            if (tmp < currentValue){
+                while (tmp < currentValue){
+                    tmp+=step;
                 }
+                histogramInterval->append(QwtInterval(tmp-step, tmp));
             }
             else{
-                // Create first interval
-                double tmp=0;
-                if (tmp < currentValue){
-                    while (tmp < currentValue){
-                        tmp+=step;
-                    }
-                    histogramInterval->append(QwtInterval(tmp-step, tmp));
+                while (tmp > step){
+                    tmp-=step;
                 }
-                else{
-                    while (tmp > step){
-                        tmp-=step;
-                    }
-                    histogramInterval->append(QwtInterval(tmp, tmp+step));
-                }
-
-                histogramBins->append(QwtIntervalSample(0,histogramInterval->front()));
+                histogramInterval->append(QwtInterval(tmp, tmp+step));
             }
 
-
-            return true;
+            histogramBins->append(QwtIntervalSample(0,histogramInterval->front()));
         }
+
+
+        return true;
     }
 
     return false;
@@ -0,0 +1,171 @@
+/**
+ ******************************************************************************
+ *
+ * @file       plotsamplebuffer.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2017
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup ScopePlugin Scope Gadget Plugin
+ * @{
+ * @brief The scope Gadget, graphically plots the states of UAVObjects
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "scopes2d/plotsamplebuffer.h"
+
+#include <math.h>
+
+PlotSampleBuffer::PlotSampleBuffer(int capacity) :
+    xs(capacity),
+    ys(capacity),
+    head(0),
+    count(0)
+{
+}
+
+/**
+ * @brief PlotSampleBuffer::setCapacity Resize the buffer, keeping as many
+ * of the newest samples as fit
+ */
+void PlotSampleBuffer::setCapacity(int capacity)
+{
+    if (capacity < 0)
+        capacity = 0;
+    if (capacity == xs.size())
+        return;
+
+    int keep = qMin(count, capacity);
+    QVector<double> newXs(capacity);
+    QVector<double> newYs(capacity);
+    for (int i = 0; i < keep; i++) {
+        newXs[i] = x(count - keep + i);
+        newYs[i] = y(count - keep + i);
+    }
+
+    xs = newXs;
+    ys = newYs;
+    head = 0;
+    count = keep;
+}
+
+/**
+ * @brief PlotSampleBuffer::append Add the newest sample, dropping the
+ * oldest if the buffer is full
+ */
+void PlotSampleBuffer::append(double x, double y)
+{
+    if (xs.isEmpty())
+        return;
+
+    int tail = index(count);
+    xs[tail] = x;
+    ys[tail] = y;
+
+    if (count < xs.size())
+        count++;
+    else
+        head = index(1);
+}
+
+//! Drop the oldest sample
+void PlotSampleBuffer::removeFirst()
+{
+    if (count == 0)
+        return;
+
+    head = index(1);
+    count--;
+}
+
+void PlotSampleBuffer::clear()
+{
+    head = 0;
+    count = 0;
+}
+
+//! First sample with an x of at least the given value
+int PlotSampleBuffer::lowerBound(double value) const
+{
+    int lo = 0;
+    int hi = count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (x(mid) < value)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/**
+ * @brief PlotSampleBuffer::decimate Reduce the samples between xMin and
+ * xMax to what can be told apart on screen. The range is split into
+ * buckets (one per pixel column) and each bucket keeps only its first,
+ * minimum, maximum and last samples, so the drawn envelope is the same as
+ * with every sample but the point count is bounded by the plot width.
+ * One sample either side of the range is kept so the curve reaches the
+ * edges.
+ * @param xMin Left edge of the plot
+ * @param xMax Right edge of the plot
+ * @param buckets Number of buckets, normally the canvas width in pixels
+ * @param xOffset Subtracted from each x in the output
+ * @param out The points to plot
+ */
+void PlotSampleBuffer::decimate(double xMin, double xMax, int buckets, double xOffset, QVector<QPointF> *out) const
+{
+    out->clear();
+
+    int begin = qMax(lowerBound(xMin) - 1, 0);
+    int end = qMin(lowerBound(xMax) + 1, count);
+
+    if (buckets <= 0 || xMax <= xMin || end - begin <= 4 * buckets) {
+        out->reserve(end - begin);
+        for (int i = begin; i < end; i++)
+            out->append(QPointF(x(i) - xOffset, y(i)));
+        return;
+    }
+
+    out->reserve(4 * (buckets + 2));
+    double scale = buckets / (xMax - xMin);
+
+    int i = begin;
+    while (i < end) {
+        double bucket = floor((x(i) - xMin) * scale);
+        int first = i;
+        int minIdx = i;
+        int maxIdx = i;
+
+        for (i++; i < end && floor((x(i) - xMin) * scale) == bucket; i++) {
+            if (y(i) < y(minIdx))
+                minIdx = i;
+            if (y(i) > y(maxIdx))
+                maxIdx = i;
+        }
+        int last = i - 1;
+
+        // Keep the points in x order, without repeats
+        int lo = qMin(minIdx, maxIdx);
+        int hi = qMax(minIdx, maxIdx);
+        out->append(QPointF(x(first) - xOffset, y(first)));
+        if (lo != first && lo != last)
+            out->append(QPointF(x(lo) - xOffset, y(lo)));
+        if (hi != lo && hi != last)
+            out->append(QPointF(x(hi) - xOffset, y(hi)));
+        if (last != first)
+            out->append(QPointF(x(last) - xOffset, y(last)));
+    }
+}
@@ -0,0 +1,68 @@
+/**
+ ******************************************************************************
+ *
+ * @file       plotsamplebuffer.h
+ * @author     dRonin, http://dronin.org Copyright (C) 2017
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup ScopePlugin Scope Gadget Plugin
+ * @{
+ * @brief The scope Gadget, graphically plots the states of UAVObjects
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef PLOTSAMPLEBUFFER_H
+#define PLOTSAMPLEBUFFER_H
+
+#include <QPointF>
+#include <QVector>
+
+/**
+ * @brief The PlotSampleBuffer class Fixed capacity ring of (x, y) samples,
+ * with x increasing. Once full, each new sample overwrites the oldest.
+ */
+class PlotSampleBuffer
+{
+public:
+    explicit PlotSampleBuffer(int capacity = 0);
+
+    int size() const {return count;}
+    int capacity() const {return xs.size();}
+    bool isEmpty() const {return count == 0;}
+    bool isFull() const {return count == xs.size();}
+
+    void setCapacity(int capacity);
+    void append(double x, double y);
+    void removeFirst();
+    void clear();
+
+    //! Sample i, counting from the oldest
+    double x(int i) const {return xs.at(index(i));}
+    double y(int i) const {return ys.at(index(i));}
+
+    void decimate(double xMin, double xMax, int buckets, double xOffset, QVector<QPointF> *out) const;
+
+private:
+    int index(int i) const {int j = head + i; return j >= xs.size() ? j - xs.size() : j;}
+    int lowerBound(double x) const;
+
+    QVector<double> xs;
+    QVector<double> ys;
+    int head;  //!< Position of the oldest sample
+    int count;
+};
+
+#endif // PLOTSAMPLEBUFFER_H
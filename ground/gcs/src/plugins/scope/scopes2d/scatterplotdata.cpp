@@ -46,16 +46,17 @@ void TimeSeriesPlotData::plotNewData(PlotData *plot2dData, ScopeConfig *scopeCon
 {
     Q_UNUSED(plot2dData);
     Q_UNUSED(scopeConfig);
-    Q_UNUSED(scopeGadgetWidget);
-
-    //Plot new data
-    if (readAndResetUpdatedFlag() == true)
-        curve->setSamples(*xData, *yData);
 
     QDateTime NOW = QDateTime::currentDateTime();
     double toTime = NOW.toTime_t();
     toTime += NOW.time().msec() / 1000.0;
 
+    //Plot new data, at most a few points per pixel column
+    if (readAndResetUpdatedFlag() == true) {
+        samples.decimate(toTime - m_xWindowSize, toTime, scopeGadgetWidget->canvas()->width(), 0, &decimated);
+        curve->setSamples(decimated);
+    }
+
     scopeGadgetWidget->setAxisScale(QwtPlot::xBottom, toTime - m_xWindowSize, toTime);
 }
 
@@ -68,11 +69,14 @@ void SeriesPlotData::plotNewData(PlotData *plot2dData, ScopeConfig *scopeConfig,
 {
     Q_UNUSED(plot2dData);
     Q_UNUSED(scopeConfig);
-    Q_UNUSED(scopeGadgetWidget);
 
-    //Plot new data
-    if (readAndResetUpdatedFlag() == true)
-        curve->setSamples(*xData, *yData);
+    //Plot new data, at most a few points per pixel column. Samples are
+    //numbered as they arrive, so shift them to start at 0 on the x axis.
+    if (readAndResetUpdatedFlag() == true) {
+        double first = samples.isEmpty() ? 0 : samples.x(0);
+        samples.decimate(first, first + m_xWindowSize, scopeGadgetWidget->canvas()->width(), first, &decimated);
+        curve->setSamples(decimated);
+    }
 }
 
 
@@ -83,61 +87,55 @@ void SeriesPlotData::plotNewData(PlotData *plot2dData, ScopeConfig *scopeConfig,
  */
 bool SeriesPlotData::append(UAVObject* obj)
 {
-    if (uavObjectName == obj->getName()) {
-
-        //Get the field of interest
-        UAVObjectField* field =  obj->getField(uavFieldName);
+    //Get the field of interest
+    UAVObjectField* field = plottedField(obj);
 
-        if (field) {
+    if (field) {
 
-            double currentValue = valueAsDouble(obj, field, haveSubField, uavSubFieldName) * pow(10, scalePower);
+        double currentValue = plottedValue() * pow(10, scalePower);
 
-            //Perform scope math, if necessary
-            if (mathFunction  == "Boxcar average" || mathFunction  == "Standard deviation"){
-                //Put the new value at the front
-                yDataHistory->append( currentValue );
+        //Perform scope math, if necessary
+        if (mathFunction  == "Boxcar average" || mathFunction  == "Standard deviation"){
+            //Put the new value at the front
+            yDataHistory->append( currentValue );
 
-                // calculate average value
-                meanSum += currentValue;
-                if(yDataHistory->size() > (int)meanSamples) {
-                    meanSum -= yDataHistory->first();
-                    yDataHistory->pop_front();
-                }
+            // calculate average value
+            meanSum += currentValue;
+            if(yDataHistory->size() > (int)meanSamples) {
+                meanSum -= yDataHistory->first();
+                yDataHistory->pop_front();
+            }
 
-                // make sure to correct the sum every meanSamples steps to prevent it
-                // from running away due to floating point rounding errors
-                correctionSum+=currentValue;
-                if (++correctionCount >= (int)meanSamples) {
-                    meanSum = correctionSum;
-                    correctionSum = 0.0f;
-                    correctionCount = 0;
-                }
+            // make sure to correct the sum every meanSamples steps to prevent it
+            // from running away due to floating point rounding errors
+            correctionSum+=currentValue;
+            if (++correctionCount >= (int)meanSamples) {
+                meanSum = correctionSum;
+                correctionSum = 0.0f;
+                correctionCount = 0;
+            }
 
-                double boxcarAvg=meanSum/yDataHistory->size();
+            double boxcarAvg=meanSum/yDataHistory->size();
 
-                if ( mathFunction  == "Standard deviation" ){
-                    //Calculate square of sample standard deviation, with Bessel's correction
-                    double stdSum=0;
-                    for (int i=0; i < yDataHistory->size(); i++){
-                        stdSum+= pow(yDataHistory->at(i)- boxcarAvg,2)/(meanSamples-1);
-                    }
-                    yData->append(sqrt(stdSum));
-                }
-                else  {
-                    yData->append(boxcarAvg);
+            if ( mathFunction  == "Standard deviation" ){
+                //Calculate square of sample standard deviation, with Bessel's correction
+                double stdSum=0;
+                for (int i=0; i < yDataHistory->size(); i++){
+                    stdSum+= pow(yDataHistory->at(i)- boxcarAvg,2)/(meanSamples-1);
                 }
+                currentValue = sqrt(stdSum);
             }
-            else{
-                yData->append( currentValue );
+            else  {
+                currentValue = boxcarAvg;
             }
+        }
 
-            if (yData->size() > getXWindowSize()) { //If new data overflows the window, remove old data...
-                yData->pop_front();
-            } else //...otherwise, add a new y point at position xData
-                xData->insert(xData->size(), xData->size());
+        //Once the window is full each new point overwrites the oldest
+        if (samples.capacity() != (int)getXWindowSize())
+            samples.setCapacity(getXWindowSize());
+        samples.append(nextX++, currentValue);
 
-            return true;
-        }
+        return true;
     }
 
     return false;
@@ -151,60 +149,67 @@ bool SeriesPlotData::append(UAVObject* obj)
  */
 bool TimeSeriesPlotData::append(UAVObject* obj)
 {
-    if (uavObjectName == obj->getName()) {
-        //Get the field of interest
-        UAVObjectField* field =  obj->getField(uavFieldName);
-
-        if (field) {
-            QDateTime NOW = QDateTime::currentDateTime(); //THINK ABOUT REIMPLEMENTING THIS TO SHOW UAVO TIME, NOT SYSTEM TIME
-            double currentValue = valueAsDouble(obj, field, haveSubField, uavSubFieldName) * pow(10, scalePower);
-
-            //Perform scope math, if necessary
-            if (mathFunction  == "Boxcar average" || mathFunction  == "Standard deviation"){
-                //Put the new value at the back
-                yDataHistory->append( currentValue );
-
-                // calculate average value
-                meanSum += currentValue;
-                if(yDataHistory->size() > (int)meanSamples) {
-                    meanSum -= yDataHistory->first();
-                    yDataHistory->pop_front();
-                }
-                // make sure to correct the sum every meanSamples steps to prevent it
-                // from running away due to floating point rounding errors
-                correctionSum+=currentValue;
-                if (++correctionCount >= (int)meanSamples) {
-                    meanSum = correctionSum;
-                    correctionSum = 0.0f;
-                    correctionCount = 0;
-                }
+    //Get the field of interest
+    UAVObjectField* field = plottedField(obj);
+
+    if (field) {
+        QDateTime NOW = QDateTime::currentDateTime(); //THINK ABOUT REIMPLEMENTING THIS TO SHOW UAVO TIME, NOT SYSTEM TIME
+        double currentValue = plottedValue() * pow(10, scalePower);
+
+        //Perform scope math, if necessary
+        if (mathFunction  == "Boxcar average" || mathFunction  == "Standard deviation"){
+            //Put the new value at the back
+            yDataHistory->append( currentValue );
+
+            // calculate average value
+            meanSum += currentValue;
+            if(yDataHistory->size() > (int)meanSamples) {
+                meanSum -= yDataHistory->first();
+                yDataHistory->pop_front();
+            }
+            // make sure to correct the sum every meanSamples steps to prevent it
+            // from running away due to floating point rounding errors
+            correctionSum+=currentValue;
+            if (++correctionCount >= (int)meanSamples) {
+                meanSum = correctionSum;
+                correctionSum = 0.0f;
+                correctionCount = 0;
+            }
 
-                double boxcarAvg=meanSum/yDataHistory->size();
+            double boxcarAvg=meanSum/yDataHistory->size();
 
-                if ( mathFunction  == "Standard deviation" ){
-                    //Calculate square of sample standard deviation, with Bessel's correction
-                    double stdSum=0;
-                    for (int i=0; i < yDataHistory->size(); i++){
-                        stdSum+= pow(yDataHistory->at(i)- boxcarAvg,2)/(meanSamples-1);
-                    }
-                    yData->append(sqrt(stdSum));
-                }
-                else  {
-                    yData->append(boxcarAvg);
+            if ( mathFunction  == "Standard deviation" ){
+                //Calculate square of sample standard deviation, with Bessel's correction
+                double stdSum=0;
+                for (int i=0; i < yDataHistory->size(); i++){
+                    stdSum+= pow(yDataHistory->at(i)- boxcarAvg,2)/(meanSamples-1);
                 }
+                currentValue = sqrt(stdSum);
             }
-            else{
-                yData->append( currentValue );
+            else  {
+                currentValue = boxcarAvg;
             }
+        }
 
-            double valueX = NOW.toTime_t() + NOW.time().msec() / 1000.0;
-            xData->append(valueX);
-
-            //Remove stale data
-            removeStaleData();
-
-            return true;
+        double valueX = NOW.toTime_t() + NOW.time().msec() / 1000.0;
+
+        //Remove stale data
+        removeStaleData();
+
+        //Grow the ring while the whole window doesn't fit in it, otherwise
+        //the oldest sample gets overwritten
+        if (samples.capacity() == 0) {
+            samples.setCapacity(INITIAL_CAPACITY);
+        } else if (samples.isFull() && samples.capacity() < MAX_CAPACITY &&
+                   valueX - samples.x(0) <= getXWindowSize()) {
+            int capacity = samples.capacity() * 2;
+            if (capacity > MAX_CAPACITY)
+                capacity = MAX_CAPACITY;
+            samples.setCapacity(capacity);
         }
+        samples.append(valueX, currentValue);
+
+        return true;
     }
 
     return false;
@@ -216,22 +221,13 @@ bool TimeSeriesPlotData::append(UAVObject* obj)
  */
 void TimeSeriesPlotData::removeStaleData()
 {
-    double newestValue;
-    double oldestValue;
+    if (samples.isEmpty())
+        return;
 
-    while (1) {
-        if (xData->size() == 0)
-            break;
+    double newestValue = samples.x(samples.size() - 1);
 
-        newestValue = xData->last();
-        oldestValue = xData->first();
-
-        if (newestValue - oldestValue > getXWindowSize()) {
-            yData->pop_front();
-            xData->pop_front();
-        } else
-            break;
-    }
+    while (!samples.isEmpty() && newestValue - samples.x(0) > getXWindowSize())
+        samples.removeFirst();
 }
 
 
@@ -261,6 +257,5 @@ void ScatterplotData::deletePlots(PlotData *scatterplotData)
  */
 void ScatterplotData::clearPlots()
 {
-    yData->clear();
-    xData->clear();
+    samples.clear();
 }
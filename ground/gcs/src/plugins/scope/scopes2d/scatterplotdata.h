@@ -28,6 +28,7 @@
 #define SCATTERPLOTDATA_H
 
 #include "scopes2d/plotdata2d.h"
+#include "scopes2d/plotsamplebuffer.h"
 #include "uavobject.h"
 #include "qwt/src/qwt_plot_curve.h"
 
@@ -54,6 +55,10 @@ public:
 
 protected:
     QwtPlotCurve* curve;
+
+    //! Samples in the window, stored once and decimated to the canvas width for drawing
+    PlotSampleBuffer samples;
+    QVector<QPointF> decimated;
 };
 
 
@@ -67,7 +72,7 @@ class SeriesPlotData : public ScatterplotData
     Q_OBJECT
 public:
     SeriesPlotData(QString uavObject, QString uavField)
-            : ScatterplotData(uavObject, uavField) {}
+            : ScatterplotData(uavObject, uavField) {nextX = 0;}
     ~SeriesPlotData() {}
 
     /*!
@@ -81,6 +86,9 @@ public:
       */
     virtual void removeStaleData(){}
     virtual void plotNewData(PlotData *, ScopeConfig *, ScopeGadgetWidget *);
+
+private:
+    double nextX; //!< Sequence number of the next sample
 };
 
 
@@ -106,6 +114,11 @@ public:
 
 private slots:
     void removeStaleDataTimeout();
+
+private:
+    //! Initial and largest number of samples held for the time window
+    static const int INITIAL_CAPACITY = 4096;
+    static const int MAX_CAPACITY = 1 << 20;
 };
 
 #endif // SCATTERPLOTDATA_H
@@ -298,7 +298,6 @@ void Scatterplot2dScopeConfig::loadConfiguration(ScopeGadgetWidget *scopeGadgetW
         //Create the curve plot
         QwtPlotCurve* plotCurve = new QwtPlotCurve(curveNameScaledMath);
         plotCurve->setPen(QPen(QBrush(QColor(color), Qt::SolidPattern), (qreal)1, Qt::SolidLine, Qt::SquareCap, Qt::BevelJoin));
-        plotCurve->setSamples(*(scatterplotData->getXData()), *(scatterplotData->getYData()));
         plotCurve->attach(scopeGadgetWidget);
         scatterplotData->setCurve(plotCurve);
 
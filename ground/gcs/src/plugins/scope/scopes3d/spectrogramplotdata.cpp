@@ -63,7 +63,7 @@ SpectrogramData::SpectrogramData(QString uavObject, QString uavField, double sam
     // Create raster data
     rasterData = new QwtMatrixRasterData();
     
-    if(mathFunction == "FFT") {
+    if(isFFT()) {
         fft_object = new ffft::FFTReal<double>(windowWidth);
         windowWidth /= 2;
     }
@@ -163,24 +163,20 @@ bool SpectrogramData::append(UAVObject* multiObj)
         // Get list of object instances
         QVector<UAVObject*> list = objManager->getObjectInstancesVector(multiObj->getName());
 
-        uint16_t newWindowWidth = list.size() * list.front()->getField(uavFieldName)->getNumElements();
+        uint16_t newWindowWidth = list.size() * instanceFields(list.front()).field->getNumElements();
 
         /* Check if the instance has a samples field as this will override the windowWidth
         *  Field can be used in objects that have dynamic size 
         *  like the case of the Vibration Analysis modeule
         */
-        QList<UAVObjectField*> fieldList = multiObj->getFields();
-        foreach (UAVObjectField* field, fieldList) {
-            if (field->getType() == UAVObjectField::INT16 && field->getName() == "samples") {
-                newWindowWidth = field->getValue().toDouble();
-                break;
-            }
-        }
+        InstanceFields multiFields = instanceFields(multiObj);
+        if (multiFields.samples.isValid())
+            newWindowWidth = multiFields.samples.toDouble();
 
         uint16_t valuesToProcess = newWindowWidth; // Store the number of samples expected
 
         // Can happen when changing the FFTP Window Width
-        if (mathFunction == "FFT") {
+        if (isFFT()) {
             if (! ((valuesToProcess != 0) && ((valuesToProcess & (valuesToProcess - 1)) == 0))) {
                 return false;
             }
@@ -201,40 +197,37 @@ bool SpectrogramData::append(UAVObject* multiObj)
             qDebug() << "Spectrogram width adjusted to " << windowWidth;
         }
 
-        UAVObjectField* multiField = multiObj->getField(uavFieldName);
+        UAVObjectField* multiField = multiFields.field;
         Q_ASSERT(multiField);
         if (multiField ) {
 
             // Get the field of interest
             foreach (UAVObject *obj, list) {
-                UAVObjectField* field = obj->getField(uavFieldName);
+                InstanceFields fields = instanceFields(obj);
+                UAVObjectField* field = fields.field;
                 int numElements = field->getNumElements();
 
+                // Check if the instance has a scale field
                 double scale = 1;
-                QList<UAVObjectField*> fieldList = obj->getFields();
-                foreach (UAVObjectField* field, fieldList) {
-                    // Check if the instance has a scale field
-                    if(field->getType() == UAVObjectField::FLOAT32 && field->getName() == "scale"){
-                        scale = field->getValue().toDouble();
-                        break;
+                if (fields.scale.isValid())
+                    scale = fields.scale.toDouble();
+
+                // Check if data is ordered. If not, just discard everything
+                if (fields.index.isValid()) {
+                    int currentIndex = fields.index.toDouble();
+                    if (currentIndex != (lastInstanceIndex + 1)) {
+                        fprintf(stderr, "Out of order index. Got %d expected %d\n", currentIndex, lastInstanceIndex + 1);
+                        plotData.clear();
+                        previousFrame.clear(); // Frames are no longer contiguous
+                        lastInstanceIndex = -1; // Next index will be 0
+                        return false;
                     }
 
-                    // Check if data is ordered. If not, just discard everything
-                    if (field->getType() == UAVObjectField::INT16 && field->getName() == "index") {
-                        int currentIndex = field->getValue().toDouble();
-                        if (currentIndex != (lastInstanceIndex + 1)) {
-                            fprintf(stderr, "Out of order index. Got %d expected %d\n", currentIndex, lastInstanceIndex + 1);
-                            plotData.clear();
-                            lastInstanceIndex = -1; // Next index will be 0
-                            return false;
-                        }
-
-                        lastInstanceIndex++;
-                    }
+                    lastInstanceIndex++;
                 }
 
                 for (int i = 0; i < numElements; i++) {
-                    double currentValue = field->getValue(i).toDouble() / scale;  // Get the value and scale it
+                    double currentValue = field->getDouble(i) / scale;  // Get the value and scale it
 
                     //Normally some math would go here, modifying currentValue before appending it to values
                     // .
@@ -261,7 +254,7 @@ bool SpectrogramData::append(UAVObject* multiObj)
             // Because this function is optional we will calculate the FFT and then
             // update the original vector. This will allow using the same code
             // to display the information.
-            if (mathFunction == "FFT") {
+            if (isFFT()) {
 
                 // Check if the fft_object was already created or needs to be updated
                 // May happen if settings change after the spectrogram was created
@@ -272,23 +265,7 @@ bool SpectrogramData::append(UAVObject* multiObj)
                     fft_object = new ffft::FFTReal<double>(valuesToProcess);
                 }
 
-                // Hanning Window
-                for (int i = 0; i < valuesToProcess; i++) {
-                    plotData[i] *= pow(sin(PI*i/(valuesToProcess - 1) ), 2);
-                }
-
-                QVector<double> fftout(valuesToProcess);
-
-                fft_object->do_fft(&fftout[0], plotData.data()); // Do FFT
-                plotData.clear();  // Clear vector
-
-                // Lets get the magnitude and scale it.
-                // mag = X * sqrt(re^2 + im^2)/n
-                // X (4.2) is chosen so that the magnitude presented is similar to the acceleration registered
-                // although this is not 100% correct, it helps users understanding the spectrogram.
-                for (unsigned int i = 0; i < valuesToProcess/2; i++) {
-                    plotData << 4.2*sqrt(pow(fftout[i], 2) + pow(fftout[valuesToProcess/2 + i], 2)) / valuesToProcess;
-                }
+                computeSpectrum(valuesToProcess);
             }
             
             // Apply autoscale if enabled
@@ -323,6 +300,133 @@ bool SpectrogramData::append(UAVObject* multiObj)
 }
 
 
+/**
+ * @brief SpectrogramData::hanningWindow Hanning window coefficients, computed
+ * once per window size
+ * @param size Window size
+ * @return The coefficients
+ */
+const QVector<double> &SpectrogramData::hanningWindow(int size)
+{
+    static QHash<int, QVector<double> > windows;
+
+    QHash<int, QVector<double> >::iterator it = windows.find(size);
+    if (it == windows.end()) {
+        QVector<double> window(size);
+        for (int i = 0; i < size; i++)
+            window[i] = pow(sin(PI*i/(size - 1)), 2);
+        it = windows.insert(size, window);
+    }
+
+    return it.value();
+}
+
+
+/**
+ * @brief SpectrogramData::computeSpectrum Replace the frame in plotData by
+ * its magnitude spectrum, using fft_object and the reused buffers.
+ *
+ * "FFT (Welch)" averages the power of this frame with that of a segment
+ * overlapping it by half with the previous frame. "FFT (dB)" shows the
+ * magnitude in dB above LOG_MAGNITUDE_FLOOR, clamped at 0 so the color
+ * scale still starts at 0.
+ * @param size Number of samples in the frame, a power of 2
+ */
+void SpectrogramData::computeSpectrum(int size)
+{
+    static const double LOG_MAGNITUDE_FLOOR = 1e-3;
+
+    const QVector<double> &window = hanningWindow(size);
+    int half = size / 2;
+
+    fftIn.resize(size);
+    fftOut.resize(size);
+    fftPower.fill(0, half);
+    int segments = 0;
+
+    bool welch = mathFunction == "FFT (Welch)";
+    if (welch && previousFrame.size() == size) {
+        for (int i = 0; i < half; i++)
+            fftIn[i] = previousFrame[half + i] * window[i];
+        for (int i = half; i < size; i++)
+            fftIn[i] = plotData[i - half] * window[i];
+        segments++;
+
+        fft_object->do_fft(fftOut.data(), fftIn.data());
+        for (int i = 0; i < half; i++)
+            fftPower[i] += fftOut[i] * fftOut[i] + (i ? fftOut[half + i] * fftOut[half + i] : 0);
+    }
+
+    for (int i = 0; i < size; i++)
+        fftIn[i] = plotData[i] * window[i];
+    segments++;
+
+    // The output holds the real parts of bins 0..n/2, then the imaginary
+    // parts of bins 1..n/2-1
+    fft_object->do_fft(fftOut.data(), fftIn.data());
+    for (int i = 0; i < half; i++)
+        fftPower[i] += fftOut[i] * fftOut[i] + (i ? fftOut[half + i] * fftOut[half + i] : 0);
+
+    if (welch) {
+        previousFrame.resize(size);
+        for (int i = 0; i < size; i++)
+            previousFrame[i] = plotData[i];
+    }
+
+    // Lets get the magnitude and scale it.
+    // mag = X * sqrt(re^2 + im^2)/n
+    // X (4.2) is chosen so that the magnitude presented is similar to the acceleration registered
+    // although this is not 100% correct, it helps users understanding the spectrogram.
+    bool logMagnitude = mathFunction == "FFT (dB)";
+    plotData.resize(half);
+    for (int i = 0; i < half; i++) {
+        double magnitude = 4.2 * sqrt(fftPower[i] / segments) / size;
+        if (logMagnitude)
+            magnitude = qMax(20 * log10(magnitude / LOG_MAGNITUDE_FLOOR), 0.0);
+        plotData[i] = magnitude;
+    }
+}
+
+
+/**
+ * @brief SpectrogramData::instanceFields Look up the plotted, samples, scale
+ * and index fields of an instance, once per instance rather than for every
+ * update
+ * @param obj Instance of the plotted UAVO
+ * @return The fields; the readers are invalid when the instance lacks them
+ */
+SpectrogramData::InstanceFields SpectrogramData::instanceFields(UAVObject *obj)
+{
+    QHash<UAVObject *, InstanceFields>::const_iterator it = fieldCache.constFind(obj);
+    if (it != fieldCache.constEnd())
+        return it.value();
+
+    InstanceFields fields;
+    fields.field = obj->getField(uavFieldName);
+
+    foreach (UAVObjectField* field, obj->getFields()) {
+        if (field->getType() == UAVObjectField::INT16 && field->getName() == "samples") {
+            fields.samples = field->reader();
+            break;
+        }
+    }
+
+    // The index is only checked when it comes before the scale field, as
+    // the per-update scan this replaces stopped at the scale field
+    foreach (UAVObjectField* field, obj->getFields()) {
+        if (field->getType() == UAVObjectField::FLOAT32 && field->getName() == "scale") {
+            fields.scale = field->reader();
+            break;
+        }
+        if (field->getType() == UAVObjectField::INT16 && field->getName() == "index")
+            fields.index = field->reader();
+    }
+
+    fieldCache.insert(obj, fields);
+    return fields;
+}
+
+
 /**
  * @brief SpectrogramScopeConfig::deletePlots Delete all plot data
  */
@@ -346,6 +450,7 @@ void SpectrogramData::clearPlots()
 {
     timeDataHistory->clear();
     zDataHistory->clear();
+    previousFrame.clear();
 
     resetAxisRanges();
 }
@@ -29,9 +29,11 @@
 
 #include "scopes3d/plotdata3d.h"
 #include "uavobject.h"
+#include "uavobjectfield.h"
 #include "qwt/src/qwt_plot_spectrogram.h"
 #include "qwt/src/qwt_matrix_raster_data.h"
 
+#include <QHash>
 #include <QTimer>
 #include <QTime>
 #include <QVector>
@@ -77,7 +79,21 @@ public:
     void setSpectrogram(QwtPlotSpectrogram *val){spectrogram = val;}
 
 private:
+    //! True for all the FFT math functions: "FFT", "FFT (Welch)" and "FFT (dB)"
+    bool isFFT() const {return mathFunction.startsWith("FFT");}
+    static const QVector<double> &hanningWindow(int size);
+    void computeSpectrum(int size);
+
+    //! Fields of one instance of the plotted object, looked up once
+    struct InstanceFields {
+        UAVObjectField *field;
+        UAVObjectFieldReader samples;
+        UAVObjectFieldReader scale;
+        UAVObjectFieldReader index;
+    };
+
     void resetAxisRanges();
+    InstanceFields instanceFields(UAVObject *obj);
 
     QwtPlotSpectrogram *spectrogram;
     QwtMatrixRasterData *rasterData;
@@ -87,8 +103,15 @@ private:
     unsigned int windowWidth;
     double autoscaleValueUpdated;
     ffft::FFTReal <double> *fft_object;
+    //! FFT input, output and power buffers, reused from frame to frame
+    QVector<double> fftIn;
+    QVector<double> fftOut;
+    QVector<double> fftPower;
+    //! Last frame's samples, for the overlapping segment in Welch mode
+    QVector<double> previousFrame;
     QVector<double> plotData;
     int lastInstanceIndex;
+    QHash<UAVObject *, InstanceFields> fieldCache;
 };
 
 #endif // SPECTROGRAMDATA_H
@@ -137,11 +137,11 @@ class IntFieldTreeItem : public FieldTreeItem
 Q_OBJECT
 public:
     IntFieldTreeItem(UAVObjectField *field, int index, const QList<QVariant> &data, TreeItem *parent = 0) :
-            FieldTreeItem(index, data, parent), m_field(field) {
+            FieldTreeItem(index, data, parent), m_field(field), m_reader(field->reader(index)) {
         setMinMaxValues();
     }
     IntFieldTreeItem(UAVObjectField *field, int index, const QVariant &data, TreeItem *parent = 0) :
-            FieldTreeItem(index, data, parent), m_field(field) {
+            FieldTreeItem(index, data, parent), m_field(field), m_reader(field->reader(index)) {
         setMinMaxValues();
     }
 
@@ -232,18 +232,20 @@ public:
     }
     void update() {
 
-        QVariant value = m_field->getValue(m_index);
-        if (data() != value || changed()) {
+        // Every field of every updated object goes through here, so read
+        // the element directly rather than through a QVariant
+        double value = m_reader.toDouble();
+        if (data().toDouble() != value || changed()) {
             switch (m_field->getType()) {
             case UAVObjectField::INT8:
             case UAVObjectField::INT16:
             case UAVObjectField::INT32:
-                TreeItem::setData(value.toInt());
+                TreeItem::setData((int) value);
                 break;
             case UAVObjectField::UINT8:
             case UAVObjectField::UINT16:
             case UAVObjectField::UINT32:
-                TreeItem::setData(value.toUInt());
+                TreeItem::setData((uint) value);
                 break;
             default:
                 Q_ASSERT(false);
@@ -259,6 +261,7 @@ public:
 
 private:
     UAVObjectField *m_field;
+    UAVObjectFieldReader m_reader;
     int m_minValue;
     int m_maxValue;
 };
@@ -268,9 +271,9 @@ class FloatFieldTreeItem : public FieldTreeItem
 Q_OBJECT
 public:
     FloatFieldTreeItem(UAVObjectField *field, int index, const QList<QVariant> &data, bool scientific = false, TreeItem *parent = 0) :
-        FieldTreeItem(index, data, parent), m_field(field), m_useScientificNotation(scientific){}
+        FieldTreeItem(index, data, parent), m_field(field), m_reader(field->reader(index)), m_useScientificNotation(scientific){}
     FloatFieldTreeItem(UAVObjectField *field, int index, const QVariant &data, bool scientific = false, TreeItem *parent = 0) :
-            FieldTreeItem(index, data, parent), m_field(field), m_useScientificNotation(scientific) { }
+            FieldTreeItem(index, data, parent), m_field(field), m_reader(field->reader(index)), m_useScientificNotation(scientific) { }
     void setData(QVariant value, int column) {
         setChanged(m_field->getValue(m_index) != value);
         TreeItem::setData(value, column);
@@ -283,7 +286,7 @@ public:
             setIsDefaultValue(m_field->isDefaultValue(m_index));
     }
     void update() {
-        double value = m_field->getValue(m_index).toDouble();
+        double value = m_reader.toDouble();
         if (data() != value || changed()) {
             TreeItem::setData(value);
             setHighlight(true);
@@ -330,6 +333,7 @@ public:
     }
 private:
     UAVObjectField *m_field;
+    UAVObjectFieldReader m_reader;
     bool m_useScientificNotation;
 
 };
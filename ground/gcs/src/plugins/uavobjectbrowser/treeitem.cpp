@@ -56,10 +56,10 @@ HighLightManager::HighLightManager(long checkingInterval, QTime *currentTime)
  */
 bool HighLightManager::add(TreeItem *itemToAdd)
 {
-    // Check so that the item isn't already in the list
-    if(!m_itemsList.contains(itemToAdd))
+    // Check so that the item isn't already in the set
+    if(!m_items.contains(itemToAdd))
     {
-        m_itemsList.append(itemToAdd);
+        m_items.insert(itemToAdd);
         return true;
     }
     return false;
@@ -72,7 +72,7 @@ bool HighLightManager::add(TreeItem *itemToAdd)
 bool HighLightManager::remove(TreeItem *itemToRemove)
 {
     // Remove item and return result
-    return m_itemsList.removeOne(itemToRemove);
+    return m_items.remove(itemToRemove);
 }
 
 /*
@@ -83,8 +83,8 @@ bool HighLightManager::remove(TreeItem *itemToRemove)
  */
 void HighLightManager::checkItemsExpired()
 {
-    // Get a mutable iterator for the list
-    QMutableLinkedListIterator<TreeItem*> iter(m_itemsList);
+    // Get a mutable iterator for the set
+    QMutableSetIterator<TreeItem*> iter(m_items);
 
     // Loop over all items, check if they expired.
     while(iter.hasNext())
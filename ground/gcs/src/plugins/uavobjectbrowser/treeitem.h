@@ -40,8 +40,9 @@
 #include "uavmetaobject.h"
 #include "uavobjectfield.h"
 #include <QtCore/QList>
-#include <QtCore/QLinkedList>
+#include <QtCore/QSet>
 #include <QtCore/QMap>
+#include <QtCore/QHash>
 #include <QtCore/QVariant>
 #include <QtCore/QTime>
 #include <QtCore/QTimer>
@@ -54,7 +55,7 @@ class TreeItem;
 * Small utility class that handles the higlighting of
 * tree grid items.
 * Basicly it maintains all items due to be restored to
-* non highlighted state in a linked list.
+* non highlighted state in a set.
 * A timer traverses this list periodically to find out
 * if any of the items should be restored. All items are
 * updated withan expiration timestamp when they expires.
@@ -87,8 +88,8 @@ private:
     // The timer checking highlight expiration.
     QTimer m_expirationTimer;
 
-    // The list holding all items due to be updated.
-    QLinkedList<TreeItem*> m_itemsList;
+    // The set holding all items due to be updated.
+    QSet<TreeItem*> m_items;
 
     // This is the timestamp to compare with
     static QTime *m_currentTime;
@@ -217,7 +218,7 @@ public:
     }
 
     DataObjectTreeItem* findDataObjectTreeItemByObjectId(quint32 objectId) {
-        return m_objectTreeItemsPerObjectIds.contains(objectId) ? m_objectTreeItemsPerObjectIds[objectId] : 0;
+        return m_objectTreeItemsPerObjectIds.value(objectId);
     }
 
     void addMetaObjectTreeItem(quint32 objectId, MetaObjectTreeItem* oti) {
@@ -225,13 +226,13 @@ public:
     }
 
     MetaObjectTreeItem* findMetaObjectTreeItemByObjectId(quint32 objectId) {
-        return m_metaObjectTreeItemsPerObjectIds.contains(objectId) ? m_metaObjectTreeItemsPerObjectIds[objectId] : 0;
+        return m_metaObjectTreeItemsPerObjectIds.value(objectId);
     }
     QList<MetaObjectTreeItem*> getMetaObjectItems();
     QList<DataObjectTreeItem*> getDataObjectItems();
 private:
-    QMap<quint32, DataObjectTreeItem*> m_objectTreeItemsPerObjectIds;
-    QMap<quint32, MetaObjectTreeItem*> m_metaObjectTreeItemsPerObjectIds;
+    QHash<quint32, DataObjectTreeItem*> m_objectTreeItemsPerObjectIds;
+    QHash<quint32, MetaObjectTreeItem*> m_metaObjectTreeItemsPerObjectIds;
 };
 
 class ObjectTreeItem : public TreeItem
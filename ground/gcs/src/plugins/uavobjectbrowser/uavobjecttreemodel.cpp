@@ -48,6 +48,9 @@
 
 #include <QApplication>
 
+//! Period at which object updates are applied to the tree and the view
+static const int UPDATE_PERIOD_MS = 100;
+
 UAVObjectTreeModel::UAVObjectTreeModel(QObject *parent, bool useScientificNotation) :
     QAbstractItemModel(parent),
     m_rootItem(NULL),
@@ -73,6 +76,10 @@ UAVObjectTreeModel::UAVObjectTreeModel(QObject *parent, bool useScientificNotati
                                                                                  // out. In any case, never go faster than 10ms.
     TreeItem::setHighlightTime(m_recentlyUpdatedTimeout);
 
+    m_updateTimer.setSingleShot(true);
+    m_updateTimer.setInterval(UPDATE_PERIOD_MS);
+    connect(&m_updateTimer, SIGNAL(timeout()), this, SLOT(flushUpdates()));
+
     QFont font;
     m_defaultValueFont = font;
     font.setWeight(QFont::Bold);
@@ -102,6 +109,10 @@ void UAVObjectTreeModel::setupModelData(UAVObjectManager *objManager, bool categ
         disconnect(objManager, SIGNAL(newInstance(UAVObject*)), this, SLOT(newObject(UAVObject*)));
         disconnect(objManager, SIGNAL(instanceRemoved(UAVObject*)), this, SLOT(instanceRemove(UAVObject*)));
         delete m_highlightManager;
+        m_dirtyObjects.clear();
+        m_dirtyItems.clear();
+        m_expandedItems.clear();
+        m_objectTreeItems.clear();
         int count = m_rootItem->childCount();
         beginRemoveRows(index(m_rootItem), 0, count);
         delete m_rootItem;
@@ -163,6 +174,9 @@ void UAVObjectTreeModel::instanceRemove(UAVObject *obj)
             InstanceTreeItem *inst = dynamic_cast<InstanceTreeItem*>(item);
             if(inst && inst->object() == obj)
             {
+                m_dirtyObjects.remove(obj);
+                m_objectTreeItems.remove(obj);
+                forgetItem(inst);
                 inst->parent()->removeChild(inst);
                 inst->deleteLater();
             }
@@ -222,6 +236,7 @@ MetaObjectTreeItem* UAVObjectTreeModel::addMetaObject(UAVMetaObject *obj, TreeIt
 {
     connect(obj, SIGNAL(objectUpdated(UAVObject*)), this, SLOT(highlightUpdatedObject(UAVObject*)));
     MetaObjectTreeItem *meta = new MetaObjectTreeItem(obj, tr("Meta Data"));
+    m_objectTreeItems.insert(obj, meta);
 
     meta->setHighlightManager(m_highlightManager);
     connect(meta, SIGNAL(updateHighlight(TreeItem*)), this, SLOT(updateHighlight(TreeItem*)));
@@ -260,6 +275,7 @@ void UAVObjectTreeModel::addInstance(UAVObject *obj, TreeItem *parent)
         // Inform the model that the row addition is complete
         endInsertRows();
     }
+    m_objectTreeItems.insert(obj, static_cast<ObjectTreeItem*>(item));
     foreach (UAVObjectField *field, obj->getFields()) {
         if (field->getNumElements() > 1) {
             addArrayField(field, item);
@@ -355,16 +371,7 @@ QModelIndex UAVObjectTreeModel::index(TreeItem *item)
     if (item->parent() == 0)
         return QModelIndex();
 
-    QModelIndex root = index(item->parent());
-
-    for (int i = 0; i < rowCount(root); ++i) {
-        QModelIndex childIndex = index(i, 0, root);
-        TreeItem *child = static_cast<TreeItem*>(childIndex.internalPointer());
-        if (child == item)
-            return childIndex;
-    }
-    Q_ASSERT(false);
-    return QModelIndex();
+    return createIndex(item->row(), 0, item);
 }
 
 QModelIndex UAVObjectTreeModel::parent(const QModelIndex &index) const
@@ -530,57 +537,118 @@ QVariant UAVObjectTreeModel::headerData(int section, Qt::Orientation orientation
     return QVariant();
 }
 
+/**
+ * @brief Marks an object as updated. However often it is updated, its tree
+ * items are refreshed at most once per UPDATE_PERIOD_MS, by flushUpdates().
+ */
 void UAVObjectTreeModel::highlightUpdatedObject(UAVObject *obj)
 {
     Q_ASSERT(obj);
-    ObjectTreeItem *item = findObjectTreeItem(obj);
-    Q_ASSERT(item);
-    if(!m_onlyHighlightChangedValues){
-        item->setHighlight(true);
-    }
-    item->update();
-    if(!m_onlyHighlightChangedValues){
-        QModelIndex itemIndex = index(item);
-        Q_ASSERT(itemIndex != QModelIndex());
-        emit dataChanged(itemIndex, itemIndex);
-    }
+    m_dirtyObjects.insert(obj);
+    scheduleFlush();
 }
 
 ObjectTreeItem* UAVObjectTreeModel::findObjectTreeItem(UAVObject *object)
 {
-    UAVDataObject *dataObject = qobject_cast<UAVDataObject*>(object);
-    UAVMetaObject *metaObject = qobject_cast<UAVMetaObject*>(object);
-    Q_ASSERT(dataObject || metaObject);
-    if (dataObject) {
-        return findDataObjectTreeItem(dataObject);
-    } else {
-        return findMetaObjectTreeItem(metaObject);
-    }
-    return 0;
+    return m_objectTreeItems.value(object);
 }
 
-DataObjectTreeItem* UAVObjectTreeModel::findDataObjectTreeItem(UAVDataObject *obj)
+void UAVObjectTreeModel::updateHighlight(TreeItem *item)
 {
-    //Determine if the root tree is the settings or dynamic data tree
-    TopTreeItem *root = obj->isSettings() ? m_settingsTree : m_nonSettingsTree;
-    return root->findDataObjectTreeItemByObjectId(obj->getObjID());
+    m_dirtyItems.insert(item);
+    scheduleFlush();
 }
 
-MetaObjectTreeItem* UAVObjectTreeModel::findMetaObjectTreeItem(UAVMetaObject *obj)
+void UAVObjectTreeModel::scheduleFlush()
 {
-    UAVDataObject *dataObject = qobject_cast<UAVDataObject*>(obj->getParentObject());
-    Q_ASSERT(dataObject);
+    if (!m_updateTimer.isActive())
+        m_updateTimer.start();
+}
 
-    //Determine if the root tree is the settings or dynamic data tree
-    TopTreeItem *root = dataObject->isSettings() ? m_settingsTree : m_nonSettingsTree;
-    return root->findMetaObjectTreeItemByObjectId(obj->getObjID());
+/**
+ * @brief Refreshes the items of all the objects updated since the last flush,
+ * then emits one dataChanged() per parent spanning its changed rows. Rows the
+ * view can't show, as one of their parents is collapsed, are left out; their
+ * data is still current when they are expanded.
+ */
+void UAVObjectTreeModel::flushUpdates()
+{
+    foreach (UAVObject *obj, m_dirtyObjects) {
+        ObjectTreeItem *item = findObjectTreeItem(obj);
+        Q_ASSERT(item);
+        if (!item)
+            continue;
+        if (!m_onlyHighlightChangedValues) {
+            item->setHighlight(true);
+            m_dirtyItems.insert(item);
+        }
+        item->update();
+    }
+    m_dirtyObjects.clear();
+
+    QHash<TreeItem *, QPair<int, int> > rows;
+    foreach (TreeItem *item, m_dirtyItems) {
+        TreeItem *parent = item->parent();
+        if (!parent || !isVisible(item))
+            continue;
+
+        int row = item->row();
+        QHash<TreeItem *, QPair<int, int> >::iterator range = rows.find(parent);
+        if (range == rows.end()) {
+            rows.insert(parent, qMakePair(row, row));
+        } else {
+            range->first = qMin(range->first, row);
+            range->second = qMax(range->second, row);
+        }
+    }
+    m_dirtyItems.clear();
+
+    for (QHash<TreeItem *, QPair<int, int> >::const_iterator range = rows.constBegin(); range != rows.constEnd(); ++range) {
+        TreeItem *parent = range.key();
+        int first = range->first;
+        int last = range->second;
+        emit dataChanged(createIndex(first, 0, parent->getChild(first)),
+                         createIndex(last, TreeItem::dataColumn, parent->getChild(last)));
+    }
 }
 
-void UAVObjectTreeModel::updateHighlight(TreeItem *item)
+/**
+ * @brief Tells the model which items the view has expanded, so it only
+ * reports changes to rows that can be seen.
+ * @param index source model index of the item
+ * @param expanded true if the item was expanded, false if collapsed
+ */
+void UAVObjectTreeModel::setExpanded(const QModelIndex &index, bool expanded)
+{
+    TreeItem *item = static_cast<TreeItem*>(index.internalPointer());
+    if (!item)
+        return;
+
+    if (expanded)
+        m_expandedItems.insert(item);
+    else
+        m_expandedItems.remove(item);
+}
+
+bool UAVObjectTreeModel::isVisible(TreeItem *item)
+{
+    for (TreeItem *parent = item->parent(); parent && parent != m_rootItem; parent = parent->parent()) {
+        if (!m_expandedItems.contains(parent))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Drops an item about to be removed, and its children, from the
+ * pending updates.
+ */
+void UAVObjectTreeModel::forgetItem(TreeItem *item)
 {
-    QModelIndex itemIndex = index(item);
-    Q_ASSERT(itemIndex != QModelIndex());
-    emit dataChanged(itemIndex, itemIndex.sibling(itemIndex.row(), TreeItem::dataColumn));
+    m_dirtyItems.remove(item);
+    m_expandedItems.remove(item);
+    foreach (TreeItem *child, item->treeChildren())
+        forgetItem(child);
 }
 
 
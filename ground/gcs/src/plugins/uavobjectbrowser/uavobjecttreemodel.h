@@ -39,6 +39,9 @@
 #include <QAbstractItemModel>
 #include <QtCore/QMap>
 #include <QtCore/QList>
+#include <QtCore/QHash>
+#include <QtCore/QSet>
+#include <QtCore/QTimer>
 #include <QColor>
 #include <QFont>
 
@@ -88,6 +91,8 @@ public:
 
     QModelIndex getIndex(int indexRow, int indexCol, TopTreeItem *topTreeItem){return createIndex(indexRow, indexCol, topTreeItem);}
 
+    void setExpanded(const QModelIndex &index, bool expanded);
+
 signals:
     void presentOnHardwareChanged();
 public slots:
@@ -98,6 +103,7 @@ private slots:
     void highlightUpdatedObject(UAVObject *obj);
     void updateHighlight(TreeItem*);
     void updateCurrentTime();
+    void flushUpdates();
     void presentOnHardwareChangedCB(UAVDataObject*);
 
 private:
@@ -113,8 +119,9 @@ private:
 
     QString updateMode(quint8 updateMode);
     ObjectTreeItem *findObjectTreeItem(UAVObject *obj);
-    DataObjectTreeItem *findDataObjectTreeItem(UAVDataObject *obj);
-    MetaObjectTreeItem *findMetaObjectTreeItem(UAVMetaObject *obj);
+    void scheduleFlush();
+    bool isVisible(TreeItem *item);
+    void forgetItem(TreeItem *item);
 
     TreeItem *m_rootItem;
     TopTreeItem *m_settingsTree;
@@ -133,6 +140,12 @@ private:
     bool m_categorize;
     QTimer m_currentTimeTimer;
     QTime m_currentTime;
+    // Updates are collected here and handed to the view at a fixed rate
+    QTimer m_updateTimer;
+    QSet<UAVObject *> m_dirtyObjects;
+    QSet<TreeItem *> m_dirtyItems;
+    QSet<TreeItem *> m_expandedItems;
+    QHash<UAVObject *, ObjectTreeItem *> m_objectTreeItems;
     UAVObjectManager *objManager;
     // Highlight manager to handle highlighting of tree items.
     HighLightManager *m_highlightManager;
@@ -0,0 +1,22 @@
+# Microbenchmark of UAVObjectField element reads, build against the
+# UAVObjects plugin of a normal GCS build:
+#   qmake fieldbenchmark.pro && make && ./fieldbenchmark
+include(../../../../../gcs.pri)
+include(../../../../rpath.pri)
+
+QT -= gui
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+TARGET = fieldbenchmark
+TEMPLATE = app
+
+LIBS += -L$$GCS_PLUGIN_PATH/dRonin
+include(../../uavobjects.pri)
+
+linux-* {
+    QMAKE_LFLAGS += \'-Wl,-rpath,$$GCS_PLUGIN_PATH/dRonin\'
+}
+
+SOURCES += main.cpp
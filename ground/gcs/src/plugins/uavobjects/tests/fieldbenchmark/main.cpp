@@ -0,0 +1,119 @@
+/**
+ ******************************************************************************
+ * @file       main.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2017
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVObjectsPlugin UAVObjects Plugin
+ * @{
+ * @brief Microbenchmark of the ways to read a field element as a double
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "uavobjectfield.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QRegExp>
+#include <QTextStream>
+
+static const int SAMPLES = 10000000;
+
+static QTextStream out(stdout);
+
+static void report(const QString &name, qint64 elapsedNs, double sum)
+{
+    double seconds = qMax<qint64>(elapsedNs, 1) / 1e9;
+
+    // The sum is printed so the reads can't be optimized away
+    out << QString("%0: %1 Msamples/s, %2 ns/sample (sum %3)")
+           .arg(name, -28)
+           .arg(SAMPLES / seconds / 1e6, 0, 'f', 1)
+           .arg(elapsedNs / (double) SAMPLES, 0, 'f', 1)
+           .arg(sum) << endl;
+}
+
+static void benchmark(UAVObjectField *field, quint32 index)
+{
+    QElapsedTimer timer;
+    double sum;
+
+    out << field->getTypeAsString() << " element " << index << endl;
+
+    // What the scope did for every sample before: look up the element by
+    // name, then read it through a QVariant
+    QString elementName = field->getElementName(index);
+    sum = 0;
+    timer.start();
+    for (int i = 0; i < SAMPLES; i++) {
+        int element = field->getElementNames().indexOf(QRegExp(elementName, Qt::CaseSensitive, QRegExp::FixedString));
+        sum += field->getValue(element).toDouble();
+    }
+    report("  name lookup + getValue()", timer.nsecsElapsed(), sum);
+
+    sum = 0;
+    timer.start();
+    for (int i = 0; i < SAMPLES; i++)
+        sum += field->getValue(index).toDouble();
+    report("  getValue().toDouble()", timer.nsecsElapsed(), sum);
+
+    sum = 0;
+    timer.start();
+    for (int i = 0; i < SAMPLES; i++)
+        sum += field->getDouble(index);
+    report("  getDouble()", timer.nsecsElapsed(), sum);
+
+    UAVObjectFieldReader reader = field->reader(index);
+    sum = 0;
+    timer.start();
+    for (int i = 0; i < SAMPLES; i++)
+        sum += reader.toDouble();
+    report("  UAVObjectFieldReader", timer.nsecsElapsed(), sum);
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QStringList axes = QStringList() << "X" << "Y" << "Z";
+
+    UAVObjectField gyro("Gyro", "deg/s", UAVObjectField::FLOAT32, axes, QStringList(), QList<int>());
+    UAVObjectField rssi("Rssi", "dBm", UAVObjectField::INT16, 1, QStringList(), QList<int>());
+    UAVObjectField flags("Flags", "", UAVObjectField::BITFIELD, 8, QStringList(), QList<int>());
+
+    // Fields read straight out of a plain buffer, no object needed
+    quint8 data[32];
+    gyro.initialize(data, 0, NULL);
+    rssi.initialize(data, gyro.getNumBytes(), NULL);
+    flags.initialize(data, gyro.getNumBytes() + rssi.getNumBytes(), NULL);
+
+    float rate = 12.5f;
+    qint16 dbm = -71;
+    memcpy(&data[gyro.getDataOffset() + 2 * sizeof(float)], &rate, sizeof(rate));
+    memcpy(&data[rssi.getDataOffset()], &dbm, sizeof(dbm));
+    data[flags.getDataOffset()] = 0x24;
+
+    benchmark(&gyro, 2);
+    benchmark(&rssi, 0);
+    benchmark(&flags, 5);
+
+    return 0;
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -1148,9 +1148,34 @@ void UAVObjectField::setValue(const QVariant& value, quint32 index)
 
 double UAVObjectField::getDouble(quint32 index)
 {
+    // Numeric types skip the QVariant; enums and strings keep converting
+    // their text as before
+    if (type != ENUM && type != STRING) {
+        if (index >= numElements)
+            return 0;
+        return reader(index).toDouble();
+    }
+
     return getValue(index).toDouble();
 }
 
+/**
+ * @brief UAVObjectField::reader Get a reader bound to one element
+ * @param index The element to read
+ * @return The reader, invalid for strings, out of range elements or a
+ * field that is not initialized yet
+ */
+UAVObjectFieldReader UAVObjectField::reader(quint32 index)
+{
+    if (index >= numElements || data == NULL || type == STRING)
+        return UAVObjectFieldReader();
+
+    if (type == BITFIELD)
+        return UAVObjectFieldReader(&data[offset + numBytesPerElement*(index/8)], type, index % 8);
+
+    return UAVObjectFieldReader(&data[offset + numBytesPerElement*index], type, 0);
+}
+
 void UAVObjectField::setDouble(double value, quint32 index)
 {
     setValue(QVariant(value), index);
@@ -34,8 +34,10 @@
 #include <QVariant>
 #include <QList>
 #include <QMap>
+#include <string.h>
 
 class UAVObject;
+class UAVObjectFieldReader;
 
 class UAVOBJECTS_EXPORT UAVObjectField: public QObject
 {
@@ -80,6 +82,7 @@ public:
     bool checkValue(const QVariant& data, quint32 index = 0);
     void setValue(const QVariant& data, quint32 index = 0);
     double getDouble(quint32 index = 0);
+    UAVObjectFieldReader reader(quint32 index = 0);
     void setDouble(double value, quint32 index = 0);
     quint32 getDataOffset();
     quint32 getNumBytes();
@@ -130,6 +133,63 @@ protected:
 
 };
 
+/**
+ * @brief The UAVObjectFieldReader class Reads one numeric element straight
+ * from the object data, for code that samples a field at telemetry rate.
+ * The offset and type are resolved once by UAVObjectField::reader(), so a
+ * read does not build a QVariant, allocate or check bounds. Enums read as
+ * their raw value. A reader stays valid for as long as its object exists.
+ */
+class UAVObjectFieldReader
+{
+public:
+    UAVObjectFieldReader() : ptr(NULL), type(UAVObjectField::UINT8), bit(0) {}
+    UAVObjectFieldReader(const quint8 *ptr, UAVObjectField::FieldType type, quint8 bit) :
+        ptr(ptr), type(type), bit(bit) {}
+
+    bool isValid() const { return ptr != NULL; }
+
+    double toDouble() const
+    {
+        if (!ptr)
+            return 0;
+
+        switch (type) {
+        case UAVObjectField::INT8:
+            return read<qint8>();
+        case UAVObjectField::INT16:
+            return read<qint16>();
+        case UAVObjectField::INT32:
+            return read<qint32>();
+        case UAVObjectField::UINT8:
+        case UAVObjectField::ENUM:
+            return read<quint8>();
+        case UAVObjectField::UINT16:
+            return read<quint16>();
+        case UAVObjectField::UINT32:
+            return read<quint32>();
+        case UAVObjectField::FLOAT32:
+            return read<float>();
+        case UAVObjectField::BITFIELD:
+            return (*ptr >> bit) & 1;
+        default:
+            return 0;
+        }
+    }
+
+private:
+    template <typename T> T read() const
+    {
+        T value;
+        memcpy(&value, ptr, sizeof(value));
+        return value;
+    }
+
+    const quint8 *ptr;
+    UAVObjectField::FieldType type;
+    quint8 bit;
+};
+
 #endif // UAVOBJECTFIELD_H
 
 /**
@@ -86,6 +86,11 @@ Telemetry::Telemetry(UAVTalk* utalk, UAVObjectManager* objMngr)
 {
     this->utalk = utalk;
     this->objMngr = objMngr;
+    // Setup the periodic timer, it is started once all objects are registered
+    schedulerClock.start();
+    updateTimer = new QTimer(this);
+    updateTimer->setSingleShot(true);
+    connect(updateTimer, SIGNAL(timeout()), this, SLOT(processPeriodicUpdates()));
     // Process all objects in the list
     QVector< QVector<UAVObject*> > objs = objMngr->getObjectsVector();
     const int objSize = objs.size();
@@ -101,11 +106,8 @@ Telemetry::Telemetry(UAVTalk* utalk, UAVObjectManager* objMngr)
     connect(utalk, SIGNAL(nackReceived(UAVObject*)), this, SLOT(transactionFailure(UAVObject*)));
     // Get GCS stats object
     gcsStatsObj = GCSTelemetryStats::GetInstance(objMngr);
-    // Setup and start the periodic timer
-    timeToNextUpdateMs = 0;
-    updateTimer = new QTimer(this);
-    connect(updateTimer, SIGNAL(timeout()), this, SLOT(processPeriodicUpdates()));
-    updateTimer->start(1000);
+    // Start the periodic timer
+    restartUpdateTimer();
     // Setup and start the stats timer
     txErrors = 0;
     txRetries = 0;
@@ -136,21 +138,20 @@ void Telemetry::registerObject(UAVObject* obj)
 void Telemetry::addObject(UAVObject* obj)
 {
     // Check if object type is already in the list
-    const QVector<ObjectTimeInfo>::iterator iterEnd = objList.end();
-    for (QVector<ObjectTimeInfo>::const_iterator iter = objList.constBegin(); iter != iterEnd; ++iter)
+    if (objListIndex.contains(obj->getObjID()))
     {
-        if (iter->obj->getObjID() == obj->getObjID())
-        {
-            // Object type (not instance!) is already in the list, do nothing
-            return;
-        }
+        // Object type (not instance!) is already in the list, do nothing
+        return;
     }
 
     // If this point is reached, then the object type is new, let's add it
     ObjectTimeInfo timeInfo;
     timeInfo.obj = obj;
-    timeInfo.timeToNextUpdateMs = 0;
     timeInfo.updatePeriodMs = 0;
+    timeInfo.nextUpdateMs = 0;
+    timeInfo.generation = 0;
+    memset(&timeInfo.stats, 0, sizeof(timeInfo.stats));
+    objListIndex.insert(obj->getObjID(), objList.size());
     objList.append(timeInfo);
 }
 
@@ -160,19 +161,108 @@ void Telemetry::addObject(UAVObject* obj)
 void Telemetry::setUpdatePeriod(UAVObject* obj, qint32 periodMs)
 {
     // Find object type (not instance!) and update its period
-    const quint32 objID = obj->getObjID();
+    QHash<quint32, int>::const_iterator iter = objListIndex.constFind(obj->getObjID());
+    if (iter == objListIndex.constEnd())
+    {
+        return;
+    }
 
-    const QVector<ObjectTimeInfo>::iterator iterEnd = objList.end();
-    for (QVector<ObjectTimeInfo>::iterator iter = objList.begin(); iter != iterEnd; ++iter)
+    ObjectTimeInfo &timeInfo = objList[iter.value()];
+
+    // Keep the current schedule if nothing changed, otherwise every
+    // periodic send would restart its own period at a random phase
+    if (timeInfo.updatePeriodMs == periodMs)
     {
-        if (iter->obj->getObjID() == objID)
+        return;
+    }
+
+    // Invalidate any queued update for the old period
+    timeInfo.updatePeriodMs = periodMs;
+    ++timeInfo.generation;
+
+    if (periodMs > 0)
+    {
+        qint64 delayMs = qint64((float)periodMs * (float)qrand() / (float)RAND_MAX); // avoid bunching of updates
+        timeInfo.nextUpdateMs = schedulerClock.elapsed() + delayMs;
+        scheduleUpdate(iter.value());
+
+        // Pull the timer in if this update is due before the next wakeup
+        if (updateTimer->isActive() && updateTimer->remainingTime() > delayMs)
         {
-            iter->updatePeriodMs = periodMs;
-            iter->timeToNextUpdateMs = quint32((float)periodMs * (float)qrand() / (float)RAND_MAX); // avoid bunching of updates
+            restartUpdateTimer();
         }
     }
 }
 
+/**
+ * Queue the next periodic update of an object
+ */
+void Telemetry::scheduleUpdate(int index)
+{
+    ScheduleEntry entry;
+    entry.dueMs = objList[index].nextUpdateMs;
+    entry.index = index;
+    entry.generation = objList[index].generation;
+    updateQueue.push(entry);
+
+    // Stale entries are normally dropped as they surface, but bound
+    // the queue in case periods are changed much faster than they expire
+    if (updateQueue.size() > (size_t)(2 * objList.size() + MAX_QUEUE_SIZE))
+    {
+        rebuildUpdateQueue();
+    }
+}
+
+/**
+ * Rebuild the periodic update queue from the object list, dropping stale entries
+ */
+void Telemetry::rebuildUpdateQueue()
+{
+    updateQueue = ScheduleQueue();
+
+    const int objListSize = objList.size();
+    for (int index = 0; index < objListSize; ++index)
+    {
+        if (objList[index].updatePeriodMs > 0)
+        {
+            ScheduleEntry entry;
+            entry.dueMs = objList[index].nextUpdateMs;
+            entry.index = index;
+            entry.generation = objList[index].generation;
+            updateQueue.push(entry);
+        }
+    }
+}
+
+/**
+ * Arm the periodic timer for the earliest pending update
+ */
+void Telemetry::restartUpdateTimer()
+{
+    // Drop stale entries so that the head of the queue is a real deadline
+    while (!updateQueue.empty())
+    {
+        const ScheduleEntry &entry = updateQueue.top();
+        const ObjectTimeInfo &timeInfo = objList[entry.index];
+        if (entry.generation == timeInfo.generation && timeInfo.updatePeriodMs > 0)
+        {
+            break;
+        }
+        updateQueue.pop();
+    }
+
+    qint64 delayMs = MAX_UPDATE_PERIOD_MS;
+    if (!updateQueue.empty())
+    {
+        delayMs = updateQueue.top().dueMs - schedulerClock.elapsed();
+    }
+
+    // Check if delay for the next update is too short or too long
+    delayMs = qBound<qint64>(MIN_UPDATE_PERIOD_MS, delayMs, MAX_UPDATE_PERIOD_MS);
+
+    updateTimer->start((int)delayMs);
+}
+
 /**
  * Connect to all instances of an object depending on the event mask specified
  */
@@ -560,61 +650,54 @@ void Telemetry::processObjectQueue()
 
 
 /**
- * @brief Telemetry::processPeriodicUpdates Check if any objects are pending for periodic updates
+ * @brief Telemetry::processPeriodicUpdates Send the periodic updates that are due
+ *
+ * Objects are kept in a queue ordered by the time of their next update, so
+ * each tick only touches the objects that are actually due.
  */
 void Telemetry::processPeriodicUpdates()
 {
     // Stop timer
     updateTimer->stop();
 
-    // Iterate through each object and update its timer, if zero then transmit object.
-    // Also calculate smallest delay to next update (will be used for setting timeToNextUpdateMs)
-    qint32 minDelay = MAX_UPDATE_PERIOD_MS;
-    qint32 elapsedMs = 0;
-    QTime time;
-    qint32 offset;
+    qint64 nowMs = schedulerClock.elapsed();
 
-    const QVector<ObjectTimeInfo>::iterator objInfoEnd = objList.end();
-    for (QVector<ObjectTimeInfo>::iterator objinfo = objList.begin(); objinfo != objInfoEnd; ++objinfo)
+    while (!updateQueue.empty() && updateQueue.top().dueMs <= nowMs)
     {
-        // If object is configured for periodic updates
-        // FixMe: This is an inefficient process as it depends on polling. It would be better to have
-        // this functionality be driven through timers.
-        if (objinfo->updatePeriodMs > 0)
+        ScheduleEntry entry = updateQueue.top();
+        updateQueue.pop();
+
+        ObjectTimeInfo &timeInfo = objList[entry.index];
+
+        // Skip entries invalidated by a period change
+        if (entry.generation != timeInfo.generation || timeInfo.updatePeriodMs <= 0)
         {
-            objinfo->timeToNextUpdateMs -= timeToNextUpdateMs;
-            // Check if time for the next update
-            if (objinfo->timeToNextUpdateMs <= 0)
-            {
-                // Reset timer
-                offset = (-objinfo->timeToNextUpdateMs) % objinfo->updatePeriodMs;
-                objinfo->timeToNextUpdateMs = objinfo->updatePeriodMs - offset;
-                // Send object
-                time.start();
-                processObjectUpdates(objinfo->obj, EV_UPDATED_PERIODIC, true, false);
-                elapsedMs = time.elapsed();
-                // Update timeToNextUpdateMs with the elapsed delay of sending the object;
-                timeToNextUpdateMs += elapsedMs;
-            }
-            // Update minimum delay
-            if (objinfo->timeToNextUpdateMs < minDelay)
-            {
-                minDelay = objinfo->timeToNextUpdateMs;
-            }
+            continue;
         }
-    }
 
-    // Check if delay for the next update is too short
-    if (minDelay < MIN_UPDATE_PERIOD_MS)
-    {
-        minDelay = MIN_UPDATE_PERIOD_MS;
-    }
+        // Track how late this update is being sent
+        quint32 latenessMs = nowMs - entry.dueMs;
+        ++timeInfo.stats.updates;
+        timeInfo.stats.totalLatenessMs += latenessMs;
+        if (latenessMs > timeInfo.stats.maxLatenessMs)
+        {
+            timeInfo.stats.maxLatenessMs = latenessMs;
+        }
 
-    // Done
-    timeToNextUpdateMs = minDelay;
+        // Schedule the next update, skipping any periods that were missed
+        timeInfo.nextUpdateMs = entry.dueMs + (qint64)timeInfo.updatePeriodMs * (1 + latenessMs / timeInfo.updatePeriodMs);
+        scheduleUpdate(entry.index);
+
+        // Send object. This may change the update period, so timeInfo
+        // must not be used past this point.
+        processObjectUpdates(timeInfo.obj, EV_UPDATED_PERIODIC, true, false);
+
+        // Account for the time spent sending the object
+        nowMs = schedulerClock.elapsed();
+    }
 
     // Restart timer
-    updateTimer->start(timeToNextUpdateMs);
+    restartUpdateTimer();
 }
 
 Telemetry::TelemetryStats Telemetry::getStats()
@@ -633,6 +716,20 @@ Telemetry::TelemetryStats Telemetry::getStats()
     stats.txErrors = utalkStats.txErrors + txErrors;
     stats.rxErrors = utalkStats.rxErrors;
     stats.txRetries = txRetries;
+    stats.txDeltaObjects = utalkStats.txDeltaObjects;
+    stats.txDeltaBytesSaved = utalkStats.txDeltaBytesSaved;
+    stats.rxDeltaObjects = utalkStats.rxDeltaObjects;
+    stats.rxDeltaErrors = utalkStats.rxDeltaErrors;
+
+    // Periodic update lateness
+    const QVector<ObjectTimeInfo>::const_iterator iterEnd = objList.constEnd();
+    for (QVector<ObjectTimeInfo>::const_iterator iter = objList.constBegin(); iter != iterEnd; ++iter)
+    {
+        if (iter->stats.updates > 0)
+        {
+            stats.periodicStats.insert(iter->obj->getObjID(), iter->stats);
+        }
+    }
 
     // Done
     return stats;
@@ -643,6 +740,20 @@ void Telemetry::resetStats()
     utalk->resetStats();
     txErrors = 0;
     txRetries = 0;
+
+    const QVector<ObjectTimeInfo>::iterator iterEnd = objList.end();
+    for (QVector<ObjectTimeInfo>::iterator iter = objList.begin(); iter != iterEnd; ++iter)
+    {
+        memset(&iter->stats, 0, sizeof(iter->stats));
+    }
+}
+
+/**
+ * Allow sending objects as deltas, once the autopilot has agreed to it
+ */
+void Telemetry::setDeltaEncoding(bool enabled)
+{
+    utalk->setDeltaEnabled(enabled);
 }
 
 void Telemetry::objectUpdatedAuto(UAVObject* obj)
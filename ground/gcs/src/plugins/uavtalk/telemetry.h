@@ -42,6 +42,10 @@
 #include <QTimer>
 #include <QQueue>
 #include <QMap>
+#include <QHash>
+#include <QElapsedTimer>
+#include <queue>
+#include <vector>
 
 class TransactionKey;
 
@@ -67,6 +71,17 @@ class Telemetry: public QObject
     Q_OBJECT
 
 public:
+    /**
+     * Send-lateness statistics for an object with periodic updates.
+     * Lateness is the time between when an update was due and when it
+     * was actually handed to the transmit queue.
+     */
+    typedef struct {
+        quint32 updates;
+        quint32 totalLatenessMs;
+        quint32 maxLatenessMs;
+    } PeriodicUpdateStats;
+
     typedef struct {
         quint32 txBytes;
         quint32 rxBytes;
@@ -77,12 +92,18 @@ public:
         quint32 txErrors;
         quint32 rxErrors;
         quint32 txRetries;
+        quint32 txDeltaObjects;
+        quint32 txDeltaBytesSaved;
+        quint32 rxDeltaObjects;
+        quint32 rxDeltaErrors;
+        QMap<quint32, PeriodicUpdateStats> periodicStats; /** Keyed by object ID */
     } TelemetryStats;
 
     Telemetry(UAVTalk* utalk, UAVObjectManager* objMngr);
     ~Telemetry();
     TelemetryStats getStats();
     void resetStats();
+    void setDeltaEncoding(bool enabled);
     void transactionTimeout(ObjectTransactionInfo *info);
 
 signals:
@@ -111,9 +132,29 @@ private:
     typedef struct {
         UAVObject* obj;
         qint32 updatePeriodMs;      /** Update period in ms or 0 if no periodic updates are needed */
-        qint32 timeToNextUpdateMs;  /** Time delay to the next update */
+        qint64 nextUpdateMs;        /** Scheduler time at which the next update is due */
+        quint32 generation;         /** Bumped on reschedule to invalidate queued entries */
+        PeriodicUpdateStats stats;
     } ObjectTimeInfo;
 
+    /**
+     * Entry in the periodic update queue. Entries whose generation does not
+     * match the object's are stale and are dropped when they surface.
+     */
+    typedef struct {
+        qint64 dueMs;
+        int index;                  /** Index into objList */
+        quint32 generation;
+    } ScheduleEntry;
+
+    struct ScheduleEntryLater {
+        bool operator()(const ScheduleEntry &a, const ScheduleEntry &b) const {
+            return a.dueMs > b.dueMs;
+        }
+    };
+
+    typedef std::priority_queue<ScheduleEntry, std::vector<ScheduleEntry>, ScheduleEntryLater> ScheduleQueue;
+
     typedef struct {
         UAVObject* obj;
         EventMask event;
@@ -125,12 +166,14 @@ private:
     UAVTalk* utalk;
     GCSTelemetryStats* gcsStatsObj;
     QVector<ObjectTimeInfo> objList;
+    QHash<quint32, int> objListIndex;
+    ScheduleQueue updateQueue;
+    QElapsedTimer schedulerClock;
     QQueue<ObjectQueueInfo> objQueue;
     QQueue<ObjectQueueInfo> objPriorityQueue;
     QMap<TransactionKey, ObjectTransactionInfo*>transMap;
     QTimer* updateTimer;
     QTimer* statsTimer;
-    qint32 timeToNextUpdateMs;
     quint32 txErrors;
     quint32 txRetries;
 
@@ -138,6 +181,9 @@ private:
     void registerObject(UAVObject* obj);
     void addObject(UAVObject* obj);
     void setUpdatePeriod(UAVObject* obj, qint32 periodMs);
+    void scheduleUpdate(int index);
+    void rebuildUpdateQueue();
+    void restartUpdateTimer();
     void connectToObjectInstances(UAVObject* obj, quint32 eventMask);
     void updateObject(UAVObject* obj, quint32 eventMask);
     void processObjectUpdates(UAVObject* obj, EventMask event, bool allInstances, bool priority);
@@ -342,6 +342,10 @@ void TelemetryMonitor::checkSessionObjNacked(UAVObject *obj, bool success, bool
 void TelemetryMonitor::sessionObjUnpackedCB(UAVObject *obj)
 {
     sessionObjRetries = 0;
+    // The autopilot echoes back whether it will send delta packets, which
+    // also means it understands ours. Only asked for when the user allows it.
+    tel->setDeltaEncoding(settings->useDeltaEncoding() &&
+            sessionObj->getDeltaEncoding() == SessionManaging::DELTAENCODING_ENABLED);
     switch(connectionStatus)
     {
     case CON_INITIALIZING:
@@ -488,6 +492,8 @@ void TelemetryMonitor::startSessionRetrieving(UAVObject *session)
         sessionObjRetries = 0;
         connectionStatus = CON_SESSION_INITIALIZING;
         sessionObj->setSessionID(0);
+        sessionObj->setDeltaEncoding(settings->useDeltaEncoding() ?
+                SessionManaging::DELTAENCODING_ENABLED : SessionManaging::DELTAENCODING_DISABLED);
         sessionObj->updated();
     }
     else if(sessionObj->getSessionID() == 0)
@@ -498,6 +504,8 @@ void TelemetryMonitor::startSessionRetrieving(UAVObject *session)
         sessionID = QDateTime::currentDateTime().toTime_t();
         sessionObj->setSessionID(sessionID);
         sessionObj->setObjectOfInterestIndex(0);
+        sessionObj->setDeltaEncoding(settings->useDeltaEncoding() ?
+                SessionManaging::DELTAENCODING_ENABLED : SessionManaging::DELTAENCODING_DISABLED);
         TELEMETRYMONITOR_QXTLOG_DEBUG(QString("%0 SESSION SETUP with numberofobjects:%1 and sessionID:%2").arg(Q_FUNC_INFO)
                                       .arg(objectCount).arg(sessionID));
         sessionObj->updated();
@@ -662,6 +670,7 @@ void TelemetryMonitor::processStatsUpdates()
     {
         statsTimer->setInterval(STATS_CONNECT_PERIOD_MS);
         connectionStatus = CON_DISCONNECTED;
+        tel->setDeltaEncoding(false);
         ExtensionSystem::PluginManager* pm = ExtensionSystem::PluginManager::instance();
         Core::Internal::GeneralSettings * settings=pm->getObject<Core::Internal::GeneralSettings>();
         if (settings->useSessionManaging())
@@ -0,0 +1,392 @@
+/**
+ ******************************************************************************
+ * @file       main.cpp
+ * @author     dRonin, http://dronin.org Copyright (C) 2017
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalkPlugin UAVTalk Plugin
+ * @{
+ * @brief Checks the block parser against the byte-wise one, and times both
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "uavtalk.h"
+#include "uavdataobject.h"
+#include "uavobjectfield.h"
+
+#include <extensionsystem/pluginmanager.h>
+#include <coreplugin/generalsettings.h>
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTextStream>
+
+static const quint8 SYNC_VAL = 0x3C;
+static const quint8 TYPE_OBJ = 0x20;
+static const quint8 TYPE_OBJ_REQ = 0x21;
+static const quint8 TYPE_OBJ_ACK = 0x22;
+
+static const quint32 SMALL_ID = 0x10000000;
+static const quint32 LARGEST_ID = 0x20000000; // as large as a packet allows
+static const quint32 MULTI_ID = 0x30000000;
+static const quint32 UNKNOWN_ID = 0x40000000;
+
+static const int SMALL_SIZE = 24;
+static const int LARGEST_SIZE = 256;
+static const int MULTI_SIZE = 12;
+
+static const int CHUNK_SIZES[] = { 1, 2, 7, 64, 1000, 16 * 1024 };
+
+static const int BENCHMARK_PACKETS = 200000;
+
+static QTextStream out(stdout);
+
+//! An object that is just a byte array
+class TestObject : public UAVDataObject
+{
+public:
+    TestObject(quint32 objId, bool isSingleInst, int numBytes) :
+        UAVDataObject(objId, isSingleInst, false, QString("Test%0").arg(objId, 0, 16)),
+        data(numBytes, 0)
+    {
+        QList<UAVObjectField*> fields;
+        fields.append(new UAVObjectField("Data", "", UAVObjectField::UINT8, numBytes,
+                                         QStringList(), QList<int>()));
+        initializeFields(fields, (quint8*)data.data(), numBytes);
+    }
+
+    Metadata getDefaultMetadata()
+    {
+        Metadata metadata;
+        memset(&metadata, 0, sizeof(metadata));
+        return metadata;
+    }
+
+    UAVDataObject* clone(quint32 instID)
+    {
+        TestObject* obj = new TestObject(getObjID(), isSingleInstance(), data.size());
+        obj->initialize(instID, getMetaObject());
+        return obj;
+    }
+
+    UAVDataObject* dirtyClone()
+    {
+        return new TestObject(getObjID(), isSingleInstance(), data.size());
+    }
+
+private:
+    QByteArray data;
+};
+
+//! Keeps what UAVTalk sends back, there is never anything to read
+class Sink : public QIODevice
+{
+public:
+    Sink() { open(QIODevice::ReadWrite); }
+
+    QByteArray written;
+
+protected:
+    qint64 readData(char*, qint64) { return 0; }
+    qint64 writeData(const char* data, qint64 len)
+    {
+        written.append(data, len);
+        return len;
+    }
+};
+
+//! A link as the GCS has it: objects, a device and the protocol on top
+struct Link {
+    Link() : talk(&sink, &objMngr)
+    {
+        objMngr.registerObject(new TestObject(SMALL_ID, true, SMALL_SIZE));
+        objMngr.registerObject(new TestObject(LARGEST_ID, true, LARGEST_SIZE));
+        objMngr.registerObject(new TestObject(MULTI_ID, false, MULTI_SIZE));
+
+        UAVDataObject* multi = dynamic_cast<UAVDataObject*>(objMngr.getObject(MULTI_ID));
+        objMngr.registerObject(multi->clone(1));
+    }
+
+    //! Everything the stream did to the link, for comparing
+    QByteArray outcome()
+    {
+        QByteArray result;
+        QDataStream stream(&result, QIODevice::WriteOnly);
+        UAVTalk::ComStats stats = talk.getStats();
+
+        stream << stats.rxBytes << stats.rxObjectBytes << stats.rxObjects << stats.rxErrors
+               << stats.txBytes << stats.txObjects << sink.written;
+
+        QHash<quint32, QMap<quint32, UAVObject*> > objects = objMngr.getObjects();
+        QList<quint32> ids = objects.keys();
+        qSort(ids);
+        foreach (quint32 id, ids) {
+            foreach (UAVObject* obj, objects.value(id)) {
+                QByteArray data(obj->getNumBytes(), 0);
+                obj->pack((quint8*)data.data());
+                stream << id << obj->getInstID() << data;
+            }
+        }
+
+        return result;
+    }
+
+    UAVObjectManager objMngr;
+    Sink sink;
+    UAVTalk talk;
+};
+
+//! Deterministic so that a mismatch can be reproduced
+class Random
+{
+public:
+    Random(quint32 seed) : state(seed) {}
+
+    quint32 next(quint32 range)
+    {
+        state = state * 1103515245 + 12345;
+        return (state >> 8) % range;
+    }
+
+private:
+    quint32 state;
+};
+
+//! CRC-8 (poly 0x07, initial value 0) as used by UAVTalk
+static quint8 crc8(const QByteArray &data)
+{
+    quint8 crc = 0;
+    for (int i = 0; i < data.size(); i++) {
+        crc ^= (quint8)data.at(i);
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+    return crc;
+}
+
+static QByteArray packet(quint8 type, quint32 objId, int instId, const QByteArray &data)
+{
+    QByteArray p;
+    p.append((char)SYNC_VAL);
+    p.append((char)type);
+    p.append((char)0); // length, filled in below
+    p.append((char)0);
+    for (int i = 0; i < 4; i++)
+        p.append((char)(objId >> (8 * i)));
+    if (instId >= 0) {
+        p.append((char)(instId & 0xff));
+        p.append((char)(instId >> 8));
+    }
+    p.append(data);
+    p[2] = (char)(p.size() & 0xff);
+    p[3] = (char)(p.size() >> 8);
+    p.append((char)crc8(p));
+    return p;
+}
+
+static QByteArray randomBytes(Random &random, int length)
+{
+    QByteArray bytes(length, 0);
+    for (int i = 0; i < length; i++)
+        bytes[i] = (char)random.next(256);
+    return bytes;
+}
+
+//! An update of one of the known objects
+static QByteArray objectPacket(Random &random, quint8 type)
+{
+    switch (random.next(4)) {
+    case 0:
+        return packet(type, SMALL_ID, -1, randomBytes(random, SMALL_SIZE));
+    case 1:
+        return packet(type, LARGEST_ID, -1, randomBytes(random, LARGEST_SIZE));
+    default:
+        // Instance 2 doesn't exist until the first update for it
+        return packet(type, MULTI_ID, random.next(3), randomBytes(random, MULTI_SIZE));
+    }
+}
+
+/**
+ * A stream with all the ways a link goes wrong: garbage (sync bytes
+ * included) between packets, packets with bad CRCs, packets cut short,
+ * objects we don't know, and requests and acked updates we reply to.
+ */
+static QByteArray makeStream(Random &random, int packets, bool clean)
+{
+    QByteArray stream;
+
+    for (int i = 0; i < packets; i++) {
+        int kind = clean ? 0 : random.next(12);
+
+        if (kind < 6) {
+            stream.append(objectPacket(random, TYPE_OBJ));
+        } else if (kind == 6) {
+            QByteArray garbage = randomBytes(random, 1 + random.next(20));
+            if (random.next(2))
+                garbage[random.next(garbage.size())] = (char)SYNC_VAL;
+            stream.append(garbage);
+        } else if (kind == 7) {
+            QByteArray p = objectPacket(random, TYPE_OBJ);
+            p[p.size() - 1] = (char)(p.at(p.size() - 1) ^ (1 + random.next(255)));
+            stream.append(p);
+        } else if (kind == 8) {
+            QByteArray p = objectPacket(random, TYPE_OBJ);
+            stream.append(p.left(1 + random.next(p.size() - 1)));
+        } else if (kind == 9) {
+            stream.append(packet(TYPE_OBJ, UNKNOWN_ID, -1, randomBytes(random, SMALL_SIZE)));
+        } else if (kind == 10) {
+            stream.append(packet(TYPE_OBJ_REQ, random.next(2) ? SMALL_ID : UNKNOWN_ID, -1, QByteArray()));
+        } else {
+            stream.append(objectPacket(random, TYPE_OBJ_ACK));
+        }
+    }
+
+    return stream;
+}
+
+//! The parser as it was: one byte at a time through the state machine
+static void feedBytewise(UAVTalk &talk, const QByteArray &stream)
+{
+    const quint8* data = (const quint8*)stream.constData();
+    for (int i = 0; i < stream.size(); i++)
+        talk.processInputByte(data[i]);
+}
+
+//! The parser as it is: reads of up to chunk bytes
+static void feedBlocks(UAVTalk &talk, const QByteArray &stream, int chunk)
+{
+    const quint8* data = (const quint8*)stream.constData();
+    for (int pos = 0; pos < stream.size(); pos += chunk)
+        talk.processInputBytes(&data[pos], qMin(chunk, stream.size() - pos));
+}
+
+static bool checkSame(const QByteArray &stream, const QString &name)
+{
+    Link expected;
+    feedBytewise(expected.talk, stream);
+    QByteArray want = expected.outcome();
+
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(CHUNK_SIZES) / sizeof(CHUNK_SIZES[0]); i++) {
+        Link actual;
+        feedBlocks(actual.talk, stream, CHUNK_SIZES[i]);
+        if (actual.outcome() != want) {
+            out << "FAIL: " << name << " differs from the byte-wise parser in reads of "
+                << CHUNK_SIZES[i] << " bytes" << endl;
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+
+//! An object as large as a packet allows goes through both parsers
+static bool checkLargest()
+{
+    Random random(7);
+    QByteArray data = randomBytes(random, LARGEST_SIZE);
+    QByteArray stream = packet(TYPE_OBJ, LARGEST_ID, -1, data);
+
+    bool ok = true;
+    for (int blocks = 0; blocks < 2; blocks++) {
+        Link link;
+        if (blocks)
+            feedBlocks(link.talk, stream, stream.size());
+        else
+            feedBytewise(link.talk, stream);
+
+        QByteArray got(LARGEST_SIZE, 0);
+        link.objMngr.getObject(LARGEST_ID)->pack((quint8*)got.data());
+        if (got != data || link.talk.getStats().rxObjects != 1) {
+            out << "FAIL: " << LARGEST_SIZE << " byte object dropped by the "
+                << (blocks ? "block" : "byte-wise") << " parser" << endl;
+            ok = false;
+        }
+    }
+
+    return ok;
+}
+
+static void report(const QString &name, qint64 elapsedNs, int bytes)
+{
+    double seconds = qMax<qint64>(elapsedNs, 1) / 1e9;
+
+    out << QString("%0: %1 MB/s, %2 ns/packet")
+           .arg(name, -28)
+           .arg(bytes / seconds / 1e6, 0, 'f', 1)
+           .arg(elapsedNs / (double) BENCHMARK_PACKETS, 0, 'f', 1) << endl;
+}
+
+static void benchmark(const QByteArray &stream, const QString &name)
+{
+    QElapsedTimer timer;
+
+    out << name << " (" << stream.size() << " bytes)" << endl;
+
+    {
+        Link link;
+        timer.start();
+        feedBytewise(link.talk, stream);
+        report("  processInputByte()", timer.nsecsElapsed(), stream.size());
+    }
+
+    {
+        Link link;
+        timer.start();
+        feedBlocks(link.talk, stream, 16 * 1024);
+        report("  processInputBytes()", timer.nsecsElapsed(), stream.size());
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    // UAVTalk looks up the general settings, as it would in the GCS
+    ExtensionSystem::PluginManager pm;
+    pm.addObject(new Core::Internal::GeneralSettings);
+
+    bool ok = true;
+
+    ok &= checkLargest();
+
+    for (quint32 seed = 1; seed <= 20; seed++) {
+        Random random(seed);
+        ok &= checkSame(makeStream(random, 500, false), QString("stream %0").arg(seed));
+    }
+
+    // Garbage at the start, and a link that only ever sees garbage
+    {
+        Random random(100);
+        QByteArray stream = randomBytes(random, 1000);
+        ok &= checkSame(stream, "garbage");
+        stream.append(makeStream(random, 200, true));
+        ok &= checkSame(stream, "garbage then packets");
+    }
+
+    out << (ok ? "Block parser matches the byte-wise parser" : "Block parser MISMATCH") << endl;
+
+    Random random(1000);
+    benchmark(makeStream(random, BENCHMARK_PACKETS, true), "Clean stream");
+    benchmark(makeStream(random, BENCHMARK_PACKETS, false), "Noisy stream");
+
+    return ok ? 0 : 1;
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,25 @@
+# Checks the block parser in UAVTalk::processInputBytes() against the
+# byte-wise state machine and times the two, build against the UAVTalk
+# plugin of a normal GCS build:
+#   qmake parserbenchmark.pro && make && ./parserbenchmark
+include(../../../../../gcs.pri)
+include(../../../../rpath.pri)
+
+QT -= gui
+QT += network
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+TARGET = parserbenchmark
+TEMPLATE = app
+
+LIBS += -L$$GCS_PLUGIN_PATH/dRonin
+include(../../uavtalk.pri)
+INCLUDEPATH += $$PWD/../.. $$PWD/../../..
+
+linux-* {
+    QMAKE_LFLAGS += \'-Wl,-rpath,$$GCS_PLUGIN_PATH/dRonin\'
+}
+
+SOURCES += main.cpp
@@ -45,8 +45,6 @@
   #define UAVTALK_QXTLOG_DEBUG(...)
 #endif	// UAVTALK_DEBUG
 
-#define SYNC_VAL 0x3C
-
 const quint8 UAVTalk::crc_table[256] = {
     0x00, 0x07, 0x0e, 0x09, 0x1c, 0x1b, 0x12, 0x15, 0x38, 0x3f, 0x36, 0x31, 0x24, 0x23, 0x2a, 0x2d,
     0x70, 0x77, 0x7e, 0x79, 0x6c, 0x6b, 0x62, 0x65, 0x48, 0x4f, 0x46, 0x41, 0x54, 0x53, 0x5a, 0x5d,
@@ -79,8 +77,12 @@ UAVTalk::UAVTalk(QIODevice* iodev, UAVObjectManager* objMngr)
     rxState = STATE_SYNC;
     rxPacketLength = 0;
 
+    deltaEnabled = false;
+
     memset(&stats, 0, sizeof(ComStats));
 
+    rxReadBuffer.resize(RX_READ_BUFFER_SIZE);
+
     connect(io, SIGNAL(readyRead()), this, SLOT(processInputStream()));
     ExtensionSystem::PluginManager *pm = ExtensionSystem::PluginManager::instance();
     Core::Internal::GeneralSettings * settings=pm->getObject<Core::Internal::GeneralSettings>();
@@ -121,18 +123,34 @@ UAVTalk::ComStats UAVTalk::getStats()
     return stats;
 }
 
+/**
+ * Allow or stop sending objects as deltas against the copy last sent.
+ * Only enable once the other end has said it understands delta packets;
+ * they are always accepted on receive.
+ */
+void UAVTalk::setDeltaEnabled(bool enabled)
+{
+    if (enabled == deltaEnabled)
+        return;
+
+    deltaEnabled = enabled;
+    deltaBases.clear();
+}
+
 /**
  * Called each time there are data in the input buffer
  */
 void UAVTalk::processInputStream()
 {
-    quint8 tmp;
-
     if (io && io->isReadable()) {
         while (io->bytesAvailable() > 0)
         {
-            io->read((char*)&tmp, 1);
-            processInputByte(tmp);
+            qint64 toRead = qMin<qint64>(io->bytesAvailable(), RX_READ_BUFFER_SIZE);
+            qint64 numRead = io->read(rxReadBuffer.data(), toRead);
+            if (numRead <= 0)
+                break;
+
+            processInputBytes((const quint8 *)rxReadBuffer.constData(), numRead);
         }
     }
 }
@@ -200,6 +218,118 @@ bool UAVTalk::objectTransaction(UAVObject* obj, quint8 type, bool allInstances)
     }
 }
 
+/**
+ * Process a block of bytes from the telemetry stream.
+ *
+ * Complete packets that lie entirely within the block are validated and
+ * dispatched directly from the block. Anything else (a packet straddling
+ * the block boundary, or a malformed packet) goes through the byte-wise
+ * state machine in processInputByte() so error handling stays identical.
+ * \param[in] data Received bytes
+ * \param[in] length Number of bytes in data
+ */
+void UAVTalk::processInputBytes(const quint8 *data, qint64 length)
+{
+    qint64 pos = 0;
+
+    while (pos < length)
+    {
+        // Finish any packet that was started in a previous block
+        if (rxState != STATE_SYNC)
+        {
+            processInputByte(data[pos++]);
+            continue;
+        }
+
+        // Hunt for the next sync byte
+        const quint8 *sync = (const quint8 *)memchr(&data[pos], SYNC_VAL, length - pos);
+        if (sync == NULL)
+        {
+            stats.rxBytes += length - pos;
+            return;
+        }
+
+        stats.rxBytes += sync - &data[pos];
+        pos = sync - data;
+
+        qint64 consumed = processPacket(&data[pos], length - pos);
+        if (consumed > 0)
+        {
+            pos += consumed;
+        }
+        else
+        {
+            // Incomplete or invalid, let the state machine deal with it
+            processInputByte(data[pos++]);
+        }
+    }
+}
+
+/**
+ * Parse and dispatch a complete packet starting with a sync byte.
+ * \param[in] data Buffer starting at the sync byte
+ * \param[in] length Number of bytes available in data
+ * \return Number of bytes consumed, or 0 if the buffer does not start with
+ * a complete, valid packet for a known object
+ */
+qint64 UAVTalk::processPacket(const quint8 *data, qint64 length)
+{
+    if (length < MIN_HEADER_LENGTH + CHECKSUM_LENGTH)
+        return 0;
+
+    quint8 type = data[1];
+    if ((type & TYPE_MASK) != TYPE_VER)
+        return 0;
+
+    quint16 size = qFromLittleEndian<quint16>(&data[2]);
+    if (size < MIN_HEADER_LENGTH || size > MAX_HEADER_LENGTH + MAX_PAYLOAD_LENGTH)
+        return 0;
+
+    if (length < size + CHECKSUM_LENGTH)
+        return 0;
+
+    quint32 objId = qFromLittleEndian<quint32>(&data[4]);
+    UAVObject *obj = objMngr->getObject(objId);
+    if (obj == NULL)
+        return 0;
+
+    int headerLength = obj->isSingleInstance() ? MIN_HEADER_LENGTH : MAX_HEADER_LENGTH;
+
+    quint16 dataLength;
+    if (type == TYPE_OBJ_REQ || type == TYPE_ACK || type == TYPE_NACK)
+        dataLength = 0;
+    else if (type == TYPE_OBJ_DELTA)
+        dataLength = (size > headerLength) ? size - headerLength : 0; // variable length
+    else
+        dataLength = obj->getNumBytes();
+
+    if (dataLength > MAX_PAYLOAD_LENGTH)
+        return 0;
+
+    if (headerLength + dataLength != size)
+        return 0;
+
+    if (updateCRC(0, data, size) != data[size])
+        return 0;
+
+    quint16 instId = 0;
+    if (!obj->isSingleInstance())
+        instId = qFromLittleEndian<quint16>(&data[8]);
+
+    stats.rxBytes += size + CHECKSUM_LENGTH;
+
+    memcpy(rxBuffer, &data[headerLength], dataLength);
+    receiveObject(type, objId, instId, rxBuffer, dataLength);
+    if(useUDPMirror)
+    {
+        udpSocketTx->writeDatagram((const char *)data, size + CHECKSUM_LENGTH, QHostAddress::LocalHost, udpSocketRx->localPort());
+    }
+    stats.rxObjectBytes += dataLength;
+    stats.rxObjects++;
+
+    return size + CHECKSUM_LENGTH;
+}
+
 /**
  * Process a byte from the telemetry stream.
  * \param[in] rxbyte Received byte
@@ -334,7 +464,7 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
                 }
 
                 // Check length and determine next state
-                if (rxLength >= MAX_PAYLOAD_LENGTH)
+                if (rxLength > MAX_PAYLOAD_LENGTH)
                 {
                     stats.rxErrors++;
                     rxState = STATE_SYNC;
@@ -343,6 +473,26 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
                 }
 
                 quint8 rxInstanceLength = (rxObj->isSingleInstance() ? 0 : 2);
+                if (rxType == TYPE_OBJ_DELTA)
+                {
+                    // Delta packets are variable length
+                    if (packetSize <= rxPacketLength + rxInstanceLength)
+                    {
+                        stats.rxErrors++;
+                        rxState = STATE_SYNC;
+                        UAVTALK_QXTLOG_DEBUG("UAVTalk: ObjID->Sync (empty delta)");
+                        break;
+                    }
+                    rxLength = packetSize - rxPacketLength - rxInstanceLength;
+                    if (rxLength > MAX_PAYLOAD_LENGTH)
+                    {
+                        stats.rxErrors++;
+                        rxState = STATE_SYNC;
+                        UAVTALK_QXTLOG_DEBUG("UAVTalk: ObjID->Sync (oversize)");
+                        break;
+                    }
+                }
+
                 if ((rxPacketLength + rxInstanceLength + rxLength) != packetSize)
                 {   // packet error - mismatched packet size
                     stats.rxErrors++;
@@ -468,7 +618,7 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
 
 /**
  * Receive an object. This function process objects received through the telemetry stream.
- * \param[in] type Type of received message (TYPE_OBJ, TYPE_OBJ_REQ, TYPE_OBJ_ACK, TYPE_ACK, TYPE_NACK)
+ * \param[in] type Type of received message (TYPE_OBJ, TYPE_OBJ_REQ, TYPE_OBJ_ACK, TYPE_ACK, TYPE_NACK, TYPE_OBJ_DELTA)
  * \param[in] obj Handle of the received object
  * \param[in] instId The instance ID of UAVOBJ_ALL_INSTANCES for all instances.
  * \param[in] data Data buffer
@@ -477,7 +627,6 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
  */
 bool UAVTalk::receiveObject(quint8 type, quint32 objId, quint16 instId, quint8* data, qint32 length)
 {
-    Q_UNUSED(length);
     UAVObject* obj = NULL;
     bool error = false;
     bool allInstances =  (instId == ALL_INSTANCES);
@@ -525,6 +674,32 @@ bool UAVTalk::receiveObject(quint8 type, quint32 objId, quint16 instId, quint8*
             error = true;
         }
         break;
+    case TYPE_OBJ_DELTA: // We have received the changes to an object
+        // All instances, not allowed for delta messages
+        if (!allInstances)
+        {
+            obj = objMngr->getObject(objId, instId);
+            if (obj == NULL || !applyDelta(obj, data, length))
+            {
+                // We don't have what the delta was made against, so
+                // ask for the whole object.
+                UAVObject* tobj = objMngr->getObject(objId);
+                if (obj != NULL)
+                {
+                    transmitSingleObject(obj, TYPE_OBJ_REQ, false);
+                }
+                else if (tobj != NULL)
+                {
+                    transmitSingleObject(tobj, TYPE_OBJ_REQ, true);
+                }
+                error = true;
+            }
+        }
+        else
+        {
+            error = true;
+        }
+        break;
     case TYPE_OBJ_REQ:  // We are being asked for an object
         // Get object, if all instances are requested get instance 0 of the object
         if (allInstances)
@@ -538,6 +713,9 @@ bool UAVTalk::receiveObject(quint8 type, quint32 objId, quint16 instId, quint8*
         // If object was found transmit it
         if (obj != NULL)
         {
+            // The requester may not have what we last sent, so answer
+            // in full
+            forgetDeltaBases(objId);
             transmitObject(obj, TYPE_OBJ, allInstances);
         }
         else
@@ -637,6 +815,127 @@ UAVObject* UAVTalk::updateObject(quint32 objId, quint16 instId, quint8* data)
 }
 
 
+/**
+ * Apply a received delta packet to our copy of an object instance.
+ * \param[in] obj Object instance
+ * \param[in] data Delta payload (CRC-16 of the base followed by runs of
+ * offset, length and bytes)
+ * \param[in] length Payload length
+ * \return Success (true), Failure (false) if malformed or our copy differs
+ * from the one the delta was made against
+ */
+bool UAVTalk::applyDelta(UAVObject* obj, const quint8* data, qint32 length)
+{
+    qint32 objLength = obj->getNumBytes();
+    QByteArray current(objLength, 0);
+    quint8* buf = (quint8*)current.data();
+
+    if (length < DELTA_BASE_CRC_LENGTH || objLength > MAX_PAYLOAD_LENGTH || !obj->pack(buf))
+    {
+        stats.rxDeltaErrors++;
+        return false;
+    }
+
+    quint16 baseCrc = data[0] | (data[1] << 8);
+    if (updateCRC16(0, buf, objLength) != baseCrc)
+    {
+        stats.rxDeltaErrors++;
+        return false;
+    }
+
+    for (qint32 pos = DELTA_BASE_CRC_LENGTH; pos < length; )
+    {
+        if (pos + DELTA_RUN_HEADER_LENGTH > length)
+        {
+            stats.rxDeltaErrors++;
+            return false;
+        }
+
+        quint8 offset = data[pos];
+        quint8 runLength = data[pos + 1];
+        pos += DELTA_RUN_HEADER_LENGTH;
+
+        if (runLength == 0 || offset + runLength > objLength || pos + runLength > length)
+        {
+            stats.rxDeltaErrors++;
+            return false;
+        }
+
+        memcpy(&buf[offset], &data[pos], runLength);
+        pos += runLength;
+    }
+
+    stats.rxDeltaObjects++;
+    obj->unpack(buf);
+    return true;
+}
+
+/**
+ * Drop the delta bases of all instances of an object, so that they are
+ * next sent in full.
+ */
+void UAVTalk::forgetDeltaBases(quint32 objId)
+{
+    QHash<quint64, DeltaBase>::iterator iter = deltaBases.begin();
+    while (iter != deltaBases.end())
+    {
+        if ((iter.key() >> 16) == objId)
+            iter = deltaBases.erase(iter);
+        else
+            ++iter;
+    }
+}
+
+/**
+ * Encode the difference between two copies of an object as runs of
+ * (offset, length, bytes). Runs separated by fewer unchanged bytes than a
+ * run header are merged.
+ * \param[in] base Copy the other end has
+ * \param[in] current Copy to send
+ * \param[in] length Object length
+ * \param[out] out Where to write the runs
+ * \param[in] maxLength Give up if the runs need more than this
+ * \return Length of the runs, or -1 if they didn't fit
+ */
+qint32 UAVTalk::encodeDelta(const quint8* base, const quint8* current, qint32 length, quint8* out, qint32 maxLength)
+{
+    qint32 outLength = 0;
+    qint32 pos = 0;
+
+    while (pos < length)
+    {
+        if (base[pos] == current[pos])
+        {
+            pos++;
+            continue;
+        }
+
+        qint32 start = pos;
+        qint32 end = pos + 1;
+
+        for (qint32 i = end; i < length && i - start < DELTA_MAX_RUN; i++)
+        {
+            if (base[i] != current[i])
+                end = i + 1;
+            else if (i - end >= DELTA_RUN_HEADER_LENGTH)
+                break;
+        }
+
+        qint32 runLength = end - start;
+        if (outLength + DELTA_RUN_HEADER_LENGTH + runLength > maxLength)
+            return -1;
+
+        out[outLength++] = start;
+        out[outLength++] = runLength;
+        memcpy(&out[outLength], &current[start], runLength);
+        outLength += runLength;
+
+        pos = end;
+    }
+
+    return outLength;
+}
+
 /**
  * Send an object through the telemetry link.
  * \param[in] obj Object to send
@@ -801,6 +1100,51 @@ bool UAVTalk::transmitSingleObject(UAVObject* obj, quint8 type, bool allInstance
         }
     }
 
+    // Send only what changed since the last copy, if that's smaller
+    qint32 fullLength = length;
+    quint64 deltaKey = ((quint64)objId << 16) | obj->getInstID();
+    bool useDelta = deltaEnabled && type == TYPE_OBJ && length >= DELTA_MIN_LENGTH;
+
+    if (useDelta)
+    {
+        quint8* current = &txBuffer[dataOffset];
+        QHash<quint64, DeltaBase>::iterator base = deltaBases.find(deltaKey);
+        qint32 deltaLength = -1;
+        quint8 delta[MAX_PAYLOAD_LENGTH];
+
+        if (base == deltaBases.end())
+        {
+            base = deltaBases.insert(deltaKey, DeltaBase());
+            base->sendsSinceFull = DELTA_FULL_INTERVAL;
+        }
+        else if (base->sendsSinceFull < DELTA_FULL_INTERVAL)
+        {
+            const quint8* baseData = (const quint8*)base->data.constData();
+            quint16 baseCrc = updateCRC16(0, baseData, length);
+            delta[0] = baseCrc & 0xFF;
+            delta[1] = baseCrc >> 8;
+            // Only worth it if it comes out shorter than the object
+            deltaLength = encodeDelta(baseData, current, length, &delta[DELTA_BASE_CRC_LENGTH],
+                                      length - DELTA_BASE_CRC_LENGTH - 1);
+        }
+
+        // Whatever goes out becomes the other end's copy
+        base->data = QByteArray((const char*)current, length);
+
+        if (deltaLength >= 0)
+        {
+            deltaLength += DELTA_BASE_CRC_LENGTH;
+            memcpy(current, delta, deltaLength);
+            txBuffer[1] = TYPE_OBJ_DELTA;
+            length = deltaLength;
+            base->sendsSinceFull++;
+        }
+        else
+        {
+            base->sendsSinceFull = 0;
+        }
+    }
+
     qToLittleEndian<quint16>(dataOffset + length, &txBuffer[2]);
 
     // Calculate checksum
@@ -818,6 +1162,9 @@ bool UAVTalk::transmitSingleObject(UAVObject* obj, quint8 type, bool allInstance
     else
     {
         ++stats.txErrors;
+        // The other end didn't get it; start over with a full send
+        if (useDelta)
+            deltaBases.remove(deltaKey);
         return false;
     }
 
@@ -825,6 +1172,11 @@ bool UAVTalk::transmitSingleObject(UAVObject* obj, quint8 type, bool allInstance
     ++stats.txObjects;
     stats.txBytes += dataOffset+length+CHECKSUM_LENGTH;
     stats.txObjectBytes += length;
+    if (length != fullLength)
+    {
+        ++stats.txDeltaObjects;
+        stats.txDeltaBytesSaved += fullLength - length;
+    }
 
     // Done
     return true;
@@ -858,3 +1210,19 @@ quint8 UAVTalk::updateCRC(quint8 crc, const quint8* data, qint32 length)
         crc = crc_table[crc ^ *data++];
     return crc;
 }
+
+/**
+ * CRC-16-CCITT (poly 0x1021), matching PIOS_CRC16_CCITT_updateCRC on the
+ * flight side.  Only used to check delta bases and flight log blocks, so not
+ * table driven.
+ */
+quint16 UAVTalk::updateCRC16(quint16 crc, const quint8* data, qint32 length)
+{
+    while (length--)
+    {
+        crc ^= *data++ << 8;
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
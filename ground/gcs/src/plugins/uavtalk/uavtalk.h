@@ -57,6 +57,10 @@ public:
         quint32 txObjects;
         quint32 txErrors;
         quint32 rxErrors;
+        quint32 txDeltaObjects;
+        quint32 txDeltaBytesSaved;
+        quint32 rxDeltaObjects;
+        quint32 rxDeltaErrors;
     } ComStats;
 
     UAVTalk(QIODevice* iodev, UAVObjectManager* objMngr);
@@ -65,8 +69,10 @@ public:
     bool sendObjectRequest(UAVObject* obj, bool allInstances);
     ComStats getStats();
     void resetStats();
+    void setDeltaEnabled(bool enabled);
 
     bool processInputByte(quint8 rxbyte);
+    void processInputBytes(const quint8 *data, qint64 length);
 
 signals:
     // The only signals we send to the upper level are when we
@@ -78,9 +84,9 @@ private slots:
     void processInputStream(void);
     void dummyUDPRead();
 
-protected:
-
-    // Constants
+public:
+    // Constants, also used by the readers of flight logs
+    static const quint8 SYNC_VAL = 0x3C;
     static const int TYPE_MASK = 0xF8;
     static const int TYPE_VER = 0x20;
     static const int TYPE_OBJ = (TYPE_VER | 0x00);
@@ -88,7 +94,16 @@ protected:
     static const int TYPE_OBJ_ACK = (TYPE_VER | 0x02);
     static const int TYPE_ACK = (TYPE_VER | 0x03);
     static const int TYPE_NACK = (TYPE_VER | 0x04);
+    static const int TYPE_OBJ_DELTA = (TYPE_VER | 0x05);
+    static const int TYPE_TIMESTAMPED = 0x80; // flight logs only: a uint16 of ms follows the IDs
+
+    static quint8 updateCRC(quint8 crc, const quint8 data);
+    static quint8 updateCRC(quint8 crc, const quint8* data, qint32 length);
+    static quint16 updateCRC16(quint16 crc, const quint8* data, qint32 length);
+
+protected:
 
+    // Constants
     static const int MIN_HEADER_LENGTH = 8; // sync(1), type (1), size(2), object ID(4)
     static const int MAX_HEADER_LENGTH = 10; // sync(1), type (1), size(2), object ID (4), instance ID(2, not used in single objects)
 
@@ -98,19 +113,32 @@ protected:
 
     static const int MAX_PACKET_LENGTH = (MAX_HEADER_LENGTH + MAX_PAYLOAD_LENGTH + CHECKSUM_LENGTH);
 
+    static const int DELTA_BASE_CRC_LENGTH = 2; // CRC-16-CCITT of the base, little endian
+    static const int DELTA_RUN_HEADER_LENGTH = 2; // offset(1), length(1)
+    static const int DELTA_MAX_RUN = 255;
+    static const int DELTA_MIN_LENGTH = 32; // smaller objects are always sent in full
+    static const int DELTA_FULL_INTERVAL = 16; // deltas between full sends
+
     static const quint16 ALL_INSTANCES = 0xFFFF;
     static const quint16 OBJID_NOTFOUND = 0x0000;
 
     static const int TX_BUFFER_SIZE = 2*1024;
+    static const int RX_READ_BUFFER_SIZE = 16*1024;
     static const quint8 crc_table[256];
 
     // Types
     typedef enum {STATE_SYNC, STATE_TYPE, STATE_SIZE, STATE_OBJID, STATE_INSTID, STATE_DATA, STATE_CS} RxStateType;
 
+    typedef struct {
+        QByteArray data; /** The copy the other end was last sent */
+        quint8 sendsSinceFull;
+    } DeltaBase;
+
     // Variables
     QPointer<QIODevice> io;
     UAVObjectManager* objMngr;
     quint8 rxBuffer[MAX_PACKET_LENGTH];
+    QByteArray rxReadBuffer;
     quint8 txBuffer[MAX_PACKET_LENGTH];
     // Variables used by the receive state machine
     quint8 rxTmpBuffer[4];
@@ -126,20 +154,25 @@ protected:
     RxStateType rxState;
     ComStats stats;
 
+    bool deltaEnabled;
+    QHash<quint64, DeltaBase> deltaBases; /** Keyed by object and instance ID */
+
     bool useUDPMirror;
     QUdpSocket * udpSocketTx;
     QUdpSocket * udpSocketRx;
     QByteArray rxDataArray;
 
     // Methods
+    qint64 processPacket(const quint8 *data, qint64 length);
     bool objectTransaction(UAVObject* obj, quint8 type, bool allInstances);
     virtual bool receiveObject(quint8 type, quint32 objId, quint16 instId, quint8* data, qint32 length);
     UAVObject* updateObject(quint32 objId, quint16 instId, quint8* data);
+    bool applyDelta(UAVObject* obj, const quint8* data, qint32 length);
+    void forgetDeltaBases(quint32 objId);
+    static qint32 encodeDelta(const quint8* base, const quint8* current, qint32 length, quint8* out, qint32 maxLength);
     bool transmitNack(quint32 objId);
     bool transmitObject(UAVObject* obj, quint8 type, bool allInstances);
     bool transmitSingleObject(UAVObject* obj, quint8 type, bool allInstances);
-    quint8 updateCRC(quint8 crc, const quint8 data);
-    quint8 updateCRC(quint8 crc, const quint8* data, qint32 length);
 };
 
 #endif // UAVTALK_H
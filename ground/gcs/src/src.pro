@@ -6,3 +6,8 @@ SUBDIRS = \
     plugins \
     app \
     crashreporterapp
+
+LOGEXPORT {
+    # Headless log to CSV/columnar converter
+    SUBDIRS += logexport
+}
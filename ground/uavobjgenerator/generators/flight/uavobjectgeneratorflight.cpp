@@ -38,6 +38,7 @@ bool UAVObjectGeneratorFlight::generate(UAVObjectParser* parser,QString template
             <<"uint16_t" << "uint32_t" << "float" << "uint8_t";
 
     QString flightObjInit,objInc,objFileNames,objNames;
+    QList<quint32> objIds;
     qint32 sizeCalc;
     flightCodePath = QDir( templatepath + QString("flight/UAVObjects"));
     flightOutputPath = QDir( outputpath + QString("flight") );
@@ -48,8 +49,10 @@ bool UAVObjectGeneratorFlight::generate(UAVObjectParser* parser,QString template
     flightInitTemplate = readFile( flightCodePath.absoluteFilePath("uavobjectsinittemplate.c") );
     flightInitIncludeTemplate = readFile( flightCodePath.absoluteFilePath("inc/uavobjectsinittemplate.h") );
     flightVersionTemplate = readFile( flightCodePath.absoluteFilePath("inc/uavoversiontemplate.h") );
+    flightIndexTemplate = readFile( flightCodePath.absoluteFilePath("uavobjectsindextemplate.c") );
 
-    if ( flightCodeTemplate.isNull() || flightIncludeTemplate.isNull() || flightInitTemplate.isNull()) {
+    if ( flightCodeTemplate.isNull() || flightIncludeTemplate.isNull() || flightInitTemplate.isNull() ||
+            flightIndexTemplate.isNull()) {
             cerr << "Error: Could not open flight template files." << endl;
             return false;
         }
@@ -62,6 +65,7 @@ bool UAVObjectGeneratorFlight::generate(UAVObjectParser* parser,QString template
         objInc.append("#include \"" + info->namelc + ".h\"\r\n");
 	objFileNames.append(" " + info->namelc);
 	objNames.append(" " + info->name);
+	objIds.append(info->id);
 	if (parser->getNumBytes(objidx)>sizeCalc) {
 		sizeCalc = parser->getNumBytes(objidx);
 	}
@@ -77,8 +81,24 @@ bool UAVObjectGeneratorFlight::generate(UAVObjectParser* parser,QString template
         return false;
     }
 
+    // Write the flight object ID index, sorted so the object manager
+    // can binary search it
+    qSort(objIds);
+    QString objIdList;
+    foreach (quint32 objId, objIds) {
+        objIdList.append(QString("\t0x") + QString().setNum(objId, 16).toUpper() + ",\r\n");
+    }
+    flightIndexTemplate.replace( QString("$(OBJIDS)"), objIdList);
+    res = writeFileIfDiffrent( flightOutputPath.absolutePath() + "/uavobjectsindex.c",
+                     flightIndexTemplate );
+    if (!res) {
+        cout << "Error: Could not write flight object index file" << endl;
+        return false;
+    }
+
     // Write the flight object initialization header
     flightInitIncludeTemplate.replace( QString("$(SIZECALCULATION)"), QString().setNum(sizeCalc));
+    flightInitIncludeTemplate.replace( QString("$(NUMOBJECTS)"), QString().setNum(objIds.size()));
     res = writeFileIfDiffrent( flightOutputPath.absolutePath() + "/uavobjectsinit.h",
                      flightInitIncludeTemplate );
     if (!res) {
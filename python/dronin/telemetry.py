@@ -26,7 +26,8 @@ class TelemetryBase(with_metaclass(ABCMeta)):
 
     def __init__(self, githash=None, service_in_iter=True,
             iter_blocks=True, use_walltime=True, do_handshaking=False,
-            gcs_timestamps=False, name=None, progress_callback=None):
+            gcs_timestamps=False, name=None, progress_callback=None,
+            compact=False):
 
         """Instantiates a telemetry instance.  Called only by derived classes.
          - githash: revision control id of the UAVO's used to communicate.
@@ -46,6 +47,8 @@ class TelemetryBase(with_metaclass(ABCMeta)):
          - name: a filename to store into .filename for legacy purposes
          - progress_callback: a function to call periodically with progress
              information
+         - compact: if true, the stream is a flight log in the compact format
+             rather than UAVTalk
         """
 
         uavo_defs = uavo_collection.UAVOCollection()
@@ -60,12 +63,16 @@ class TelemetryBase(with_metaclass(ABCMeta)):
         self.githash = githash
 
         self.uavo_defs = uavo_defs
-        self.uavtalk_generator = uavtalk.process_stream(uavo_defs,
-            use_walltime=use_walltime, gcs_timestamps=gcs_timestamps,
-            progress_callback=progress_callback,
-            ack_callback=self.gotack_callback,
-            nack_callback=self.gotnack_callback,
-            reqack_callback=self.reqack_callback)
+        if compact:
+            self.uavtalk_generator = uavtalk.process_compact_stream(uavo_defs,
+                progress_callback=progress_callback)
+        else:
+            self.uavtalk_generator = uavtalk.process_stream(uavo_defs,
+                use_walltime=use_walltime, gcs_timestamps=gcs_timestamps,
+                progress_callback=progress_callback,
+                ack_callback=self.gotack_callback,
+                nack_callback=self.gotnack_callback,
+                reqack_callback=self.reqack_callback)
 
         self.uavtalk_generator.send(None)
 
@@ -241,6 +248,16 @@ class TelemetryBase(with_metaclass(ABCMeta)):
         objs = []
 
         if frames == b'':
+            # Let the parser hand over anything it was holding back
+            try:
+                obj = self.uavtalk_generator.send(None)
+
+                while obj:
+                    objs.append(obj)
+                    obj = self.uavtalk_generator.send(b'')
+            except StopIteration:
+                pass
+
             self.eof = True
             self._close()
         else:
@@ -717,7 +734,8 @@ class FileTelemetry(TelemetryBase):
 
         if parse_header:
             # Check the header signature
-            #    First line is "dRonin git hash:" or "Tau Labs git hash:"
+            #    First line is "dRonin git hash:" or "Tau Labs git hash:",
+            #       or "dRonin compact log:" for the compact format
             #    Second line is the actual git hash
             #    Third line is the UAVO hash
             #    Fourth line is "##" (only from GCS)
@@ -725,12 +743,17 @@ class FileTelemetry(TelemetryBase):
             # Scan up to 100 "lines" looking for the signature, in case
             # there's garbage at the beginning of the log
             found = False
+            compact = False
 
             for i in range(100):
                 sig = self.f.readline()
                 if sig.endswith(b'dRonin git hash:\n') or sig.endswith(b'Tau Labs git hash:\n'):
                     found = True
                     break;
+                if sig.endswith(uavtalk.COMPACT_LOG_SIGNATURE):
+                    found = True
+                    compact = True
+                    break;
 
             if not found:
                 print("Source file does not have a recognized header signature")
@@ -752,6 +775,10 @@ class FileTelemetry(TelemetryBase):
             # miss first objects in telemetry-type streams
             # divider = self.f.readline()
 
+            if compact:
+                print("Log file is in the compact format")
+                kwargs['compact'] = True
+
             TelemetryBase.__init__(self, iter_blocks=True,
                 do_handshaking=False, githash=githash, use_walltime=False,
                 *args, **kwargs)
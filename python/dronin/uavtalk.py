@@ -17,7 +17,7 @@ except:
 
 import time
 
-__all__ = [ "send_object", "process_stream" ]
+__all__ = [ "send_object", "process_stream", "process_compact_stream" ]
 
 from six import int2byte, indexbytes, byte2int, iterbytes
 
@@ -35,6 +35,16 @@ header_fmt = Struct("<BBHL")
 logheader_fmt = Struct("<IQ")
 timestamp_fmt = Struct("<H")
 instance_fmt = Struct("<H")
+objid_fmt = Struct("<L")
+
+# First line of the header of logs in the compact format
+COMPACT_LOG_SIGNATURE = b'dRonin compact log:\n'
+
+# Framing of the blocks of records in compact logs
+COMPACT_BLOCK_SYNC = b'\xd5\x1c\xb7\x3a'
+COMPACT_END_KEY = 1
+compact_time_fmt = Struct("<I")
+compact_crc_fmt = Struct("<H")
 
 # CRC lookup table
 crc_table = [
@@ -295,6 +305,249 @@ def process_stream(uavo_defs, use_walltime=False, gcs_timestamps=None,
         if next_recv is not None and next_recv != '':
             pending_pieces.append(next_recv)
 
+class _ShortRecord(Exception):
+    """ The buffered data ends partway through a compact log block """
+    pass
+
+class _BadBlock(Exception):
+    """ A compact log block that can't be decoded or fails its CRC """
+    pass
+
+def _read_varint(buf, offset):
+    """ Reads a little-endian base 128 varint, returning (value, new offset) """
+    value = 0
+    shift = 0
+
+    while True:
+        if offset >= len(buf):
+            raise _ShortRecord()
+
+        if shift >= 35:
+            raise _BadBlock("varint too long")
+
+        b = indexbytes(buf, offset)
+        offset += 1
+
+        value |= (b & 0x7f) << shift
+        shift += 7
+
+        if not (b & 0x80):
+            return (value, offset)
+
+def _decode_compact_block(uavo_defs, buf, start, objs):
+    """Decodes the compact log block whose sync is at start, appending the
+    objects in it to objs.  Returns the offset just past the block; raises
+    _ShortRecord if buf ends before the block does and _BadBlock if it is
+    damaged."""
+
+    pos = start + len(COMPACT_BLOCK_SYNC)
+
+    if pos + compact_time_fmt.size > len(buf):
+        raise _ShortRecord()
+    timestamp = compact_time_fmt.unpack_from(buf, pos)[0]
+    pos += compact_time_fmt.size
+
+    # code -> [objId, instance id, length, data last logged]
+    codes = {}
+
+    while True:
+        (key, pos) = _read_varint(buf, pos)
+
+        if key == COMPACT_END_KEY:
+            if pos + compact_crc_fmt.size > len(buf):
+                raise _ShortRecord()
+
+            crc = compact_crc_fmt.unpack_from(buf, pos)[0]
+            if crc != calcCRC16(buf[start:pos]):
+                raise _BadBlock("bad CRC")
+
+            return pos + compact_crc_fmt.size
+
+        code = key >> 1
+        is_delta = key & 1
+
+        if code == 0:
+            (code, pos) = _read_varint(buf, pos)
+
+            if pos + objid_fmt.size > len(buf):
+                raise _ShortRecord()
+            objId = objid_fmt.unpack_from(buf, pos)[0]
+            pos += objid_fmt.size
+
+            (instance_id, pos) = _read_varint(buf, pos)
+            (length, pos) = _read_varint(buf, pos)
+
+            entry = [objId, instance_id, length, None]
+        elif code in codes:
+            entry = codes[code]
+        else:
+            raise _BadBlock("undefined code %d"%(code))
+
+        (dt, pos) = _read_varint(buf, pos)
+
+        (objId, instance_id, length, last) = entry
+
+        if is_delta:
+            (runs_length, pos) = _read_varint(buf, pos)
+
+            if pos + runs_length > len(buf):
+                raise _ShortRecord()
+
+            if last is None:
+                raise _BadBlock("delta without a base for code %d"%(code))
+
+            data = bytearray(last)
+            end = pos + runs_length
+
+            while pos < end:
+                if pos + 2 > end:
+                    raise _BadBlock("truncated delta run")
+
+                run_offset = indexbytes(buf, pos)
+                run_length = indexbytes(buf, pos + 1)
+
+                if run_offset + run_length > length or pos + 2 + run_length > end:
+                    raise _BadBlock("delta run past the end of the object")
+
+                data[run_offset:run_offset + run_length] = buf[pos + 2:pos + 2 + run_length]
+                pos += 2 + run_length
+
+            data = bytes(data)
+        else:
+            if pos + length > len(buf):
+                raise _ShortRecord()
+
+            data = buf[pos:pos + length]
+            pos += length
+
+        if key >> 1 == 0 and code != 0:
+            codes[code] = entry
+        entry[3] = data
+
+        timestamp += dt
+
+        uavo_key = '{0:08x}'.format(objId)
+        obj = uavo_defs.get(uavo_key)
+
+        if obj is None or obj.get_size_of_data() != length:
+            # Unknown or different object; the length still lets us skip it
+            continue
+
+        if obj._single:
+            instance_id = None
+
+        objs.append(obj.from_bytes(data, timestamp & 0xffffffff, instance_id))
+
+def process_compact_stream(uavo_defs, progress_callback=None):
+    """Generator function that parses the records of a log in the compact
+    format, which the flight side writes when LoggingSettings.Format is
+    Compact or CompactDelta.  The header must already have been consumed.
+
+    The records come in blocks: COMPACT_BLOCK_SYNC, a uint32 of
+    milliseconds, the records, a varint COMPACT_END_KEY and a CRC-16-CCITT
+    of the block.  Each record is a varint key (code << 1, bit 0 set for a
+    delta), a definition when the code is 0 (varint code, uint32 object id,
+    varint instance id, varint length), a varint of milliseconds since the
+    previous record, then either the object data or a varint length of
+    (offset, length, bytes) runs to apply to the data last logged under the
+    code.  Codes are defined afresh in each block, so a damaged block is
+    skipped and decoding carries on with the next.
+
+    Driven the same way as process_stream."""
+
+    received = 0
+
+    buf = b''
+    buf_offset = 0
+
+    past_bytes = 0
+
+    ended = False
+    synced = True
+    lost = 0
+
+    while True:
+        start = buf.find(COMPACT_BLOCK_SYNC, buf_offset)
+
+        objs = []
+        end = None
+        short = False
+
+        if start < 0:
+            # Anything but the start of a sync is what's left of a damaged
+            # block
+            keep = len(buf) - len(COMPACT_BLOCK_SYNC) + 1
+            if ended:
+                keep = len(buf)
+
+            if keep > buf_offset:
+                if synced:
+                    lost += 1
+                synced = False
+                buf_offset = keep
+
+            short = True
+        else:
+            if start != buf_offset:
+                if synced:
+                    lost += 1
+                synced = False
+                buf_offset = start
+
+            try:
+                end = _decode_compact_block(uavo_defs, buf, start, objs)
+            except _ShortRecord:
+                if not ended:
+                    short = True
+                elif buf.find(COMPACT_BLOCK_SYNC, start + 1) < 0:
+                    # The last block, cut short with the power; keep what
+                    # there is of it
+                    end = len(buf)
+            except _BadBlock as e:
+                print("Damaged block at %d: %s"%(past_bytes + start, e))
+
+            if end is None and not short:
+                # Look for the next block from just past this sync
+                if synced:
+                    lost += 1
+                synced = False
+                buf_offset = start + 1
+                continue
+
+        if short:
+            if ended:
+                if lost:
+                    print("Left %d damaged parts out of the log"%(lost))
+                return
+
+            rx = yield None
+
+            if rx is None:
+                ended = True
+            else:
+                past_bytes += buf_offset
+                buf = buf[buf_offset:] + rx
+                buf_offset = 0
+
+            continue
+
+        synced = True
+        buf_offset = end
+
+        for objInstance in objs:
+            received += 1
+            if not (received % 10000):
+                if progress_callback is not None:
+                    progress_callback(received, past_bytes + buf_offset)
+                print("received %d objs"%(received))
+
+            next_recv = yield objInstance
+
+            if next_recv is None:
+                ended = True
+            elif next_recv != '':
+                buf = buf + next_recv
+
 def send_object(obj, req_ack=False):
     """Generates a string containing a UAVTalk packet describing this object"""
 
@@ -331,6 +584,23 @@ def acknowledge_object(obj):
 
     return packet
 
+def calcCRC16(s):
+    """
+    CRC-16-CCITT (poly 0x1021, initial value 0), as PIOS_CRC16_CCITT_updateCRC
+    """
+
+    cs = 0
+
+    for c in iterbytes(s):
+        cs ^= c << 8
+        for i in range(8):
+            if cs & 0x8000:
+                cs = ((cs << 1) ^ 0x1021) & 0xffff
+            else:
+                cs = (cs << 1) & 0xffff
+
+    return cs
+
 def calcCRC(s):
     """
     Calculate a CRC consistently with how they are computed on the firmware side